@@ -1,77 +1,62 @@
 #include "acs712.h"
 #include "esp_log.h"
-#include "esp_adc/adc_oneshot.h"
-#include "driver/gpio.h"
+#include "adc_sampler.h"
+#include "adc_cal.h"
 #include "voltage.h"
-#include "freertos/FreeRTOS.h"
+#include "power_meter.h"
 
 namespace acs712 {
     const char *TAG = "acs712";
-    adc_oneshot_unit_handle_t adc_handle = nullptr;
     adc_channel_t adc_channel = ADC_CHANNEL_5;
-    const float sensitivity = 0.066;
-    const float v_ref = 3.3;
-    float zero_current_voltage = v_ref / 2;
+    const int32_t sensitivity_mv_per_a = 66;  // ACS712-30A
+    const int32_t zero_current_mv = 1650;     // Выход при нулевом токе (Vcc / 2)
     const float default_voltage = 12.8;
     bool initialized = false;
 
     void init() {
         if (initialized) return;
-        adc_oneshot_unit_handle_t voltage_handle = voltage::getAdcHandle();  // Из [11]
-        if (voltage_handle != nullptr) {
-            adc_handle = voltage_handle;
-        } else {
-            adc_oneshot_unit_init_cfg_t unit_config = {
-                .unit_id = ADC_UNIT_1,
-                .clk_src = ADC_DIGI_CLK_SRC_DEFAULT,
-                .ulp_mode = ADC_ULP_MODE_DISABLE
-            };
-            esp_err_t err = adc_oneshot_new_unit(&unit_config, &adc_handle);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "ADC init failed: %d", err);
-                vTaskDelay(100 / portTICK_PERIOD_MS);  // Дополнительная задержка
-                return;
-            }
-        }
-        adc_oneshot_chan_cfg_t config = {
-            .atten = ADC_ATTEN_DB_12,
-            .bitwidth = ADC_BITWIDTH_12
-        };
-        esp_err_t err = adc_oneshot_config_channel(adc_handle, adc_channel, &config);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "ADC channel config failed: %d", err);
+        // Канал сканируется adc_sampler через DMA; порядок с другими датчиками не важен
+        if (!adc_sampler::registerChannel(adc_channel, ADC_ATTEN_DB_12, adc_sampler::DEFAULT_CHANNEL_RATE_HZ)) {
+            ESP_LOGE(TAG, "Failed to register ADC channel");
+            return;
         }
         initialized = true;
         ESP_LOGI(TAG, "ACS712 initialized successfully");
     }
 
-    float readCurrent() {
+    int32_t readMilliamps() {
         if (!initialized) init();
-        int raw_value;
-        esp_err_t err = adc_oneshot_read(adc_handle, adc_channel, &raw_value);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "ADC read failed: %d, returning 0", err);
-            vTaskDelay(50 / portTICK_PERIOD_MS);  // Задержка для избежания блокировки
-            return 0.0;
+        int32_t filtered;
+        if (!adc_sampler::latestFiltered(adc_channel, &filtered)) {
+            ESP_LOGD(TAG, "No ADC data yet, returning 0");
+            return 0;
         }
-        float voltage = ((float)raw_value / 4095.0) * v_ref;
-        float current = (voltage - zero_current_voltage) / sensitivity;
-        vTaskDelay(50 / portTICK_PERIOD_MS);
-        return current;
+        return millivoltsToMilliamps(adc_cal::toMillivolts(adc_cal::CURRENT_PIN, filtered));
+    }
+
+    int32_t millivoltsToMilliamps(int32_t mv) {
+        return (mv - zero_current_mv) * 1000 / sensitivity_mv_per_a;
+    }
+
+    int32_t milliampsToMillivolts(int32_t ma) {
+        return zero_current_mv + ma * sensitivity_mv_per_a / 1000;
+    }
+
+    float readCurrent() {
+        return readMilliamps() / 1000.0f;
     }
 
     float readPower() {
+        power_meter::Result result;
+        if (power_meter::latest(&result)) {
+            return result.real_mw / 1000.0f;
+        }
         float current = readCurrent();
         float volt = default_voltage;
-        if (voltage::getAdcHandle() != nullptr) {
+        if (voltage::isInitialized()) {
             volt = voltage::readVoltage(true);
         }
         float power = current * volt;
-        vTaskDelay(50 / portTICK_PERIOD_MS);
         return power;
     }
-
-    adc_oneshot_unit_handle_t getAdcHandle() {
-        return adc_handle;
-    }
-}
\ No newline at end of file
+}
@@ -1,7 +1,7 @@
 #ifndef ACS712_H
 #define ACS712_H
 
-#include "esp_adc/adc_oneshot.h"
+#include <cstdint>
 
 namespace acs712 {
     // Инициализация ADC для ACS712 (для измерения тока)
@@ -9,12 +9,15 @@ namespace acs712 {
     
     // Чтение тока в амперах
     float readCurrent();  
+    int32_t readMilliamps();  // То же в мА, без плавающей точки
+
+    // Пересчёт выхода датчика (мВ на выводе) в ток (мА)
+    int32_t millivoltsToMilliamps(int32_t mv);
+    int32_t milliampsToMillivolts(int32_t ma);   // Обратный пересчёт (пороги защиты)
     
-    // Чтение мощности в ваттах (использует voltage, если инициализирован, иначе дефолтное напряжение 5V)
+    // Чтение мощности в ваттах: активная мощность power_meter, если есть окно измерений,
+    // иначе произведение текущих значений (voltage, если инициализирован, иначе 12.8V)
     float readPower();  
-    
-    // Получение handle ADC для других модулей
-    adc_oneshot_unit_handle_t getAdcHandle();
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,218 @@
+#include "adc_cal.h"
+#include "adc_filter.h"
+#include "esp_log.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "nvs.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace adc_cal {
+    static const char* TAG = "adc_cal";
+    static const char* NVS_NAMESPACE = "adc_cal";
+    static const int32_t LINEAR_FULL_SCALE_MV = 3300;  // Без eFuse - прежнее приближение raw / 4095 * 3.3
+
+    struct TableInfo {
+        const char* name;
+        adc_channel_t channel;
+        bool divider;
+        int32_t linear_gain_ppm;   // Только без eFuse: прежние подобранные коэффициенты к линейной кривой
+    };
+
+    // 1.255/1.262 подбирались к грубому raw / 4095 * 3.3, которое не учитывает ослабление
+    // 12 дБ и смещение нуля конкретного чипа. Кривая eFuse уже даёт напряжение на выводе,
+    // поэтому на неё эти коэффициенты не накладываются (иначе поправка учлась бы дважды);
+    // остаточная погрешность платы снимается через gain/offset (adc_cal trim).
+
+    static const TableInfo TABLES[TABLE_COUNT] = {
+        { "pin",     ADC_CHANNEL_4, false, 1255000 },
+        { "divider", ADC_CHANNEL_4, true,  1262000 },
+        { "current", ADC_CHANNEL_5, false, 1000000 },
+    };
+
+    // Допустимые поправки: за пределами - опечатка или испорченная запись NVS
+    static const int32_t MIN_GAIN_PPM = 500000;
+    static const int32_t MAX_GAIN_PPM = 2000000;
+    static const int32_t MAX_OFFSET_MV = 1000;
+    static const uint32_t MAX_RESISTOR_OHM = 10000000;
+
+    static const Calibration DEFAULT_CALIBRATION = {
+        30000, 7500,
+        { 1000000, 1000000, 1000000 },
+        { 0, 0, 0 },
+    };
+
+    // 3 x 8 КБ; при перестроении читатели могут кратко увидеть смесь старых и новых значений
+    uint16_t tables[TABLE_COUNT][CODES];
+    static Calibration calibration = DEFAULT_CALIBRATION;
+    static bool calibrated = false;
+
+    static bool is_valid(const Calibration& value) {
+        if (value.r2_ohm == 0 || value.r2_ohm > MAX_RESISTOR_OHM || value.r1_ohm > MAX_RESISTOR_OHM) return false;
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            if (value.gain_ppm[t] < MIN_GAIN_PPM || value.gain_ppm[t] > MAX_GAIN_PPM) return false;
+            if (value.offset_mv[t] < -MAX_OFFSET_MV || value.offset_mv[t] > MAX_OFFSET_MV) return false;
+        }
+        return true;
+    }
+
+    // Ключи NVS: r1, r2, g_<таблица>, o_<таблица>
+    static void nvs_key(char* buf, size_t len, char prefix, Table table) {
+        snprintf(buf, len, "%c_%s", prefix, TABLES[table].name);
+    }
+
+    static void load_calibration() {
+        calibration = DEFAULT_CALIBRATION;
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+            ESP_LOGI(TAG, "No stored calibration, using defaults");
+            return;
+        }
+        nvs_get_u32(handle, "r1", &calibration.r1_ohm);
+        nvs_get_u32(handle, "r2", &calibration.r2_ohm);
+        char key[16];
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            nvs_key(key, sizeof(key), 'g', static_cast<Table>(t));
+            nvs_get_i32(handle, key, &calibration.gain_ppm[t]);
+            nvs_key(key, sizeof(key), 'o', static_cast<Table>(t));
+            nvs_get_i32(handle, key, &calibration.offset_mv[t]);
+        }
+        nvs_close(handle);
+        if (!is_valid(calibration)) {
+            ESP_LOGW(TAG, "Stored calibration out of range, using defaults");
+            calibration = DEFAULT_CALIBRATION;
+        }
+    }
+
+    static bool save_calibration() {
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to open NVS: %d", err);
+            return false;
+        }
+        nvs_set_u32(handle, "r1", calibration.r1_ohm);
+        nvs_set_u32(handle, "r2", calibration.r2_ohm);
+        char key[16];
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            nvs_key(key, sizeof(key), 'g', static_cast<Table>(t));
+            nvs_set_i32(handle, key, calibration.gain_ppm[t]);
+            nvs_key(key, sizeof(key), 'o', static_cast<Table>(t));
+            nvs_set_i32(handle, key, calibration.offset_mv[t]);
+        }
+        err = nvs_commit(handle);
+        nvs_close(handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to commit calibration: %d", err);
+            return false;
+        }
+        return true;
+    }
+
+    // Калибровка по eFuse для канала; NULL - схемы нет (чип без записанных коэффициентов)
+    static adc_cali_handle_t create_scheme(adc_channel_t channel) {
+        adc_cali_handle_t handle = NULL;
+        adc_cali_curve_fitting_config_t config = {};
+        config.unit_id = ADC_UNIT_1;
+        config.chan = channel;
+        config.atten = ADC_ATTEN_DB_12;
+        config.bitwidth = ADC_BITWIDTH_12;
+        esp_err_t err = adc_cali_create_scheme_curve_fitting(&config, &handle);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Curve fitting unavailable for channel %d: %d", (int)channel, err);
+            return NULL;
+        }
+        return handle;
+    }
+
+    static void build_tables() {
+        adc_cali_handle_t schemes[TABLE_COUNT] = {};
+        calibrated = true;
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            // Таблицы одного канала используют одну схему
+            for (int prev = 0; prev < t; prev++) {
+                if (TABLES[prev].channel == TABLES[t].channel) schemes[t] = schemes[prev];
+            }
+            if (!schemes[t]) schemes[t] = create_scheme(TABLES[t].channel);
+            if (!schemes[t]) calibrated = false;
+        }
+
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            int64_t num = calibration.gain_ppm[t];
+            int64_t den = 1000000;
+            if (TABLES[t].divider) {
+                num *= (int64_t)calibration.r1_ohm + calibration.r2_ohm;
+                den *= calibration.r2_ohm;
+            }
+            for (int raw = 0; raw < CODES; raw++) {
+                int pin_mv = 0;
+                if (!schemes[t] || adc_cali_raw_to_voltage(schemes[t], raw, &pin_mv) != ESP_OK) {
+                    const int64_t scale = (int64_t)(CODES - 1) * 1000000;
+                    pin_mv = (int)(((int64_t)raw * LINEAR_FULL_SCALE_MV * TABLES[t].linear_gain_ppm + scale / 2) / scale);
+                }
+                int64_t mv = (pin_mv * num + den / 2) / den + calibration.offset_mv[t];
+                if (mv < 0) mv = 0;
+                if (mv > UINT16_MAX) mv = UINT16_MAX;
+                tables[t][raw] = (uint16_t)mv;
+            }
+        }
+
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            bool shared = false;
+            for (int prev = 0; prev < t; prev++) shared |= schemes[prev] == schemes[t];
+            if (schemes[t] && !shared) adc_cali_delete_scheme_curve_fitting(schemes[t]);
+        }
+    }
+
+    void init() {
+        load_calibration();
+        build_tables();
+        ESP_LOGI(TAG, "ADC tables built (%s), R1=%" PRIu32 " R2=%" PRIu32 ", full scale divider %u mV",
+                 calibrated ? "eFuse curve fitting" : "linear", calibration.r1_ohm, calibration.r2_ohm,
+                 tables[VOLTAGE_DIVIDER][CODES - 1]);
+    }
+
+    bool isCalibrated() {
+        return calibrated;
+    }
+
+    int32_t toMillivolts(Table table, int32_t filtered) {
+        if (filtered <= 0) return tables[table][0];
+        int32_t index = filtered >> adc_filter::FRAC_BITS;
+        if (index >= CODES - 1) return tables[table][CODES - 1];
+        int32_t frac = filtered & ((1 << adc_filter::FRAC_BITS) - 1);
+        int32_t lo = tables[table][index];
+        int32_t hi = tables[table][index + 1];
+        return lo + (((hi - lo) * frac + (1 << (adc_filter::FRAC_BITS - 1))) >> adc_filter::FRAC_BITS);
+    }
+
+    Calibration getCalibration() {
+        return calibration;
+    }
+
+    bool setCalibration(const Calibration& value) {
+        if (!is_valid(value)) return false;
+        calibration = value;
+        build_tables();
+        return save_calibration();
+    }
+
+    void resetCalibration() {
+        setCalibration(DEFAULT_CALIBRATION);
+    }
+
+    const char* tableName(Table table) {
+        return TABLES[table].name;
+    }
+
+    bool tableFromName(const char* name, Table* table) {
+        for (int t = 0; t < TABLE_COUNT; t++) {
+            if (strcmp(name, TABLES[t].name) == 0) {
+                *table = static_cast<Table>(t);
+                return true;
+            }
+        }
+        return false;
+    }
+}
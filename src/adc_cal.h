@@ -0,0 +1,49 @@
+#ifndef ADC_CAL_H
+#define ADC_CAL_H
+
+#include <cstdint>
+
+// Перевод кодов ADC в милливольты: eFuse-калибровка (curve fitting) один раз
+// при инициализации сводится в таблицы на 4096 кодов, чтение - поиск в таблице.
+// Делитель R1/R2 и поправки хранятся в NVS и учитываются при построении таблиц.
+namespace adc_cal {
+    enum Table {
+        VOLTAGE_PIN,      // GPIO4, напряжение на выводе
+        VOLTAGE_DIVIDER,  // GPIO4, напряжение на входе делителя R1/R2
+        CURRENT_PIN,      // GPIO5, выход ACS712
+        TABLE_COUNT
+    };
+
+    struct Calibration {
+        uint32_t r1_ohm;
+        uint32_t r2_ohm;
+        int32_t gain_ppm[TABLE_COUNT];   // Поправочный множитель, 1000000 = 1.0
+        int32_t offset_mv[TABLE_COUNT];  // Смещение после множителя
+    };
+
+    void init();
+    bool isCalibrated();  // false - eFuse-калибровки нет, таблицы линейные (3300 мВ / 4095
+                          // с прежними коэффициентами 1.255 вывод / 1.262 делитель)
+
+    // filtered = raw << adc_filter::FRAC_BITS; линейная интерполяция между соседними кодами
+    int32_t toMillivolts(Table table, int32_t filtered);
+
+    Calibration getCalibration();
+    // Сохраняет в NVS и перестраивает таблицы; false - значения вне диапазона
+    // (gain 0.5..2.0, offset +-1000 мВ, R2 > 0, R1/R2 до 10 МОм) или ошибка NVS
+    bool setCalibration(const Calibration& calibration);
+    void resetCalibration();
+
+    const char* tableName(Table table);
+    bool tableFromName(const char* name, Table* table);
+
+    static const int CODES = 4096;
+    extern uint16_t tables[TABLE_COUNT][CODES];
+
+    // Сырой 12-битный код без интерполяции - для обработки каждого отсчёта
+    inline int32_t rawToMillivolts(Table table, int raw) {
+        return tables[table][raw & (CODES - 1)];
+    }
+}
+
+#endif
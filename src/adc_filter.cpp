@@ -0,0 +1,185 @@
+#include "adc_filter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace adc_filter {
+    struct StageName {
+        StageType type;
+        const char* name;
+    };
+
+    static const StageName STAGE_NAMES[] = {
+        { StageType::Decimate,      "dec" },
+        { StageType::MovingAverage, "ma" },
+        { StageType::Median,        "med" },
+        { StageType::Iir,           "iir" },
+    };
+
+    static bool valid(const StageConfig& config) {
+        switch (config.type) {
+            case StageType::Decimate:      return config.param >= 1 && config.param <= MAX_DECIMATE;
+            case StageType::MovingAverage: return config.param >= 1 && config.param <= MAX_WINDOW;
+            case StageType::Median:        return config.param >= 1 && config.param <= MAX_MEDIAN && (config.param & 1);
+            case StageType::Iir:           return config.param >= 1 && config.param <= MAX_IIR_SHIFT;
+        }
+        return false;
+    }
+
+    bool validate(const StageConfig* stages, size_t count) {
+        if (count > MAX_STAGES) return false;
+        for (size_t i = 0; i < count; i++) {
+            if (!valid(stages[i])) return false;
+        }
+        return true;
+    }
+
+    bool configure(Chain& chain, const StageConfig* stages, size_t count) {
+        if (!validate(stages, count)) return false;
+        for (size_t i = 0; i < count; i++) {
+            chain.stages[i].config = stages[i];
+        }
+        chain.count = count;
+        reset(chain);
+        return true;
+    }
+
+    void reset(Chain& chain) {
+        for (size_t i = 0; i < chain.count; i++) {
+            Stage& s = chain.stages[i];
+            s.count = 0;
+            s.pos = 0;
+            s.acc = 0;
+        }
+    }
+
+    // Деление с округлением до ближайшего (для отрицательных - симметрично)
+    static int32_t div_round(int64_t num, int32_t den) {
+        return (int32_t)(num >= 0 ? (num + den / 2) / den : (num - den / 2) / den);
+    }
+
+    static bool decimate(Stage& s, int32_t x, int32_t* y) {
+        s.acc += x;
+        if (++s.count < s.config.param) return false;
+        *y = div_round(s.acc, s.config.param);
+        s.acc = 0;
+        s.count = 0;
+        return true;
+    }
+
+    static int32_t moving_average(Stage& s, int32_t x) {
+        uint32_t n = s.config.param;
+        if (s.count < n) {
+            s.count++;
+        } else {
+            s.acc -= s.window[s.pos];
+        }
+        s.window[s.pos] = x;
+        s.acc += x;
+        s.pos = (s.pos + 1) % n;
+        return div_round(s.acc, (int32_t)s.count);
+    }
+
+    static int32_t median(Stage& s, int32_t x) {
+        uint32_t n = s.config.param;
+        s.window[s.pos] = x;
+        s.pos = (s.pos + 1) % n;
+        if (s.count < n) s.count++;
+
+        // Вставками по копии окна: N <= 9, дешевле любой кучи
+        int32_t sorted[MAX_MEDIAN];
+        for (uint32_t i = 0; i < s.count; i++) {
+            int32_t v = s.window[i];
+            uint32_t j = i;
+            while (j > 0 && sorted[j - 1] > v) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        return sorted[s.count / 2];
+    }
+
+    static int32_t iir(Stage& s, int32_t x) {
+        // acc = y << K; первый отсчёт инициализирует состояние, чтобы не было разгона от нуля
+        int shift = s.config.param;
+        if (s.count == 0) {
+            s.acc = (int64_t)x << shift;
+            s.count = 1;
+        } else {
+            s.acc += x - (s.acc >> shift);
+        }
+        return (int32_t)((s.acc + ((int64_t)1 << (shift - 1))) >> shift);
+    }
+
+    bool push(Chain& chain, int32_t raw, int32_t* out) {
+        int32_t x = raw << FRAC_BITS;
+        for (size_t i = 0; i < chain.count; i++) {
+            Stage& s = chain.stages[i];
+            switch (s.config.type) {
+                case StageType::Decimate:
+                    if (!decimate(s, x, &x)) return false;
+                    break;
+                case StageType::MovingAverage:
+                    x = moving_average(s, x);
+                    break;
+                case StageType::Median:
+                    x = median(s, x);
+                    break;
+                case StageType::Iir:
+                    x = iir(s, x);
+                    break;
+            }
+        }
+        *out = x;
+        return true;
+    }
+
+    bool parse(const char* spec, StageConfig* stages, size_t* count) {
+        size_t n = 0;
+        const char* p = spec;
+        while (*p) {
+            while (*p == ' ' || *p == ',') p++;
+            if (!*p) break;
+            if (n == MAX_STAGES) return false;
+
+            const char* colon = strchr(p, ':');
+            if (!colon) return false;
+            size_t name_len = colon - p;
+            bool found = false;
+            for (const auto& entry : STAGE_NAMES) {
+                if (strlen(entry.name) == name_len && strncmp(p, entry.name, name_len) == 0) {
+                    stages[n].type = entry.type;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) return false;
+
+            char* end;
+            long param = strtol(colon + 1, &end, 10);
+            if (end == colon + 1 || param < 1 || param > 255) return false;
+            stages[n].param = (uint8_t)param;
+            if (!valid(stages[n])) return false;
+            n++;
+            p = end;
+            if (*p && *p != ',' && *p != ' ') return false;
+        }
+        *count = n;
+        return true;
+    }
+
+    void format(const StageConfig* stages, size_t count, char* buf, size_t len) {
+        size_t pos = 0;
+        buf[0] = '\0';
+        for (size_t i = 0; i < count && pos < len; i++) {
+            const char* name = "?";
+            for (const auto& entry : STAGE_NAMES) {
+                if (entry.type == stages[i].type) name = entry.name;
+            }
+            int written = snprintf(buf + pos, len - pos, "%s%s:%u", i ? "," : "", name, (unsigned)stages[i].param);
+            if (written < 0) break;
+            pos += written;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef ADC_FILTER_H
+#define ADC_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Цепочка фильтров для отсчётов ADC в целочисленной арифметике (у ESP32-C6 нет FPU).
+// Внутри цепочки значения хранятся как raw << FRAC_BITS, чтобы не терять
+// разрядность, полученную передискретизацией и усреднением.
+// Без зависимостей от ESP-IDF - собирается и на хосте (tools/adc_filter_trace.cpp).
+namespace adc_filter {
+    static const int FRAC_BITS = 4;
+    static const size_t MAX_STAGES = 5;
+    static const size_t MAX_WINDOW = 64;   // Скользящее среднее
+    static const size_t MAX_MEDIAN = 9;    // Медиана, нечётное N
+    static const int MAX_IIR_SHIFT = 8;    // alpha = 2^-shift
+    static const size_t MAX_DECIMATE = 64;
+
+    enum class StageType : uint8_t {
+        Decimate,       // dec:N - среднее N отсчётов, один выход на N входов
+        MovingAverage,  // ma:N  - скользящее среднее по N выходам
+        Median,         // med:N - медиана N последних (отсев выбросов)
+        Iir,            // iir:K - однополюсный ФНЧ, y += (x - y) / 2^K
+    };
+
+    struct StageConfig {
+        StageType type;
+        uint8_t param;
+    };
+
+    struct Stage {
+        StageConfig config;
+        uint32_t count;            // Заполненность окна / счётчик децимации
+        uint32_t pos;
+        int64_t acc;               // Сумма окна / аккумулятор IIR
+        int32_t window[MAX_WINDOW];
+    };
+
+    struct Chain {
+        Stage stages[MAX_STAGES];
+        size_t count;
+    };
+
+    bool validate(const StageConfig* stages, size_t count);
+
+    // false - неверные параметры (цепочка не меняется)
+    bool configure(Chain& chain, const StageConfig* stages, size_t count);
+    void reset(Chain& chain);
+
+    // Один сырой отсчёт; true и *out (raw << FRAC_BITS), если на выходе есть значение
+    bool push(Chain& chain, int32_t raw, int32_t* out);
+
+    // Разбор/печать описания цепочки: "med:3,dec:8,ma:16,iir:2"; пустая строка - без фильтров
+    bool parse(const char* spec, StageConfig* stages, size_t* count);
+    void format(const StageConfig* stages, size_t count, char* buf, size_t len);
+}
+
+#endif
@@ -0,0 +1,541 @@
+#include "adc_sampler.h"
+#include "esp_adc/adc_monitor.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <inttypes.h>
+#include <string.h>
+
+namespace adc_sampler {
+    static const char* TAG = "adc_sampler";
+
+    // По умолчанию: отсев одиночных выбросов, децимация 10 кГц -> 1.25 кГц, среднее за ~13 мс
+    static const adc_filter::StageConfig DEFAULT_FILTER[] = {
+        { adc_filter::StageType::Median, 3 },
+        { adc_filter::StageType::Decimate, 8 },
+        { adc_filter::StageType::MovingAverage, 16 },
+    };
+
+    // Кадр DMA: 128 результатов; при 20 кГц шаблона задача просыпается ~156 раз в секунду
+    static const uint32_t FRAME_RESULTS = 128;
+    static const uint32_t FRAME_BYTES = FRAME_RESULTS * SOC_ADC_DIGI_RESULT_BYTES;
+    static const uint32_t POOL_BYTES = FRAME_BYTES * 4;
+
+    struct Channel {
+        adc_channel_t id;
+        adc_atten_t atten;
+        uint32_t requested_hz;   // Запрошенная частота
+        uint32_t effective_hz;   // Фактическая, по построенному шаблону
+        uint16_t ring[RING_SIZE];
+        uint32_t written;        // Всего записано (индекс = written % RING_SIZE)
+        volatile int32_t latest; // Выход цепочки фильтров (raw << FRAC_BITS), -1 - ещё нет данных
+        adc_filter::Chain chain; // Состояние фильтров - только задача выборки
+        adc_filter::StageConfig config[adc_filter::MAX_STAGES];
+        size_t config_count;
+        bool config_pending;     // Под ring_lock; задача применяет перед следующим кадром
+    };
+
+    static const size_t MAX_LISTENERS = 4;
+
+    struct Listener {
+        FrameListener fn;
+        void* ctx;
+    };
+
+    static Channel channels[MAX_CHANNELS];
+    static adc_channel_t channel_ids[MAX_CHANNELS];  // Для Frame::ids
+    static size_t channel_count = 0;
+    static Listener listeners[MAX_LISTENERS];
+    static volatile size_t listener_count = 0;
+    static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+    static adc_continuous_handle_t handle = NULL;
+    static TaskHandle_t task_handle = NULL;
+    static volatile bool running = false;
+    static bool enabled = false;                 // init() вызван; регистрация перезапускает выборку
+    static SemaphoreHandle_t config_lock = NULL; // Регистрация/запуск/остановка; создаётся в init()
+    static SemaphoreHandle_t task_exited = NULL; // Задача выборки больше не обращается к драйверу
+    static const int STOP_ATTEMPTS = 5;          // По 1 с ожидания задачи при остановке
+
+    struct Monitor {
+        adc_channel_t channel;
+        int32_t high;
+        int32_t low;
+        MonitorCallback callback;   // NULL - монитор не нужен
+        void* ctx;
+    };
+    static Monitor monitor = {};                 // Под config_lock
+    static adc_monitor_handle_t monitor_handle = NULL;
+    static Stats stats;
+
+    static int channel_index(adc_channel_t channel) {
+        for (size_t i = 0; i < channel_count; i++) {
+            if (channel_ids[i] == channel) return (int)i;
+        }
+        return -1;
+    }
+
+    static bool lock_config() {
+        if (!config_lock) {
+            ESP_LOGE(TAG, "ADC sampler not initialized");
+            return false;
+        }
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        return true;
+    }
+
+    static void unlock_config() {
+        xSemaphoreGive(config_lock);
+    }
+
+    static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t, const adc_continuous_evt_data_t*, void*) {
+        BaseType_t woken = pdFALSE;
+        if (task_handle) vTaskNotifyGiveFromISR(task_handle, &woken);
+        return woken == pdTRUE;
+    }
+
+    static bool IRAM_ATTR on_monitor_high(adc_monitor_handle_t, const adc_monitor_evt_data_t*, void*) {
+        return monitor.callback(true, monitor.ctx);
+    }
+
+    static bool IRAM_ATTR on_monitor_low(adc_monitor_handle_t, const adc_monitor_evt_data_t*, void*) {
+        return monitor.callback(false, monitor.ctx);
+    }
+
+    static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t, const adc_continuous_evt_data_t*, void*) {
+        stats.overflows++;
+        return false;
+    }
+
+    // Применяет новую цепочку, если она была задана через setFilter
+    static void apply_pending_filter(Channel& ch) {
+        adc_filter::StageConfig config[adc_filter::MAX_STAGES];
+        size_t count = 0;
+        bool pending;
+        portENTER_CRITICAL(&ring_lock);
+        pending = ch.config_pending;
+        if (pending) {
+            count = ch.config_count;
+            memcpy(config, ch.config, sizeof(config));
+            ch.config_pending = false;
+        }
+        portEXIT_CRITICAL(&ring_lock);
+        if (pending) adc_filter::configure(ch.chain, config, count);
+    }
+
+    // Разбор кадра: отсчёты в кольца, затем через цепочку фильтров в latest
+    static void process_frame(const uint8_t* frame, uint32_t len) {
+        static uint16_t values[MAX_CHANNELS][FRAME_RESULTS];
+        uint32_t count[MAX_CHANNELS] = {};
+
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t* out = reinterpret_cast<const adc_digi_output_data_t*>(frame + i);
+            int idx = channel_index(static_cast<adc_channel_t>(out->type2.channel));
+            if (idx < 0 || out->type2.unit != 0 || count[idx] == FRAME_RESULTS) {
+                stats.invalid++;
+                continue;
+            }
+            values[idx][count[idx]++] = out->type2.data;
+        }
+
+        portENTER_CRITICAL(&ring_lock);
+        for (size_t c = 0; c < channel_count; c++) {
+            Channel& ch = channels[c];
+            for (uint32_t i = 0; i < count[c]; i++) {
+                ch.ring[ch.written & (RING_SIZE - 1)] = values[c][i];
+                ch.written++;
+            }
+        }
+        portEXIT_CRITICAL(&ring_lock);
+
+        for (size_t c = 0; c < channel_count; c++) {
+            Channel& ch = channels[c];
+            apply_pending_filter(ch);
+            int32_t filtered;
+            bool updated = false;
+            for (uint32_t i = 0; i < count[c]; i++) {
+                if (adc_filter::push(ch.chain, values[c][i], &filtered)) updated = true;
+            }
+            if (updated) ch.latest = filtered;
+            stats.samples += count[c];
+        }
+
+        const uint16_t* samples[MAX_CHANNELS];
+        for (size_t c = 0; c < channel_count; c++) samples[c] = values[c];
+        Frame parsed = { channel_count, channel_ids, samples, count };
+        for (size_t i = 0; i < listener_count; i++) {
+            listeners[i].fn(parsed, listeners[i].ctx);
+        }
+        stats.frames++;
+    }
+
+    static void sampler_task(void* pvParameters) {
+        static uint8_t frame[FRAME_BYTES];
+        while (running) {
+            ulTaskNotifyTake(pdTRUE, 100 / portTICK_PERIOD_MS);
+            uint32_t len = 0;
+            // Вычитываем всё накопленное, без ожидания
+            while (running && adc_continuous_read(handle, frame, FRAME_BYTES, &len, 0) == ESP_OK) {
+                process_frame(frame, len);
+            }
+        }
+        task_handle = NULL;
+        xSemaphoreGive(task_exited);
+        vTaskDelete(NULL);
+    }
+
+    // Шаблон сканирования: каждому каналу - число слотов, пропорциональное частоте
+    // (не больше SOC_ADC_PATT_LEN_MAX в сумме), слоты перемешаны плавным взвешенным
+    // round-robin, чтобы отсчёты канала шли равномерно. Частота шаблона - минимальная,
+    // при которой каждый канал получает не меньше запрошенного.
+    static size_t build_pattern(adc_digi_pattern_config_t* pattern, uint32_t* freq_hz) {
+        uint32_t weights[MAX_CHANNELS];
+        uint32_t min_rate = UINT32_MAX;
+        for (size_t c = 0; c < channel_count; c++) {
+            if (channels[c].requested_hz < min_rate) min_rate = channels[c].requested_hz;
+        }
+        uint32_t total = 0;
+        for (size_t c = 0; c < channel_count; c++) {
+            weights[c] = (channels[c].requested_hz + min_rate / 2) / min_rate;
+            total += weights[c];
+        }
+        while (total > SOC_ADC_PATT_LEN_MAX) {
+            // Ужимаем самый тяжёлый канал, пока шаблон не поместится
+            size_t heaviest = 0;
+            for (size_t c = 1; c < channel_count; c++) {
+                if (weights[c] > weights[heaviest]) heaviest = c;
+            }
+            weights[heaviest]--;
+            total--;
+        }
+
+        int32_t current[MAX_CHANNELS] = {};
+        for (uint32_t slot = 0; slot < total; slot++) {
+            size_t pick = 0;
+            for (size_t c = 0; c < channel_count; c++) {
+                current[c] += weights[c];
+                if (current[c] > current[pick]) pick = c;
+            }
+            current[pick] -= total;
+            pattern[slot].atten = channels[pick].atten;
+            pattern[slot].channel = channels[pick].id;
+            pattern[slot].unit = ADC_UNIT_1;
+            pattern[slot].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        }
+
+        uint64_t freq = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+        for (size_t c = 0; c < channel_count; c++) {
+            uint64_t need = ((uint64_t)channels[c].requested_hz * total + weights[c] - 1) / weights[c];
+            if (need > freq) freq = need;
+        }
+        if (freq > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) freq = SOC_ADC_SAMPLE_FREQ_THRES_HIGH;
+        *freq_hz = (uint32_t)freq;
+        for (size_t c = 0; c < channel_count; c++) {
+            channels[c].effective_hz = (uint32_t)(freq * weights[c] / total);
+        }
+        return total;
+    }
+
+    // Вызывается между adc_continuous_config и adc_continuous_start (драйвер в состоянии init)
+    static void attach_monitor() {
+        if (!monitor.callback || channel_index(monitor.channel) < 0) return;
+        adc_monitor_config_t config = {};
+        config.adc_unit = ADC_UNIT_1;
+        config.channel = monitor.channel;
+        config.h_threshold = monitor.high;
+        config.l_threshold = monitor.low;
+        esp_err_t err = adc_new_continuous_monitor(handle, &config, &monitor_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create ADC monitor: %d", err);
+            monitor_handle = NULL;
+            return;
+        }
+        adc_monitor_evt_cbs_t callbacks = {};
+        if (monitor.high >= 0) callbacks.on_over_high_thresh = on_monitor_high;
+        if (monitor.low >= 0) callbacks.on_below_low_thresh = on_monitor_low;
+        adc_continuous_monitor_register_event_callbacks(monitor_handle, &callbacks, NULL);
+        adc_continuous_monitor_enable(monitor_handle);
+        ESP_LOGI(TAG, "Monitor on channel %d: low %" PRId32 ", high %" PRId32,
+                 (int)monitor.channel, monitor.low, monitor.high);
+    }
+
+    static void detach_monitor() {
+        if (!monitor_handle) return;
+        adc_continuous_monitor_disable(monitor_handle);
+        adc_del_continuous_monitor(monitor_handle);
+        monitor_handle = NULL;
+    }
+
+    // Драйвер освобождается только после подтверждения выхода задачи: она может быть
+    // внутри adc_continuous_read. Без подтверждения handle остаётся (повтор - при
+    // следующей остановке), выборка не перезапускается
+    static bool stop_locked() {
+        if (!handle) return true;
+        running = false;
+        if (task_handle) xTaskNotifyGive(task_handle);
+        bool exited = false;
+        for (int attempt = 0; attempt < STOP_ATTEMPTS && !exited; attempt++) {
+            exited = xSemaphoreTake(task_exited, 1000 / portTICK_PERIOD_MS) == pdTRUE;
+            if (!exited) ESP_LOGW(TAG, "Waiting for the sampler task to exit");
+        }
+        if (!exited) {
+            ESP_LOGE(TAG, "Sampler task did not exit, ADC driver left allocated");
+            return false;
+        }
+        adc_continuous_stop(handle);
+        detach_monitor();
+        adc_continuous_deinit(handle);
+        handle = NULL;
+        ESP_LOGI(TAG, "ADC sampler stopped");
+        return true;
+    }
+
+    static void start_locked() {
+        if (running || handle || channel_count == 0) return;   // handle - остановка не завершилась
+
+        adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX] = {};
+        uint32_t rate_hz;
+        size_t pattern_len = build_pattern(pattern, &rate_hz);
+
+        adc_continuous_handle_cfg_t handle_config = {};
+        handle_config.max_store_buf_size = POOL_BYTES;
+        handle_config.conv_frame_size = FRAME_BYTES;
+        esp_err_t err = adc_continuous_new_handle(&handle_config, &handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create ADC continuous handle: %d", err);
+            handle = NULL;
+            return;
+        }
+
+        adc_continuous_config_t config = {};
+        config.pattern_num = pattern_len;
+        config.adc_pattern = pattern;
+        config.sample_freq_hz = rate_hz;
+        config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+        config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+        adc_continuous_config(handle, &config);
+
+        adc_continuous_evt_cbs_t callbacks = {};
+        callbacks.on_conv_done = on_conv_done;
+        callbacks.on_pool_ovf = on_pool_ovf;
+        adc_continuous_register_event_callbacks(handle, &callbacks, NULL);
+        attach_monitor();
+
+        memset(&stats, 0, sizeof(stats));
+        stats.rate_hz = rate_hz;
+        stats.pattern_len = pattern_len;
+        for (size_t c = 0; c < channel_count; c++) {
+            Channel& ch = channels[c];
+            ch.written = 0;
+            ch.latest = -1;
+            ch.config_pending = false;
+            adc_filter::configure(ch.chain, ch.config, ch.config_count);
+        }
+
+        running = true;
+        if (xTaskCreate(sampler_task, "adc_sampler", 3072, NULL, 10, &task_handle) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create sampler task");
+            running = false;
+            task_handle = NULL;
+            detach_monitor();
+            adc_continuous_deinit(handle);
+            handle = NULL;
+            return;
+        }
+        err = adc_continuous_start(handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start ADC sampling: %d", err);
+            stop_locked();
+            return;
+        }
+        for (size_t c = 0; c < channel_count; c++) {
+            ESP_LOGI(TAG, "Channel %d: requested %" PRIu32 " Hz, effective %" PRIu32 " Hz",
+                     (int)channels[c].id, channels[c].requested_hz, channels[c].effective_hz);
+        }
+        ESP_LOGI(TAG, "ADC sampler started: %u channels, %u slots, %" PRIu32 " Hz",
+                 (unsigned)channel_count, (unsigned)pattern_len, rate_hz);
+    }
+
+    bool registerChannel(adc_channel_t channel, adc_atten_t atten, uint32_t rate_hz) {
+        if (rate_hz == 0) rate_hz = DEFAULT_CHANNEL_RATE_HZ;
+        if (!lock_config()) return false;
+        int idx = channel_index(channel);
+        bool ok = true;
+        if (idx >= 0) {
+            Channel& ch = channels[idx];
+            if (ch.atten != atten) {
+                ESP_LOGE(TAG, "Channel %d already registered with attenuation %d", (int)channel, (int)ch.atten);
+                ok = false;
+            } else if (rate_hz > ch.requested_hz) {
+                // Шаблон меняется только при остановленной выборке
+                stop_locked();
+                ch.requested_hz = rate_hz;
+                if (enabled) start_locked();
+            }
+        } else if (channel_count == MAX_CHANNELS) {
+            ESP_LOGE(TAG, "No free ADC channel slots for channel %d", (int)channel);
+            ok = false;
+        } else {
+            stop_locked();
+            Channel& ch = channels[channel_count];
+            ch.id = channel;
+            ch.atten = atten;
+            ch.requested_hz = rate_hz;
+            ch.effective_hz = 0;
+            memcpy(ch.config, DEFAULT_FILTER, sizeof(DEFAULT_FILTER));
+            ch.config_count = sizeof(DEFAULT_FILTER) / sizeof(DEFAULT_FILTER[0]);
+            channel_ids[channel_count] = channel;
+            channel_count++;
+            ESP_LOGI(TAG, "Registered channel %d, %" PRIu32 " Hz", (int)channel, rate_hz);
+            if (enabled) start_locked();
+        }
+        unlock_config();
+        return ok;
+    }
+
+    bool setChannelRate(adc_channel_t channel, uint32_t rate_hz) {
+        if (rate_hz == 0) return false;
+        if (!lock_config()) return false;
+        int idx = channel_index(channel);
+        if (idx >= 0) {
+            stop_locked();
+            channels[idx].requested_hz = rate_hz;
+            if (enabled) start_locked();
+        }
+        unlock_config();
+        return idx >= 0;
+    }
+
+    uint32_t channelRate(adc_channel_t channel) {
+        int idx = channel_index(channel);
+        return idx >= 0 && running ? channels[idx].effective_hz : 0;
+    }
+
+    size_t registeredChannels(adc_channel_t* out, size_t max) {
+        if (!lock_config()) return 0;
+        size_t n = channel_count < max ? channel_count : max;
+        memcpy(out, channel_ids, n * sizeof(adc_channel_t));
+        unlock_config();
+        return n;
+    }
+
+    void init() {
+        if (!config_lock) {
+            config_lock = xSemaphoreCreateMutex();
+            task_exited = xSemaphoreCreateBinary();
+        }
+        lock_config();
+        enabled = true;
+        if (running) {
+            ESP_LOGW(TAG, "ADC sampler already running");
+        } else {
+            start_locked();
+        }
+        unlock_config();
+    }
+
+    void stop() {
+        if (!lock_config()) return;
+        enabled = false;
+        stop_locked();
+        unlock_config();
+    }
+
+    bool isRunning() {
+        return running;
+    }
+
+    bool latestFiltered(adc_channel_t channel, int32_t* value) {
+        int idx = channel_index(channel);
+        if (idx < 0 || !running) return false;
+        int32_t v = channels[idx].latest;
+        if (v < 0) return false;
+        *value = v;
+        return true;
+    }
+
+    bool latest(adc_channel_t channel, int* raw) {
+        int32_t value;
+        if (!latestFiltered(channel, &value)) return false;
+        *raw = (value + (1 << (adc_filter::FRAC_BITS - 1))) >> adc_filter::FRAC_BITS;
+        return true;
+    }
+
+    bool setFilter(adc_channel_t channel, const adc_filter::StageConfig* stages, size_t count) {
+        int idx = channel_index(channel);
+        if (idx < 0 || !adc_filter::validate(stages, count)) return false;
+
+        Channel& ch = channels[idx];
+        portENTER_CRITICAL(&ring_lock);
+        memcpy(ch.config, stages, count * sizeof(stages[0]));
+        ch.config_count = count;
+        ch.config_pending = true;
+        portEXIT_CRITICAL(&ring_lock);
+        return true;
+    }
+
+    bool getFilter(adc_channel_t channel, adc_filter::StageConfig* stages, size_t* count) {
+        int idx = channel_index(channel);
+        if (idx < 0) return false;
+        Channel& ch = channels[idx];
+        portENTER_CRITICAL(&ring_lock);
+        memcpy(stages, ch.config, ch.config_count * sizeof(stages[0]));
+        *count = ch.config_count;
+        portEXIT_CRITICAL(&ring_lock);
+        return true;
+    }
+
+    size_t copyRecent(adc_channel_t channel, uint16_t* out, size_t max) {
+        int idx = channel_index(channel);
+        if (idx < 0) return 0;
+        const Channel& ch = channels[idx];
+        portENTER_CRITICAL(&ring_lock);
+        size_t available = ch.written < RING_SIZE ? ch.written : RING_SIZE;
+        size_t n = available < max ? available : max;
+        uint32_t start = ch.written - n;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = ch.ring[(start + i) & (RING_SIZE - 1)];
+        }
+        portEXIT_CRITICAL(&ring_lock);
+        return n;
+    }
+
+    bool setMonitor(adc_channel_t channel, int32_t high_code, int32_t low_code, MonitorCallback callback, void* ctx) {
+        if (!callback || (high_code < 0 && low_code < 0)) return false;
+        if (!lock_config()) return false;
+        stop_locked();
+        monitor = { channel, high_code, low_code, callback, ctx };
+        if (enabled) start_locked();
+        unlock_config();
+        return true;
+    }
+
+    void clearMonitor() {
+        if (!lock_config()) return;
+        stop_locked();
+        monitor = {};
+        if (enabled) start_locked();
+        unlock_config();
+    }
+
+    bool monitorActive() {
+        return monitor_handle != NULL;
+    }
+
+    bool addListener(FrameListener listener, void* ctx) {
+        portENTER_CRITICAL(&ring_lock);
+        bool ok = listener_count < MAX_LISTENERS;
+        if (ok) {
+            listeners[listener_count].fn = listener;
+            listeners[listener_count].ctx = ctx;
+            listener_count = listener_count + 1;  // Публикуем после заполнения записи
+        }
+        portEXIT_CRITICAL(&ring_lock);
+        return ok;
+    }
+
+    Stats getStats() {
+        return stats;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include "esp_adc/adc_continuous.h"
+#include "adc_filter.h"
+#include <cstddef>
+#include <cstdint>
+
+// Владелец ADC1: непрерывная выборка через DMA (adc_continuous). Модули датчиков
+// регистрируют каналы с ослаблением и нужной частотой, менеджер строит из них один
+// шаблон сканирования; отсчёты складываются в кольцевые буферы каналов.
+namespace adc_sampler {
+    static const uint32_t DEFAULT_CHANNEL_RATE_HZ = 10000;
+    static const size_t MAX_CHANNELS = 4;
+    static const size_t RING_SIZE = 1024;           // Отсчётов на канал, степень двойки
+
+    // Регистрация - после init(), в любом порядке: при работающей выборке шаблон
+    // перестраивается. Повторная регистрация канала берёт большую из частот;
+    // ослабление должно совпадать.
+    bool registerChannel(adc_channel_t channel, adc_atten_t atten, uint32_t rate_hz);
+    bool setChannelRate(adc_channel_t channel, uint32_t rate_hz);  // Явная частота (консоль)
+    uint32_t channelRate(adc_channel_t channel);  // Фактическая частота канала в шаблоне, 0 - нет канала
+    size_t registeredChannels(adc_channel_t* out, size_t max);  // Каналы в порядке регистрации
+
+    void init();   // Создаёт блокировку и запускает выборку; вызывать до регистрации каналов
+    void stop();
+    bool isRunning();
+
+    // Последнее значение на выходе цепочки фильтров канала, без блокировки
+    bool latest(adc_channel_t channel, int* raw);                   // Округлённый код ADC
+    bool latestFiltered(adc_channel_t channel, int32_t* value);     // raw << adc_filter::FRAC_BITS
+
+    // Цепочка фильтров канала; новая цепочка применяется задачей выборки к следующему кадру
+    bool setFilter(adc_channel_t channel, const adc_filter::StageConfig* stages, size_t count);
+    bool getFilter(adc_channel_t channel, adc_filter::StageConfig* stages, size_t* count);
+
+    // Копирует до max последних сырых отсчётов канала (от старых к новым)
+    size_t copyRecent(adc_channel_t channel, uint16_t* out, size_t max);
+
+    // Разобранный кадр DMA: отсчёты зарегистрированных каналов. Каналы с равной частотой
+    // чередуются в шаблоне, поэтому их i-е отсчёты разнесены не больше чем на период шаблона.
+    struct Frame {
+        size_t channels;
+        const adc_channel_t* ids;
+        const uint16_t* const* samples;  // samples[c][i], сырые коды
+        const uint32_t* counts;
+    };
+    typedef void (*FrameListener)(const Frame& frame, void* ctx);
+
+    // Слушатели вызываются из задачи выборки на каждый кадр - без блокировок внутри
+    bool addListener(FrameListener listener, void* ctx);
+
+    // Аппаратный монитор порога (digital monitor ADC): каждое преобразование канала
+    // сравнивается с порогами в железе, обработчик вызывается из ISR драйвера -
+    // без ожидания кадра DMA. Пороги в сырых кодах, -1 - порог не используется.
+    // Монитор создаётся только при остановленной выборке: установка перезапускает её.
+    typedef bool (*MonitorCallback)(bool high, void* ctx);   // ISR; true - нужен переход в задачу
+    bool setMonitor(adc_channel_t channel, int32_t high_code, int32_t low_code, MonitorCallback callback, void* ctx);
+    void clearMonitor();
+    bool monitorActive();
+
+    struct Stats {
+        uint32_t rate_hz;        // Суммарная частота шаблона
+        uint32_t pattern_len;    // Слотов в шаблоне
+        uint32_t frames;         // Обработано кадров DMA
+        uint32_t samples;        // Принято отсчётов
+        uint32_t invalid;        // Отсчёты с чужим/неверным каналом
+        uint32_t overflows;      // Переполнения пула драйвера (потеря данных)
+    };
+    Stats getStats();
+}
+
+#endif
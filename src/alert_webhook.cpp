@@ -0,0 +1,103 @@
+#include "alert_webhook.h"
+#include "alerts.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace alert_webhook {
+    static const char* TAG = "alert_webhook";
+    static const char* NVS_NAMESPACE = "alerts";
+    static const char* NVS_KEY = "webhook";
+    static const int TIMEOUT_MS = 2000;
+
+    static char url[MAX_URL_LEN] = "";
+    static SemaphoreHandle_t url_mutex = NULL;
+
+    // Вызывается из задачи рассылки alerts - блокирующий запрос не задерживает выборку АЦП
+    static void push_event(const alerts::Event& event, const alerts::Rule& rule, void*) {
+        char target[MAX_URL_LEN];
+        getUrl(target, sizeof(target));
+        if (target[0] == '\0') return;
+
+        char body[160];
+        int len = snprintf(body, sizeof(body),
+                           "{\"seq\":%" PRIu32 ",\"rule\":\"%s\",\"active\":%s,\"value\":%" PRId32 ",\"threshold\":%" PRId32 ",\"time_us\":%lld}",
+                           event.seq, rule.name, event.active ? "true" : "false",
+                           event.value, rule.threshold, (long long)event.time_us);
+
+        esp_http_client_config_t config = {};
+        config.url = target;
+        config.method = HTTP_METHOD_POST;
+        config.timeout_ms = TIMEOUT_MS;
+        config.crt_bundle_attach = esp_crt_bundle_attach;   // https:// - проверка по встроенному набору корневых сертификатов
+        esp_http_client_handle_t client = esp_http_client_init(&config);
+        if (!client) {
+            ESP_LOGE(TAG, "Failed to create HTTP client");
+            return;
+        }
+        esp_http_client_set_header(client, "Content-Type", "application/json");
+        esp_http_client_set_post_field(client, body, len);
+        esp_err_t err = esp_http_client_perform(client);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "POST %s failed: %d", target, err);
+        } else {
+            int status = esp_http_client_get_status_code(client);
+            if (status >= 300) ESP_LOGW(TAG, "POST %s returned %d", target, status);
+        }
+        esp_http_client_cleanup(client);
+    }
+
+    void init() {
+        url_mutex = xSemaphoreCreateMutex();
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+            size_t len = sizeof(url);
+            if (nvs_get_str(handle, NVS_KEY, url, &len) != ESP_OK) url[0] = '\0';
+            nvs_close(handle);
+        }
+        alerts::subscribe(push_event, NULL, false, alerts::ACTION_PUSH);
+        if (url[0]) ESP_LOGI(TAG, "Webhook: %s", url);
+    }
+
+    bool setUrl(const char* value) {
+        if (!url_mutex) return false;   // До init(): адрес ещё не загружен из NVS
+        if (!value) value = "";
+        if (strlen(value) >= MAX_URL_LEN) return false;
+        if (value[0] && strncmp(value, "http://", 7) != 0 && strncmp(value, "https://", 8) != 0) return false;
+
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to open NVS: %d", err);
+            return false;
+        }
+        err = nvs_set_str(handle, NVS_KEY, value);
+        if (err == ESP_OK) err = nvs_commit(handle);
+        nvs_close(handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to save webhook: %d", err);
+            return false;
+        }
+
+        xSemaphoreTake(url_mutex, portMAX_DELAY);
+        snprintf(url, sizeof(url), "%s", value);
+        xSemaphoreGive(url_mutex);
+        return true;
+    }
+
+    void getUrl(char* buf, size_t len) {
+        if (!url_mutex) {
+            if (len) buf[0] = '\0';
+            return;
+        }
+        xSemaphoreTake(url_mutex, portMAX_DELAY);
+        snprintf(buf, len, "%s", url);
+        xSemaphoreGive(url_mutex);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef ALERT_WEBHOOK_H
+#define ALERT_WEBHOOK_H
+
+#include <cstddef>
+
+// Отправка событий alerts POST-запросом (JSON) на внешний URL.
+// URL хранится в NVS; пустой URL - отправка выключена.
+namespace alert_webhook {
+    static const size_t MAX_URL_LEN = 128;
+
+    void init();
+    bool setUrl(const char* url);   // NULL или "" - выключить; false до init()
+    void getUrl(char* buf, size_t len);  // До init() - пустая строка
+}
+
+#endif
@@ -0,0 +1,291 @@
+#include "alerts.h"
+#include "adc_sampler.h"
+#include "adc_cal.h"
+#include "acs712.h"
+#include "l298n.h"
+#include "motor_control.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <string.h>
+
+namespace alerts {
+    static const char* TAG = "alerts";
+    static const adc_channel_t VOLTAGE_CHANNEL = ADC_CHANNEL_4;
+    static const adc_channel_t CURRENT_CHANNEL = ADC_CHANNEL_5;
+    static const size_t MAX_SUBSCRIBERS = 6;
+    static const size_t HISTORY_SIZE = 32;
+    static const size_t QUEUE_LENGTH = 16;
+    static const uint32_t DISPATCH_STACK = 8192;  // Подписчик webhook выполняет HTTPS-запрос (mbedTLS) в этой задаче
+    static const int RATE_SMOOTHING_SHIFT = 3;  // EMA 1/8 перед дифференцированием
+
+    // Пороги для батареи 12.8 В (4S LiFePO4) и L298N (2 А на канал)
+    static Rule rules[] = {
+        { "undervoltage", Source::Voltage, Kind::Under, 11500, 300, 200, ACTION_LOG | ACTION_PUSH, true },
+        { "overvoltage",  Source::Voltage, Kind::Over,  14600, 200, 100, ACTION_LOG | ACTION_PUSH, true },
+        { "overcurrent",  Source::Current, Kind::Over,   2500, 300,  20, ACTION_LOG | ACTION_PUSH | ACTION_CUTOFF, true },
+        { "stall",        Source::Current, Kind::Over,   1800, 300, 500, ACTION_LOG | ACTION_PUSH | ACTION_CUTOFF, true },
+        { "voltage_sag",  Source::Voltage, Kind::Fall,   3000, 1000, 50, ACTION_LOG | ACTION_PUSH, true },
+    };
+    static const size_t RULE_COUNT = sizeof(rules) / sizeof(rules[0]);
+
+    struct RuleState {
+        bool active;
+        uint32_t pending_us;  // Сколько держится условие перехода
+    };
+
+    struct Subscription {
+        Subscriber fn;
+        void* ctx;
+        bool immediate;
+        uint8_t mask;
+    };
+
+    struct SourceState {
+        bool primed;
+        int64_t smoothed;     // Значение << RATE_SMOOTHING_SHIFT
+        int32_t rate;         // Единиц в секунду
+        int32_t value;
+    };
+
+    static RuleState states[RULE_COUNT];
+    static SourceState sources[2];
+    static Subscription subscribers[MAX_SUBSCRIBERS];
+    static volatile size_t subscriber_count = 0;
+    static Event history[HISTORY_SIZE];
+    static uint32_t event_seq = 0;
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    static QueueHandle_t queue = NULL;
+    static bool initialized = false;
+
+    static int32_t frame_millivolts(adc_cal::Table table, const uint16_t* samples, uint32_t n) {
+        int64_t sum = 0;
+        for (uint32_t k = 0; k < n; k++) sum += samples[k];
+        return adc_cal::toMillivolts(table, (int32_t)((sum << adc_filter::FRAC_BITS) / n));
+    }
+
+    static void update_source(SourceState& s, int32_t value, uint32_t dt_us) {
+        s.value = value;
+        int64_t scaled = (int64_t)value << RATE_SMOOTHING_SHIFT;
+        if (!s.primed) {
+            s.smoothed = scaled;
+            s.rate = 0;
+            s.primed = true;
+            return;
+        }
+        int64_t prev = s.smoothed;
+        s.smoothed += (scaled - s.smoothed) >> RATE_SMOOTHING_SHIFT;
+        s.rate = (int32_t)(((s.smoothed - prev) * 1000000 / dt_us) >> RATE_SMOOTHING_SHIFT);
+    }
+
+    // Условие срабатывания (для неактивного правила) или сброса (для активного)
+    static bool transition_condition(const Rule& rule, bool active, int32_t value, int32_t rate) {
+        switch (rule.kind) {
+            case Kind::Under: return active ? value > rule.threshold + rule.hysteresis : value < rule.threshold;
+            case Kind::Over:  return active ? value < rule.threshold - rule.hysteresis : value > rule.threshold;
+            case Kind::Fall:  return active ? -rate < rule.threshold - rule.hysteresis : -rate > rule.threshold;
+            case Kind::Rise:  return active ? rate < rule.threshold - rule.hysteresis : rate > rule.threshold;
+        }
+        return false;
+    }
+
+    static void emit(size_t index, bool active, int32_t value) {
+        Event event;
+        event.rule = (uint8_t)index;
+        event.active = active;
+        event.value = value;
+        event.time_us = esp_timer_get_time();
+        portENTER_CRITICAL(&lock);
+        event.seq = ++event_seq;
+        history[event.seq % HISTORY_SIZE] = event;
+        portEXIT_CRITICAL(&lock);
+
+        const Rule& rule = rules[index];
+        for (size_t i = 0; i < subscriber_count; i++) {
+            const Subscription& sub = subscribers[i];
+            if (sub.immediate && (rule.actions & sub.mask)) sub.fn(event, rule, sub.ctx);
+        }
+        if (queue && xQueueSend(queue, &event, 0) != pdTRUE) {
+            ESP_LOGW(TAG, "Event queue full, dropped event for %s", rule.name);
+        }
+    }
+
+    static void on_frame(const adc_sampler::Frame& frame, void*) {
+        int vc = -1, ic = -1;
+        for (size_t c = 0; c < frame.channels; c++) {
+            if (frame.ids[c] == VOLTAGE_CHANNEL) vc = (int)c;
+            if (frame.ids[c] == CURRENT_CHANNEL) ic = (int)c;
+        }
+        // Время кадра по числу отсчётов и частоте канала
+        uint32_t dt_us = 0;
+        if (vc >= 0 && frame.counts[vc]) {
+            uint32_t rate = adc_sampler::channelRate(VOLTAGE_CHANNEL);
+            if (rate) dt_us = (uint32_t)((uint64_t)frame.counts[vc] * 1000000 / rate);
+            update_source(sources[(int)Source::Voltage],
+                          frame_millivolts(adc_cal::VOLTAGE_DIVIDER, frame.samples[vc], frame.counts[vc]), dt_us ? dt_us : 1);
+        }
+        if (ic >= 0 && frame.counts[ic]) {
+            uint32_t rate = adc_sampler::channelRate(CURRENT_CHANNEL);
+            uint32_t current_dt = rate ? (uint32_t)((uint64_t)frame.counts[ic] * 1000000 / rate) : 0;
+            if (!dt_us) dt_us = current_dt;
+            int32_t ma = acs712::millivoltsToMilliamps(
+                frame_millivolts(adc_cal::CURRENT_PIN, frame.samples[ic], frame.counts[ic]));
+            update_source(sources[(int)Source::Current], ma < 0 ? -ma : ma, current_dt ? current_dt : 1);
+        }
+        if (!dt_us) return;
+
+        for (size_t i = 0; i < RULE_COUNT; i++) {
+            const Rule& rule = rules[i];
+            RuleState& state = states[i];
+            const SourceState& src = sources[(int)rule.source];
+            if (!rule.enabled || !src.primed) continue;
+            if (!transition_condition(rule, state.active, src.value, src.rate)) {
+                state.pending_us = 0;
+                continue;
+            }
+            state.pending_us += dt_us;
+            if (state.pending_us >= rule.debounce_ms * 1000) {
+                state.active = !state.active;
+                state.pending_us = 0;
+                bool rate_rule = rule.kind == Kind::Fall || rule.kind == Kind::Rise;
+                emit(i, state.active, rate_rule ? src.rate : src.value);
+            }
+        }
+    }
+
+    // Рассылка событий подписчикам, которым можно блокироваться (лог, webhook)
+    static void dispatch_task(void* pvParameters) {
+        Event event;
+        while (1) {
+            if (xQueueReceive(queue, &event, portMAX_DELAY) != pdTRUE) continue;
+            const Rule& rule = rules[event.rule];
+            for (size_t i = 0; i < subscriber_count; i++) {
+                const Subscription& sub = subscribers[i];
+                if (!sub.immediate && (rule.actions & sub.mask)) sub.fn(event, rule, sub.ctx);
+            }
+        }
+    }
+
+    static const char* unit(const Rule& rule) {
+        bool rate = rule.kind == Kind::Fall || rule.kind == Kind::Rise;
+        if (rule.source == Source::Voltage) return rate ? "mV/s" : "mV";
+        return rate ? "mA/s" : "mA";
+    }
+
+    static void log_event(const Event& event, const Rule& rule, void*) {
+        if (event.active) {
+            ESP_LOGW(TAG, "ALERT %s raised: %" PRId32 " %s (threshold %" PRId32 ")",
+                     rule.name, event.value, unit(rule), rule.threshold);
+        } else {
+            ESP_LOGI(TAG, "ALERT %s cleared: %" PRId32 " %s", rule.name, event.value, unit(rule));
+        }
+    }
+
+    // Немедленно, из задачи выборки; блокировка остаётся до l298_release
+    static void motor_cutoff(const Event& event, const Rule& rule, void*) {
+        if (event.active) l298n::inhibit();
+    }
+
+    // Уставка регулятора тока должна оставаться ниже правил, отключающих мотор
+    static void publish_cutoff_limit() {
+        int32_t cutoff = INT32_MAX;
+        for (size_t i = 0; i < RULE_COUNT; i++) {
+            const Rule& rule = rules[i];
+            if (rule.enabled && rule.source == Source::Current && rule.kind == Kind::Over &&
+                (rule.actions & ACTION_CUTOFF) && rule.threshold < cutoff) {
+                cutoff = rule.threshold;
+            }
+        }
+        motor_control::setCutoffLimit(cutoff);
+    }
+
+    bool subscribe(Subscriber subscriber, void* ctx, bool immediate, uint8_t mask) {
+        portENTER_CRITICAL(&lock);
+        bool ok = subscriber_count < MAX_SUBSCRIBERS;
+        if (ok) {
+            subscribers[subscriber_count] = { subscriber, ctx, immediate, mask };
+            subscriber_count = subscriber_count + 1;
+        }
+        portEXIT_CRITICAL(&lock);
+        return ok;
+    }
+
+    void init() {
+        if (initialized) return;
+        queue = xQueueCreate(QUEUE_LENGTH, sizeof(Event));
+        xTaskCreate(dispatch_task, "alerts", DISPATCH_STACK, NULL, 4, NULL);
+        subscribe(log_event, NULL, false, ACTION_LOG);
+        subscribe(motor_cutoff, NULL, true, ACTION_CUTOFF);
+        publish_cutoff_limit();
+
+        adc_sampler::registerChannel(VOLTAGE_CHANNEL, ADC_ATTEN_DB_12, adc_sampler::DEFAULT_CHANNEL_RATE_HZ);
+        adc_sampler::registerChannel(CURRENT_CHANNEL, ADC_ATTEN_DB_12, adc_sampler::DEFAULT_CHANNEL_RATE_HZ);
+        if (!adc_sampler::addListener(on_frame, NULL)) {
+            ESP_LOGE(TAG, "Failed to register ADC listener");
+            return;
+        }
+        initialized = true;
+        ESP_LOGI(TAG, "Alert engine started with %u rules", (unsigned)RULE_COUNT);
+    }
+
+    size_t ruleCount() {
+        return RULE_COUNT;
+    }
+
+    bool getRule(size_t index, Rule* rule, bool* active) {
+        if (index >= RULE_COUNT) return false;
+        *rule = rules[index];
+        *active = states[index].active;
+        return true;
+    }
+
+    int findRule(const char* name) {
+        for (size_t i = 0; i < RULE_COUNT; i++) {
+            if (strcmp(rules[i].name, name) == 0) return (int)i;
+        }
+        return -1;
+    }
+
+    bool setRule(size_t index, int32_t threshold, int32_t hysteresis, uint32_t debounce_ms) {
+        if (index >= RULE_COUNT || hysteresis < 0) return false;
+        // Поля 32-битные - задача выборки видит либо старое, либо новое значение каждого
+        rules[index].threshold = threshold;
+        rules[index].hysteresis = hysteresis;
+        rules[index].debounce_ms = debounce_ms;
+        publish_cutoff_limit();
+        return true;
+    }
+
+    bool enableRule(size_t index, bool enabled) {
+        if (index >= RULE_COUNT) return false;
+        rules[index].enabled = enabled;
+        if (!enabled) {
+            states[index].pending_us = 0;
+            // Выключенное правило не остаётся активным: событие сброса, как при
+            // возврате значения (блокировку L298N снимает только l298_release)
+            if (states[index].active) {
+                const Rule& rule = rules[index];
+                const SourceState& src = sources[(int)rule.source];
+                states[index].active = false;
+                emit(index, false, rule.kind == Kind::Fall || rule.kind == Kind::Rise ? src.rate : src.value);
+            }
+        }
+        publish_cutoff_limit();
+        return true;
+    }
+
+    size_t recentEvents(Event* out, size_t max) {
+        portENTER_CRITICAL(&lock);
+        uint32_t last = event_seq;
+        size_t available = last < HISTORY_SIZE ? last : HISTORY_SIZE;
+        size_t n = available < max ? available : max;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = history[(last - n + 1 + i) % HISTORY_SIZE];
+        }
+        portEXIT_CRITICAL(&lock);
+        return n;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Правила по потоку отсчётов adc_sampler: пониженное/повышенное напряжение,
+// перегрузка по току, скорость изменения. Правила проверяются на каждом кадре DMA
+// (единицы миллисекунд), с гистерезисом и задержкой срабатывания/сброса.
+namespace alerts {
+    enum class Source : uint8_t {
+        Voltage,   // мВ на входе делителя
+        Current,   // |мА| ACS712
+    };
+
+    enum class Kind : uint8_t {
+        Under,     // value < threshold
+        Over,      // value > threshold
+        Fall,      // скорость снижения > threshold (единиц в секунду)
+        Rise,      // скорость роста > threshold
+    };
+
+    enum Action : uint8_t {
+        ACTION_LOG = 1,
+        ACTION_PUSH = 2,     // Webhook (alert_webhook)
+        ACTION_CUTOFF = 4,   // Блокировка мотора L298N
+    };
+
+    struct Rule {
+        const char* name;
+        Source source;
+        Kind kind;
+        int32_t threshold;
+        int32_t hysteresis;   // Сброс - когда значение вернулось за порог на hysteresis
+        uint32_t debounce_ms; // Условие должно держаться столько, чтобы сработать/сброситься
+        uint8_t actions;
+        bool enabled;
+    };
+
+    struct Event {
+        uint32_t seq;
+        uint8_t rule;       // Индекс правила
+        bool active;        // true - сработало, false - сброшено
+        int32_t value;      // Значение в момент события
+        int64_t time_us;    // esp_timer_get_time()
+    };
+
+    // immediate: вызов прямо из задачи выборки (только быстрые действия без блокировок),
+    // иначе - из задачи рассылки. Подписчик получает события правил с (actions & mask) != 0.
+    typedef void (*Subscriber)(const Event& event, const Rule& rule, void* ctx);
+    bool subscribe(Subscriber subscriber, void* ctx, bool immediate, uint8_t mask);
+
+    void init();
+
+    size_t ruleCount();
+    bool getRule(size_t index, Rule* rule, bool* active);
+    int findRule(const char* name);
+    bool setRule(size_t index, int32_t threshold, int32_t hysteresis, uint32_t debounce_ms);
+    bool enableRule(size_t index, bool enabled);
+
+    // Последние события, от старых к новым
+    size_t recentEvents(Event* out, size_t max);
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "cbor.h"
+#include <cstring>
+
+namespace cbor {
+    static const uint8_t MAJOR_UINT = 0;
+    static const uint8_t MAJOR_NINT = 1;
+    static const uint8_t MAJOR_TEXT = 3;
+    static const uint8_t MAJOR_ARRAY = 4;
+    static const uint8_t MAJOR_MAP = 5;
+    static const uint8_t SIMPLE_FALSE = 0xf4;
+    static const uint8_t SIMPLE_TRUE = 0xf5;
+
+    void sinkInit(Sink& sink, uint8_t* buf, size_t cap, FlushFn flush, void* ctx) {
+        sink.buf = buf;
+        sink.cap = cap;
+        sink.len = 0;
+        sink.failed = false;
+        sink.flush = flush;
+        sink.ctx = ctx;
+    }
+
+    static bool flushSink(Sink& sink) {
+        if (sink.len == 0) return true;
+        if (!sink.flush || !sink.flush(sink.ctx, sink.buf, sink.len)) {
+            sink.failed = true;
+            return false;
+        }
+        sink.len = 0;
+        return true;
+    }
+
+    void write(Sink& sink, const void* data, size_t len) {
+        const uint8_t* src = static_cast<const uint8_t*>(data);
+        while (len > 0 && !sink.failed) {
+            if (sink.len == sink.cap && !flushSink(sink)) return;
+            size_t n = sink.cap - sink.len;
+            if (n > len) n = len;
+            memcpy(sink.buf + sink.len, src, n);
+            sink.len += n;
+            src += n;
+            len -= n;
+        }
+    }
+
+    bool finish(Sink& sink) {
+        if (sink.failed) return false;
+        return sink.flush ? flushSink(sink) : true;
+    }
+
+    // Заголовок элемента: старший тип + аргумент в кратчайшей форме
+    static void writeHead(Sink& sink, uint8_t major, uint64_t value) {
+        uint8_t head[9];
+        size_t len;
+        major <<= 5;
+        if (value < 24) {
+            head[0] = major | (uint8_t)value;
+            len = 1;
+        } else if (value <= 0xff) {
+            head[0] = major | 24;
+            head[1] = (uint8_t)value;
+            len = 2;
+        } else if (value <= 0xffff) {
+            head[0] = major | 25;
+            head[1] = (uint8_t)(value >> 8);
+            head[2] = (uint8_t)value;
+            len = 3;
+        } else if (value <= 0xffffffffULL) {
+            head[0] = major | 26;
+            for (int i = 0; i < 4; i++) head[1 + i] = (uint8_t)(value >> (24 - 8 * i));
+            len = 5;
+        } else {
+            head[0] = major | 27;
+            for (int i = 0; i < 8; i++) head[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+            len = 9;
+        }
+        write(sink, head, len);
+    }
+
+    void writeMap(Sink& sink, size_t pairs) {
+        writeHead(sink, MAJOR_MAP, pairs);
+    }
+
+    void writeArray(Sink& sink, size_t items) {
+        writeHead(sink, MAJOR_ARRAY, items);
+    }
+
+    void writeUint(Sink& sink, uint64_t value) {
+        writeHead(sink, MAJOR_UINT, value);
+    }
+
+    void writeInt(Sink& sink, int64_t value) {
+        if (value >= 0) {
+            writeHead(sink, MAJOR_UINT, (uint64_t)value);
+        } else {
+            writeHead(sink, MAJOR_NINT, (uint64_t)(-(value + 1)));
+        }
+    }
+
+    void writeText(Sink& sink, const char* text) {
+        size_t len = strlen(text);
+        writeHead(sink, MAJOR_TEXT, len);
+        write(sink, text, len);
+    }
+
+    void writeBool(Sink& sink, bool value) {
+        uint8_t b = value ? SIMPLE_TRUE : SIMPLE_FALSE;
+        write(sink, &b, 1);
+    }
+}
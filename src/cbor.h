@@ -0,0 +1,34 @@
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cbor {
+    // Буфер вывода фиксированного размера; при заполнении содержимое
+    // передаётся в flush (например, как HTTP-чанк). Без flush - переполнение = ошибка.
+    typedef bool (*FlushFn)(void* ctx, const uint8_t* data, size_t len);
+
+    struct Sink {
+        uint8_t* buf;
+        size_t cap;
+        size_t len;
+        bool failed;
+        FlushFn flush;
+        void* ctx;
+    };
+
+    void sinkInit(Sink& sink, uint8_t* buf, size_t cap, FlushFn flush = nullptr, void* ctx = nullptr);
+    void write(Sink& sink, const void* data, size_t len);
+    bool finish(Sink& sink);  // Сбрасывает остаток буфера, возвращает false при ошибке
+
+    // Минимальный кодировщик CBOR (RFC 8949): только определённые длины, без тегов
+    void writeMap(Sink& sink, size_t pairs);
+    void writeArray(Sink& sink, size_t items);
+    void writeUint(Sink& sink, uint64_t value);
+    void writeInt(Sink& sink, int64_t value);
+    void writeText(Sink& sink, const char* text);
+    void writeBool(Sink& sink, bool value);
+}
+
+#endif
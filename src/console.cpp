@@ -6,15 +6,29 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include <cstring>
+#include <cstdlib>
+#include <inttypes.h>
 #include <esp_sleep.h>
 #include <string>
 #include <functional>
 #include "f660.h"
+#include "f660_fleet.h"
 #include "voltage.h"
+#include "adc_sampler.h"
+#include "adc_cal.h"
+#include "power_meter.h"
+#include "energy.h"
+#include "spectrum.h"
+#include "motor_control.h"
+#include "motion.h"
+#include "protection.h"
+#include "alerts.h"
+#include "alert_webhook.h"
 #include "l298n.h"
 #include "dns_server.h"
 #include "telnet_server.h"
 #include "http_api_server.h"
+#include "wifi_sta.h"
 
 namespace console {
     const uart_port_t UART_PORT = UART_NUM_0;
@@ -111,86 +125,769 @@ namespace console {
         ESP_LOGI(TAG, "Console initialized");
     }
 
-    void processCommand(const char* command, std::function<void(const char*)> sendResponse) {
+    static void alertsCommand(std::function<void(const char*)> sendResponse) {
+        char response[160];
+        for (size_t i = 0; i < alerts::ruleCount(); i++) {
+            alerts::Rule rule;
+            bool active;
+            alerts::getRule(i, &rule, &active);
+            snprintf(response, sizeof(response),
+                     "%-13s %-6s threshold %" PRId32 ", hysteresis %" PRId32 ", debounce %" PRIu32 " ms%s",
+                     rule.name, active ? "ACTIVE" : "ok", rule.threshold, rule.hysteresis, rule.debounce_ms,
+                     rule.enabled ? "" : " (disabled)");
+            sendResponse(response);
+        }
+        alerts::Event events[8];
+        size_t n = alerts::recentEvents(events, 8);
+        for (size_t i = 0; i < n; i++) {
+            alerts::Rule rule;
+            bool active;
+            alerts::getRule(events[i].rule, &rule, &active);
+            snprintf(response, sizeof(response), "#%" PRIu32 " %lld ms %s %s %" PRId32,
+                     events[i].seq, (long long)(events[i].time_us / 1000), rule.name,
+                     events[i].active ? "raised" : "cleared", events[i].value);
+            sendResponse(response);
+        }
+        snprintf(response, sizeof(response), "Motor %s.", l298n::isInhibited() ? "inhibited (l298_release to clear)" : "enabled");
+        sendResponse(response);
+    }
+
+    static void spectrumCommand(std::function<void(const char*)> sendResponse) {
+        spectrum::Result r;
+        if (!spectrum::latest(&r)) {
+            sendResponse("No spectrum yet.");
+            return;
+        }
+        char response[256];
+        snprintf(response, sizeof(response),
+                 "N=%" PRIu32 " @ %" PRIu32 " Hz (%" PRIu32 ".%02" PRIu32 " Hz/bin): dominant %" PRIu32 ".%02" PRIu32 " Hz %" PRId32 " mA, AC rms %" PRId32 " mA, DC %" PRId32 " mA",
+                 r.size, r.rate_hz, r.bin_hz_x100 / 100, r.bin_hz_x100 % 100,
+                 r.dominant_hz_x100 / 100, r.dominant_hz_x100 % 100, r.dominant_ma, r.rms_ma, r.dc_ma);
+        sendResponse(response);
+        int len = snprintf(response, sizeof(response), "Bands (rms mA):");
+        for (size_t b = 0; b < r.band_count && len < (int)sizeof(response); b++) {
+            len += snprintf(response + len, sizeof(response) - len, " %s %" PRId32, r.band_names[b], r.band_rms_ma[b]);
+        }
+        sendResponse(response);
+        len = snprintf(response, sizeof(response), "Spectrum (peak mA, %u groups):", (unsigned)fft::COMPACT_BINS);
+        for (size_t g = 0; g < fft::COMPACT_BINS && len < (int)sizeof(response); g++) {
+            len += snprintf(response + len, sizeof(response) - len, " %" PRId32, r.compact_ma[g]);
+        }
+        sendResponse(response);
+        spectrum::Stats st = spectrum::getStats();
+        snprintf(response, sizeof(response),
+                 "Cycles per block: last %" PRIu32 " (%" PRIu32 " us), min %" PRIu32 ", max %" PRIu32 ", avg %" PRIu64 " over %" PRIu32 " blocks",
+                 st.last_cycles, st.last_us, st.min_cycles, st.max_cycles,
+                 st.blocks ? st.total_cycles / st.blocks : 0, st.blocks);
+        sendResponse(response);
+    }
+
+    static void motorGainsCommand(const std::string& args, std::function<void(const char*)> sendResponse) {
+        motor_control::Gains g = motor_control::getGains();
+        long kp, ki, kd, r_mohm, max_duty;
+        int parsed = sscanf(args.c_str(), "%ld %ld %ld %ld %ld", &kp, &ki, &kd, &r_mohm, &max_duty);
+        if (parsed > 0) {
+            if (parsed < 3) {
+                sendResponse("Usage: motor_gains [<kp> <ki> <kd> [r_mohm] [max_duty]]");
+                return;
+            }
+            g.kp = kp;
+            g.ki = ki;
+            g.kd = kd;
+            if (parsed >= 4) g.r_mohm = r_mohm;
+            if (parsed >= 5) g.max_duty = max_duty < 0 ? UINT32_MAX : (uint32_t)max_duty;
+            if (!motor_control::setGains(g)) {
+                sendResponse("Invalid gains.");
+                return;
+            }
+        }
+        char response[160];
+        snprintf(response, sizeof(response),
+                 "kp %" PRId32 " duty/A, ki %" PRId32 " duty/(A*s), kd %" PRId32 " duty/(A/s), R %" PRId32 " mOhm, max duty %" PRIu32,
+                 g.kp, g.ki, g.kd, g.r_mohm, g.max_duty);
+        sendResponse(response);
+    }
+
+    static void motionStatus(std::function<void(const char*)> sendResponse) {
+        motion::Profile profile;
+        motion::Status st = motion::getStatus(&profile);
+        char spec[motion::MAX_SPEC_LEN];
+        char response[motion::MAX_SPEC_LEN + 128];
+        if (profile.count) {
+            motion::format(profile, spec, sizeof(spec));
+            snprintf(response, sizeof(response),
+                     "%s: %s, step %u, cycle %" PRIu32 ", %" PRIu32 " steps, timer late %" PRId32 " us (max %" PRId32 ")",
+                     st.running ? "running" : "stopped", spec, (unsigned)st.step, st.cycle, st.steps_done,
+                     st.last_late_us, st.max_late_us);
+            sendResponse(response);
+        }
+        motion::format(motion::getDefault(), spec, sizeof(spec));
+        snprintf(response, sizeof(response), "Default: %s; PWM %" PRIu32 " Hz, %" PRIu32 " bit",
+                 spec, l298n::pwmFrequency(), l298n::pwmResolution());
+        sendResponse(response);
+    }
+
+    static void protectionCommand(const std::string& args, std::function<void(const char*)> sendResponse) {
+        long trip_ma = 0;
+        long samples = protection::getStatus().trip_samples;
+        int parsed = sscanf(args.c_str(), "%ld %ld", &trip_ma, &samples);
+        if (parsed > 0 && (samples < 1 || !protection::configure(trip_ma, samples))) {
+            sendResponse("Usage: protection [<trip_ma> [samples 1..16]]");
+            return;
+        }
+        protection::Status st = protection::getStatus();
+        char response[256];
+        snprintf(response, sizeof(response),
+                 "%s, trip %" PRId32 " mA x %" PRIu32 " samples (codes < %" PRId32 " or > %" PRId32 ", %" PRIu32 " us/sample), %s",
+                 st.armed ? "armed" : "NOT armed", st.trip_ma, st.trip_samples, st.low_code, st.high_code,
+                 st.sample_period_us, st.fault ? "FAULT latched (l298_release to clear)" : "no fault");
+        sendResponse(response);
+        if (st.trips) {
+            snprintf(response, sizeof(response),
+                     "%" PRIu32 " trips, last at %lld ms (%s): detected in %" PRIu32 " us, outputs off in %" PRIu32 " cycles (%" PRIu32 " ns)",
+                     st.trips, (long long)(st.trip_time_us / 1000), st.trip_high ? "forward" : "reverse",
+                     st.detect_us, st.cutoff_cycles, st.cutoff_ns);
+            sendResponse(response);
+        }
+    }
+
+    static void motorsCommand(std::function<void(const char*)> sendResponse) {
+        char response[160];
+        for (size_t i = 0; i < l298n::motorCount(); i++) {
+            l298n::MotorConfig c;
+            if (!l298n::getMotor(i, &c)) break;
+            int dir = l298n::getDirection(i);
+            int len = snprintf(response, sizeof(response), "%s: %s, ENA %d, IN %d/%d",
+                               c.name, c.backend == l298n::Backend::Mcpwm ? "MCPWM" : "LEDC",
+                               c.ena_gpio, c.in1_gpio, c.in2_gpio);
+            if (c.comp_gpio >= 0) len += snprintf(response + len, sizeof(response) - len, ", complementary %d", c.comp_gpio);
+            snprintf(response + len, sizeof(response) - len, ", phase %" PRIu32 "/%" PRIu32 ", %s, duty %" PRIu32,
+                     l298n::phase(i), l298n::MAX_DUTY + 1, dir > 0 ? "forward" : dir < 0 ? "backward" : "stopped",
+                     l298n::getDuty(i));
+            sendResponse(response);
+        }
+    }
+
+    static void motorAddCommand(const std::string& args, std::function<void(const char*)> sendResponse) {
+        l298n::MotorConfig config = {};
+        char backend[8] = "ledc";
+        int ena = -1, in1 = -1, in2 = -1, comp = -1;
+        int parsed = sscanf(args.c_str(), "%11s %d %d %d %7s %d", config.name, &ena, &in1, &in2, backend, &comp);
+        bool mcpwm = strcmp(backend, "mcpwm") == 0;
+        if (parsed < 4 || (!mcpwm && strcmp(backend, "ledc") != 0) || (comp >= 0 && !mcpwm)) {
+            sendResponse("Usage: motor_add <name> <ena> <in1> <in2> [ledc | mcpwm [complementary_gpio]]");
+            return;
+        }
+        config.ena_gpio = ena;
+        config.in1_gpio = in1;
+        config.in2_gpio = in2;
+        config.comp_gpio = comp;
+        config.backend = mcpwm ? l298n::Backend::Mcpwm : l298n::Backend::Ledc;
+        int index = l298n::addMotor(config);
+        if (index < 0) {
+            sendResponse("Cannot add motor: no free slot/MCPWM operator, duplicate name or invalid/used GPIO.");
+            return;
+        }
+        char response[48];
+        snprintf(response, sizeof(response), "Motor %d added.", index);
+        sendResponse(response);
+    }
+
+    static void f660DevicesCommand(std::function<void(const char*)> sendResponse) {
+        if (f660_fleet::deviceCount() == 0) {
+            sendResponse("No devices.");
+            return;
+        }
+        char response[160];
+        for (size_t i = 0; i < f660_fleet::deviceCount(); i++) {
+            f660_fleet::Device d;
+            f660_fleet::Result r;
+            if (!f660_fleet::getDevice(i, &d, &r)) break;
+            int len = snprintf(response, sizeof(response), "%s: %s:%u, %s", d.name, d.ip, d.port,
+                               f660_fleet::stateName(r.state));
+            if (r.state != f660_fleet::State::Idle && r.state != f660_fleet::State::Pending) {
+                len += snprintf(response + len, sizeof(response) - len, ", login %" PRIu32 " ms, run %" PRIu32 " ms",
+                                r.login_ms, r.run_ms);
+                if (r.back_ms) len += snprintf(response + len, sizeof(response) - len, ", back in %" PRIu32 " ms", r.back_ms);
+                if (r.error[0]) snprintf(response + len, sizeof(response) - len, " (%s)", r.error);
+            }
+            sendResponse(response);
+        }
+    }
+
+    static void f660DeviceAddCommand(const std::string& args, std::function<void(const char*)> sendResponse) {
+        f660_fleet::Device device = {};
+        unsigned port = 23;
+        int parsed = sscanf(args.c_str(), "%15s %15s %u %15s %23s", device.name, device.ip, &port,
+                            device.username, device.password);
+        if (parsed < 2 || port == 0 || port > 65535) {
+            sendResponse("Usage: f660_device_add <name> <ip> [port] [user] [password]");
+            return;
+        }
+        device.port = (uint16_t)port;
+        int index = f660_fleet::addDevice(device);
+        if (index < 0) {
+            sendResponse("Cannot add device: inventory full, duplicate name, invalid IP or job running.");
+            return;
+        }
+        char response[48];
+        snprintf(response, sizeof(response), "Device %d added.", index);
+        sendResponse(response);
+    }
+
+    // f660_run [-p workers] [-r rolling] [-f max_failures] [-t reboot_timeout_s] <all|name,...> <cmd>[;<cmd>...]
+    static void f660RunCommand(const std::string& args, std::function<void(const char*)> sendResponse) {
+        f660_fleet::JobOptions options;
+        const char* p = args.c_str();
+        char flag[4];
+        unsigned value;
+        int used;
+        while (sscanf(p, " %3s %u%n", flag, &value, &used) == 2 && flag[0] == '-') {
+            if (strcmp(flag, "-p") == 0) options.parallel = value;
+            else if (strcmp(flag, "-r") == 0) options.rolling = value;
+            else if (strcmp(flag, "-f") == 0) options.max_failures = value;
+            else if (strcmp(flag, "-t") == 0) options.reboot_timeout_ms = value * 1000;
+            else break;
+            p += used;
+        }
+        char targets[128];
+        if (sscanf(p, " %127s %n", targets, &used) != 1 || targets[0] == '-' || !p[used]) {
+            sendResponse("Usage: f660_run [-p workers] [-r rolling] [-f max_failures] [-t reboot_timeout_s] <all|name,...> <cmd>[;<cmd>...]");
+            return;
+        }
+        if (!f660_fleet::run(targets, p + used, options)) {
+            sendResponse("Cannot start job: already running, unknown device or no commands.");
+            return;
+        }
+        sendResponse("Job started, see f660_job and f660_devices.");
+    }
+
+    // adc_cal                          - показать калибровку
+    // adc_cal r1|r2 <ом>                - сопротивления делителя
+    // adc_cal gain|offset <таблица> <v> - множитель (ppm) / смещение (мВ)
+    // adc_cal trim <таблица> <мВ>       - подогнать множитель под показание эталонного прибора
+    // adc_cal reset                     - вернуть значения по умолчанию
+    static void adcCalCommand(const std::string& args, std::function<void(const char*)> sendResponse) {
+        adc_cal::Calibration cal = adc_cal::getCalibration();
+        char action[8] = "";
+        char name[12] = "";
+        long value = 0;
+        int parsed = sscanf(args.c_str(), "%7s %11s %ld", action, name, &value);
+        bool changed = true;
+        adc_cal::Table table;
+
+        if (parsed <= 0) {
+            changed = false;
+        } else if (strcmp(action, "reset") == 0) {
+            adc_cal::resetCalibration();
+            cal = adc_cal::getCalibration();
+            changed = false;
+        } else if ((strcmp(action, "r1") == 0 || strcmp(action, "r2") == 0) && parsed >= 2) {
+            long ohm = atol(name);
+            if (ohm <= 0) {
+                sendResponse("Resistance must be positive.");
+                return;
+            }
+            (action[1] == '1' ? cal.r1_ohm : cal.r2_ohm) = ohm;
+        } else if (parsed == 3 && adc_cal::tableFromName(name, &table)) {
+            if (strcmp(action, "gain") == 0) {
+                cal.gain_ppm[table] = value;
+            } else if (strcmp(action, "offset") == 0) {
+                cal.offset_mv[table] = value;
+            } else if (strcmp(action, "trim") == 0) {
+                // Текущее показание без смещения -> множитель, дающий эталонное значение
+                int32_t measured;
+                if (table == adc_cal::CURRENT_PIN) {
+                    int32_t filtered;
+                    measured = adc_sampler::latestFiltered(ADC_CHANNEL_5, &filtered)
+                        ? adc_cal::toMillivolts(table, filtered) : 0;
+                } else {
+                    measured = voltage::readMillivolts(table == adc_cal::VOLTAGE_DIVIDER);
+                }
+                measured -= cal.offset_mv[table];
+                if (measured <= 0 || value <= 0) {
+                    sendResponse("Cannot trim: no reading or invalid reference.");
+                    return;
+                }
+                cal.gain_ppm[table] = (int32_t)((int64_t)cal.gain_ppm[table] * (value - cal.offset_mv[table]) / measured);
+            } else {
+                changed = false;
+                parsed = -1;
+            }
+        } else {
+            parsed = -1;
+        }
+
+        if (parsed < 0) {
+            sendResponse("Usage: adc_cal [r1|r2 <ohm> | gain|offset|trim <pin|divider|current> <value> | reset]");
+            return;
+        }
+        if (changed && !adc_cal::setCalibration(cal)) {
+            sendResponse("Failed to apply calibration (gain 500000..2000000 ppm, offset -1000..1000 mV, R up to 10 MOhm).");
+            return;
+        }
+        char response[192];
+        int len = snprintf(response, sizeof(response), "ADC calibration (%s): R1=%" PRIu32 " R2=%" PRIu32,
+                           adc_cal::isCalibrated() ? "eFuse" : "linear", cal.r1_ohm, cal.r2_ohm);
+        for (int t = 0; t < adc_cal::TABLE_COUNT && len < (int)sizeof(response); t++) {
+            len += snprintf(response + len, sizeof(response) - len, ", %s gain=%" PRId32 "ppm offset=%" PRId32 "mV",
+                            adc_cal::tableName(static_cast<adc_cal::Table>(t)), cal.gain_ppm[t], cal.offset_mv[t]);
+        }
+        sendResponse(response);
+    }
+
+    bool processCommand(const char* command, std::function<void(const char*)> sendResponse) {
         std::string cmd = utils::trim(command);
         if (cmd == "help") {
-            sendResponse("Available commands: help, exit, poweroff, reboot, f660, f660_stop, voltage_3v3, voltage_r1_r2, l298, l298_stop, dns_server_init, dns_server_stop, telnet_server_init, telnet_server_stop, http_api_server_init, http_api_server_stop");
-            return;
+            sendResponse("Available commands: help, exit, poweroff, reboot, f660 [monitor|cycle], f660_stop, f660_status, f660_health, f660_devices, f660_device_add <name> <ip> [port] [user] [pass], f660_device_del <name>, f660_run [-p N] [-r K] [-f F] [-t s] <all|n1,n2> <cmd>[;<cmd>...], f660_job, f660_abort, wifi_sta, voltage_3v3, voltage_r1_r2, adc_stats, adc_rate <channel> <hz>, adc_filter <channel> [spec], adc_cal [r1|r2 <ohm> | gain|offset|trim <table> <value> | reset], power, power_window <ms>, energy, energy_reset, spectrum, spectrum_size <n>, spectrum_interval <ms>, alerts, alert_set <rule> <threshold> [hysteresis] [debounce_ms], alert_enable <rule> on|off, alert_webhook [url|off], motor_current <mA|off>, motor_pid, motor_gains [kp ki kd [r_mohm] [max_duty]], motion [profile], motion_save [profile], motion_stop, pwm <hz> <bits>, motors, motor_add <name> <ena> <in1> <in2> [ledc|mcpwm [comp]], motor_del <name>, motor_set <name>:f|b|s[:duty][,...], protection [trip_ma [samples]], l298, l298_stop, l298_release, dns_server_init, dns_server_stop, telnet_server_init, telnet_server_stop, http_api_server_init, http_api_server_stop, http_api_token <token>");
+            return true;
         }
         if (cmd == "poweroff") {
+            energy::checkpoint();
             sendResponse("Entering deep sleep...");
             esp_deep_sleep_start();
-            return;
+            return true;
         }
         if (cmd == "reboot") {
+            energy::checkpoint();
             sendResponse("Rebooting...");
             esp_restart();
-            return;
+            return true;
         }
-        if (cmd == "f660") {
-            f660::start();
-            sendResponse("f660 started.");
-            return;
+        if (cmd == "f660" || cmd == "f660 monitor") {
+            f660::start(f660::Mode::Monitor);
+            sendResponse("f660 started (monitor).");
+            return true;
+        }
+        if (cmd == "f660 cycle") {
+            f660::start(f660::Mode::Cycle);
+            sendResponse("f660 started (cycle).");
+            return true;
         }
         if (cmd == "f660_stop") {
             f660::stop();
             sendResponse("f660 stopped.");
-            return;
+            return true;
+        }
+        if (cmd == "f660_status") {
+            f660::Stats st = f660::getStats();
+            char response[256];
+            snprintf(response, sizeof(response),
+                     "Session %s: %" PRIu32 " connects (%" PRIu32 " failed, last login %" PRIu32 " ms), %" PRIu32 " reuses, %" PRIu32 " probes (%" PRIu32 " failed, last %" PRIu32 " ms), %" PRIu32 " sequences (%" PRIu32 " failed, last %" PRIu32 " ms)",
+                     st.connected ? "open" : "closed", st.connects, st.connect_failures, st.last_login_ms,
+                     st.reuses, st.probes, st.probe_failures, st.last_probe_ms,
+                     st.sequences, st.sequence_failures, st.last_sequence_ms);
+            sendResponse(response);
+            return true;
+        }
+        if (cmd == "f660_health") {
+            f660::Health h = f660::getHealth();
+            char response[320];
+            snprintf(response, sizeof(response),
+                     "Monitor %s, %s: %" PRIu32 " checks (%" PRIu32 " failed, %" PRIu32 " link down, %" PRIu32 " in a row), %" PRIu32 " recoveries (%" PRIu32 " failed), last detection %" PRIu32 " ms, last outage %" PRIu32 " ms, probes gateway %" PRIu32 " / tcp %" PRIu32 " / dns %" PRIu32 " ms",
+                     h.monitoring ? "on" : "off", !h.link_up ? "link down" : h.healthy ? "healthy" : "upstream down",
+                     h.checks, h.failed_checks, h.link_down_checks, h.consecutive, h.recoveries, h.recovery_failures,
+                     h.last_detect_ms, h.last_outage_ms, h.gateway_ms, h.tcp_ms, h.dns_ms);
+            sendResponse(response);
+            return true;
+        }
+        if (cmd == "f660_devices") {
+            f660DevicesCommand(sendResponse);
+            return true;
+        }
+        if (cmd.rfind("f660_device_add ", 0) == 0) {
+            f660DeviceAddCommand(cmd.substr(strlen("f660_device_add ")), sendResponse);
+            return true;
+        }
+        if (cmd.rfind("f660_device_del ", 0) == 0) {
+            std::string name = cmd.substr(strlen("f660_device_del "));
+            sendResponse(f660_fleet::removeDevice(name.c_str()) ? "Device removed." : "Unknown device or job running.");
+            return true;
+        }
+        if (cmd.rfind("f660_run ", 0) == 0) {
+            f660RunCommand(cmd.substr(strlen("f660_run ")), sendResponse);
+            return true;
+        }
+        if (cmd == "f660_job") {
+            f660_fleet::JobStatus st = f660_fleet::getStatus();
+            char response[128];
+            snprintf(response, sizeof(response), "Job %s: %u/%u done, %u failed, %u rebooting, %" PRIu32 " ms",
+                     st.running ? (st.aborted ? "aborting" : "running") : (st.aborted ? "aborted" : "idle"),
+                     (unsigned)st.done, (unsigned)st.total, (unsigned)st.failed, (unsigned)st.rebooting, st.elapsed_ms);
+            sendResponse(response);
+            return true;
+        }
+        if (cmd == "f660_abort") {
+            f660_fleet::abort();
+            sendResponse("Job aborting.");
+            return true;
+        }
+        if (cmd == "wifi_sta") {
+            wifi_sta::Stats st = wifi_sta::getStats();
+            char response[360];
+            snprintf(response, sizeof(response),
+                     "STA %s, channel %u (%s): %" PRIu32 " disconnects (last reason %u), %" PRIu32 " reconnects, %" PRIu32 " failures in a row, next retry in %" PRIu32 " ms; directed connects %" PRIu32 " ok / %" PRIu32 " fell back to scan; last connect %" PRIu32 " ms, last outage %" PRIu32 " ms, boot to IP %" PRIu32 " ms",
+                     st.connected ? "connected" : "disconnected", st.channel, st.last_directed ? "directed" : "scan",
+                     st.disconnects, st.last_reason, st.attempts, st.failures, st.next_retry_ms,
+                     st.directed_hits, st.directed_misses, st.last_connect_ms, st.last_outage_ms, st.boot_to_ip_ms);
+            sendResponse(response);
+            return true;
         }
         if (cmd == "voltage_3v3") {
             float voltage = voltage::readVoltage(false);
             char response[32];
             snprintf(response, sizeof(response), "Voltage: %.2f V", voltage);
             sendResponse(response);
-            return;
+            return true;
         }
         if (cmd == "voltage_r1_r2") {
             float voltage = voltage::readVoltage(true);
             char response[32];
             snprintf(response, sizeof(response), "Voltage: %.2f V", voltage);
             sendResponse(response);
-            return;
+            return true;
+        }
+        if (cmd == "adc_stats") {
+            adc_sampler::Stats stats = adc_sampler::getStats();
+            char response[160];
+            snprintf(response, sizeof(response),
+                     "ADC sampler: %s, %" PRIu32 " Hz over %" PRIu32 " slots, frames %" PRIu32 ", samples %" PRIu32 ", invalid %" PRIu32 ", overflows %" PRIu32,
+                     adc_sampler::isRunning() ? "running" : "stopped", stats.rate_hz, stats.pattern_len, stats.frames,
+                     stats.samples, stats.invalid, stats.overflows);
+            sendResponse(response);
+            adc_channel_t ids[adc_sampler::MAX_CHANNELS];
+            size_t count = adc_sampler::registeredChannels(ids, adc_sampler::MAX_CHANNELS);
+            for (size_t i = 0; i < count; i++) {
+                snprintf(response, sizeof(response), "  channel %d: %" PRIu32 " Hz", (int)ids[i],
+                         adc_sampler::channelRate(ids[i]));
+                sendResponse(response);
+            }
+            return true;
+        }
+        if (cmd.rfind("adc_rate ", 0) == 0) {
+            int channel = -1;
+            int rate = 0;
+            if (sscanf(cmd.c_str() + strlen("adc_rate "), "%d %d", &channel, &rate) != 2 || rate <= 0 ||
+                !adc_sampler::setChannelRate(static_cast<adc_channel_t>(channel), rate)) {
+                sendResponse("Usage: adc_rate <registered channel> <hz>");
+                return true;
+            }
+            char response[64];
+            snprintf(response, sizeof(response), "ADC channel %d: %" PRIu32 " Hz (pattern %" PRIu32 " Hz)",
+                     channel, adc_sampler::channelRate(static_cast<adc_channel_t>(channel)), adc_sampler::getStats().rate_hz);
+            sendResponse(response);
+            return true;
+        }
+        if (cmd.rfind("adc_filter ", 0) == 0) {
+            // adc_filter <channel> [med:3,dec:8,ma:16,iir:2 | none]
+            std::string args = utils::trim(cmd.substr(strlen("adc_filter ")));
+            size_t space = args.find(' ');
+            adc_channel_t channel = static_cast<adc_channel_t>(atoi(args.substr(0, space).c_str()));
+            adc_filter::StageConfig stages[adc_filter::MAX_STAGES];
+            size_t count = 0;
+            if (space != std::string::npos) {
+                std::string spec = utils::trim(args.substr(space + 1));
+                if ((spec != "none" && !adc_filter::parse(spec.c_str(), stages, &count)) ||
+                    !adc_sampler::setFilter(channel, stages, count)) {
+                    sendResponse("Invalid channel or filter spec (stages: dec:N, ma:N, med:N, iir:K).");
+                    return true;
+                }
+            } else if (!adc_sampler::getFilter(channel, stages, &count)) {
+                sendResponse("Unknown ADC channel.");
+                return true;
+            }
+            char spec[64];
+            adc_filter::format(stages, count, spec, sizeof(spec));
+            char response[96];
+            snprintf(response, sizeof(response), "ADC channel %d filter: %s", (int)channel, count ? spec : "none");
+            sendResponse(response);
+            return true;
+        }
+        if (cmd == "adc_cal" || cmd.rfind("adc_cal ", 0) == 0) {
+            adcCalCommand(cmd.substr(strlen("adc_cal")), sendResponse);
+            return true;
+        }
+        if (cmd == "power") {
+            power_meter::Result r;
+            if (!power_meter::latest(&r)) {
+                sendResponse("No power measurement yet.");
+                return true;
+            }
+            // Знак отдельно: у -0.500 целая часть 0 знака не несёт
+            int32_t pf = r.power_factor < 0 ? -r.power_factor : r.power_factor;
+            char response[192];
+            snprintf(response, sizeof(response),
+                     "Vrms %" PRId32 " mV, Irms %" PRId32 " mA, P %" PRId32 " mW, S %" PRId32 " mW, PF %s%" PRId32 ".%03" PRId32 " (%" PRIu32 " ms, %" PRIu32 " pairs)",
+                     r.v_rms_mv, r.i_rms_ma, r.real_mw, r.apparent_mw,
+                     r.power_factor < 0 ? "-" : "", pf / 1000, pf % 1000,
+                     r.window_ms, r.pairs);
+            sendResponse(response);
+            return true;
+        }
+        if (cmd.rfind("power_window ", 0) == 0) {
+            int ms = atoi(cmd.c_str() + strlen("power_window "));
+            if (ms <= 0 || !power_meter::setWindow(ms)) {
+                sendResponse("Window must be 10..10000 ms.");
+                return true;
+            }
+            sendResponse("Power window updated.");
+            return true;
+        }
+        if (cmd == "energy") {
+            energy::Totals t = energy::get();
+            // Знак отдельно: отдача меньше 1 мВт*ч иначе выводится без минуса
+            int64_t energy = t.energy_uwh < 0 ? -t.energy_uwh : t.energy_uwh;
+            int64_t charge = t.charge_uah < 0 ? -t.charge_uah : t.charge_uah;
+            char response[160];
+            snprintf(response, sizeof(response),
+                     "Energy %s%" PRId64 ".%03" PRId64 " mWh, charge %s%" PRId64 ".%03" PRId64 " mAh over %" PRIu64 " s (%" PRIu32 " checkpoints)",
+                     t.energy_uwh < 0 ? "-" : "", energy / 1000, energy % 1000,
+                     t.charge_uah < 0 ? "-" : "", charge / 1000, charge % 1000,
+                     t.duration_ms / 1000, t.checkpoints);
+            sendResponse(response);
+            return true;
+        }
+        if (cmd == "energy_reset") {
+            energy::reset();
+            sendResponse("Energy counter reset.");
+            return true;
+        }
+        if (cmd == "spectrum") {
+            spectrumCommand(sendResponse);
+            return true;
+        }
+        if (cmd.rfind("spectrum_size ", 0) == 0) {
+            int size = atoi(cmd.c_str() + strlen("spectrum_size "));
+            if (size <= 0 || !spectrum::setSize(size)) {
+                sendResponse("Size must be a power of two, 64..2048.");
+                return true;
+            }
+            sendResponse("Spectrum size updated.");
+            return true;
+        }
+        if (cmd.rfind("spectrum_interval ", 0) == 0) {
+            int ms = atoi(cmd.c_str() + strlen("spectrum_interval "));
+            if (ms <= 0 || !spectrum::setInterval(ms)) {
+                sendResponse("Interval must be at least 50 ms.");
+                return true;
+            }
+            sendResponse("Spectrum interval updated.");
+            return true;
+        }
+        if (cmd == "alerts") {
+            alertsCommand(sendResponse);
+            return true;
+        }
+        if (cmd.rfind("alert_set ", 0) == 0) {
+            char name[24] = "";
+            long threshold = 0;
+            long hysteresis = -1;
+            long debounce = -1;
+            int parsed = sscanf(cmd.c_str() + strlen("alert_set "), "%23s %ld %ld %ld", name, &threshold, &hysteresis, &debounce);
+            int index = alerts::findRule(name);
+            alerts::Rule rule;
+            bool active;
+            if (parsed < 2 || index < 0 || !alerts::getRule(index, &rule, &active)) {
+                sendResponse("Usage: alert_set <rule> <threshold> [hysteresis] [debounce_ms]");
+                return true;
+            }
+            if (parsed < 3) hysteresis = rule.hysteresis;
+            if (parsed < 4) debounce = rule.debounce_ms;
+            if (debounce < 0 || !alerts::setRule(index, threshold, hysteresis, debounce)) {
+                sendResponse("Invalid alert parameters.");
+                return true;
+            }
+            sendResponse("Alert rule updated.");
+            return true;
+        }
+        if (cmd.rfind("alert_enable ", 0) == 0) {
+            char name[24] = "";
+            char state[4] = "";
+            int index = -1;
+            if (sscanf(cmd.c_str() + strlen("alert_enable "), "%23s %3s", name, state) == 2) index = alerts::findRule(name);
+            if (index < 0 || (strcmp(state, "on") != 0 && strcmp(state, "off") != 0)) {
+                sendResponse("Usage: alert_enable <rule> on|off");
+                return true;
+            }
+            alerts::enableRule(index, strcmp(state, "on") == 0);
+            sendResponse("Alert rule updated.");
+            return true;
+        }
+        if (cmd == "alert_webhook" || cmd.rfind("alert_webhook ", 0) == 0) {
+            if (cmd.size() > strlen("alert_webhook ")) {
+                std::string url = cmd.substr(strlen("alert_webhook "));
+                if (!alert_webhook::setUrl(url == "off" ? "" : url.c_str())) {
+                    sendResponse("Invalid webhook URL.");
+                    return true;
+                }
+            }
+            char url[alert_webhook::MAX_URL_LEN];
+            alert_webhook::getUrl(url, sizeof(url));
+            char response[alert_webhook::MAX_URL_LEN + 16];
+            snprintf(response, sizeof(response), "Webhook: %s", url[0] ? url : "off");
+            sendResponse(response);
+            return true;
+        }
+        if (cmd == "motor_pid") {
+            motor_control::Telemetry t = motor_control::getTelemetry();
+            char response[224];
+            snprintf(response, sizeof(response),
+                     "%s: target %" PRId32 " mA, measured %" PRId32 " mA, supply %" PRId32 " mV, duty %" PRIu32 " (P %" PRId32 " I %" PRId32 " D %" PRId32 " FF %" PRId32 ")%s, %" PRIu32 " loops, %" PRIu32 " overruns, %" PRIu32 "/%" PRIu32 " us",
+                     t.running ? "running" : "stopped", t.target_ma, t.measured_ma, t.supply_mv, t.duty,
+                     t.p, t.i, t.d, t.ff, t.saturated ? " saturated" : "",
+                     t.loops, t.overruns, t.exec_us, t.max_exec_us);
+            sendResponse(response);
+            return true;
+        }
+        if (cmd.rfind("motor_current ", 0) == 0) {
+            std::string arg = cmd.substr(strlen("motor_current "));
+            if (arg == "off") {
+                motor_control::stop();
+                sendResponse("Current control stopped.");
+                return true;
+            }
+            char* end;
+            long target = strtol(arg.c_str(), &end, 10);
+            if (end == arg.c_str() || *end != '\0' || !motor_control::setTarget(target)) {
+                char msg[160];
+                long limit = motor_control::maxTarget();
+                snprintf(msg, sizeof(msg), "Target must be -%ld..%ld mA (below the current cutoff alerts and the protection trip) "
+                         "and the motor must not be inhibited.", limit, limit);
+                sendResponse(msg);
+                return true;
+            }
+            sendResponse("Current target set.");
+            return true;
+        }
+        if (cmd == "motor_gains" || cmd.rfind("motor_gains ", 0) == 0) {
+            motorGainsCommand(cmd.substr(strlen("motor_gains")), sendResponse);
+            return true;
+        }
+        if (cmd == "motion") {
+            motionStatus(sendResponse);
+            return true;
+        }
+        if (cmd.rfind("motion ", 0) == 0 || cmd.rfind("motion_save ", 0) == 0 || cmd == "motion_save") {
+            bool save = cmd.rfind("motion_save", 0) == 0;
+            std::string spec = cmd.size() > strlen(save ? "motion_save " : "motion ")
+                ? cmd.substr(strlen(save ? "motion_save " : "motion ")) : "";
+            motion::Profile profile;
+            if (spec.empty() && save) {
+                motion::getStatus(&profile);
+                if (profile.count == 0) {
+                    sendResponse("No profile to save.");
+                    return true;
+                }
+            } else if (!motion::parse(spec.c_str(), &profile)) {
+                sendResponse("Invalid profile. Format: f|b|c:<duty>:<ramp_ms>:<hold_ms>,...[*repeat]");
+                return true;
+            }
+            if (save) {
+                sendResponse(motion::saveDefault(profile) ? "Default profile saved." : "Failed to save profile.");
+            } else {
+                sendResponse(motion::start(profile) ? "Profile started." : "Cannot start profile (motor inhibited?).");
+            }
+            return true;
+        }
+        if (cmd == "motion_stop") {
+            motion::stop();
+            sendResponse("Profile stopped.");
+            return true;
+        }
+        if (cmd.rfind("pwm ", 0) == 0) {
+            unsigned long freq = 0, bits = 0;
+            if (sscanf(cmd.c_str() + strlen("pwm "), "%lu %lu", &freq, &bits) != 2 || !motion::setPwm(freq, bits)) {
+                sendResponse("Unsupported PWM frequency/resolution.");
+                return true;
+            }
+            sendResponse("PWM updated, motors stopped.");
+            return true;
+        }
+        if (cmd == "motors") {
+            motorsCommand(sendResponse);
+            return true;
+        }
+        if (cmd.rfind("motor_add ", 0) == 0) {
+            motorAddCommand(cmd.substr(strlen("motor_add ")), sendResponse);
+            return true;
+        }
+        if (cmd.rfind("motor_del ", 0) == 0) {
+            int index = l298n::findMotor(utils::trim(cmd.substr(strlen("motor_del "))).c_str());
+            sendResponse(index > 0 && l298n::removeMotor(index) ? "Motor removed." : "Unknown motor (motor 0 cannot be removed).");
+            return true;
+        }
+        if (cmd.rfind("motor_set ", 0) == 0) {
+            // motor_set m1:f:4000,m2:b:2000,m3:s - одним пакетом
+            l298n::Command commands[l298n::MAX_MOTORS];
+            size_t count = 0;
+            if (!l298n::parseCommands(utils::trim(cmd.substr(strlen("motor_set "))).c_str(), commands, l298n::MAX_MOTORS, &count)) {
+                sendResponse("Usage: motor_set <name>:f|b|s[:duty][,...]");
+                return true;
+            }
+            for (size_t i = 0; i < count; i++) {
+                // Мотор 0 переходит под ручное управление
+                if (commands[i].motor == 0) {
+                    motion::stop();
+                    motor_control::stop();
+                }
+            }
+            sendResponse(l298n::apply(commands, count) ? "Motors updated." : "Motors inhibited.");
+            return true;
         }
         if (cmd == "l298") {
-            sendResponse("l298 started.");
-            l298n::startCycleTask();
-            return;
+            sendResponse(motion::startDefault() ? "l298 started." : "l298 inhibited.");
+            return true;
         }
         if (cmd == "l298_stop") {
-            l298n::stopCycleTask();
+            motion::stopAll();
             sendResponse("l298 stopped.");
-            return;
+            return true;
+        }
+        if (cmd == "protection" || cmd.rfind("protection ", 0) == 0) {
+            protectionCommand(cmd.substr(strlen("protection")), sendResponse);
+            return true;
+        }
+        if (cmd == "l298_release") {
+            protection::clear();
+            sendResponse("l298 released.");
+            return true;
         }
         if (cmd == "dns_server_init") {
             dns_server::init();
             sendResponse("DNS server started.");
-            return;
+            return true;
         }
         if (cmd == "dns_server_stop") {
             dns_server::stop();
             sendResponse("DNS server stopped.");
-            return;
+            return true;
         }
         if (cmd == "telnet_server_init") {
             telnet_server::init();
             sendResponse("Telnet server started.");
-            return;
+            return true;
         }
         if (cmd == "telnet_server_stop") {
             telnet_server::stop();
             sendResponse("Telnet server stopped.");
-            return;
+            return true;
         }
         if (cmd == "http_api_server_init") {
             http_api_server::init();
             sendResponse("HTTP API server started.");
-            return;
+            return true;
+        }
+        if (cmd.rfind("http_api_token ", 0) == 0) {
+            std::string token = utils::trim(cmd.substr(strlen("http_api_token ")));
+            sendResponse(http_api_server::setToken(token.c_str()) ? "API token saved." : "Usage: http_api_token <8..32 printable characters>");
+            return true;
         }
         if (cmd == "http_api_server_stop") {
             http_api_server::stop();
             sendResponse("HTTP API server stopped.");
-            return;
+            return true;
         }
         sendResponse("Unknown command.");
+        return false;
     }
 }
\ No newline at end of file
@@ -6,7 +6,8 @@
 
 namespace console {
     void init();
-    void processCommand(const char* command, std::function<void(const char*)> sendResponse);
+    // Возвращает false, если команда не распознана
+    bool processCommand(const char* command, std::function<void(const char*)> sendResponse);
 }
 
 #endif
\ No newline at end of file
@@ -9,6 +9,8 @@ namespace dns_server {
     static const char* TAG = "dns_server";
     static int sock_fd = -1;
     static TaskHandle_t dns_task_handle = nullptr;
+    static Stats stats = {};
+    static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
 
     // ===== КОНФИГУРАЦИЯ =====
     static const char* server_ip = "0.0.0.0";     // IP для прослушивания
@@ -34,6 +36,13 @@ namespace dns_server {
     };
 
     // ===== ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ =====
+    // Счётчики обновляются из нескольких задач, а читаются из консоли/HTTP
+    static void count(uint32_t& counter) {
+        portENTER_CRITICAL(&stats_lock);
+        counter++;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+
     static bool is_valid_ip(const char* ip) {
         struct in_addr addr;
         return inet_pton(AF_INET, ip, &addr) == 1;
@@ -89,18 +98,26 @@ namespace dns_server {
         while (true) {
             int len = recvfrom(sock_fd, buffer, sizeof(buffer), 0, 
                              (struct sockaddr*)&client_addr, &client_len);
-            if (len < 12) continue;
+            if (len < 12) {
+                count(stats.dropped);
+                continue;
+            }
+            count(stats.queries);
 
             // Пропуск loopback-запросов
             if (is_loopback(&client_addr)) {
                 ESP_LOGW(TAG, "Loopback ignored");
+                count(stats.dropped);
                 continue;
             }
 
             // Анализ DNS запроса
             int qname_len = 0;
             while (buffer[12 + qname_len] != 0 && qname_len < len - 12) qname_len++;
-            if (12 + qname_len + 4 > len) continue;
+            if (12 + qname_len + 4 > len) {
+                count(stats.dropped);
+                continue;
+            }
             
             uint16_t qtype = (buffer[12 + qname_len] << 8) | buffer[12 + qname_len + 1];
             bool response_sent = false;
@@ -115,7 +132,10 @@ namespace dns_server {
                 inet_pton(AF_INET, forwarders[i], &forward_addr.sin_addr);
 
                 if (sendto(forward_sock_fd, buffer, len, 0, 
-                          (struct sockaddr*)&forward_addr, sizeof(forward_addr)) < 0) continue;
+                          (struct sockaddr*)&forward_addr, sizeof(forward_addr)) < 0) {
+                    count(stats.forward_errors);
+                    continue;
+                }
 
                 struct sockaddr_in recv_addr;
                 socklen_t recv_len = sizeof(recv_addr);
@@ -126,6 +146,9 @@ namespace dns_server {
                     sendto(sock_fd, buffer, recv_len_data, 0,
                           (struct sockaddr*)&client_addr, client_len);
                     response_sent = true;
+                    count(stats.forwarded);
+                } else {
+                    count(stats.forward_errors);
                 }
             }
 
@@ -157,6 +180,7 @@ namespace dns_server {
 
                 sendto(sock_fd, buffer, pos, 0, 
                       (struct sockaddr*)&client_addr, client_len);
+                count(stats.local_answers);
             }
         }
 
@@ -175,4 +199,11 @@ namespace dns_server {
         sock_fd = -1;
         dns_task_handle = nullptr;
     }
+
+    Stats getStats() {
+        portENTER_CRITICAL(&stats_lock);
+        Stats result = stats;
+        portEXIT_CRITICAL(&stats_lock);
+        return result;
+    }
 }
\ No newline at end of file
@@ -1,9 +1,20 @@
 #ifndef DNS_SERVER_H
 #define DNS_SERVER_H
 
+#include <cstdint>
+
 namespace dns_server {
+    struct Stats {
+        uint32_t queries;         // Принятые запросы
+        uint32_t forwarded;       // Ответы, полученные от форвардеров
+        uint32_t local_answers;   // Локальные ответы (response_ip)
+        uint32_t forward_errors;  // Неудачные попытки форвардинга
+        uint32_t dropped;         // Отброшенные (loopback, некорректные)
+    };
+
     void init();
     void stop();
+    Stats getStats();
 }
 
 #endif
\ No newline at end of file
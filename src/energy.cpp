@@ -0,0 +1,175 @@
+#include "energy.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include <inttypes.h>
+
+namespace energy {
+    static const char* TAG = "energy";
+    static const char* NVS_NAMESPACE = "energy";
+    static const char* NVS_KEY = "state";
+    static const uint32_t STATE_VERSION = 1;
+
+    // Проверка раз в минуту; запись - если изменение >= порога или прошло MAX_INTERVAL.
+    // При постоянной нагрузке это не чаще раза в 5 минут (~100 тыс. записей в год).
+    static const uint32_t CHECK_PERIOD_MS = 60 * 1000;
+    static const uint32_t MIN_INTERVAL_MS = 5 * 60 * 1000;
+    static const uint32_t MAX_INTERVAL_MS = 60 * 60 * 1000;
+    static const int64_t MIN_DELTA_UWH = 1000;  // 1 мВт*ч
+    static const int64_t MIN_DELTA_UAH = 1000;  // 1 мА*ч
+
+    struct State {
+        uint32_t version;
+        uint32_t reserved;
+        int64_t energy_uwh;
+        int64_t charge_uah;
+        uint64_t duration_ms;
+    };
+
+    // Остатки в единицах "значение * период пары": uwh += rem / (3600 * rate)
+    struct Remainders {
+        int64_t energy;
+        int64_t charge;
+        uint64_t duration;
+        uint32_t rate;
+    };
+
+    static State state;
+    static Remainders rem;
+    static State saved;                 // Последнее записанное состояние
+    static TickType_t saved_at = 0;     // Когда записано (или загружено) saved
+    static uint32_t checkpoints = 0;
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    static SemaphoreHandle_t save_lock = NULL;  // Запись из задачи контрольных точек и из консоли
+    static TaskHandle_t task_handle = NULL;
+
+    static void load() {
+        state = State();
+        state.version = STATE_VERSION;
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+            State stored;
+            size_t len = sizeof(stored);
+            if (nvs_get_blob(handle, NVS_KEY, &stored, &len) == ESP_OK &&
+                len == sizeof(stored) && stored.version == STATE_VERSION) {
+                state = stored;
+            }
+            nvs_close(handle);
+        }
+        saved = state;
+        saved_at = xTaskGetTickCount();
+    }
+
+    static bool save(const State& snapshot) {
+        if (!save_lock) return false;
+        xSemaphoreTake(save_lock, portMAX_DELAY);
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err == ESP_OK) {
+            err = nvs_set_blob(handle, NVS_KEY, &snapshot, sizeof(snapshot));
+            if (err == ESP_OK) err = nvs_commit(handle);
+            nvs_close(handle);
+        }
+        if (err == ESP_OK) {
+            saved = snapshot;
+            saved_at = xTaskGetTickCount();  // Любая запись, в т.ч. checkpoint() и reset(), сдвигает интервал
+            checkpoints++;
+        }
+        xSemaphoreGive(save_lock);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to save energy state: %d", err);
+            return false;
+        }
+        return true;
+    }
+
+    static State snapshot() {
+        portENTER_CRITICAL(&lock);
+        State s = state;
+        portEXIT_CRITICAL(&lock);
+        return s;
+    }
+
+    static int64_t abs64(int64_t v) {
+        return v < 0 ? -v : v;
+    }
+
+    static void checkpoint_task(void* pvParameters) {
+        while (1) {
+            vTaskDelay(CHECK_PERIOD_MS / portTICK_PERIOD_MS);
+            uint32_t since_save_ms = (xTaskGetTickCount() - saved_at) * portTICK_PERIOD_MS;
+            State s = snapshot();
+            bool changed = abs64(s.energy_uwh - saved.energy_uwh) >= MIN_DELTA_UWH ||
+                           abs64(s.charge_uah - saved.charge_uah) >= MIN_DELTA_UAH;
+            bool due = (changed && since_save_ms >= MIN_INTERVAL_MS) ||
+                       (since_save_ms >= MAX_INTERVAL_MS && s.duration_ms != saved.duration_ms);
+            if (due) save(s);
+        }
+    }
+
+    void init() {
+        if (task_handle) return;
+        save_lock = xSemaphoreCreateMutex();
+        load();
+        xTaskCreate(checkpoint_task, "energy_ckpt", 3072, NULL, 2, &task_handle);
+        ESP_LOGI(TAG, "Energy counter restored: %" PRId64 " uWh, %" PRId64 " uAh over %" PRIu64 " s",
+                 state.energy_uwh, state.charge_uah, state.duration_ms / 1000);
+    }
+
+    void accumulate(int64_t sum_uw, int64_t sum_ma, uint32_t pairs, uint32_t pair_rate_hz) {
+        if (pair_rate_hz == 0 || pairs == 0) return;
+        portENTER_CRITICAL(&lock);
+        if (rem.rate != pair_rate_hz) {
+            // Частота сменилась: остатки переводим в новые единицы
+            if (rem.rate) {
+                rem.energy = rem.energy * pair_rate_hz / rem.rate;
+                rem.charge = rem.charge * pair_rate_hz / rem.rate;
+                rem.duration = rem.duration * pair_rate_hz / rem.rate;
+            }
+            rem.rate = pair_rate_hz;
+        }
+        const int64_t per_hour = 3600LL * pair_rate_hz;
+
+        rem.energy += sum_uw;
+        state.energy_uwh += rem.energy / per_hour;
+        rem.energy %= per_hour;
+
+        rem.charge += sum_ma * 1000;  // мА -> мкА
+        state.charge_uah += rem.charge / per_hour;
+        rem.charge %= per_hour;
+
+        rem.duration += (uint64_t)pairs * 1000;
+        state.duration_ms += rem.duration / pair_rate_hz;
+        rem.duration %= pair_rate_hz;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    Totals get() {
+        State s = snapshot();
+        Totals t;
+        t.energy_uwh = s.energy_uwh;
+        t.charge_uah = s.charge_uah;
+        t.duration_ms = s.duration_ms;
+        t.checkpoints = checkpoints;
+        return t;
+    }
+
+    void reset() {
+        portENTER_CRITICAL(&lock);
+        state.energy_uwh = 0;
+        state.charge_uah = 0;
+        state.duration_ms = 0;
+        rem.energy = 0;
+        rem.charge = 0;
+        rem.duration = 0;
+        portEXIT_CRITICAL(&lock);
+        save(snapshot());
+        ESP_LOGI(TAG, "Energy counter reset");
+    }
+
+    void checkpoint() {
+        save(snapshot());
+    }
+}
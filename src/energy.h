@@ -0,0 +1,28 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <cstdint>
+
+// Счётчик энергии и заряда батареи (делитель R1/R2 + ACS712). Интегрирует каждую
+// пару отсчётов power_meter в целых числах с остатком - без накопления ошибки.
+// Состояние сохраняется в NVS периодически и только при заметном изменении.
+namespace energy {
+    struct Totals {
+        int64_t energy_uwh;    // Знак: > 0 - потребление
+        int64_t charge_uah;
+        uint64_t duration_ms;  // Интегрированное время с последнего сброса
+        uint32_t checkpoints;  // Записей в NVS с загрузки
+    };
+
+    void init();
+
+    // Суммы по n парам кадра: sum_uw = sum(мВ * мА), sum_ma = sum(мА); pair_rate_hz - пар в секунду.
+    // Вызывается из задачи выборки.
+    void accumulate(int64_t sum_uw, int64_t sum_ma, uint32_t pairs, uint32_t pair_rate_hz);
+
+    Totals get();
+    void reset();
+    void checkpoint();  // Немедленная запись в NVS (перед перезагрузкой)
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "expect.h"
+#include <cstring>
+
+namespace expect {
+    static uint8_t child(const Automaton& a, uint8_t node, uint8_t c) {
+        if (node == 0) return a.root_next[c];
+        for (uint8_t n = a.first_child[node]; n; n = a.next_sibling[n]) {
+            if (a.ch[n] == c) return n;
+        }
+        return 0;
+    }
+
+    bool build(Automaton& a, const Pattern* patterns, size_t count) {
+        if (count == 0 || count > MAX_PATTERNS) return false;
+        memset(&a, 0, sizeof(a));
+        a.states = 1;
+        a.count = count;
+
+        // Бор образцов
+        for (size_t p = 0; p < count; p++) {
+            const uint8_t* text = reinterpret_cast<const uint8_t*>(patterns[p].text);
+            if (!text || !text[0]) return false;
+            uint8_t node = 0;
+            for (; *text; text++) {
+                uint8_t next = child(a, node, *text);
+                if (!next) {
+                    if (a.states == MAX_STATES) return false;
+                    next = (uint8_t)a.states++;
+                    a.ch[next] = *text;
+                    if (node == 0) {
+                        a.root_next[*text] = next;
+                    } else {
+                        a.next_sibling[next] = a.first_child[node];
+                        a.first_child[node] = next;
+                    }
+                }
+                node = next;
+            }
+            a.out[node] |= (uint8_t)(1u << p);
+            a.anchors[p] = patterns[p].anchor;
+        }
+
+        // Ссылки неудачи обходом в ширину; выход узла включает выходы его суффиксов
+        uint8_t queue[MAX_STATES];
+        size_t head = 0, tail = 0;
+        for (int c = 0; c < 256; c++) {
+            if (a.root_next[c]) queue[tail++] = a.root_next[c];
+        }
+        while (head < tail) {
+            uint8_t node = queue[head++];
+            for (uint8_t n = a.first_child[node]; n; n = a.next_sibling[n]) {
+                uint8_t f = a.fail[node];
+                while (f && !child(a, f, a.ch[n])) f = a.fail[f];
+                uint8_t target = child(a, f, a.ch[n]);
+                a.fail[n] = target != n ? target : 0;
+                a.out[n] |= a.out[a.fail[n]];
+                queue[tail++] = n;
+            }
+        }
+        return true;
+    }
+
+    void reset(Matcher& m, const Automaton& automaton) {
+        m.automaton = &automaton;
+        m.state = 0;
+        m.pending = NO_MATCH;
+        m.consumed = 0;
+    }
+
+    int feed(Matcher& m, const uint8_t* data, size_t len, size_t* used) {
+        const Automaton& a = *m.automaton;
+        uint8_t state = m.state;
+        for (size_t i = 0; i < len; i++) {
+            uint8_t c = data[i];
+            if (m.pending != NO_MATCH && c != ' ' && c != '\t') m.pending = NO_MATCH;
+
+            uint8_t next = 0;
+            while (state && !(next = child(a, state, c))) state = a.fail[state];
+            state = state ? next : a.root_next[c];
+
+            uint8_t out = a.out[state];
+            if (!out) continue;
+            for (size_t p = 0; p < a.count; p++) {
+                if (!(out & (1u << p))) continue;
+                if (a.anchors[p] == Anchor::Anywhere) {
+                    m.state = state;
+                    m.pending = NO_MATCH;
+                    m.consumed += i + 1;
+                    *used = i + 1;
+                    return (int)p;
+                }
+                if (m.pending == NO_MATCH) m.pending = (int)p;
+            }
+        }
+        m.state = state;
+        m.consumed += len;
+        *used = len;
+        return NO_MATCH;
+    }
+
+    int idle(Matcher& m) {
+        int result = m.pending;
+        m.pending = NO_MATCH;
+        return result;
+    }
+}
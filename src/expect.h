@@ -0,0 +1,63 @@
+#ifndef EXPECT_H
+#define EXPECT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Потоковый поиск нескольких образцов в выводе telnet (приглашения, ошибки,
+// "--More--") автоматом Ахо-Корасик: каждый байт обрабатывается один раз,
+// состояние ограничено (без накопления принятого текста).
+// Без зависимостей от ESP-IDF - собирается и на хосте (tools/expect_bench.cpp).
+namespace expect {
+    static const size_t MAX_PATTERNS = 8;
+    static const size_t MAX_STATES = 128;   // Узлов бора: сумма длин образцов + 1
+    static const int NO_MATCH = -1;
+
+    enum class Anchor : uint8_t {
+        Anywhere,   // В любом месте потока
+        End,        // В конце вывода: после образца только пробелы, и больше байт не ожидается
+                    // ("# " в приглашении, но не '#' внутри текста команды); см. idle()
+    };
+
+    struct Pattern {
+        const char* text;
+        Anchor anchor;
+    };
+
+    struct Automaton {
+        uint8_t ch[MAX_STATES];          // Байт ребра от родителя
+        uint8_t first_child[MAX_STATES]; // 0 - нет (корень не бывает ребёнком)
+        uint8_t next_sibling[MAX_STATES];
+        uint8_t fail[MAX_STATES];
+        uint8_t out[MAX_STATES];         // Маска образцов, оканчивающихся в узле (с учётом суффиксов)
+        uint8_t root_next[256];          // Переходы корня таблицей: большую часть вывода автомат в корне
+        size_t states;
+        size_t count;
+        Anchor anchors[MAX_PATTERNS];
+    };
+
+    // false - пустой образец, больше MAX_PATTERNS или не помещается в MAX_STATES
+    bool build(Automaton& automaton, const Pattern* patterns, size_t count);
+
+    struct Matcher {
+        const Automaton* automaton;
+        uint8_t state;
+        int pending;          // Образец End, за которым пока только пробелы (между порциями тоже)
+        uint64_t consumed;    // Байт с начала потока
+    };
+
+    void reset(Matcher& matcher, const Automaton& automaton);
+
+    // Очередная порция потока. Возвращает индекс образца Anywhere или NO_MATCH, *used -
+    // сколько байт обработано: при совпадении - до конца образца включительно (остаток
+    // порции можно передать следующим вызовом), иначе вся порция. Первое по позиции,
+    // при равной позиции - меньший индекс. Образцы End feed() не возвращает: от разбиения
+    // потока на порции результат не зависит.
+    int feed(Matcher& matcher, const uint8_t* data, size_t len, size_t* used);
+
+    // Вызывающий установил, что больше байт нет (в сокете пусто, поток кончился):
+    // образец End, после которого были только пробелы, или NO_MATCH
+    int idle(Matcher& matcher);
+}
+
+#endif
@@ -1,9 +1,76 @@
 #ifndef F660_H
 #define F660_H
 
+#include "telnet_client.h"
+#include <string>
+
 namespace f660 {
-    void start();
-    void stop();
+    // Session manager counters: one authenticated telnet session to the router
+    // is kept between cycles and replaced only when it drops
+    typedef telnet_client::Stats Stats;
+
+    enum class Mode {
+        Cycle,      // Run cycle_commands (reboot) every reconnect_delay_ms
+        Monitor     // Probe upstream health, run cycle_commands only after repeated failures
+    };
+
+    // Router, timings and command sequences
+    struct Config {
+        std::string server_ip = "192.168.100.1";
+        int port = 23;
+        int reconnect_delay_ms = 1000;    // Delay between reconnection attempts
+        int max_attempts_before_pause = 10; // Attempts before 60s pause
+        int pause_after_attempts_ms = 60000; // 60s pause after 10 attempts
+        telnet_client::Options session;   // Timeouts, credentials, probe and keepalive
+        // Monitor mode: a check probes the STA gateway, then upstream (TCP connect
+        // and an uncached DNS query); upstream is healthy if any enabled probe answers
+        int health_interval_ms = 10000;   // Between checks while healthy
+        int health_retry_ms = 2000;       // Between checks after a failure: detection in ~N * retry
+        int health_timeout_ms = 2000;     // Per probe
+        int failures_before_recovery = 3;
+        int recovery_holdoff_ms = 180000; // Router boot: failures right after a recovery are not counted
+        int gateway_port = 23;            // Any answer counts, a refused connection too
+        std::string tcp_target_ip = "1.1.1.1";   // Empty - disabled
+        int tcp_target_port = 443;
+        std::string dns_domain = "google.com";   // Empty - disabled
+        // Commands run on the kept session; a command with empty prompt ends it (exit).
+        // Cycle mode runs them every loop, monitor mode up to the reboot as the recovery sequence
+        telnet_client::Commands cycle_commands = {
+            {"reboot\r\n", "#"},
+            {"sleep 3\r\n", "#"},
+            {"true\r\n", "#"}
+        };
+        telnet_client::Commands stop_commands = {
+            {"ip link set dev eth3 up\r\n", "#"},
+            {"exit 0\r\n", ""}
+        };
+    };
+
+    // Monitor mode counters
+    struct Health {
+        bool monitoring;
+        bool healthy;                // Last check: upstream reachable
+        bool link_up;                // Last check: STA gateway reachable
+        uint32_t checks;
+        uint32_t failed_checks;      // Gateway reachable, upstream not
+        uint32_t link_down_checks;   // Gateway unreachable: not counted towards recovery
+        uint32_t consecutive;        // Failed checks in a row
+        uint32_t recoveries;         // Recovery sequences run
+        uint32_t recovery_failures;  // Could not log in or the sequence failed
+        uint32_t last_detect_ms;     // Last healthy check to recovery decision
+        uint32_t last_outage_ms;     // First failed check to healthy again
+        uint32_t gateway_ms;         // Probe durations of the last check
+        uint32_t tcp_ms;
+        uint32_t dns_ms;
+    };
+
+    void start(Mode mode = Mode::Monitor);
+    void stop();                 // Asynchronous: the task runs the stop sequence and exits
+    bool isRunning();
+    Config getConfig();
+    bool setConfig(const Config& config);  // Only while the task is not running
+    Stats getStats();
+    Health getHealth();
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,431 @@
+#include "f660_fleet.h"
+#include "telnet_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include <cstring>
+#include <string>
+
+namespace f660_fleet {
+    static const char* TAG = "f660_fleet";
+    static const char* NVS_NAMESPACE = "f660";
+    static const char* NVS_KEY = "devices";
+    static const uint8_t STORE_VERSION = 1;
+
+    static const int DOWN_POLL_MS = 2000;       // Waiting for a rebooting router to stop answering
+    static const int DOWN_WAIT_MS = 30000;      // Gave up waiting: it may have rebooted faster than the poll
+    static const int UP_POLL_MS = 5000;         // Login attempts while it boots
+
+    struct Stored {
+        uint8_t version;
+        uint8_t count;
+        Device devices[MAX_DEVICES];
+    };
+
+    struct Job {
+        telnet_client::Commands commands;
+        bool reboots;
+        JobOptions options;
+        uint8_t targets[MAX_DEVICES];
+        size_t total;
+        size_t next;             // Next entry of targets for a free worker
+        size_t done;
+        size_t failed;
+        size_t rebooting;
+        size_t workers;          // Still running; the last one finishes the job
+        int64_t start_ms;
+        int64_t end_ms;
+        volatile bool aborted;
+        volatile bool running;
+        SemaphoreHandle_t slots; // Rolling reboot slots
+    };
+
+    static Device devices[MAX_DEVICES];
+    static Result results[MAX_DEVICES];
+    static size_t device_count = 0;
+    static Job job = {};
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;   // results and job counters
+
+    static int64_t nowMs() {
+        return esp_timer_get_time() / 1000;
+    }
+
+    static void load() {
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return;
+        static Stored stored;
+        size_t len = sizeof(stored);
+        if (nvs_get_blob(handle, NVS_KEY, &stored, &len) == ESP_OK && len == sizeof(stored) &&
+            stored.version == STORE_VERSION && stored.count <= MAX_DEVICES) {
+            for (size_t i = 0; i < stored.count; i++) {
+                devices[i] = stored.devices[i];
+                devices[i].name[MAX_NAME_LEN - 1] = '\0';
+                devices[i].ip[sizeof(devices[i].ip) - 1] = '\0';
+                devices[i].username[sizeof(devices[i].username) - 1] = '\0';
+                devices[i].password[sizeof(devices[i].password) - 1] = '\0';
+            }
+            device_count = stored.count;
+        }
+        nvs_close(handle);
+    }
+
+    static bool save() {
+        static Stored stored;
+        memset(&stored, 0, sizeof(stored));
+        stored.version = STORE_VERSION;
+        stored.count = (uint8_t)device_count;
+        memcpy(stored.devices, devices, device_count * sizeof(Device));
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err == ESP_OK) {
+            err = nvs_set_blob(handle, NVS_KEY, &stored, sizeof(stored));
+            if (err == ESP_OK) err = nvs_commit(handle);
+            nvs_close(handle);
+        }
+        if (err != ESP_OK) ESP_LOGE(TAG, "Failed to save devices: %d", err);
+        return err == ESP_OK;
+    }
+
+    void init() {
+        load();
+        ESP_LOGI(TAG, "%u devices in inventory", (unsigned)device_count);
+    }
+
+    int findDevice(const char* name) {
+        for (size_t i = 0; i < device_count; i++) {
+            if (strcmp(devices[i].name, name) == 0) return (int)i;
+        }
+        return -1;
+    }
+
+    int addDevice(const Device& device) {
+        struct in_addr addr;
+        if (job.running || device_count >= MAX_DEVICES || !device.name[0] ||
+            strnlen(device.name, MAX_NAME_LEN) == MAX_NAME_LEN || findDevice(device.name) >= 0 ||
+            strnlen(device.ip, sizeof(device.ip)) == sizeof(device.ip) || inet_pton(AF_INET, device.ip, &addr) <= 0) {
+            return -1;
+        }
+        size_t index = device_count;
+        devices[index] = device;
+        devices[index].username[sizeof(devices[index].username) - 1] = '\0';
+        devices[index].password[sizeof(devices[index].password) - 1] = '\0';
+        if (devices[index].port == 0) devices[index].port = 23;
+        results[index] = {};
+        device_count++;
+        save();
+        ESP_LOGI(TAG, "Device %s (%s:%u) added", device.name, device.ip, devices[index].port);
+        return (int)index;
+    }
+
+    bool removeDevice(const char* name) {
+        int index = findDevice(name);
+        if (job.running || index < 0) return false;
+        for (size_t i = index; i + 1 < device_count; i++) {
+            devices[i] = devices[i + 1];
+            results[i] = results[i + 1];
+        }
+        device_count--;
+        save();
+        ESP_LOGI(TAG, "Device %s removed", name);
+        return true;
+    }
+
+    size_t deviceCount() {
+        return device_count;
+    }
+
+    bool getDevice(size_t index, Device* device, Result* result) {
+        if (index >= device_count) return false;
+        if (device) *device = devices[index];
+        if (result) {
+            portENTER_CRITICAL(&lock);
+            *result = results[index];
+            portEXIT_CRITICAL(&lock);
+        }
+        return true;
+    }
+
+    const char* stateName(State state) {
+        switch (state) {
+        case State::Idle: return "idle";
+        case State::Pending: return "pending";
+        case State::Running: return "running";
+        case State::Rebooting: return "rebooting";
+        case State::Ok: return "ok";
+        case State::Failed: return "failed";
+        case State::Skipped: return "skipped";
+        }
+        return "?";
+    }
+
+    static void setState(size_t index, State state) {
+        portENTER_CRITICAL(&lock);
+        results[index].state = state;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    static void finishDevice(size_t index, State state, const char* error) {
+        portENTER_CRITICAL(&lock);
+        results[index].state = state;
+        if (error) {
+            strncpy(results[index].error, error, sizeof(results[index].error) - 1);
+            results[index].error[sizeof(results[index].error) - 1] = '\0';
+        }
+        job.done++;
+        if (state == State::Failed) job.failed++;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    // Next device for a free worker, or -1; past the failure limit or after
+    // abort() the remaining ones are marked skipped instead
+    static int takeNext() {
+        int index = -1;
+        portENTER_CRITICAL(&lock);
+        bool stop = job.aborted || (job.options.max_failures > 0 && job.failed >= job.options.max_failures);
+        while (job.next < job.total) {
+            size_t device = job.targets[job.next++];
+            if (!stop) {
+                index = (int)device;
+                results[device].state = State::Running;
+                break;
+            }
+            results[device].state = State::Skipped;
+            job.done++;
+        }
+        portEXIT_CRITICAL(&lock);
+        return index;
+    }
+
+    // Reboot slot, polled so that abort() is noticed while waiting for one
+    static bool takeSlot() {
+        while (!xSemaphoreTake(job.slots, 500 / portTICK_PERIOD_MS)) {
+            if (job.aborted) return false;
+        }
+        portENTER_CRITICAL(&lock);
+        job.rebooting++;
+        portEXIT_CRITICAL(&lock);
+        return true;
+    }
+
+    static void releaseSlot() {
+        portENTER_CRITICAL(&lock);
+        job.rebooting--;
+        portEXIT_CRITICAL(&lock);
+        xSemaphoreGive(job.slots);
+    }
+
+    // The router first has to go away (the reboot command returns before the
+    // shell is killed), then accept a login again; the session is left open
+    static bool waitBack(telnet_client::Session& s, size_t index, int64_t since) {
+        int64_t deadline = since + job.options.reboot_timeout_ms;
+        while (!job.aborted && nowMs() - since < DOWN_WAIT_MS &&
+               telnet_client::reachable(s.ip, s.port, 1000)) {
+            vTaskDelay(DOWN_POLL_MS / portTICK_PERIOD_MS);
+        }
+        while (!job.aborted && nowMs() < deadline) {
+            if (telnet_client::open(s)) {
+                portENTER_CRITICAL(&lock);
+                results[index].back_ms = (uint32_t)(nowMs() - since);
+                portEXIT_CRITICAL(&lock);
+                return true;
+            }
+            vTaskDelay(UP_POLL_MS / portTICK_PERIOD_MS);
+        }
+        strncpy(s.error, job.aborted ? "aborted" : "not back after reboot", sizeof(s.error) - 1);
+        return false;
+    }
+
+    static void runDevice(size_t index) {
+        const Device& d = devices[index];
+        telnet_client::Session s;
+        s.ip = d.ip;
+        s.port = d.port;
+        if (d.username[0]) s.options.username = d.username;
+        if (d.password[0]) s.options.password = d.password;
+
+        if (!telnet_client::open(s)) {
+            ESP_LOGW(TAG, "%s: login failed (%s)", d.name, s.error);
+            finishDevice(index, State::Failed, s.error);
+            return;
+        }
+        portENTER_CRITICAL(&lock);
+        results[index].login_ms = s.stats.last_login_ms;
+        portEXIT_CRITICAL(&lock);
+
+        if (job.reboots && !takeSlot()) {
+            telnet_client::close(s);
+            finishDevice(index, State::Skipped, "aborted");
+            return;
+        }
+        if (job.reboots) setState(index, State::Rebooting);
+
+        bool ok = telnet_client::run(s, job.commands);
+        int64_t sent = nowMs();
+        portENTER_CRITICAL(&lock);
+        results[index].run_ms = ok ? s.stats.last_sequence_ms : 0;
+        portEXIT_CRITICAL(&lock);
+        telnet_client::close(s);
+        if (ok && job.reboots) {
+            ok = waitBack(s, index, sent);
+            telnet_client::close(s);
+        }
+        if (job.reboots) releaseSlot();
+
+        if (ok) {
+            ESP_LOGI(TAG, "%s: done", d.name);
+        } else {
+            ESP_LOGW(TAG, "%s: failed (%s)", d.name, s.error);
+        }
+        finishDevice(index, ok ? State::Ok : State::Failed, ok ? "" : s.error);
+    }
+
+    // Called by whoever drops the worker count to zero
+    static void finishJob() {
+        vSemaphoreDelete(job.slots);
+        job.slots = NULL;
+        ESP_LOGI(TAG, "Job %s: %u devices, %u failed, %u ms", job.aborted ? "aborted" : "finished",
+                 (unsigned)job.total, (unsigned)job.failed, (unsigned)(job.end_ms - job.start_ms));
+        job.running = false;
+    }
+
+    static bool leaveJob(size_t workers) {
+        portENTER_CRITICAL(&lock);
+        job.workers -= workers;
+        bool last = job.workers == 0;
+        if (last) job.end_ms = nowMs();
+        portEXIT_CRITICAL(&lock);
+        return last;
+    }
+
+    static void workerTask(void* pv) {
+        int index;
+        while ((index = takeNext()) >= 0) {
+            runDevice((size_t)index);
+        }
+        if (leaveJob(1)) finishJob();
+        vTaskDelete(NULL);
+    }
+
+    static bool parseTargets(const char* targets, uint8_t* indices, size_t* count) {
+        *count = 0;
+        if (strcmp(targets, "all") == 0) {
+            for (size_t i = 0; i < device_count; i++) indices[(*count)++] = (uint8_t)i;
+            return *count > 0;
+        }
+        std::string list = targets;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = list.find(',', start);
+            if (end == std::string::npos) end = list.size();
+            int index = findDevice(list.substr(start, end - start).c_str());
+            if (index < 0 || *count >= MAX_DEVICES) return false;
+            for (size_t i = 0; i < *count; i++) {
+                if (indices[i] == index) return false;
+            }
+            indices[(*count)++] = (uint8_t)index;
+            start = end + 1;
+        }
+        return *count > 0;
+    }
+
+    static bool parseCommands(const char* text, telnet_client::Commands& commands, bool* reboots) {
+        commands.clear();
+        *reboots = false;
+        std::string list = text;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = list.find(';', start);
+            if (end == std::string::npos) end = list.size();
+            size_t first = list.find_first_not_of(' ', start);
+            size_t last = list.find_last_not_of(' ', end - 1);
+            if (first < end && last != std::string::npos && last >= first) {
+                std::string cmd = list.substr(first, last - first + 1);
+                if (cmd.rfind("reboot", 0) == 0) *reboots = true;
+                commands.push_back({cmd + "\r\n", "#"});
+            }
+            start = end + 1;
+        }
+        // The router may drop the session before printing the prompt after reboot
+        if (!commands.empty() && commands.back().first.rfind("reboot", 0) == 0) commands.back().second = "";
+        return !commands.empty();
+    }
+
+    bool run(const char* targets, const char* commands, const JobOptions& options) {
+        if (job.running) return false;
+        uint8_t indices[MAX_DEVICES];
+        size_t count;
+        telnet_client::Commands parsed;
+        bool reboots;
+        if (!parseTargets(targets, indices, &count) || !parseCommands(commands, parsed, &reboots)) return false;
+
+        job.commands = parsed;
+        job.reboots = reboots;
+        job.options = options;
+        if (job.options.parallel < 1) job.options.parallel = 1;
+        if (job.options.parallel > MAX_WORKERS) job.options.parallel = MAX_WORKERS;
+        if (job.options.parallel > count) job.options.parallel = count;
+        if (job.options.rolling < 1) job.options.rolling = 1;
+        job.slots = xSemaphoreCreateCounting(job.options.rolling, job.options.rolling);
+        if (!job.slots) return false;
+
+        portENTER_CRITICAL(&lock);
+        for (size_t i = 0; i < device_count; i++) results[i] = {};
+        for (size_t i = 0; i < count; i++) results[indices[i]].state = State::Pending;
+        memcpy(job.targets, indices, count);
+        job.total = count;
+        job.next = 0;
+        job.done = 0;
+        job.failed = 0;
+        job.rebooting = 0;
+        job.workers = job.options.parallel;
+        job.start_ms = nowMs();
+        job.end_ms = 0;
+        job.aborted = false;
+        job.running = true;
+        portEXIT_CRITICAL(&lock);
+
+        ESP_LOGI(TAG, "Job: %u devices, %u commands, %u workers, %u rebooting at once", (unsigned)count,
+                 (unsigned)parsed.size(), (unsigned)job.options.parallel, (unsigned)job.options.rolling);
+        size_t started = 0;
+        for (; started < job.options.parallel; started++) {
+            char name[16];
+            snprintf(name, sizeof(name), "f660_w%u", (unsigned)started);
+            if (xTaskCreate(workerTask, name, 8192, NULL, 5, NULL) != pdPASS) break;
+        }
+        if (started < job.options.parallel) {
+            ESP_LOGW(TAG, "Only %u of %u workers started", (unsigned)started, (unsigned)job.options.parallel);
+            if (started == 0) {
+                for (size_t i = 0; i < count; i++) results[indices[i]].state = State::Idle;
+            }
+            if (leaveJob(job.options.parallel - started)) finishJob();
+            if (started == 0) return false;
+        }
+        return true;
+    }
+
+    void abort() {
+        if (job.running) {
+            job.aborted = true;
+            ESP_LOGI(TAG, "Job aborting");
+        }
+    }
+
+    JobStatus getStatus() {
+        JobStatus st;
+        portENTER_CRITICAL(&lock);
+        st.running = job.running;
+        st.aborted = job.aborted;
+        st.total = job.total;
+        st.done = job.done;
+        st.failed = job.failed;
+        st.rebooting = job.rebooting;
+        st.elapsed_ms = job.start_ms ? (uint32_t)((job.running ? nowMs() : job.end_ms) - job.start_ms) : 0;
+        portEXIT_CRITICAL(&lock);
+        return st;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef F660_FLEET_H
+#define F660_FLEET_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Maintenance of many F660 routers at once: an inventory kept in NVS and a job
+// running one command sequence on the selected devices with a bounded pool of
+// worker tasks (one telnet session each). Sequences containing "reboot" take a
+// rolling slot first, so only a limited number of routers are down at a time;
+// the slot is held until the router accepts a login again.
+namespace f660_fleet {
+    static const size_t MAX_DEVICES = 32;
+    // Each worker holds one socket; lwip has 10 in total shared with httpd,
+    // the telnet and DNS servers
+    static const size_t MAX_WORKERS = 4;
+    static const size_t MAX_NAME_LEN = 16;
+
+    struct Device {
+        char name[MAX_NAME_LEN];
+        char ip[16];
+        uint16_t port;
+        char username[16];      // Empty - telnet_client::Options default
+        char password[24];
+    };
+
+    enum class State : uint8_t {
+        Idle,       // Not part of the last job
+        Pending,
+        Running,    // Login and sequence
+        Rebooting,  // Sequence sent, waiting for the router to come back
+        Ok,
+        Failed,
+        Skipped     // Job aborted or failure limit reached before its turn
+    };
+
+    struct Result {
+        State state;
+        uint32_t login_ms;      // Connect, negotiation and login
+        uint32_t run_ms;        // Command sequence
+        uint32_t back_ms;       // End of sequence to the next successful login (reboot only)
+        char error[48];
+    };
+
+    struct JobOptions {
+        size_t parallel = MAX_WORKERS;       // Worker tasks, 1..MAX_WORKERS
+        size_t rolling = 1;                  // Devices rebooting at once
+        size_t max_failures = 0;             // Skip the rest once this many failed, 0 - never
+        uint32_t reboot_timeout_ms = 180000; // Router must accept a login again within this
+    };
+
+    struct JobStatus {
+        bool running;
+        bool aborted;
+        size_t total;
+        size_t done;            // Finished, failed or skipped
+        size_t failed;
+        size_t rebooting;
+        uint32_t elapsed_ms;
+    };
+
+    void init();                                 // Loads the inventory
+
+    // Inventory changes are refused while a job runs
+    int addDevice(const Device& device);         // Index or -1 (full, duplicate name, bad address)
+    bool removeDevice(const char* name);
+    size_t deviceCount();
+    int findDevice(const char* name);
+    bool getDevice(size_t index, Device* device, Result* result);
+
+    // targets: "all" or "name1,name2"; commands: "cmd1;cmd2", each waits for the
+    // "#" prompt. A final "reboot" is sent without waiting (the router may drop
+    // the session first). false - job already running, unknown name or nothing to run
+    bool run(const char* targets, const char* commands, const JobOptions& options);
+    void abort();                                // Devices not started yet are skipped
+    JobStatus getStatus();
+    const char* stateName(State state);
+}
+
+#endif
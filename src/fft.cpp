@@ -0,0 +1,187 @@
+#include "fft.h"
+#include <cmath>
+
+namespace fft {
+    static const int32_t Q15_ONE = 32767;
+
+    static inline int32_t mul_q15(int32_t a, int32_t b) {
+        return (int32_t)(((int64_t)a * b) >> 15);
+    }
+
+    bool validSize(size_t size) {
+        return size >= MIN_SIZE && size <= MAX_SIZE && (size & (size - 1)) == 0;
+    }
+
+    bool init(Plan& plan, size_t size) {
+        if (!validSize(size)) return false;
+        plan.size = size;
+        // Считается один раз при настройке - программная плавающая точка здесь допустима
+        const double step = 2.0 * M_PI / size;
+        for (size_t n = 0; n < size; n++) {
+            plan.window[n] = (int16_t)lround(Q15_ONE * 0.5 * (1.0 - cos(step * n)));
+        }
+        for (size_t k = 0; k < size / 2; k++) {
+            plan.cos_table[k] = (int16_t)lround(Q15_ONE * cos(step * k));
+            plan.sin_table[k] = (int16_t)lround(Q15_ONE * sin(step * k));
+        }
+        return true;
+    }
+
+    // Комплексное БПФ длины M = N/2 над парами (re, im), прореживание по времени
+    static void complex_forward(const Plan& plan, int32_t* data, size_t m) {
+        for (size_t i = 1, j = 0; i < m; i++) {
+            size_t bit = m >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) {
+                int32_t re = data[2 * i], im = data[2 * i + 1];
+                data[2 * i] = data[2 * j];
+                data[2 * i + 1] = data[2 * j + 1];
+                data[2 * j] = re;
+                data[2 * j + 1] = im;
+            }
+        }
+        for (size_t len = 2; len <= m; len <<= 1) {
+            size_t half = len >> 1;
+            size_t stride = plan.size / len;   // W_len^j = W_N^(j * N / len)
+            for (size_t i = 0; i < m; i += len) {
+                for (size_t j = 0; j < half; j++) {
+                    int32_t c = plan.cos_table[j * stride];
+                    int32_t s = plan.sin_table[j * stride];
+                    int32_t* a = data + 2 * (i + j);
+                    int32_t* b = data + 2 * (i + j + half);
+                    // t = b * (c - js)
+                    int32_t tr = (int32_t)(((int64_t)b[0] * c + (int64_t)b[1] * s) >> 15);
+                    int32_t ti = (int32_t)(((int64_t)b[1] * c - (int64_t)b[0] * s) >> 15);
+                    b[0] = a[0] - tr;
+                    b[1] = a[1] - ti;
+                    a[0] += tr;
+                    a[1] += ti;
+                }
+            }
+        }
+    }
+
+    void realForward(const Plan& plan, int32_t* data) {
+        const size_t m = plan.size / 2;
+        // z[n] = x[2n] + j*x[2n+1] - тот же массив, читаемый как комплексный
+        complex_forward(plan, data, m);
+
+        int32_t z0r = data[0], z0i = data[1];
+        data[0] = z0r + z0i;   // X[0]
+        data[1] = z0r - z0i;   // X[N/2]
+
+        // X[k] = Fe[k] + W^k Fo[k], X[M-k] = conj(Fe[k] - W^k Fo[k]);
+        // Fe, Fo - спектры чётных и нечётных отсчётов (здесь удвоенные)
+        for (size_t k = 1; k <= m / 2; k++) {
+            int32_t* zk = data + 2 * k;
+            int32_t* zm = data + 2 * (m - k);
+            int32_t fer = zk[0] + zm[0];
+            int32_t fei = zk[1] - zm[1];
+            int32_t for_ = zk[1] + zm[1];
+            int32_t foi = zm[0] - zk[0];
+            int32_t c = plan.cos_table[k];
+            int32_t s = plan.sin_table[k];
+            int32_t tr = (int32_t)(((int64_t)for_ * c + (int64_t)foi * s) >> 15);
+            int32_t ti = (int32_t)(((int64_t)foi * c - (int64_t)for_ * s) >> 15);
+            zm[0] = (fer - tr) >> 1;
+            zm[1] = (ti - fei) >> 1;
+            zk[0] = (fer + tr) >> 1;
+            zk[1] = (fei + ti) >> 1;
+        }
+    }
+
+    static uint32_t isqrt64(uint64_t value) {
+        uint64_t result = 0;
+        uint64_t bit = (uint64_t)1 << 62;
+        while (bit > value) bit >>= 2;
+        while (bit) {
+            if (value >= result + bit) {
+                value -= result + bit;
+                result = (result >> 1) + bit;
+            } else {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint32_t)result;
+    }
+
+    static inline uint64_t bin_power(const int32_t* data, size_t k) {
+        int64_t re = data[2 * k], im = data[2 * k + 1];
+        return (uint64_t)(re * re + im * im);
+    }
+
+    void analyze(const Plan& plan, const uint16_t* samples, uint32_t rate_hz,
+                 const Band* bands, size_t band_count, int32_t* work, Result* result) {
+        const size_t n = plan.size;
+        const size_t m = n / 2;
+        if (band_count > MAX_BANDS) band_count = MAX_BANDS;
+
+        int64_t sum = 0;
+        for (size_t i = 0; i < n; i++) sum += samples[i];
+        int32_t dc = (int32_t)((sum << FRAC_BITS) / (int64_t)n);
+        for (size_t i = 0; i < n; i++) {
+            work[i] = mul_q15(((int32_t)samples[i] << FRAC_BITS) - dc, plan.window[i]);
+        }
+        realForward(plan, work);
+
+        // Амплитуда пика при окне Ханна: A = 4|X|/N; СКЗ по Парсевалю: 4*sqrt(sum|X|^2 / 3)/N
+        uint64_t total = 0;
+        uint64_t band_power[MAX_BANDS] = {};
+        uint64_t compact_power[COMPACT_BINS] = {};
+        uint64_t peak_power = 0;
+        size_t peak = 1;
+        size_t group = m / COMPACT_BINS;
+        for (size_t k = 1; k < m; k++) {
+            uint64_t p = bin_power(work, k);
+            total += p;
+            if (p > peak_power) {
+                peak_power = p;
+                peak = k;
+            }
+            uint64_t hz_x_n = (uint64_t)k * rate_hz;   // Частота бина = k * rate / N
+            for (size_t b = 0; b < band_count; b++) {
+                if (hz_x_n >= (uint64_t)bands[b].low_hz * n && hz_x_n < (uint64_t)bands[b].high_hz * n) {
+                    band_power[b] += p;
+                }
+            }
+            size_t g = k / group;
+            if (p > compact_power[g]) compact_power[g] = p;
+        }
+
+        result->size = (uint32_t)n;
+        result->rate_hz = rate_hz;
+        result->bin_hz_x100 = (uint32_t)((uint64_t)rate_hz * 100 / n);
+        result->dc = dc;
+        result->rms = (uint32_t)(4 * (uint64_t)isqrt64(total / 3) / n);
+        result->band_count = band_count;
+        for (size_t b = 0; b < band_count; b++) {
+            result->band_rms[b] = (uint32_t)(4 * (uint64_t)isqrt64(band_power[b] / 3) / n);
+        }
+        for (size_t g = 0; g < COMPACT_BINS; g++) {
+            result->compact[g] = (uint32_t)(4 * (uint64_t)isqrt64(compact_power[g]) / n);
+        }
+
+        // Уточнение по соседним бинам (для окна Ханна): d = 2(m+ - m-) / (m- + 2m0 + m+).
+        // У краёв (бин 1 - рядом убранная постоянная составляющая, последний бин) второго
+        // соседа нет: односторонняя оценка по одному соседу m1, d = (2m1 - m0) / (m1 + m0)
+        // в его сторону (из |W(1-d)| / |W(d)| = (1+d) / (2-d) для окна Ханна)
+        int64_t m0 = isqrt64(peak_power);
+        int64_t offset_x100 = 0;
+        if (peak > 1 && peak + 1 < m) {
+            int64_t before = isqrt64(bin_power(work, peak - 1));
+            int64_t after = isqrt64(bin_power(work, peak + 1));
+            int64_t denom = before + 2 * m0 + after;
+            offset_x100 = denom ? 200 * (after - before) / denom : 0;
+        } else if (peak + 1 < m || peak > 1) {
+            bool upward = peak + 1 < m;
+            int64_t m1 = isqrt64(bin_power(work, upward ? peak + 1 : peak - 1));
+            int64_t d_x100 = m1 + m0 ? 100 * (2 * m1 - m0) / (m1 + m0) : 0;
+            offset_x100 = upward ? d_x100 : -d_x100;
+        }
+        int64_t position_x100 = (int64_t)peak * 100 + offset_x100;
+        result->dominant_hz_x100 = (uint32_t)(position_x100 * rate_hz / (int64_t)n);
+        result->dominant_amplitude = (uint32_t)(4 * m0 / (int64_t)n);
+    }
+}
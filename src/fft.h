@@ -0,0 +1,59 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Вещественное БПФ в фиксированной точке и разбор спектра блока отсчётов ADC.
+// Комплексное БПФ половинной длины (radix-2) плюс разделение чётных/нечётных,
+// окно Ханна и поворачивающие множители в Q15, произведения в int64.
+// Без зависимостей от ESP-IDF - собирается и на хосте (tools/spectrum_trace.cpp).
+namespace fft {
+    static const size_t MIN_SIZE = 64;
+    static const size_t MAX_SIZE = 2048;    // Рост разрядности: 2^15 * N/2 помещается в int32
+    static const size_t MAX_BANDS = 6;
+    static const size_t COMPACT_BINS = 32;
+
+    struct Plan {
+        size_t size;                      // N, степень двойки
+        int16_t window[MAX_SIZE];         // Ханн, Q15
+        int16_t cos_table[MAX_SIZE / 2];  // cos(2*pi*k/N), Q15
+        int16_t sin_table[MAX_SIZE / 2];
+    };
+
+    bool validSize(size_t size);
+    bool init(Plan& plan, size_t size);
+
+    // На месте: data[0..N) - вещественный сигнал; на выходе X[k] = (data[2k], data[2k+1])
+    // для 1 <= k < N/2, data[0] = X[0], data[1] = X[N/2]. Без нормировки (как прямое ДПФ).
+    void realForward(const Plan& plan, int32_t* data);
+
+    struct Band {
+        const char* name;
+        uint32_t low_hz;     // Включительно
+        uint32_t high_hz;    // Не включительно
+    };
+
+    // Амплитуды - в кодах ADC << FRAC_BITS (как у adc_filter): пик синусоиды для бинов,
+    // СКЗ для полос. Постоянная составляющая вычитается до окна.
+    static const int FRAC_BITS = 4;
+
+    struct Result {
+        uint32_t size;
+        uint32_t rate_hz;
+        uint32_t bin_hz_x100;         // Ширина бина, Гц x100
+        int32_t dc;                   // Среднее блока
+        uint32_t rms;                 // СКЗ переменной составляющей (бины 1..N/2-1)
+        uint32_t dominant_hz_x100;    // Частота максимума с интерполяцией между бинами
+        uint32_t dominant_amplitude;  // По бину максимума: между бинами занижена до 1.4 дБ (окно)
+        size_t band_count;
+        uint32_t band_rms[MAX_BANDS];
+        uint32_t compact[COMPACT_BINS];  // Максимум амплитуды в каждой из 32 равных групп бинов
+    };
+
+    // work - буфер на N значений int32
+    void analyze(const Plan& plan, const uint16_t* samples, uint32_t rate_hz,
+                 const Band* bands, size_t band_count, int32_t* work, Result* result);
+}
+
+#endif
@@ -1,7 +1,42 @@
 #include "http_api_server.h"
 #include "voltage.h"
+#include "adc_sampler.h"
+#include "power_meter.h"
+#include "energy.h"
+#include "spectrum.h"
+#include "motor_control.h"
+#include "motion.h"
+#include "protection.h"
+#include "alerts.h"
+#include "l298n.h"
+#include "dns_server.h"
+#include "telnet_server.h"
+#include "console.h"
+#include "static_files.h"
+#include "telemetry.h"
+#include "telemetry_codec.h"
+#include "cbor.h"
+#include "utils.h"
+#include <cJSON.h>
+#include <string>
+#include <vector>
 #include <esp_http_server.h>
 #include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <esp_random.h>
+#include <nvs_flash.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lwip/stats.h>
+#include <lwip/memp.h>
+#include <lwip/lwip_napt.h>
+#include <lwip/sockets.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
 #include <string.h>
 
 namespace http_api_server {
@@ -11,62 +46,1175 @@ namespace http_api_server {
     // Конфигурация сервера
     static const char* SERVER_IP = "0.0.0.0"; // Слушать все интерфейсы
     static const uint16_t SERVER_PORT = 80;   // Порт по умолчанию
+    static const char* NVS_NAMESPACE = "http_api";
+    static const char* NVS_KEY_TOKEN = "token";
+    static const size_t TOKEN_MIN_LEN = 8;
+    static const size_t TOKEN_MAX_LEN = 32;
+    static const size_t CMD_MAX_BODY = 1024;      // Максимальный размер тела /api/cmd
+    static const int CMD_MAX_BATCH = 16;          // Максимум команд в одном запросе
 
-    // Обработчик GET-запроса для /api/voltage_3v3
-    static esp_err_t voltage_3v3_get_handler(httpd_req_t *req) {
-        ESP_LOGD(TAG, "Handling GET /api/voltage_3v3");
-
-        // Читаем напряжение без делителя (false)
-        float voltage = voltage::readVoltage(false);
+    // ===== Согласование формата ответа =====
+    // ?format=json|cbor|bin имеет приоритет над заголовком Accept.
+    // Возвращает false, если клиент не запросил конкретный формат.
+    static bool requested_format(httpd_req_t *req, telemetry_codec::Format* format) {
+        char query[48];
+        char value[8];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+            httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+            return telemetry_codec::fromName(value, format);
+        }
+        // Браузерный Accept длинный; усечённое значение тоже годится для поиска
+        char accept[160];
+        esp_err_t err = httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept));
+        if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC) return false;
+        return telemetry_codec::fromAccept(accept, format);
+    }
 
-        // Формируем ответ как строку (только цифры, без "V")
-        char response[16];
-        snprintf(response, sizeof(response), "%.2f", voltage);
+    static bool send_chunk(void* ctx, const uint8_t* data, size_t len) {
+        return httpd_resp_send_chunk(static_cast<httpd_req_t*>(ctx), (const char*)data, len) == ESP_OK;
+    }
 
-        // Отправляем ответ
-        esp_err_t ret = httpd_resp_send(req, response, strlen(response));
+    // Отправка напряжения: по умолчанию текст ("12.80"), по запросу - JSON/CBOR/int32 в мВ
+    static esp_err_t send_voltage(httpd_req_t *req, int32_t millivolts) {
+        esp_err_t ret;
+        telemetry_codec::Format format;
+        httpd_resp_set_hdr(req, "Vary", "Accept");
+        if (requested_format(req, &format)) {
+            uint8_t buf[32];
+            cbor::Sink sink;
+            cbor::sinkInit(sink, buf, sizeof(buf));
+            telemetry_codec::encodeValue(format, "voltage_mv", millivolts, sink);
+            httpd_resp_set_type(req, telemetry_codec::contentType(format));
+            ret = httpd_resp_send(req, (const char*)buf, sink.len);
+        } else {
+            // Формируем ответ как строку (только цифры, без "V")
+            char response[16];
+            int32_t centivolts = (millivolts + 5) / 10;
+            snprintf(response, sizeof(response), "%" PRId32 ".%02" PRId32, centivolts / 100, centivolts % 100);
+            ret = httpd_resp_send(req, response, strlen(response));
+        }
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to send response: %d", ret);
         }
         return ret;
     }
 
+    // Обработчик GET-запроса для /api/voltage_3v3
+    static esp_err_t voltage_3v3_get_handler(httpd_req_t *req) {
+        ESP_LOGD(TAG, "Handling GET /api/voltage_3v3");
+
+        // Читаем напряжение без делителя (false)
+        return send_voltage(req, voltage::readMillivolts(false));
+    }
+
     // Обработчик GET-запроса для /api/voltage_r1_r2
     static esp_err_t voltage_r1_r2_get_handler(httpd_req_t *req) {
         ESP_LOGD(TAG, "Handling GET /api/voltage_r1_r2");
 
         // Читаем напряжение с использованием делителя (true)
-        float voltage = voltage::readVoltage(true);
+        return send_voltage(req, voltage::readMillivolts(true));
+    }
+
+    // ===== /api/telemetry =====
+    // История отсчётов пакетом с дельта-кодированием меток времени.
+    // ?n=<число> ограничивает количество последних отсчётов; формат - JSON по умолчанию.
+    static const size_t TELEMETRY_CHUNK_SIZE = 512;
+
+    static esp_err_t telemetry_get_handler(httpd_req_t *req) {
+        // Обработчики httpd выполняются в одной задаче - буфер может быть статическим
+        static telemetry_codec::Sample samples[telemetry::HISTORY_SIZE];
+
+        size_t max = telemetry::HISTORY_SIZE;
+        char query[48];
+        char value[8];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+            httpd_query_key_value(query, "n", value, sizeof(value)) == ESP_OK) {
+            int n = atoi(value);
+            if (n > 0 && (size_t)n < max) max = n;
+        }
+
+        telemetry_codec::Format format = telemetry_codec::Format::Json;
+        requested_format(req, &format);
+        size_t count = telemetry::snapshot(samples, max);
+
+        uint8_t buf[TELEMETRY_CHUNK_SIZE];
+        cbor::Sink sink;
+        cbor::sinkInit(sink, buf, sizeof(buf), send_chunk, req);
+        httpd_resp_set_type(req, telemetry_codec::contentType(format));
+        httpd_resp_set_hdr(req, "Vary", "Accept");
+        telemetry_codec::encodeBatch(format, samples, count, sink);
+        if (!cbor::finish(sink)) {
+            ESP_LOGE(TAG, "Failed to send telemetry");
+            return ESP_FAIL;
+        }
+        return httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    // ===== /api/power =====
+    // Последнее окно power_meter в целых единицах (мВ, мА, мВт, PF x1000)
+    static esp_err_t power_get_handler(httpd_req_t *req) {
+        power_meter::Result r;
+        if (!power_meter::latest(&r)) {
+            httpd_resp_set_status(req, "503 Service Unavailable");
+            static const char* msg = "No power measurement yet";
+            return httpd_resp_send(req, msg, strlen(msg));
+        }
+        char response[256];
+        snprintf(response, sizeof(response),
+                 "{\"seq\":%" PRIu32 ",\"window_ms\":%" PRIu32 ",\"pairs\":%" PRIu32 ","
+                 "\"v_mean_mv\":%" PRId32 ",\"v_rms_mv\":%" PRId32 ",\"i_mean_ma\":%" PRId32 ",\"i_rms_ma\":%" PRId32 ","
+                 "\"real_mw\":%" PRId32 ",\"apparent_mw\":%" PRId32 ",\"power_factor\":%" PRId32 "}",
+                 r.seq, r.window_ms, r.pairs, r.v_mean_mv, r.v_rms_mv, r.i_mean_ma, r.i_rms_ma,
+                 r.real_mw, r.apparent_mw, r.power_factor);
+        httpd_resp_set_type(req, "application/json");
+        return httpd_resp_send(req, response, strlen(response));
+    }
+
+    // ===== /api/adc/raw =====
+    // Последние сырые отсчёты канала, по одному в строке - для записи трасс
+    // и прогона фильтров на хосте (tools/adc_filter_trace.cpp).
+    // ?channel=<N> (по умолчанию 4), ?n=<число> (по умолчанию весь буфер)
+    static esp_err_t adc_raw_get_handler(httpd_req_t *req) {
+        static uint16_t samples[adc_sampler::RING_SIZE];
+
+        int channel = ADC_CHANNEL_4;
+        size_t max = adc_sampler::RING_SIZE;
+        char query[48];
+        char value[8];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+            if (httpd_query_key_value(query, "channel", value, sizeof(value)) == ESP_OK) channel = atoi(value);
+            if (httpd_query_key_value(query, "n", value, sizeof(value)) == ESP_OK) {
+                int n = atoi(value);
+                if (n > 0 && (size_t)n < max) max = n;
+            }
+        }
+
+        size_t count = adc_sampler::copyRecent(static_cast<adc_channel_t>(channel), samples, max);
+        httpd_resp_set_type(req, "text/plain");
+        char buf[TELEMETRY_CHUNK_SIZE];
+        size_t len = snprintf(buf, sizeof(buf), "# channel %d, %" PRIu32 " Hz\n",
+                              channel, adc_sampler::channelRate(static_cast<adc_channel_t>(channel)));
+        for (size_t i = 0; i < count; i++) {
+            if (len + 8 > sizeof(buf)) {
+                if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) return ESP_FAIL;
+                len = 0;
+            }
+            len += snprintf(buf + len, sizeof(buf) - len, "%u\n", samples[i]);
+        }
+        if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) return ESP_FAIL;
+        return httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    // ===== /metrics (Prometheus text format) =====
+    // Метрики пишутся в буфер фиксированного размера и отправляются чанками
+    // по мере его заполнения, поэтому память не зависит от числа метрик.
+    static const size_t METRICS_CHUNK_SIZE = 768;
+    static const UBaseType_t METRICS_MAX_TASKS = 24;
+    static TaskStatus_t task_status[METRICS_MAX_TASKS]; // Обработчики httpd выполняются в одной задаче
+
+    struct MetricsWriter {
+        httpd_req_t* req;
+        char buf[METRICS_CHUNK_SIZE];
+        size_t len;
+        esp_err_t err;
+    };
+
+    static void metrics_flush(MetricsWriter& w) {
+        if (w.len == 0 || w.err != ESP_OK) return;
+        w.err = httpd_resp_send_chunk(w.req, w.buf, w.len);
+        w.len = 0;
+    }
+
+    static void metrics_printf(MetricsWriter& w, const char* fmt, ...) {
+        if (w.err != ESP_OK) return;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            va_list args;
+            va_start(args, fmt);
+            int n = vsnprintf(w.buf + w.len, sizeof(w.buf) - w.len, fmt, args);
+            va_end(args);
+            if (n < 0) return;
+            if ((size_t)n < sizeof(w.buf) - w.len) {
+                w.len += n;
+                return;
+            }
+            // Строка не поместилась: отправляем накопленное и пробуем снова
+            if (w.len == 0) {
+                ESP_LOGW(TAG, "Metric line too long, dropped");
+                return;
+            }
+            metrics_flush(w);
+        }
+    }
+
+    static void metric_header(MetricsWriter& w, const char* name, const char* type, const char* help) {
+        metrics_printf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+
+    static void metric_value(MetricsWriter& w, const char* name, const char* type, const char* help, uint64_t value) {
+        metric_header(w, name, type, help);
+        metrics_printf(w, "%s %" PRIu64 "\n", name, value);
+    }
+
+    static void render_runtime_metrics(MetricsWriter& w) {
+        metric_value(w, "esp_uptime_seconds", "counter", "Time since boot",
+                     (uint64_t)(esp_timer_get_time() / 1000000));
+        metric_value(w, "esp_heap_free_bytes", "gauge", "Free heap",
+                     heap_caps_get_free_size(MALLOC_CAP_8BIT));
+        metric_value(w, "esp_heap_min_free_bytes", "gauge", "Minimum free heap since boot",
+                     heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+        metric_value(w, "esp_heap_largest_free_block_bytes", "gauge", "Largest free heap block",
+                     heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    }
+
+    static void render_task_metrics(MetricsWriter& w) {
+        configRUN_TIME_COUNTER_TYPE total_runtime = 0;
+        UBaseType_t count = uxTaskGetSystemState(task_status, METRICS_MAX_TASKS, &total_runtime);
+        metric_value(w, "esp_tasks", "gauge", "Number of FreeRTOS tasks", uxTaskGetNumberOfTasks());
+        if (count == 0) {
+            // Задач больше, чем METRICS_MAX_TASKS: uxTaskGetSystemState ничего не заполняет
+            metric_value(w, "esp_tasks_truncated", "gauge", "Task table too small for per-task metrics", 1);
+            return;
+        }
+        metric_header(w, "esp_task_stack_high_water_bytes", "gauge", "Minimum free stack of a task");
+        for (UBaseType_t i = 0; i < count; i++) {
+            metrics_printf(w, "esp_task_stack_high_water_bytes{task=\"%s\"} %u\n",
+                           task_status[i].pcTaskName, (unsigned)task_status[i].usStackHighWaterMark);
+        }
+        metric_header(w, "esp_task_cpu_seconds_total", "counter", "CPU time consumed by a task");
+        for (UBaseType_t i = 0; i < count; i++) {
+            uint64_t runtime_us = task_status[i].ulRunTimeCounter;
+            metrics_printf(w, "esp_task_cpu_seconds_total{task=\"%s\"} %" PRIu64 ".%06" PRIu64 "\n",
+                           task_status[i].pcTaskName, runtime_us / 1000000, runtime_us % 1000000);
+        }
+    }
+
+    static void render_lwip_metrics(MetricsWriter& w) {
+        // Открытые сокеты считаем напрямую: пулы lwIP в ESP-IDF выделяются через malloc,
+        // и MEMP_STATS по умолчанию выключен
+        int open_sockets = 0;
+        for (int fd = LWIP_SOCKET_OFFSET; fd < LWIP_SOCKET_OFFSET + CONFIG_LWIP_MAX_SOCKETS; fd++) {
+            if (fcntl(fd, F_GETFL, 0) >= 0) open_sockets++;
+        }
+        metric_value(w, "lwip_sockets_open", "gauge", "Open lwIP sockets", open_sockets);
+        metric_value(w, "lwip_sockets_max", "gauge", "Configured socket limit", CONFIG_LWIP_MAX_SOCKETS);
+
+#if LINK_STATS
+        metric_header(w, "lwip_link_packets_total", "counter", "Link-level packets by direction");
+        metrics_printf(w, "lwip_link_packets_total{dir=\"tx\"} %u\n", (unsigned)lwip_stats.link.xmit);
+        metrics_printf(w, "lwip_link_packets_total{dir=\"rx\"} %u\n", (unsigned)lwip_stats.link.recv);
+        metric_value(w, "lwip_link_drops_total", "counter", "Dropped link-level packets", lwip_stats.link.drop);
+        metric_value(w, "lwip_link_mem_errors_total", "counter", "Out-of-memory errors (pbuf allocation)",
+                     lwip_stats.link.memerr);
+#endif
+#if MEMP_STATS
+        static const struct {
+            memp_t pool;
+            const char* name;
+        } pools[] = {
+            { MEMP_NETCONN, "netconn" },
+            { MEMP_TCP_PCB, "tcp_pcb" },
+            { MEMP_PBUF, "pbuf" },
+            { MEMP_PBUF_POOL, "pbuf_pool" },
+        };
+        metric_header(w, "lwip_memp_used", "gauge", "Objects in use per lwIP pool");
+        for (const auto& p : pools) {
+            metrics_printf(w, "lwip_memp_used{pool=\"%s\"} %u\n", p.name, (unsigned)lwip_stats.memp[p.pool]->used);
+        }
+        metric_header(w, "lwip_memp_errors_total", "counter", "Allocation failures per lwIP pool");
+        for (const auto& p : pools) {
+            metrics_printf(w, "lwip_memp_errors_total{pool=\"%s\"} %u\n", p.name, (unsigned)lwip_stats.memp[p.pool]->err);
+        }
+#endif
+#if MEM_STATS
+        metric_value(w, "lwip_mem_used_bytes", "gauge", "lwIP heap in use", lwip_stats.mem.used);
+#endif
+// IP_NAPT_STATS задаётся в корневом CMakeLists.txt
+#if IP_NAPT && IP_NAPT_STATS
+        struct stats_ip_napt napt = {};
+        ip_napt_get_stats(&napt);
+        metric_value(w, "napt_entries_max", "gauge", "NAPT table capacity", IP_NAPT_MAX);
+        metric_header(w, "napt_entries", "gauge", "Active NAPT table entries");
+        metrics_printf(w, "napt_entries{proto=\"tcp\"} %u\n", (unsigned)napt.nr_active_tcp);
+        metrics_printf(w, "napt_entries{proto=\"udp\"} %u\n", (unsigned)napt.nr_active_udp);
+        metrics_printf(w, "napt_entries{proto=\"icmp\"} %u\n", (unsigned)napt.nr_active_icmp);
+        metric_value(w, "napt_forced_evictions_total", "counter", "NAPT entries evicted to make room",
+                     napt.nr_forced_evictions);
+#endif
+    }
+
+    static void render_wifi_metrics(MetricsWriter& w) {
+        wifi_ap_record_t ap_info;
+        bool connected = esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK;
+        metric_value(w, "wifi_sta_connected", "gauge", "STA associated with upstream AP", connected ? 1 : 0);
+        if (connected) {
+            metric_header(w, "wifi_sta_rssi_dbm", "gauge", "RSSI of upstream AP");
+            metrics_printf(w, "wifi_sta_rssi_dbm %d\n", ap_info.rssi);
+        }
+        wifi_sta_list_t sta_list;
+        if (esp_wifi_ap_get_sta_list(&sta_list) == ESP_OK) {
+            metric_value(w, "wifi_ap_stations", "gauge", "Stations connected to the AP", sta_list.num);
+        }
+    }
+
+    static void render_service_metrics(MetricsWriter& w) {
+        dns_server::Stats dns = dns_server::getStats();
+        metric_header(w, "dns_server_requests_total", "counter", "DNS server requests by outcome");
+        metrics_printf(w, "dns_server_requests_total{result=\"forwarded\"} %" PRIu32 "\n", dns.forwarded);
+        metrics_printf(w, "dns_server_requests_total{result=\"local\"} %" PRIu32 "\n", dns.local_answers);
+        metrics_printf(w, "dns_server_requests_total{result=\"dropped\"} %" PRIu32 "\n", dns.dropped);
+        metric_value(w, "dns_server_queries_total", "counter", "DNS queries received", dns.queries);
+        metric_value(w, "dns_server_forward_errors_total", "counter", "Failed forwarder attempts", dns.forward_errors);
+
+        telnet_server::Stats telnet = telnet_server::getStats();
+        metric_value(w, "telnet_server_active_clients", "gauge", "Connected telnet clients", telnet.active);
+        metric_value(w, "telnet_server_accepted_total", "counter", "Accepted telnet connections", telnet.accepted);
+        metric_value(w, "telnet_server_rejected_total", "counter", "Rejected telnet connections", telnet.rejected);
+        metric_value(w, "telnet_server_auth_failures_total", "counter", "Failed telnet logins", telnet.auth_failures);
+        metric_value(w, "telnet_server_commands_total", "counter", "Commands executed over telnet", telnet.commands);
+    }
+
+    static void render_adc_metrics(MetricsWriter& w) {
+        adc_sampler::Stats adc = adc_sampler::getStats();
+        metric_value(w, "adc_sampler_rate_hz", "gauge", "ADC continuous pattern sample rate", adc.rate_hz);
+        metric_value(w, "adc_sampler_pattern_slots", "gauge", "Entries in the ADC scan pattern", adc.pattern_len);
+        metric_value(w, "adc_sampler_frames_total", "counter", "DMA frames processed", adc.frames);
+        metric_value(w, "adc_sampler_samples_total", "counter", "ADC samples accepted", adc.samples);
+        metric_value(w, "adc_sampler_invalid_total", "counter", "ADC results with unexpected channel", adc.invalid);
+        metric_value(w, "adc_sampler_overflows_total", "counter", "ADC driver pool overflows", adc.overflows);
+
+        power_meter::Result power;
+        if (power_meter::latest(&power)) {
+            metric_header(w, "power_meter_rms", "gauge", "True RMS over the last window (mV, mA)");
+            metrics_printf(w, "power_meter_rms{quantity=\"voltage_mv\"} %" PRId32 "\n", power.v_rms_mv);
+            metrics_printf(w, "power_meter_rms{quantity=\"current_ma\"} %" PRId32 "\n", power.i_rms_ma);
+            metric_header(w, "power_meter_power_mw", "gauge", "Real and apparent power over the last window");
+            metrics_printf(w, "power_meter_power_mw{kind=\"real\"} %" PRId32 "\n", power.real_mw);
+            metrics_printf(w, "power_meter_power_mw{kind=\"apparent\"} %" PRId32 "\n", power.apparent_mw);
+            metric_header(w, "power_meter_power_factor", "gauge", "Power factor x1000");
+            metrics_printf(w, "power_meter_power_factor %" PRId32 "\n", power.power_factor);
+        }
+
+        energy::Totals totals = energy::get();
+        metric_header(w, "energy_consumed_uwh", "gauge", "Integrated battery energy since reset");
+        metrics_printf(w, "energy_consumed_uwh %" PRId64 "\n", totals.energy_uwh);
+        metric_header(w, "energy_charge_uah", "gauge", "Integrated battery charge since reset");
+        metrics_printf(w, "energy_charge_uah %" PRId64 "\n", totals.charge_uah);
+        metric_value(w, "energy_checkpoints_total", "counter", "Energy state writes to NVS since boot", totals.checkpoints);
+
+        spectrum::Result spec;
+        if (spectrum::latest(&spec)) {
+            metric_header(w, "spectrum_dominant_hz", "gauge", "Dominant frequency of motor current");
+            metrics_printf(w, "spectrum_dominant_hz %" PRIu32 ".%02" PRIu32 "\n", spec.dominant_hz_x100 / 100, spec.dominant_hz_x100 % 100);
+            metric_header(w, "spectrum_band_rms_ma", "gauge", "Motor current RMS per frequency band");
+            for (size_t b = 0; b < spec.band_count; b++) {
+                metrics_printf(w, "spectrum_band_rms_ma{band=\"%s\"} %" PRId32 "\n", spec.band_names[b], spec.band_rms_ma[b]);
+            }
+            spectrum::Stats st = spectrum::getStats();
+            metric_value(w, "spectrum_block_cycles", "gauge", "CPU cycles for the last spectrum block", st.last_cycles);
+            metric_value(w, "spectrum_blocks_total", "counter", "Spectrum blocks analysed", st.blocks);
+        }
+
+        metric_header(w, "alert_active", "gauge", "Alert rule state (1 - raised)");
+        for (size_t i = 0; i < alerts::ruleCount(); i++) {
+            alerts::Rule rule;
+            bool active;
+            alerts::getRule(i, &rule, &active);
+            metrics_printf(w, "alert_active{rule=\"%s\"} %d\n", rule.name, active ? 1 : 0);
+        }
+        metric_value(w, "motor_inhibited", "gauge", "L298N locked out by an alert cutoff or protection trip", l298n::isInhibited() ? 1 : 0);
+        metric_header(w, "motor_duty", "gauge", "Motor PWM duty, 0..8191 (signed by direction)");
+        for (size_t i = 0; i < l298n::motorCount(); i++) {
+            l298n::MotorConfig c;
+            if (!l298n::getMotor(i, &c)) break;
+            metrics_printf(w, "motor_duty{motor=\"%s\"} %" PRId32 "\n", c.name,
+                           (int32_t)l298n::getDuty(i) * (l298n::getDirection(i) < 0 ? -1 : 1));
+        }
+
+        protection::Status prot = protection::getStatus();
+        metric_value(w, "protection_armed", "gauge", "ADC monitor overcurrent trip armed", prot.armed ? 1 : 0);
+        metric_value(w, "protection_fault", "gauge", "Latched overcurrent fault", prot.fault ? 1 : 0);
+        metric_value(w, "protection_trips_total", "counter", "Overcurrent trips since boot", prot.trips);
+        metric_value(w, "protection_detect_us", "gauge", "Last trip: first over-threshold sample to trip", prot.detect_us);
+        metric_value(w, "protection_cutoff_ns", "gauge", "Last trip: ISR entry to L298N outputs off", prot.cutoff_ns);
+    }
+
+    static void render_http_metrics(MetricsWriter& w);
+
+    // Обработчик GET-запроса для /metrics
+    static esp_err_t metrics_get_handler(httpd_req_t *req) {
+        ESP_LOGD(TAG, "Handling GET /metrics");
+        httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+        MetricsWriter w;
+        w.req = req;
+        w.len = 0;
+        w.err = ESP_OK;
+
+        render_runtime_metrics(w);
+        render_task_metrics(w);
+        render_lwip_metrics(w);
+        render_wifi_metrics(w);
+        render_service_metrics(w);
+        render_adc_metrics(w);
+        render_http_metrics(w);
+
+        metrics_flush(w);
+        if (w.err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to send metrics: %d", w.err);
+            return w.err;
+        }
+        return httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    // ===== /api/cmd: консольные команды без telnet-сессии =====
+    // Токен для /api/cmd и изменяющих запросов (Authorization: Bearer ...): свой у
+    // каждого устройства, хранится в NVS; при первом запуске генерируется случайный
+    static char api_token[TOKEN_MAX_LEN + 1] = "";
+    static portMUX_TYPE token_lock = portMUX_INITIALIZER_UNLOCKED;
+
+    static bool valid_token(const char* token) {
+        size_t len = strlen(token);
+        if (len < TOKEN_MIN_LEN || len > TOKEN_MAX_LEN) return false;
+        for (size_t i = 0; i < len; i++) {
+            if (token[i] <= ' ' || token[i] > '~') return false;
+        }
+        return true;
+    }
+
+    static bool save_token(const char* token) {
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err == ESP_OK) {
+            err = nvs_set_str(handle, NVS_KEY_TOKEN, token);
+            if (err == ESP_OK) err = nvs_commit(handle);
+            nvs_close(handle);
+        }
+        if (err != ESP_OK) ESP_LOGE(TAG, "Failed to save API token: %d", err);
+        return err == ESP_OK;
+    }
 
-        // Формируем ответ как строку (только цифры, без "V")
-        char response[16];
-        snprintf(response, sizeof(response), "%.2f", voltage);
+    static void load_token() {
+        char token[TOKEN_MAX_LEN + 1] = "";
+        size_t len = sizeof(token);
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+            if (nvs_get_str(handle, NVS_KEY_TOKEN, token, &len) != ESP_OK) token[0] = '\0';
+            nvs_close(handle);
+        }
+        if (!valid_token(token)) {
+            // Выводится один раз, в лог UART; сменить - командой http_api_token
+            snprintf(token, sizeof(token), "%08" PRIx32 "%08" PRIx32, esp_random(), esp_random());
+            if (save_token(token)) ESP_LOGW(TAG, "Generated API token: %s", token);
+        }
+        portENTER_CRITICAL(&token_lock);
+        strcpy(api_token, token);
+        portEXIT_CRITICAL(&token_lock);
+    }
 
-        // Отправляем ответ
-        esp_err_t ret = httpd_resp_send(req, response, strlen(response));
+    bool setToken(const char* token) {
+        if (!valid_token(token) || !save_token(token)) return false;
+        portENTER_CRITICAL(&token_lock);
+        strcpy(api_token, token);
+        portEXIT_CRITICAL(&token_lock);
+        return true;
+    }
+
+    // Время сравнения не зависит от того, сколько символов совпало
+    static bool token_equals(const char* given, const char* expected) {
+        size_t given_len = strlen(given);
+        size_t expected_len = strlen(expected);
+        uint8_t diff = given_len != expected_len;
+        for (size_t i = 0; i < TOKEN_MAX_LEN; i++) {
+            char a = i < given_len ? given[i] : 0;
+            char b = i < expected_len ? expected[i] : 0;
+            diff |= a ^ b;
+        }
+        return diff == 0;
+    }
+
+    static bool check_token(httpd_req_t *req) {
+        char auth[64];
+        if (httpd_req_get_hdr_value_str(req, "Authorization", auth, sizeof(auth)) != ESP_OK) {
+            return false;
+        }
+        static const char prefix[] = "Bearer ";
+        if (strncmp(auth, prefix, sizeof(prefix) - 1) != 0) {
+            return false;
+        }
+        char expected[TOKEN_MAX_LEN + 1];
+        portENTER_CRITICAL(&token_lock);
+        strcpy(expected, api_token);
+        portEXIT_CRITICAL(&token_lock);
+        return expected[0] != '\0' && token_equals(auth + sizeof(prefix) - 1, expected);
+    }
+
+    // Команды, останавливающие или перезапускающие сам HTTP-сервер: из его задачи
+    // httpd_stop() ждал бы завершения обработчика, который его вызвал
+    static bool server_lifecycle_command(const std::string& command) {
+        return command == "http_api_server_init" || command == "http_api_server_stop";
+    }
+
+    // Команды, после которых устройство перестаёт отвечать: ответ уходит первым,
+    // сама команда выполняется через DEFERRED_DELAY_US из задачи esp_timer
+    static const uint64_t DEFERRED_DELAY_US = 500000;
+    static char deferred[16];
+    static esp_timer_handle_t deferred_timer = NULL;
+
+    static bool deferred_command(const std::string& command) {
+        return command == "reboot" || command == "poweroff";
+    }
+
+    static void run_deferred(void*) {
+        console::processCommand(deferred, [](const char*) {});
+    }
+
+    static bool schedule_deferred(const std::string& command) {
+        if (!deferred_timer) {
+            const esp_timer_create_args_t args = {
+                .callback = run_deferred,
+                .arg = NULL,
+                .dispatch_method = ESP_TIMER_TASK,
+                .name = "http_deferred",
+                .skip_unhandled_events = false,
+            };
+            if (esp_timer_create(&args, &deferred_timer) != ESP_OK) {
+                deferred_timer = NULL;
+                return false;
+            }
+        }
+        if (esp_timer_is_active(deferred_timer)) return false;
+        snprintf(deferred, sizeof(deferred), "%s", command.c_str());
+        return esp_timer_start_once(deferred_timer, DEFERRED_DELAY_US) == ESP_OK;
+    }
+
+    static cJSON* run_command(const std::string& command) {
+        cJSON* result = cJSON_CreateObject();
+        cJSON* output = cJSON_CreateArray();
+        cJSON_AddStringToObject(result, "cmd", command.c_str());
+
+        int64_t start_us = esp_timer_get_time();
+        if (server_lifecycle_command(command)) {
+            cJSON_AddBoolToObject(result, "ok", false);
+            cJSON_AddItemToArray(output, cJSON_CreateString("Not available over HTTP: use the serial or telnet console."));
+            cJSON_AddItemToObject(result, "output", output);
+            cJSON_AddNumberToObject(result, "elapsed_us", 0);
+            return result;
+        }
+        if (deferred_command(command)) {
+            bool ok = schedule_deferred(command);
+            cJSON_AddBoolToObject(result, "ok", ok);
+            cJSON_AddItemToArray(output, cJSON_CreateString(ok ? "Scheduled in 500 ms." : "Not scheduled: a reboot or poweroff is already pending."));
+            cJSON_AddItemToObject(result, "output", output);
+            cJSON_AddNumberToObject(result, "elapsed_us", (double)(esp_timer_get_time() - start_us));
+            return result;
+        }
+        bool ok = console::processCommand(command.c_str(), [output](const char* line) {
+            if (line && strlen(line) > 0) {
+                cJSON_AddItemToArray(output, cJSON_CreateString(line));
+            }
+        });
+        cJSON_AddBoolToObject(result, "ok", ok);
+        cJSON_AddItemToObject(result, "output", output);
+        cJSON_AddNumberToObject(result, "elapsed_us", (double)(esp_timer_get_time() - start_us));
+        return result;
+    }
+
+    // Тело запроса: {"cmd": "..."}, {"cmds": ["...", ...]} или текст, по одной команде в строке
+    static bool parse_commands(const char* body, std::vector<std::string>& commands) {
+        cJSON* root = cJSON_Parse(body);
+        if (root) {
+            cJSON* cmd = cJSON_GetObjectItem(root, "cmd");
+            cJSON* cmds = cJSON_GetObjectItem(root, "cmds");
+            if (cJSON_IsString(cmd)) {
+                commands.push_back(utils::trim(cmd->valuestring));
+            } else if (cJSON_IsArray(cmds)) {
+                cJSON* item;
+                cJSON_ArrayForEach(item, cmds) {
+                    if (!cJSON_IsString(item)) {
+                        cJSON_Delete(root);
+                        return false;
+                    }
+                    commands.push_back(utils::trim(item->valuestring));
+                }
+            }
+            cJSON_Delete(root);
+        } else {
+            std::string text(body);
+            size_t pos = 0;
+            while (pos <= text.size()) {
+                size_t end = text.find('\n', pos);
+                if (end == std::string::npos) end = text.size();
+                std::string line = utils::trim(text.substr(pos, end - pos));
+                if (!line.empty()) commands.push_back(line);
+                pos = end + 1;
+            }
+        }
+        return !commands.empty() && commands.size() <= (size_t)CMD_MAX_BATCH;
+    }
+
+    // Тело запроса целиком в body (content_len уже проверен вызывающим), с завершающим нулём
+    static bool receive_body(httpd_req_t *req, char* body) {
+        size_t received = 0;
+        while (received < req->content_len) {
+            int ret = httpd_req_recv(req, body + received, req->content_len - received);
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) continue;
+            if (ret <= 0) {
+                ESP_LOGE(TAG, "Failed to receive %s body: %d", req->uri, ret);
+                return false;
+            }
+            received += ret;
+        }
+        body[received] = '\0';
+        return true;
+    }
+
+    // Обработчик POST-запроса для /api/cmd
+    static esp_err_t cmd_post_handler(httpd_req_t *req) {
+        ESP_LOGD(TAG, "Handling POST /api/cmd");
+
+        if (!check_token(req)) {
+            httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+            return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Invalid or missing token");
+        }
+        if (req->content_len == 0 || req->content_len > CMD_MAX_BODY) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid body length");
+        }
+
+        char body[CMD_MAX_BODY + 1];
+        if (!receive_body(req, body)) return ESP_FAIL;
+
+        std::vector<std::string> commands;
+        if (!parse_commands(body, commands)) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected 1..16 commands");
+        }
+
+        cJSON* root = cJSON_CreateObject();
+        cJSON* results = cJSON_AddArrayToObject(root, "results");
+        for (const auto& command : commands) {
+            cJSON_AddItemToArray(results, run_command(command));
+        }
+        char* json = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        if (!json) {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        }
+
+        httpd_resp_set_type(req, "application/json");
+        esp_err_t ret = httpd_resp_send(req, json, strlen(json));
+        cJSON_free(json);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to send response: %d", ret);
         }
         return ret;
     }
 
+    // ===== /api/energy =====
+    static esp_err_t send_energy(httpd_req_t *req) {
+        energy::Totals t = energy::get();
+        char response[160];
+        snprintf(response, sizeof(response),
+                 "{\"energy_uwh\":%" PRId64 ",\"charge_uah\":%" PRId64 ",\"duration_ms\":%" PRIu64 ",\"checkpoints\":%" PRIu32 "}",
+                 t.energy_uwh, t.charge_uah, t.duration_ms, t.checkpoints);
+        httpd_resp_set_type(req, "application/json");
+        return httpd_resp_send(req, response, strlen(response));
+    }
+
+    static esp_err_t energy_get_handler(httpd_req_t *req) {
+        return send_energy(req);
+    }
+
+    // Сброс счётчика - с тем же токеном, что и /api/cmd
+    static esp_err_t energy_reset_post_handler(httpd_req_t *req) {
+        if (!check_token(req)) {
+            httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+            return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Invalid or missing token");
+        }
+        energy::reset();
+        return send_energy(req);
+    }
+
+    // ===== /api/motor =====
+    // GET /api/motor - телеметрия регулятора тока (?trace=1 - последние точки для настройки),
+    // POST /api/motor/set {"target_ma": N} | {"stop": true} и/или коэффициенты - с токеном /api/cmd
+    static const size_t MOTOR_MAX_BODY = 256;
+
+    static esp_err_t send_motor(httpd_req_t *req, bool with_trace) {
+        motor_control::Telemetry t = motor_control::getTelemetry();
+        motor_control::Gains g = motor_control::getGains();
+        cJSON* root = cJSON_CreateObject();
+        cJSON_AddBoolToObject(root, "running", t.running);
+        cJSON_AddBoolToObject(root, "inhibited", l298n::isInhibited());
+        protection::Status prot = protection::getStatus();
+        cJSON* fault = cJSON_AddObjectToObject(root, "protection");
+        cJSON_AddBoolToObject(fault, "armed", prot.armed);
+        cJSON_AddBoolToObject(fault, "fault", prot.fault);
+        cJSON_AddNumberToObject(fault, "trip_ma", prot.trip_ma);
+        cJSON_AddNumberToObject(fault, "trip_samples", prot.trip_samples);
+        cJSON_AddNumberToObject(fault, "trips", prot.trips);
+        cJSON_AddNumberToObject(fault, "detect_us", prot.detect_us);
+        cJSON_AddNumberToObject(fault, "cutoff_ns", prot.cutoff_ns);
+        cJSON_AddNumberToObject(root, "target_ma", t.target_ma);
+        cJSON_AddNumberToObject(root, "max_target_ma", motor_control::maxTarget());
+        cJSON_AddNumberToObject(root, "measured_ma", t.measured_ma);
+        cJSON_AddNumberToObject(root, "supply_mv", t.supply_mv);
+        cJSON_AddNumberToObject(root, "duty", t.duty);
+        cJSON_AddNumberToObject(root, "p", t.p);
+        cJSON_AddNumberToObject(root, "i", t.i);
+        cJSON_AddNumberToObject(root, "d", t.d);
+        cJSON_AddNumberToObject(root, "ff", t.ff);
+        cJSON_AddBoolToObject(root, "saturated", t.saturated);
+        cJSON_AddNumberToObject(root, "loops", t.loops);
+        cJSON_AddNumberToObject(root, "overruns", t.overruns);
+        cJSON_AddNumberToObject(root, "exec_us", t.exec_us);
+        cJSON_AddNumberToObject(root, "max_exec_us", t.max_exec_us);
+        cJSON* gains = cJSON_AddObjectToObject(root, "gains");
+        cJSON_AddNumberToObject(gains, "kp", g.kp);
+        cJSON_AddNumberToObject(gains, "ki", g.ki);
+        cJSON_AddNumberToObject(gains, "kd", g.kd);
+        cJSON_AddNumberToObject(gains, "r_mohm", g.r_mohm);
+        cJSON_AddNumberToObject(gains, "max_duty", g.max_duty);
+        if (with_trace) {
+            static motor_control::TracePoint points[motor_control::TRACE_SIZE];
+            size_t n = motor_control::copyTrace(points, motor_control::TRACE_SIZE);
+            cJSON* trace = cJSON_AddArrayToObject(root, "trace");
+            for (size_t i = 0; i < n; i++) {
+                cJSON* point = cJSON_CreateArray();
+                cJSON_AddItemToArray(point, cJSON_CreateNumber(points[i].t_ms));
+                cJSON_AddItemToArray(point, cJSON_CreateNumber(points[i].target_ma));
+                cJSON_AddItemToArray(point, cJSON_CreateNumber(points[i].measured_ma));
+                cJSON_AddItemToArray(point, cJSON_CreateNumber(points[i].duty));
+                cJSON_AddItemToArray(trace, point);
+            }
+        }
+
+        char* json = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        if (!json) {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        }
+        httpd_resp_set_type(req, "application/json");
+        esp_err_t ret = httpd_resp_send(req, json, strlen(json));
+        cJSON_free(json);
+        return ret;
+    }
+
+    static esp_err_t motor_get_handler(httpd_req_t *req) {
+        char query[32];
+        char value[4];
+        bool with_trace = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                          httpd_query_key_value(query, "trace", value, sizeof(value)) == ESP_OK &&
+                          strcmp(value, "1") == 0;
+        return send_motor(req, with_trace);
+    }
+
+    static esp_err_t motor_set_post_handler(httpd_req_t *req) {
+        if (!check_token(req)) {
+            httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+            return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Invalid or missing token");
+        }
+        if (req->content_len == 0 || req->content_len > MOTOR_MAX_BODY) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid body length");
+        }
+        char body[MOTOR_MAX_BODY + 1];
+        if (!receive_body(req, body)) return ESP_FAIL;
+        cJSON* root = cJSON_Parse(body);
+        if (!root) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        }
+
+        motor_control::Gains g = motor_control::getGains();
+        cJSON* item;
+        bool gains_changed = false;
+        if (cJSON_IsNumber(item = cJSON_GetObjectItem(root, "kp"))) { g.kp = item->valueint; gains_changed = true; }
+        if (cJSON_IsNumber(item = cJSON_GetObjectItem(root, "ki"))) { g.ki = item->valueint; gains_changed = true; }
+        if (cJSON_IsNumber(item = cJSON_GetObjectItem(root, "kd"))) { g.kd = item->valueint; gains_changed = true; }
+        if (cJSON_IsNumber(item = cJSON_GetObjectItem(root, "r_mohm"))) { g.r_mohm = item->valueint; gains_changed = true; }
+        if (cJSON_IsNumber(item = cJSON_GetObjectItem(root, "max_duty"))) { g.max_duty = item->valueint; gains_changed = true; }
+        bool ok = !gains_changed || motor_control::setGains(g);
+        if (ok && cJSON_IsTrue(cJSON_GetObjectItem(root, "stop"))) {
+            motor_control::stop();
+        } else if (ok && cJSON_IsNumber(item = cJSON_GetObjectItem(root, "target_ma"))) {
+            ok = motor_control::setTarget(item->valueint);
+        }
+        cJSON_Delete(root);
+        if (!ok) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Rejected: invalid gains, target out of range or motor inhibited");
+        }
+        return send_motor(req, false);
+    }
+
+    // ===== /api/motion =====
+    // GET /api/motion - состояние профиля и ШИМ;
+    // POST /api/motion/set {"profile": "f:6191:300:2000*0", "save": true} | {"stop": true} |
+    // {"pwm_hz": N, "pwm_bits": N} - с токеном /api/cmd
+    static const size_t MOTION_MAX_BODY = 512;
+
+    static esp_err_t send_motion(httpd_req_t *req) {
+        motion::Profile profile;
+        motion::Status st = motion::getStatus(&profile);
+        char spec[motion::MAX_SPEC_LEN];
+        cJSON* root = cJSON_CreateObject();
+        cJSON_AddBoolToObject(root, "running", st.running);
+        motion::format(profile, spec, sizeof(spec));
+        cJSON_AddStringToObject(root, "profile", spec);
+        cJSON_AddNumberToObject(root, "step", st.step);
+        cJSON_AddNumberToObject(root, "cycle", st.cycle);
+        cJSON_AddNumberToObject(root, "steps_done", st.steps_done);
+        cJSON_AddNumberToObject(root, "late_us", st.last_late_us);
+        cJSON_AddNumberToObject(root, "max_late_us", st.max_late_us);
+        motion::format(motion::getDefault(), spec, sizeof(spec));
+        cJSON_AddStringToObject(root, "default", spec);
+        cJSON_AddNumberToObject(root, "duty", l298n::getDuty());
+        cJSON_AddNumberToObject(root, "pwm_hz", l298n::pwmFrequency());
+        cJSON_AddNumberToObject(root, "pwm_bits", l298n::pwmResolution());
+
+        char* json = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        if (!json) {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        }
+        httpd_resp_set_type(req, "application/json");
+        esp_err_t ret = httpd_resp_send(req, json, strlen(json));
+        cJSON_free(json);
+        return ret;
+    }
+
+    static esp_err_t motion_get_handler(httpd_req_t *req) {
+        return send_motion(req);
+    }
+
+    static esp_err_t motion_set_post_handler(httpd_req_t *req) {
+        if (!check_token(req)) {
+            httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+            return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Invalid or missing token");
+        }
+        if (req->content_len == 0 || req->content_len > MOTION_MAX_BODY) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid body length");
+        }
+        char body[MOTION_MAX_BODY + 1];
+        if (!receive_body(req, body)) return ESP_FAIL;
+        cJSON* root = cJSON_Parse(body);
+        if (!root) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        }
+
+        const char* error = NULL;
+        cJSON* hz = cJSON_GetObjectItem(root, "pwm_hz");
+        cJSON* bits = cJSON_GetObjectItem(root, "pwm_bits");
+        cJSON* spec = cJSON_GetObjectItem(root, "profile");
+        if (cJSON_IsNumber(hz) && cJSON_IsNumber(bits)) {
+            if (!motion::setPwm(hz->valueint, bits->valueint)) error = "Unsupported PWM frequency/resolution";
+        }
+        if (!error && cJSON_IsTrue(cJSON_GetObjectItem(root, "stop"))) {
+            motion::stop();
+        } else if (!error && cJSON_IsString(spec)) {
+            motion::Profile profile;
+            if (!motion::parse(spec->valuestring, &profile)) {
+                error = "Invalid profile";
+            } else if (cJSON_IsTrue(cJSON_GetObjectItem(root, "save"))) {
+                if (!motion::saveDefault(profile)) error = "Failed to save profile";
+            } else if (!motion::start(profile)) {
+                error = "Cannot start profile";
+            }
+        }
+        cJSON_Delete(root);
+        if (error) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        }
+        return send_motion(req);
+    }
+
+    // ===== /api/motors =====
+    // GET /api/motors - экземпляры моторов, смещения фронтов и скважности;
+    // POST /api/motors/set {"commands": "m1:f:4000,m2:b:2000"} | {"stop": true} -
+    // пакет применяется одной операцией (l298n::apply), с токеном /api/cmd
+    static const size_t MOTORS_MAX_BODY = 256;
+
+    static esp_err_t send_motors(httpd_req_t *req) {
+        cJSON* root = cJSON_CreateObject();
+        cJSON_AddBoolToObject(root, "inhibited", l298n::isInhibited());
+        cJSON_AddNumberToObject(root, "pwm_hz", l298n::pwmFrequency());
+        cJSON* list = cJSON_AddArrayToObject(root, "motors");
+        for (size_t i = 0; i < l298n::motorCount(); i++) {
+            l298n::MotorConfig c;
+            if (!l298n::getMotor(i, &c)) break;
+            cJSON* item = cJSON_CreateObject();
+            cJSON_AddStringToObject(item, "name", c.name);
+            cJSON_AddStringToObject(item, "backend", c.backend == l298n::Backend::Mcpwm ? "mcpwm" : "ledc");
+            cJSON_AddNumberToObject(item, "ena", c.ena_gpio);
+            cJSON_AddNumberToObject(item, "in1", c.in1_gpio);
+            cJSON_AddNumberToObject(item, "in2", c.in2_gpio);
+            if (c.comp_gpio >= 0) cJSON_AddNumberToObject(item, "complementary", c.comp_gpio);
+            cJSON_AddNumberToObject(item, "phase", l298n::phase(i));
+            cJSON_AddNumberToObject(item, "direction", l298n::getDirection(i));
+            cJSON_AddNumberToObject(item, "duty", l298n::getDuty(i));
+            cJSON_AddItemToArray(list, item);
+        }
+
+        char* json = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        if (!json) {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        }
+        httpd_resp_set_type(req, "application/json");
+        esp_err_t ret = httpd_resp_send(req, json, strlen(json));
+        cJSON_free(json);
+        return ret;
+    }
+
+    static esp_err_t motors_get_handler(httpd_req_t *req) {
+        return send_motors(req);
+    }
+
+    static esp_err_t motors_set_post_handler(httpd_req_t *req) {
+        if (!check_token(req)) {
+            httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+            return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Invalid or missing token");
+        }
+        if (req->content_len == 0 || req->content_len > MOTORS_MAX_BODY) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid body length");
+        }
+        char body[MOTORS_MAX_BODY + 1];
+        if (!receive_body(req, body)) return ESP_FAIL;
+        cJSON* root = cJSON_Parse(body);
+        if (!root) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        }
+
+        const char* error = NULL;
+        cJSON* spec = cJSON_GetObjectItem(root, "commands");
+        if (cJSON_IsTrue(cJSON_GetObjectItem(root, "stop"))) {
+            motion::stopAll();
+        } else if (cJSON_IsString(spec)) {
+            l298n::Command commands[l298n::MAX_MOTORS];
+            size_t count = 0;
+            if (!l298n::parseCommands(spec->valuestring, commands, l298n::MAX_MOTORS, &count)) {
+                error = "Invalid commands";
+            } else {
+                for (size_t i = 0; i < count; i++) {
+                    if (commands[i].motor == 0) {
+                        motion::stop();
+                        motor_control::stop();
+                    }
+                }
+                if (!l298n::apply(commands, count)) error = "Motors inhibited";
+            }
+        } else {
+            error = "Expected \"commands\" or \"stop\"";
+        }
+        cJSON_Delete(root);
+        if (error) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        }
+        return send_motors(req);
+    }
+
+    // ===== /api/spectrum =====
+    // Последний спектр тока мотора: полосы, доминирующая частота, сжатый спектр (мА)
+    static esp_err_t spectrum_get_handler(httpd_req_t *req) {
+        spectrum::Result r;
+        if (!spectrum::latest(&r)) {
+            httpd_resp_set_status(req, "503 Service Unavailable");
+            static const char* msg = "No spectrum yet";
+            return httpd_resp_send(req, msg, strlen(msg));
+        }
+        spectrum::Stats st = spectrum::getStats();
+        cJSON* root = cJSON_CreateObject();
+        cJSON_AddNumberToObject(root, "seq", r.seq);
+        cJSON_AddNumberToObject(root, "size", r.size);
+        cJSON_AddNumberToObject(root, "rate_hz", r.rate_hz);
+        cJSON_AddNumberToObject(root, "bin_hz", r.bin_hz_x100 / 100.0);
+        cJSON_AddNumberToObject(root, "dominant_hz", r.dominant_hz_x100 / 100.0);
+        cJSON_AddNumberToObject(root, "dominant_ma", r.dominant_ma);
+        cJSON_AddNumberToObject(root, "rms_ma", r.rms_ma);
+        cJSON_AddNumberToObject(root, "dc_ma", r.dc_ma);
+        cJSON* bands = cJSON_AddObjectToObject(root, "bands_rms_ma");
+        for (size_t b = 0; b < r.band_count; b++) {
+            cJSON_AddNumberToObject(bands, r.band_names[b], r.band_rms_ma[b]);
+        }
+        cJSON* compact = cJSON_AddArrayToObject(root, "spectrum_ma");
+        for (size_t g = 0; g < fft::COMPACT_BINS; g++) {
+            cJSON_AddItemToArray(compact, cJSON_CreateNumber(r.compact_ma[g]));
+        }
+        cJSON_AddNumberToObject(root, "cycles", st.last_cycles);
+        cJSON_AddNumberToObject(root, "elapsed_us", st.last_us);
+
+        char* json = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        if (!json) {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        }
+        httpd_resp_set_type(req, "application/json");
+        esp_err_t ret = httpd_resp_send(req, json, strlen(json));
+        cJSON_free(json);
+        return ret;
+    }
+
+    // ===== /api/alerts =====
+    // Правила, их состояние и последние события
+    static esp_err_t alerts_get_handler(httpd_req_t *req) {
+        cJSON* root = cJSON_CreateObject();
+        cJSON* rules = cJSON_AddArrayToObject(root, "rules");
+        for (size_t i = 0; i < alerts::ruleCount(); i++) {
+            alerts::Rule rule;
+            bool active;
+            alerts::getRule(i, &rule, &active);
+            cJSON* item = cJSON_CreateObject();
+            cJSON_AddStringToObject(item, "name", rule.name);
+            cJSON_AddBoolToObject(item, "enabled", rule.enabled);
+            cJSON_AddBoolToObject(item, "active", active);
+            cJSON_AddNumberToObject(item, "threshold", rule.threshold);
+            cJSON_AddNumberToObject(item, "hysteresis", rule.hysteresis);
+            cJSON_AddNumberToObject(item, "debounce_ms", rule.debounce_ms);
+            cJSON_AddItemToArray(rules, item);
+        }
+        cJSON* events = cJSON_AddArrayToObject(root, "events");
+        alerts::Event recent[16];
+        size_t n = alerts::recentEvents(recent, 16);
+        for (size_t i = 0; i < n; i++) {
+            alerts::Rule rule;
+            bool active;
+            alerts::getRule(recent[i].rule, &rule, &active);
+            cJSON* item = cJSON_CreateObject();
+            cJSON_AddNumberToObject(item, "seq", recent[i].seq);
+            cJSON_AddStringToObject(item, "rule", rule.name);
+            cJSON_AddBoolToObject(item, "active", recent[i].active);
+            cJSON_AddNumberToObject(item, "value", recent[i].value);
+            cJSON_AddNumberToObject(item, "time_ms", (double)(recent[i].time_us / 1000));
+            cJSON_AddItemToArray(events, item);
+        }
+        cJSON_AddBoolToObject(root, "motor_inhibited", l298n::isInhibited());
+
+        char* json = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        if (!json) {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        }
+        httpd_resp_set_type(req, "application/json");
+        esp_err_t ret = httpd_resp_send(req, json, strlen(json));
+        cJSON_free(json);
+        return ret;
+    }
+
+    // ===== Маршруты и статистика запросов =====
+    // Каждый обработчик вызывается через instrumented_handler, который считает
+    // запросы, ошибки и гистограмму времени обработки для /metrics.
+    static const uint32_t LATENCY_BOUNDS_US[] = { 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000 };
+    static const size_t LATENCY_BUCKETS = sizeof(LATENCY_BOUNDS_US) / sizeof(LATENCY_BOUNDS_US[0]) + 1;
+
+    struct Route {
+        const char* uri;
+        httpd_method_t method;
+        esp_err_t (*handler)(httpd_req_t *req);
+        uint32_t requests;
+        uint32_t errors;
+        uint32_t buckets[LATENCY_BUCKETS];
+        uint64_t latency_sum_us;
+    };
+
+    // Статические файлы последними: "/*" совпадает с любым URI
+    static Route routes[] = {
+        { "/api/voltage_3v3",   HTTP_GET,  voltage_3v3_get_handler,   0, 0, {}, 0 },
+        { "/api/voltage_r1_r2", HTTP_GET,  voltage_r1_r2_get_handler, 0, 0, {}, 0 },
+        { "/metrics",           HTTP_GET,  metrics_get_handler,       0, 0, {}, 0 },
+        { "/api/cmd",           HTTP_POST, cmd_post_handler,          0, 0, {}, 0 },
+        { "/api/telemetry",     HTTP_GET,  telemetry_get_handler,     0, 0, {}, 0 },
+        { "/api/adc/raw",       HTTP_GET,  adc_raw_get_handler,       0, 0, {}, 0 },
+        { "/api/power",         HTTP_GET,  power_get_handler,         0, 0, {}, 0 },
+        { "/api/energy",        HTTP_GET,  energy_get_handler,        0, 0, {}, 0 },
+        { "/api/energy/reset",  HTTP_POST, energy_reset_post_handler, 0, 0, {}, 0 },
+        { "/api/alerts",        HTTP_GET,  alerts_get_handler,        0, 0, {}, 0 },
+        { "/api/spectrum",      HTTP_GET,  spectrum_get_handler,      0, 0, {}, 0 },
+        { "/api/motor",         HTTP_GET,  motor_get_handler,         0, 0, {}, 0 },
+        { "/api/motor/set",     HTTP_POST, motor_set_post_handler,    0, 0, {}, 0 },
+        { "/api/motion",        HTTP_GET,  motion_get_handler,        0, 0, {}, 0 },
+        { "/api/motion/set",    HTTP_POST, motion_set_post_handler,   0, 0, {}, 0 },
+        { "/api/motors",        HTTP_GET,  motors_get_handler,        0, 0, {}, 0 },
+        { "/api/motors/set",    HTTP_POST, motors_set_post_handler,   0, 0, {}, 0 },
+        { "/*",                 HTTP_GET,  static_files::getHandler,  0, 0, {}, 0 },
+    };
+
+    struct SessionStats {
+        uint32_t opened;
+        uint32_t closed;
+        uint32_t closed_at_capacity;
+        int active;
+    };
+    static SessionStats session_stats = {};
+    static int max_open_sockets = 0;
+
+    static esp_err_t instrumented_handler(httpd_req_t *req) {
+        Route* route = static_cast<Route*>(req->user_ctx);
+        int64_t start_us = esp_timer_get_time();
+        esp_err_t ret = route->handler(req);
+        uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+        size_t bucket = 0;
+        while (bucket < LATENCY_BUCKETS - 1 && elapsed_us > LATENCY_BOUNDS_US[bucket]) bucket++;
+        route->buckets[bucket]++;
+        route->latency_sum_us += elapsed_us;
+        route->requests++;
+        if (ret != ESP_OK) route->errors++;
+        return ret;
+    }
+
+    static esp_err_t session_open(httpd_handle_t hd, int sockfd) {
+        session_stats.opened++;
+        session_stats.active++;
+        return ESP_OK;
+    }
+
+    // При заданном close_fn сокет закрывает приложение
+    static void session_close(httpd_handle_t hd, int sockfd) {
+        // Закрытие при заполненном сервере - как правило, LRU purge
+        if (session_stats.active >= max_open_sockets) session_stats.closed_at_capacity++;
+        session_stats.closed++;
+        session_stats.active--;
+        close(sockfd);
+    }
+
+    static void render_http_metrics(MetricsWriter& w) {
+        metric_value(w, "http_sessions_active", "gauge", "Open HTTP sessions", session_stats.active);
+        metric_value(w, "http_sessions_max", "gauge", "HTTP session limit", max_open_sockets);
+        metric_value(w, "http_sessions_opened_total", "counter", "Accepted HTTP sessions", session_stats.opened);
+        metric_value(w, "http_sessions_closed_total", "counter", "Closed HTTP sessions", session_stats.closed);
+        metric_value(w, "http_sessions_closed_at_capacity_total", "counter",
+                     "Sessions closed while the server was full (LRU purge)", session_stats.closed_at_capacity);
+
+        metric_header(w, "http_request_errors_total", "counter", "Handler failures per route");
+        for (const auto& route : routes) {
+            metrics_printf(w, "http_request_errors_total{route=\"%s\"} %" PRIu32 "\n", route.uri, route.errors);
+        }
+        metric_header(w, "http_request_duration_seconds", "histogram", "Handler execution time per route");
+        for (const auto& route : routes) {
+            uint32_t cumulative = 0;
+            for (size_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+                cumulative += route.buckets[i];
+                metrics_printf(w, "http_request_duration_seconds_bucket{route=\"%s\",le=\"%" PRIu32 ".%06" PRIu32 "\"} %" PRIu32 "\n",
+                               route.uri, LATENCY_BOUNDS_US[i] / 1000000, LATENCY_BOUNDS_US[i] % 1000000, cumulative);
+            }
+            metrics_printf(w, "http_request_duration_seconds_bucket{route=\"%s\",le=\"+Inf\"} %" PRIu32 "\n",
+                           route.uri, route.requests);
+            metrics_printf(w, "http_request_duration_seconds_sum{route=\"%s\"} %" PRIu64 ".%06" PRIu64 "\n",
+                           route.uri, route.latency_sum_us / 1000000, route.latency_sum_us % 1000000);
+            metrics_printf(w, "http_request_duration_seconds_count{route=\"%s\"} %" PRIu32 "\n", route.uri, route.requests);
+        }
+    }
+
     // Регистрация обработчиков URI
     static void register_handlers(httpd_handle_t server) {
-        httpd_uri_t voltage_3v3_uri = {
-            .uri       = "/api/voltage_3v3",
-            .method    = HTTP_GET,
-            .handler   = voltage_3v3_get_handler,
-            .user_ctx  = NULL
-        };
-        httpd_uri_t voltage_r1_r2_uri = {
-            .uri       = "/api/voltage_r1_r2",
-            .method    = HTTP_GET,
-            .handler   = voltage_r1_r2_get_handler,
-            .user_ctx  = NULL
-        };
-        httpd_register_uri_handler(server, &voltage_3v3_uri);
-        httpd_register_uri_handler(server, &voltage_r1_r2_uri);
-        ESP_LOGI(TAG, "Registered URI handlers for /api/voltage_3v3 and /api/voltage_r1_r2");
+        for (auto& route : routes) {
+            httpd_uri_t uri = {
+                .uri       = route.uri,
+                .method    = route.method,
+                .handler   = instrumented_handler,
+                .user_ctx  = &route
+            };
+            if (httpd_register_uri_handler(server, &uri) != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to register handler for %s", route.uri);
+            }
+        }
+        ESP_LOGI(TAG, "Registered %d URI handlers", (int)(sizeof(routes) / sizeof(routes[0])));
     }
 
     void init() {
@@ -75,6 +1223,17 @@ namespace http_api_server {
         httpd_config_t config = HTTPD_DEFAULT_CONFIG();
         config.server_port = SERVER_PORT;
         config.lru_purge_enable = true;
+        config.stack_size = 6144; // /metrics и /api/cmd используют буферы на стеке
+        config.keep_alive_enable = true; // TCP keep-alive для постоянных соединений автоматизации
+        config.max_uri_handlers = 24;
+        config.uri_match_fn = httpd_uri_match_wildcard;
+        config.open_fn = session_open;
+        config.close_fn = session_close;
+        max_open_sockets = config.max_open_sockets;
+        session_stats.active = 0;
+
+        static_files::init();
+        load_token();
 
         // Запускаем сервер
         if (httpd_start(&server, &config) == ESP_OK) {
@@ -4,6 +4,9 @@
 namespace http_api_server {
     void init();
     void stop();
+
+    // Токен API (8..32 печатных символа без пробелов), сохраняется в NVS
+    bool setToken(const char* token);
 }
 
 #endif
\ No newline at end of file
@@ -1,42 +1,186 @@
 #include "l298n.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
 #include "driver/ledc.h"
+#include "driver/mcpwm_prelude.h"
+#include "hal/gpio_ll.h"
+#include "esp_rom_gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include <cstdlib>
+#include <cstring>
 #include <inttypes.h>
 
 namespace l298n {
-    #define ENA_GPIO 8
-    #define IN1_GPIO 0
-    #define IN2_GPIO 1
     #define LEDC_TIMER LEDC_TIMER_0
-    #define LEDC_CHANNEL LEDC_CHANNEL_0
-    #define LEDC_FREQ 150 // PWM frequency, Hz
-    #define LEDC_RESOLUTION LEDC_TIMER_13_BIT  // PWM resolution
     #define FIXED_DUTY 6191
     static const char* TAG = "l298n";
+    static const char* NVS_NAMESPACE = "motors";
+    static const char* NVS_KEY = "cfg";
+    static const uint8_t STORE_VERSION = 1;
 
-    // Добавляем флаг для контроля работы задачи
-    static volatile bool cycleTaskRunning = false;
-    static TaskHandle_t cycleTaskHandle = NULL;
+    // Таймеры MCPWM 16-битные: разрешение делится пополам от 10 МГц, пока период
+    // не поместится в счётчик (150 Гц -> 5 МГц, 33333 такта)
+    static const uint32_t MCPWM_RESOLUTION_HZ = 10000000;
+    static const uint32_t MCPWM_MIN_RESOLUTION_HZ = 625000;
+    static const uint32_t MCPWM_MAX_PERIOD_TICKS = 65535;
+    static const uint32_t MCPWM_MIN_PERIOD_TICKS = 100;
+    static const uint32_t DEAD_TIME_NS = 1000;
 
-    void init() {
-        gpio_set_direction(static_cast<gpio_num_t>(IN1_GPIO), GPIO_MODE_OUTPUT);
-        gpio_set_direction(static_cast<gpio_num_t>(IN2_GPIO), GPIO_MODE_OUTPUT);
+    static const MotorConfig BUILTIN_MOTOR = { "m0", 8, 0, 1, -1, Backend::Ledc };
+
+    struct Motor {
+        MotorConfig config;
+        ledc_channel_t channel;          // LEDC: канал = индекс мотора
+        uint32_t phase;                  // Смещение фронта, 0..MAX_DUTY от периода
+        volatile int direction;          // 1 - вперёд, -1 - назад, 0 - выключен
+        uint32_t duty;                   // Последняя заданная скважность (для MCPWM)
+        mcpwm_timer_handle_t timer;
+        mcpwm_oper_handle_t oper;
+        mcpwm_cmpr_handle_t cmpr;
+        mcpwm_gen_handle_t gen;
+        mcpwm_gen_handle_t gen_comp;
+    };
+
+    struct Stored {
+        uint8_t version;
+        uint8_t count;
+        MotorConfig motors[MAX_MOTORS - 1];
+    };
+
+    static Motor motors[MAX_MOTORS];
+    static volatile size_t motor_count = 0;
+    static mcpwm_sync_handle_t mcpwm_sync = NULL;
+    static uint32_t mcpwm_period = 0;
+    static SemaphoreHandle_t config_lock = NULL;   // Добавление/удаление и команды моторам кроме 0
+    static portMUX_TYPE apply_lock = portMUX_INITIALIZER_UNLOCKED;
+
+    static volatile bool inhibited = false;
+    static volatile bool ena_detached = false;  // ENA отключены от ШИМ аварийной остановкой
+    static uint32_t pwm_freq_hz = DEFAULT_PWM_FREQ_HZ;
+    static uint32_t pwm_resolution = DEFAULT_PWM_RESOLUTION;
+
+    static uint32_t to_hw(uint32_t duty) {
+        if (duty > MAX_DUTY) duty = MAX_DUTY;
+        return (uint32_t)(((uint64_t)duty * ((1u << pwm_resolution) - 1) + MAX_DUTY / 2) / MAX_DUTY);
+    }
+
+    static uint32_t from_hw(uint32_t duty) {
+        uint32_t hw_max = (1u << pwm_resolution) - 1;
+        return (uint32_t)(((uint64_t)duty * MAX_DUTY + hw_max / 2) / hw_max);
+    }
+
+    static esp_err_t config_timer(uint32_t freq_hz, uint32_t resolution_bits) {
         ledc_timer_config_t ledc_timer = {
             .speed_mode = LEDC_LOW_SPEED_MODE,
-            .duty_resolution = static_cast<ledc_timer_bit_t>(LEDC_RESOLUTION),
+            .duty_resolution = static_cast<ledc_timer_bit_t>(resolution_bits),
             .timer_num = static_cast<ledc_timer_t>(LEDC_TIMER),
-            .freq_hz = LEDC_FREQ,
+            .freq_hz = freq_hz,
             .clk_cfg = LEDC_AUTO_CLK,
             .deconfigure = false
         };
-        ledc_timer_config(&ledc_timer);
+        return ledc_timer_config(&ledc_timer);
+    }
+
+    static bool mcpwm_timing(uint32_t freq_hz, uint32_t* resolution_hz, uint32_t* period_ticks) {
+        uint32_t resolution = MCPWM_RESOLUTION_HZ;
+        while (resolution / freq_hz > MCPWM_MAX_PERIOD_TICKS && resolution > MCPWM_MIN_RESOLUTION_HZ) resolution /= 2;
+        uint32_t period = resolution / freq_hz;
+        if (period < MCPWM_MIN_PERIOD_TICKS || period > MCPWM_MAX_PERIOD_TICKS) return false;
+        if (resolution_hz) *resolution_hz = resolution;
+        if (period_ticks) *period_ticks = period;
+        return true;
+    }
+
+    static bool valid_index(size_t motor) {
+        return motor < motor_count;
+    }
+
+    static void set_direction(Motor& m, int dir) {
+        gpio_set_level(static_cast<gpio_num_t>(m.config.in1_gpio), dir > 0 ? 1 : 0);
+        gpio_set_level(static_cast<gpio_num_t>(m.config.in2_gpio), dir < 0 ? 1 : 0);
+        m.direction = dir;
+    }
+
+    // LEDC не переносит импульс через конец периода (hpoint + duty должно
+    // поместиться в счётчик), поэтому при большой скважности смещение уменьшается
+    static uint32_t ledc_hpoint(const Motor& m, uint32_t hw_duty) {
+        uint32_t hw_max = (1u << pwm_resolution) - 1;
+        uint32_t hpoint = to_hw(m.phase);
+        if (hpoint + hw_duty > hw_max) hpoint = hw_duty >= hw_max ? 0 : hw_max - hw_duty;
+        return hpoint;
+    }
+
+    // Запись скважности без ожидания: LEDC и сравнение MCPWM подхватывают новое
+    // значение на границе периода
+    static void write_duty(Motor& m, uint32_t duty) {
+        if (duty > MAX_DUTY) duty = MAX_DUTY;
+        m.duty = duty;
+        if (m.config.backend == Backend::Ledc) {
+            uint32_t hw = to_hw(duty);
+            ledc_set_duty_with_hpoint(LEDC_LOW_SPEED_MODE, m.channel, hw, ledc_hpoint(m, hw));
+            ledc_update_duty(LEDC_LOW_SPEED_MODE, m.channel);
+            return;
+        }
+        if (!m.gen) return;
+        if (duty == 0) {
+            mcpwm_generator_set_force_level(m.gen, 0, true);
+        } else if (duty == MAX_DUTY) {
+            mcpwm_generator_set_force_level(m.gen, 1, true);
+        } else {
+            mcpwm_comparator_set_compare_value(m.cmpr, (uint32_t)((uint64_t)duty * mcpwm_period / MAX_DUTY));
+            mcpwm_generator_set_force_level(m.gen, -1, true);
+        }
+    }
+
+    static uint32_t read_duty(const Motor& m) {
+        if (m.config.backend == Backend::Ledc) return from_hw(ledc_get_duty(LEDC_LOW_SPEED_MODE, m.channel));
+        return m.gen ? m.duty : 0;
+    }
+
+    static void stop_motor(Motor& m) {
+        if (m.config.backend == Backend::Ledc) ledc_fade_stop(LEDC_LOW_SPEED_MODE, m.channel);
+        write_duty(m, 0);
+        set_direction(m, 0);
+    }
+
+    static void drive_motor(Motor& m, int dir, uint32_t duty) {
+        if (m.config.backend == Backend::Ledc) ledc_fade_stop(LEDC_LOW_SPEED_MODE, m.channel);
+        set_direction(m, dir);
+        write_duty(m, dir ? duty : 0);
+    }
+
+    static bool fade_motor(Motor& m, bool forward, uint32_t duty, uint32_t ramp_ms) {
+        if (m.config.backend != Backend::Ledc) return false;
+        ledc_fade_stop(LEDC_LOW_SPEED_MODE, m.channel);
+        if (m.direction != (forward ? 1 : -1)) {
+            write_duty(m, 0);
+            set_direction(m, forward ? 1 : -1);
+        }
+        if (ramp_ms == 0) {
+            write_duty(m, duty);
+            return true;
+        }
+        // hpoint не меняется во время fade: сразу выставляется допустимый для большей из скважностей
+        uint32_t current = ledc_get_duty(LEDC_LOW_SPEED_MODE, m.channel);
+        uint32_t target = to_hw(duty);
+        ledc_set_duty_with_hpoint(LEDC_LOW_SPEED_MODE, m.channel, current, ledc_hpoint(m, current > target ? current : target));
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, m.channel);
+        m.duty = duty;
+        if (ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, m.channel, target, ramp_ms) != ESP_OK) return false;
+        return ledc_fade_start(LEDC_LOW_SPEED_MODE, m.channel, LEDC_FADE_NO_WAIT) == ESP_OK;
+    }
+
+    // Канал LEDC на выводе ENA; повторный вызов заново подключает вывод к LEDC
+    static void config_channel(Motor& m) {
         ledc_channel_config_t ledc_channel = {
-            .gpio_num = static_cast<gpio_num_t>(ENA_GPIO),
+            .gpio_num = m.config.ena_gpio,
             .speed_mode = LEDC_LOW_SPEED_MODE,
-            .channel = static_cast<ledc_channel_t>(LEDC_CHANNEL),
+            .channel = m.channel,
             .intr_type = LEDC_INTR_DISABLE,
             .timer_sel = static_cast<ledc_timer_t>(LEDC_TIMER),
             .duty = 0,
@@ -45,80 +189,578 @@ namespace l298n {
             .flags = {}
         };
         ledc_channel_config(&ledc_channel);
-        ESP_LOGI(TAG, "L298N initialized successfully.");
+        m.duty = 0;
+    }
+
+    static void config_direction_pins(const Motor& m) {
+        gpio_set_direction(static_cast<gpio_num_t>(m.config.in1_gpio), GPIO_MODE_OUTPUT);
+        gpio_set_direction(static_cast<gpio_num_t>(m.config.in2_gpio), GPIO_MODE_OUTPUT);
+        gpio_set_level(static_cast<gpio_num_t>(m.config.in1_gpio), 0);
+        gpio_set_level(static_cast<gpio_num_t>(m.config.in2_gpio), 0);
+    }
+
+    static void release_pin(int8_t gpio) {
+        if (gpio < 0) return;
+        gpio_reset_pin(static_cast<gpio_num_t>(gpio));
+        gpio_set_direction(static_cast<gpio_num_t>(gpio), GPIO_MODE_OUTPUT);
+        gpio_set_level(static_cast<gpio_num_t>(gpio), 0);
+    }
+
+    // Все ресурсы MCPWM освобождаются, выводы ENA (и инверсные) - обычные выходы в 0
+    static void mcpwm_teardown() {
+        for (size_t i = 0; i < MAX_MOTORS; i++) {
+            Motor& m = motors[i];
+            if (m.timer) {
+                mcpwm_timer_start_stop(m.timer, MCPWM_TIMER_STOP_EMPTY);
+                mcpwm_timer_disable(m.timer);
+            }
+        }
+        for (size_t i = 0; i < MAX_MOTORS; i++) {
+            Motor& m = motors[i];
+            if (m.gen_comp) mcpwm_del_generator(m.gen_comp);
+            if (m.gen) mcpwm_del_generator(m.gen);
+            if (m.cmpr) mcpwm_del_comparator(m.cmpr);
+            if (m.oper) mcpwm_del_operator(m.oper);
+            if (m.gen || m.gen_comp) {
+                release_pin(m.config.ena_gpio);
+                release_pin(m.config.comp_gpio);
+            }
+            m.gen_comp = NULL;
+            m.gen = NULL;
+            m.cmpr = NULL;
+            m.oper = NULL;
+        }
+        if (mcpwm_sync) mcpwm_del_sync_src(mcpwm_sync);
+        mcpwm_sync = NULL;
+        for (size_t i = 0; i < MAX_MOTORS; i++) {
+            if (motors[i].timer) mcpwm_del_timer(motors[i].timer);
+            motors[i].timer = NULL;
+        }
+    }
+
+    // Оператор мотора: генератор A на ENA поднимается на нуле счётчика и падает
+    // на сравнении; генератор B (если задан) - инверсная копия A с мёртвым временем
+    static esp_err_t mcpwm_build_motor(Motor& m, uint32_t resolution_hz, uint32_t phase_ticks) {
+        mcpwm_timer_config_t timer_config = {};
+        timer_config.group_id = 0;
+        timer_config.clk_src = MCPWM_TIMER_CLK_SRC_DEFAULT;
+        timer_config.resolution_hz = resolution_hz;
+        timer_config.count_mode = MCPWM_TIMER_COUNT_MODE_UP;
+        timer_config.period_ticks = mcpwm_period;
+        esp_err_t err = mcpwm_new_timer(&timer_config, &m.timer);
+        if (err != ESP_OK) return err;
+
+        bool slave = mcpwm_sync != NULL;
+        if (!slave) {
+            // Первый таймер - ведущий: его ноль синхронизирует остальные
+            mcpwm_timer_sync_src_config_t sync_config = {};
+            sync_config.timer_event = MCPWM_TIMER_EVENT_EMPTY;
+            err = mcpwm_new_timer_sync_src(m.timer, &sync_config, &mcpwm_sync);
+        } else {
+            mcpwm_timer_sync_phase_config_t phase_config = {};
+            phase_config.sync_src = mcpwm_sync;
+            phase_config.count_value = phase_ticks;
+            phase_config.direction = MCPWM_TIMER_DIRECTION_UP;
+            err = mcpwm_timer_set_phase_on_sync(m.timer, &phase_config);
+        }
+        if (err != ESP_OK) return err;
+
+        mcpwm_operator_config_t oper_config = {};
+        oper_config.group_id = 0;
+        oper_config.flags.update_gen_action_on_tez = true;
+        oper_config.flags.update_dead_time_on_tez = true;
+        err = mcpwm_new_operator(&oper_config, &m.oper);
+        if (err == ESP_OK) err = mcpwm_operator_connect_timer(m.oper, m.timer);
+        if (err != ESP_OK) return err;
+
+        // Ведущий обновляет сравнение на своём нуле, ведомые - по событию
+        // синхронизации от него же: новые скважности вступают в силу в один момент
+        mcpwm_comparator_config_t cmpr_config = {};
+        cmpr_config.flags.update_cmp_on_tez = !slave;
+        cmpr_config.flags.update_cmp_on_sync = slave;
+        err = mcpwm_new_comparator(m.oper, &cmpr_config, &m.cmpr);
+        if (err == ESP_OK) err = mcpwm_comparator_set_compare_value(m.cmpr, 0);
+        if (err != ESP_OK) return err;
+
+        mcpwm_generator_config_t gen_config = {};
+        gen_config.gen_gpio_num = m.config.ena_gpio;
+        err = mcpwm_new_generator(m.oper, &gen_config, &m.gen);
+        if (err == ESP_OK) {
+            err = mcpwm_generator_set_action_on_timer_event(m.gen,
+                MCPWM_GEN_TIMER_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, MCPWM_TIMER_EVENT_EMPTY, MCPWM_GEN_ACTION_HIGH));
+        }
+        if (err == ESP_OK) {
+            err = mcpwm_generator_set_action_on_compare_event(m.gen,
+                MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, m.cmpr, MCPWM_GEN_ACTION_LOW));
+        }
+        if (err == ESP_OK) err = mcpwm_generator_set_force_level(m.gen, 0, true);
+        if (err != ESP_OK || m.config.comp_gpio < 0) return err;
+
+        gen_config.gen_gpio_num = m.config.comp_gpio;
+        err = mcpwm_new_generator(m.oper, &gen_config, &m.gen_comp);
+        if (err != ESP_OK) return err;
+        uint32_t dead_ticks = (uint32_t)((uint64_t)resolution_hz * DEAD_TIME_NS / 1000000000ULL);
+        if (dead_ticks == 0) dead_ticks = 1;
+        mcpwm_dead_time_config_t high = {};
+        high.posedge_delay_ticks = dead_ticks;
+        mcpwm_dead_time_config_t low = {};
+        low.negedge_delay_ticks = dead_ticks;
+        low.flags.invert_output = true;
+        err = mcpwm_generator_set_dead_time(m.gen, m.gen, &high);
+        if (err == ESP_OK) err = mcpwm_generator_set_dead_time(m.gen, m.gen_comp, &low);
+        return err;
+    }
+
+    // Таймеры MCPWM-моторов с общим периодом; k-й из n стартует со смещением k/n периода
+    static bool mcpwm_build() {
+        size_t total = 0;
+        for (size_t i = 0; i < motor_count; i++) {
+            if (motors[i].config.backend == Backend::Mcpwm) total++;
+        }
+        if (total == 0) return true;
+        uint32_t resolution_hz;
+        if (!mcpwm_timing(pwm_freq_hz, &resolution_hz, &mcpwm_period)) {
+            ESP_LOGE(TAG, "MCPWM cannot run at %" PRIu32 " Hz", pwm_freq_hz);
+            return false;
+        }
+        esp_err_t err = ESP_OK;
+        for (size_t i = 0; i < motor_count && err == ESP_OK; i++) {
+            Motor& m = motors[i];
+            if (m.config.backend != Backend::Mcpwm) continue;
+            err = mcpwm_build_motor(m, resolution_hz, (uint32_t)((uint64_t)m.phase * mcpwm_period / (MAX_DUTY + 1)));
+            m.duty = 0;
+        }
+        for (size_t i = 0; i < motor_count && err == ESP_OK; i++) {
+            if (!motors[i].timer) continue;
+            err = mcpwm_timer_enable(motors[i].timer);
+            if (err == ESP_OK) err = mcpwm_timer_start_stop(motors[i].timer, MCPWM_TIMER_START_NO_STOP);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "MCPWM setup failed: %d", err);
+            mcpwm_teardown();
+            return false;
+        }
+        ESP_LOGI(TAG, "MCPWM: %u motor(s), %" PRIu32 " ticks @ %" PRIu32 " Hz", (unsigned)total, mcpwm_period, resolution_hz);
+        return true;
+    }
+
+    // Моторы одного модуля ШИМ равномерно распределяются по периоду. Мотор 0 -
+    // всегда первый LEDC со смещением 0, поэтому перестройка его не затрагивает
+    static void assign_phases() {
+        size_t total[2] = { 0, 0 };
+        for (size_t i = 0; i < motor_count; i++) total[(int)motors[i].config.backend]++;
+        size_t index[2] = { 0, 0 };
+        for (size_t i = 0; i < motor_count; i++) {
+            int b = (int)motors[i].config.backend;
+            motors[i].phase = (uint32_t)(index[b]++ * (MAX_DUTY + 1) / total[b]);
+        }
+    }
+
+    // Перестройка добавленных моторов (1..); вызывается под config_lock
+    static void rebuild() {
+        for (size_t i = 1; i < motor_count; i++) stop_motor(motors[i]);
+        mcpwm_teardown();
+        assign_phases();
+        for (size_t i = 1; i < motor_count; i++) {
+            Motor& m = motors[i];
+            m.channel = static_cast<ledc_channel_t>(LEDC_CHANNEL_0 + i);
+            config_direction_pins(m);
+            m.direction = 0;
+            if (m.config.backend == Backend::Ledc) config_channel(m);
+        }
+        mcpwm_build();
+    }
+
+    static bool save() {
+        Stored stored = {};
+        stored.version = STORE_VERSION;
+        stored.count = (uint8_t)(motor_count - 1);
+        for (size_t i = 1; i < motor_count; i++) stored.motors[i - 1] = motors[i].config;
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err == ESP_OK) {
+            err = nvs_set_blob(handle, NVS_KEY, &stored, sizeof(stored));
+            if (err == ESP_OK) err = nvs_commit(handle);
+            nvs_close(handle);
+        }
+        if (err != ESP_OK) ESP_LOGE(TAG, "Failed to save motors: %d", err);
+        return err == ESP_OK;
+    }
+
+    static bool pin_in_use(int8_t gpio) {
+        if (gpio < 0) return false;
+        for (size_t i = 0; i < motor_count; i++) {
+            const MotorConfig& c = motors[i].config;
+            if (c.ena_gpio == gpio || c.in1_gpio == gpio || c.in2_gpio == gpio || c.comp_gpio == gpio) return true;
+        }
+        return false;
+    }
+
+    static bool valid_config(const MotorConfig& c) {
+        if (c.name[0] == '\0' || memchr(c.name, '\0', MAX_NAME_LEN) == NULL) return false;
+        int8_t pins[] = { c.ena_gpio, c.in1_gpio, c.in2_gpio, c.comp_gpio };
+        for (size_t i = 0; i < 4; i++) {
+            if (i < 3 && pins[i] < 0) return false;
+            if (pins[i] >= 0 && (!GPIO_IS_VALID_OUTPUT_GPIO(pins[i]) || pin_in_use(pins[i]))) return false;
+            for (size_t j = 0; j < i; j++) {
+                if (pins[i] >= 0 && pins[i] == pins[j]) return false;
+            }
+        }
+        return c.backend == Backend::Mcpwm || c.comp_gpio < 0;
+    }
+
+    static void load() {
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return;
+        Stored stored;
+        size_t len = sizeof(stored);
+        if (nvs_get_blob(handle, NVS_KEY, &stored, &len) == ESP_OK && len == sizeof(stored) &&
+            stored.version == STORE_VERSION && stored.count < MAX_MOTORS) {
+            // Те же проверки, что в addMotor: запись могла остаться от другой платы или
+            // встроенного мотора - неверная конфигурация пропускается, а не занимает выводы
+            size_t mcpwm_count = 0;
+            for (size_t i = 0; i < stored.count; i++) {
+                const MotorConfig& c = stored.motors[i];
+                bool mcpwm = c.backend == Backend::Mcpwm;
+                if (!valid_config(c) || findMotor(c.name) >= 0 || (mcpwm && mcpwm_count == MAX_MCPWM_MOTORS) ||
+                    (!mcpwm && c.backend != Backend::Ledc)) {
+                    ESP_LOGW(TAG, "Stored motor %u is invalid, skipped", (unsigned)i);
+                    continue;
+                }
+                if (mcpwm) mcpwm_count++;
+                motors[motor_count++].config = c;
+            }
+        }
+        nvs_close(handle);
+    }
+
+    void init() {
+        config_lock = xSemaphoreCreateMutex();
+        motors[0].config = BUILTIN_MOTOR;
+        motor_count = 1;
+        load();
+        motors[0].channel = static_cast<ledc_channel_t>(LEDC_CHANNEL_0);
+        config_direction_pins(motors[0]);
+        config_timer(pwm_freq_hz, pwm_resolution);
+        config_channel(motors[0]);
+        // Сервис аппаратного fade (прерывание LEDC по окончании изменения)
+        ledc_fade_func_install(0);
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        rebuild();
+        xSemaphoreGive(config_lock);
+        ESP_LOGI(TAG, "L298N initialized successfully, %u motor(s).", (unsigned)motor_count);
     }
 
     void forward() {
-        gpio_set_level(static_cast<gpio_num_t>(IN1_GPIO), 1);
-        gpio_set_level(static_cast<gpio_num_t>(IN2_GPIO), 0);
-        ledc_set_duty(LEDC_LOW_SPEED_MODE, static_cast<ledc_channel_t>(LEDC_CHANNEL), FIXED_DUTY);
-        ledc_update_duty(LEDC_LOW_SPEED_MODE, static_cast<ledc_channel_t>(LEDC_CHANNEL));
+        drive(true, FIXED_DUTY);
     }
 
     void backward() {
-        gpio_set_level(static_cast<gpio_num_t>(IN1_GPIO), 0);
-        gpio_set_level(static_cast<gpio_num_t>(IN2_GPIO), 1);
-        ledc_set_duty(LEDC_LOW_SPEED_MODE, static_cast<ledc_channel_t>(LEDC_CHANNEL), FIXED_DUTY);
-        ledc_update_duty(LEDC_LOW_SPEED_MODE, static_cast<ledc_channel_t>(LEDC_CHANNEL));
+        drive(false, FIXED_DUTY);
+    }
+
+    // Мотор 0 управляется без config_lock: его канал и выводы не меняются
+    void drive(bool forward, uint32_t duty) {
+        if (inhibited) return;
+        drive_motor(motors[0], forward ? 1 : -1, duty);
+    }
+
+    void setDuty(uint32_t duty) {
+        if (inhibited) return;
+        write_duty(motors[0], duty);
+    }
+
+    uint32_t getDuty() {
+        return read_duty(motors[0]);
+    }
+
+    bool fade(bool forward, uint32_t duty, uint32_t ramp_ms) {
+        if (inhibited) return false;
+        return fade_motor(motors[0], forward, duty, ramp_ms);
     }
 
     void stop() {
-        ledc_set_duty(LEDC_LOW_SPEED_MODE, static_cast<ledc_channel_t>(LEDC_CHANNEL), 0);
-        ledc_update_duty(LEDC_LOW_SPEED_MODE, static_cast<ledc_channel_t>(LEDC_CHANNEL));
-        gpio_set_level(static_cast<gpio_num_t>(IN1_GPIO), 0);
-        gpio_set_level(static_cast<gpio_num_t>(IN2_GPIO), 0);
-    }
-
-    static void runCycleTask(void *pvParameters) {
-        cycleTaskRunning = true;
-        while (cycleTaskRunning) {
-            forward();
-            vTaskDelay(2000 / portTICK_PERIOD_MS);
-            // backward();
-            vTaskDelay(300 / portTICK_PERIOD_MS);
-            
-            // Проверяем флаг на каждой итерации
-            if (!cycleTaskRunning) break;
-        }
-        
-        // Останавливаем мотор при завершении задачи
+        stop_motor(motors[0]);
+    }
+
+    int addMotor(const MotorConfig& config) {
+        if (!config_lock) return -1;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        size_t mcpwm_count = config.backend == Backend::Mcpwm ? 1 : 0;
+        for (size_t i = 0; i < motor_count; i++) {
+            if (motors[i].config.backend == Backend::Mcpwm) mcpwm_count++;
+        }
+        int index = -1;
+        if (motor_count < MAX_MOTORS && mcpwm_count <= MAX_MCPWM_MOTORS && valid_config(config) &&
+            findMotor(config.name) < 0) {
+            index = (int)motor_count;
+            motors[index].config = config;
+            motor_count++;
+            rebuild();
+            save();
+            ESP_LOGI(TAG, "Motor %d '%s': ENA %d, IN %d/%d, %s", index, config.name, config.ena_gpio,
+                     config.in1_gpio, config.in2_gpio, config.backend == Backend::Mcpwm ? "MCPWM" : "LEDC");
+        }
+        xSemaphoreGive(config_lock);
+        return index;
+    }
+
+    bool removeMotor(size_t motor) {
+        if (!config_lock || motor == 0) return false;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        bool ok = valid_index(motor);
+        if (ok) {
+            for (size_t i = 1; i < motor_count; i++) stop_motor(motors[i]);
+            mcpwm_teardown();
+            // Освободившийся последний канал LEDC и выводы удалённого мотора
+            Motor& last = motors[motor_count - 1];
+            if (last.config.backend == Backend::Ledc) ledc_stop(LEDC_LOW_SPEED_MODE, last.channel, 0);
+            MotorConfig removed = motors[motor].config;
+            for (size_t i = motor; i + 1 < motor_count; i++) motors[i].config = motors[i + 1].config;
+            motor_count--;
+            release_pin(removed.ena_gpio);
+            release_pin(removed.in1_gpio);
+            release_pin(removed.in2_gpio);
+            release_pin(removed.comp_gpio);
+            rebuild();
+            save();
+            ESP_LOGI(TAG, "Motor '%s' removed", removed.name);
+        }
+        xSemaphoreGive(config_lock);
+        return ok;
+    }
+
+    size_t motorCount() {
+        return motor_count;
+    }
+
+    bool getMotor(size_t motor, MotorConfig* config) {
+        if (!valid_index(motor)) return false;
+        if (config) *config = motors[motor].config;
+        return true;
+    }
+
+    int findMotor(const char* name) {
+        if (!name) return -1;
+        for (size_t i = 0; i < motor_count; i++) {
+            if (strncmp(motors[i].config.name, name, MAX_NAME_LEN) == 0) return (int)i;
+        }
+        return -1;
+    }
+
+    bool drive(size_t motor, bool forward, uint32_t duty) {
+        if (motor == 0) {
+            drive(forward, duty);
+            return !inhibited;
+        }
+        if (!config_lock || inhibited) return false;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        bool ok = valid_index(motor);
+        if (ok) drive_motor(motors[motor], forward ? 1 : -1, duty);
+        xSemaphoreGive(config_lock);
+        return ok;
+    }
+
+    bool setDuty(size_t motor, uint32_t duty) {
+        if (motor == 0) {
+            setDuty(duty);
+            return !inhibited;
+        }
+        if (!config_lock || inhibited) return false;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        bool ok = valid_index(motor);
+        if (ok) write_duty(motors[motor], duty);
+        xSemaphoreGive(config_lock);
+        return ok;
+    }
+
+    uint32_t getDuty(size_t motor) {
+        return valid_index(motor) ? read_duty(motors[motor]) : 0;
+    }
+
+    int getDirection(size_t motor) {
+        return valid_index(motor) ? motors[motor].direction : 0;
+    }
+
+    bool fade(size_t motor, bool forward, uint32_t duty, uint32_t ramp_ms) {
+        if (motor == 0) return fade(forward, duty, ramp_ms);
+        if (!config_lock || inhibited) return false;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        bool ok = valid_index(motor) && fade_motor(motors[motor], forward, duty, ramp_ms);
+        xSemaphoreGive(config_lock);
+        return ok;
+    }
+
+    void stop(size_t motor) {
+        if (motor == 0) {
+            stop();
+            return;
+        }
+        if (!config_lock) return;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        if (valid_index(motor)) stop_motor(motors[motor]);
+        xSemaphoreGive(config_lock);
+    }
+
+    void stopAll() {
         stop();
-        
-        // Удаляем задачу
-        cycleTaskHandle = NULL;
-        vTaskDelete(NULL);
+        if (!config_lock) return;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        for (size_t i = 1; i < motor_count; i++) stop_motor(motors[i]);
+        xSemaphoreGive(config_lock);
     }
 
-    void startCycleTask() {
-        if (cycleTaskHandle == NULL) {
-            xTaskCreate(runCycleTask, "l298n_cycle_task", 2048, NULL, 5, &cycleTaskHandle);
-            ESP_LOGI(TAG, "L298N cycle task started");
-        } else {
-            ESP_LOGW(TAG, "Cycle task is already running");
+    bool apply(const Command* commands, size_t count) {
+        if (!config_lock || inhibited) return false;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        bool ok = true;
+        for (size_t i = 0; i < count && ok; i++) {
+            ok = valid_index(commands[i].motor) && commands[i].direction >= -1 && commands[i].direction <= 1;
         }
+        if (ok) {
+            // LEDC: драйвер при установленном fade берёт семафор канала, поэтому
+            // записи идут подряд вне критической секции (значение защёлкивается
+            // на переполнении общего таймера, но пакет может попасть на границу периода)
+            for (size_t i = 0; i < count; i++) {
+                Motor& m = motors[commands[i].motor];
+                if (m.config.backend == Backend::Ledc) drive_motor(m, commands[i].direction, commands[i].duty);
+            }
+            // MCPWM: записи без вытеснения, сравнения всех таймеров защёлкиваются
+            // одновременно на нуле ведущего таймера. Принудительные уровни (0 и MAX_DUTY)
+            // и направление действуют сразу - см. l298n.h
+            portENTER_CRITICAL(&apply_lock);
+            for (size_t i = 0; i < count; i++) {
+                Motor& m = motors[commands[i].motor];
+                if (m.config.backend != Backend::Mcpwm) continue;
+                set_direction(m, commands[i].direction);
+                write_duty(m, commands[i].direction ? commands[i].duty : 0);
+            }
+            portEXIT_CRITICAL(&apply_lock);
+        }
+        xSemaphoreGive(config_lock);
+        return ok;
     }
 
-    void stopCycleTask() {
-        if (cycleTaskHandle != NULL) {
-            cycleTaskRunning = false;
-            
-            // Даем задаче время завершиться корректно
-            int timeout = 10000;
-            while (cycleTaskHandle != NULL && timeout-- > 0) {
-                vTaskDelay(10 / portTICK_PERIOD_MS);
+    bool parseCommands(const char* spec, Command* commands, size_t max, size_t* count) {
+        size_t n = 0;
+        const char* pos = spec;
+        while (*pos) {
+            const char* colon = strchr(pos, ':');
+            if (!colon || colon == pos || (size_t)(colon - pos) >= MAX_NAME_LEN || n == max) return false;
+            char name[MAX_NAME_LEN];
+            memcpy(name, pos, colon - pos);
+            name[colon - pos] = '\0';
+            int motor = findMotor(name);
+            if (motor < 0) return false;
+            for (size_t i = 0; i < n; i++) {
+                if (commands[i].motor == (size_t)motor) return false;
             }
-            
-            // Если задача не завершилась, принудительно удаляем
-            if (cycleTaskHandle != NULL) {
-                vTaskDelete(cycleTaskHandle);
-                cycleTaskHandle = NULL;
-                ESP_LOGW(TAG, "Cycle task force stopped");
+            Command& c = commands[n++];
+            c.motor = motor;
+            c.duty = 0;
+            char dir = colon[1];
+            if (dir == 'f') c.direction = 1;
+            else if (dir == 'b') c.direction = -1;
+            else if (dir == 's') c.direction = 0;
+            else return false;
+            pos = colon + 2;
+            if (*pos == ':') {
+                char* end;
+                unsigned long duty = strtoul(pos + 1, &end, 10);
+                if (end == pos + 1 || duty > MAX_DUTY) return false;
+                c.duty = c.direction ? duty : 0;
+                pos = end;
+            } else if (c.direction) {
+                return false;
             }
-            
-            stop(); // Дополнительная страховка - останавливаем мотор
-            ESP_LOGI(TAG, "L298N cycle task stopped");
+            if (*pos == ',') pos++;
+            else if (*pos != '\0') return false;
+        }
+        if (n == 0) return false;
+        *count = n;
+        return true;
+    }
+
+    uint32_t phase(size_t motor) {
+        return valid_index(motor) ? motors[motor].phase : 0;
+    }
+
+    bool configurePwm(uint32_t freq_hz, uint32_t resolution_bits) {
+        if (freq_hz == 0 || resolution_bits < 1 || resolution_bits > 14) return false;
+        if (!config_lock) return false;
+        xSemaphoreTake(config_lock, portMAX_DELAY);
+        bool has_mcpwm = false;
+        for (size_t i = 0; i < motor_count; i++) {
+            if (motors[i].config.backend == Backend::Mcpwm) has_mcpwm = true;
+        }
+        bool ok = !has_mcpwm || mcpwm_timing(freq_hz, NULL, NULL);
+        for (size_t i = 0; i < motor_count; i++) stop_motor(motors[i]);
+        if (ok && config_timer(freq_hz, resolution_bits) != ESP_OK) {
+            config_timer(pwm_freq_hz, pwm_resolution);
+            ok = false;
+        }
+        if (ok) {
+            pwm_freq_hz = freq_hz;
+            pwm_resolution = resolution_bits;
+            rebuild();
+            ESP_LOGI(TAG, "PWM %" PRIu32 " Hz, %" PRIu32 " bit", freq_hz, resolution_bits);
         } else {
-            ESP_LOGW(TAG, "No active cycle task to stop");
+            ESP_LOGW(TAG, "PWM %" PRIu32 " Hz / %" PRIu32 " bit not supported", freq_hz, resolution_bits);
         }
+        xSemaphoreGive(config_lock);
+        return ok;
+    }
+
+    uint32_t pwmFrequency() {
+        return pwm_freq_hz;
+    }
+
+    uint32_t pwmResolution() {
+        return pwm_resolution;
+    }
+
+    // Из задачи (отключение по alerts из задачи выборки ADC): те же прямые записи
+    // GPIO, что и emergencyStop. config_lock держат и drive/setDuty/fade/apply, а
+    // ledc_fade_stop может ждать - поэтому ни того, ни другого: все моторы сразу
+    void inhibit() {
+        emergencyStop();
+    }
+
+    // Из ISR (монитор ADC): без драйверов и блокировок. ENA (и инверсные выходы
+    // MCPWM) переключаются матрицей GPIO с сигнала ШИМ на обычный выход 0,
+    // IN1/IN2 - в 0 (все моторы обесточены)
+    void IRAM_ATTR emergencyStop() {
+        inhibited = true;
+        gpio_dev_t* hw = GPIO_LL_GET_HW(GPIO_PORT_0);
+        for (size_t i = 0; i < motor_count; i++) {
+            Motor& m = motors[i];
+            esp_rom_gpio_connect_out_signal(m.config.ena_gpio, SIG_GPIO_OUT_IDX, false, false);
+            gpio_ll_set_level(hw, m.config.ena_gpio, 0);
+            if (m.config.comp_gpio >= 0) {
+                esp_rom_gpio_connect_out_signal(m.config.comp_gpio, SIG_GPIO_OUT_IDX, false, false);
+                gpio_ll_set_level(hw, m.config.comp_gpio, 0);
+            }
+            gpio_ll_set_level(hw, m.config.in1_gpio, 0);
+            gpio_ll_set_level(hw, m.config.in2_gpio, 0);
+            m.direction = 0;
+        }
+        ena_detached = true;
+    }
+
+    void release() {
+        if (ena_detached && config_lock) {
+            xSemaphoreTake(config_lock, portMAX_DELAY);
+            stop();
+            config_channel(motors[0]);
+            rebuild();
+            ena_detached = false;
+            xSemaphoreGive(config_lock);
+        }
+        inhibited = false;
+        ESP_LOGI(TAG, "L298N released");
+    }
+
+    bool isInhibited() {
+        return inhibited;
     }
-}
\ No newline at end of file
+}
@@ -1,13 +1,103 @@
 #ifndef L298N_H
 #define L298N_H
 
+#include <cstddef>
+#include <cstdint>
+
 namespace l298n {
+    // Скважность в API - всегда в 13-битной шкале 0..MAX_DUTY, независимо от
+    // фактического разрешения таймера LEDC (configurePwm)
+    static const uint32_t MAX_DUTY = 8191;
+    static const uint32_t DEFAULT_PWM_FREQ_HZ = 150;
+    static const uint32_t DEFAULT_PWM_RESOLUTION = 13;
+
+    // Моторы: 0 - встроенный канал (ENA GPIO8, IN1/IN2 GPIO0/1, LEDC), остальные
+    // добавляются во время работы (второй мост платы, следующие платы) и хранятся в NVS
+    static const size_t MAX_MOTORS = 4;
+    static const size_t MAX_MCPWM_MOTORS = 3;   // Операторов MCPWM в группе ESP32-C6
+    static const size_t MAX_NAME_LEN = 12;
+
+    enum class Backend : uint8_t {
+        Ledc,    // Канал LEDC на общем таймере, смещение фронта через hpoint
+        Mcpwm    // Свой таймер MCPWM, синхронизированный с первым; сравнение защёлкивается на нуле ведущего
+    };
+
+    struct MotorConfig {
+        char name[MAX_NAME_LEN];
+        int8_t ena_gpio;
+        int8_t in1_gpio;
+        int8_t in2_gpio;
+        int8_t comp_gpio;    // Только MCPWM: инверсный ШИМ с мёртвым временем, -1 - не используется
+        Backend backend;
+    };
+
+    // Команда пакетного обновления: direction 1 - вперёд, -1 - назад, 0 - стоп
+    struct Command {
+        size_t motor;
+        int8_t direction;
+        uint32_t duty;
+    };
+
     void init();
     void forward();
     void backward();
     void stop();
-    void startCycleTask();
-    void stopCycleTask();
+
+    // Направление и скважность напрямую (для регулятора тока); игнорируются при блокировке
+    void drive(bool forward, uint32_t duty);
+    void setDuty(uint32_t duty);             // Только скважность, без переключения IN1/IN2
+    uint32_t getDuty();                      // Текущая скважность, в том числе во время плавного изменения
+
+    // Плавное изменение скважности аппаратным fade LEDC, без ожидания окончания.
+    // Смена направления при ненулевой скважности сначала сбрасывает её в 0.
+    bool fade(bool forward, uint32_t duty, uint32_t ramp_ms);
+
+    // Экземпляры моторов. Добавление/удаление останавливает моторы 1.. и заново
+    // раздаёт им каналы и смещения фронтов; мотор 0 не затрагивается и не удаляется
+    int addMotor(const MotorConfig& config);   // Индекс или -1 (нет места, занятый/неверный вывод)
+    bool removeMotor(size_t motor);
+    size_t motorCount();
+    bool getMotor(size_t motor, MotorConfig* config);
+    int findMotor(const char* name);
+
+    // То же, что функции выше, для заданного мотора (fade - только LEDC)
+    bool drive(size_t motor, bool forward, uint32_t duty);
+    bool setDuty(size_t motor, uint32_t duty);
+    uint32_t getDuty(size_t motor);
+    int getDirection(size_t motor);
+    bool fade(size_t motor, bool forward, uint32_t duty, uint32_t ramp_ms);
+    void stop(size_t motor);
+    void stopAll();
+
+    // Пакетное обновление нескольких моторов. Одновременно, на нуле ведущего
+    // таймера, вступают в силу только значения сравнения MCPWM (скважность
+    // 1..MAX_DUTY-1), и то если запись пакета не пересекла этот ноль - тогда часть
+    // моторов меняется на период позже. Сразу, без синхронизации, применяются:
+    // скважность 0 и MAX_DUTY у MCPWM (принудительный уровень генератора), выводы
+    // направления IN1/IN2 и записи LEDC (каждая - на границе своего периода).
+    // false - неверный индекс (ничего не изменено) или блокировка
+    bool apply(const Command* commands, size_t count);
+
+    // Пакет текстом: "m0:f:4000,m1:b:2000,m2:s" - имя:f|b|s[:скважность], каждый
+    // мотор не более одного раза. false - неизвестное имя, повтор или ошибка формата
+    bool parseCommands(const char* spec, Command* commands, size_t max, size_t* count);
+
+    // Смещение начала импульса мотора, в долях периода 0..MAX_DUTY: моторы
+    // включаются поочерёдно, а не все на одном фронте
+    uint32_t phase(size_t motor);
+
+    // Частота и разрешение ШИМ (общие для всех моторов); моторы останавливаются.
+    // false - таймер не принял комбинацию (прежняя настройка восстанавливается)
+    bool configurePwm(uint32_t freq_hz, uint32_t resolution_bits);
+    uint32_t pwmFrequency();
+    uint32_t pwmResolution();
+
+    // Аварийная блокировка: все моторы остановлены (ENA отключены от ШИМ),
+    // команды игнорируются до release(). Без блокировок и ожидания
+    void inhibit();
+    void emergencyStop();                    // То же из ISR: выходы в 0 напрямую через GPIO
+    void release();
+    bool isInhibited();
 }
 
-#endif
\ No newline at end of file
+#endif
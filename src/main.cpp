@@ -10,13 +10,25 @@
 #include "wifi_core.h"
 #include "wifi_ap.h"
 #include "wifi_sta.h"
+#include "adc_sampler.h"
+#include "adc_cal.h"
+#include "power_meter.h"
+#include "energy.h"
+#include "spectrum.h"
+#include "motor_control.h"
+#include "motion.h"
+#include "protection.h"
+#include "alerts.h"
+#include "alert_webhook.h"
 #include "voltage.h"
 #include "acs712.h"
 #include "l298n.h"
+#include "telemetry.h"
 #include "console.h"
 #include "telnet_server.h"
 #include "dns_server.h"
 #include "http_api_server.h"
+#include "f660_fleet.h"
 
 extern "C" void app_main(void) {
     static const char *TAG = "main";
@@ -39,14 +51,28 @@ extern "C" void app_main(void) {
     wifi_sta::init();
 
     // 5. Инициализация периферии
+    // adc_sampler - первым: датчики регистрируют в нём свои каналы ADC, шаблон
+    // перестраивается с каждым новым каналом
+    adc_sampler::init();
+    adc_cal::init();
     voltage::init();
+    acs712::init();
+    energy::init();
+    power_meter::init();
+    spectrum::init();
     l298n::init();
-    // acs712::init();
+    protection::init();
+    motor_control::init();
+    motion::init();
+    alerts::init();
+    alert_webhook::init();
+    telemetry::init();
 
     // 6. Инициализация сетевых сервисов
     dns_server::init();
     telnet_server::init();
     http_api_server::init();
+    f660_fleet::init();
 
     // Основной цикл
     while (1) {
@@ -0,0 +1,243 @@
+#include "motion.h"
+#include "l298n.h"
+#include "motor_control.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace motion {
+    static const char* TAG = "motion";
+    static const char* NVS_NAMESPACE = "motion";
+    static const char* NVS_KEY = "profile";
+
+    // Как прежний цикл l298: вперёд с FIXED_DUTY, теперь с плавным пуском
+    static const char* BUILTIN_PROFILE = "f:6191:300:2000*0";
+
+    static Profile active = {};              // Под lock
+    static Profile default_profile = {};     // Под lock
+    static Status status = {};               // Под lock
+    static int64_t deadline_us = 0;          // Срок текущего шага - только в задаче esp_timer
+    static bool last_forward = true;
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    static esp_timer_handle_t timer = NULL;
+
+    static const char DIRECTION_CODES[] = { 'f', 'b', 'c' };
+
+    bool parse(const char* spec, Profile* profile) {
+        Profile p = {};
+        p.repeat = 1;
+        const char* pos = spec;
+        while (*pos) {
+            if (p.count == MAX_STEPS) return false;
+            char dir;
+            unsigned long duty, ramp, hold;
+            int used = 0;
+            if (sscanf(pos, "%c:%lu:%lu:%lu%n", &dir, &duty, &ramp, &hold, &used) != 4) return false;
+            Step& step = p.steps[p.count++];
+            if (dir == 'f') step.direction = Direction::Forward;
+            else if (dir == 'b') step.direction = Direction::Backward;
+            else if (dir == 'c') step.direction = Direction::Coast;
+            else return false;
+            if (duty > l298n::MAX_DUTY || ramp > MAX_STEP_MS || hold > MAX_STEP_MS) return false;
+            step.duty = step.direction == Direction::Coast ? 0 : duty;
+            step.ramp_ms = ramp;
+            step.hold_ms = hold;
+            pos += used;
+            if (*pos == ',') {
+                pos++;
+            } else if (*pos == '*') {
+                char* end;
+                p.repeat = strtoul(pos + 1, &end, 10);
+                if (end == pos + 1 || *end != '\0') return false;
+                break;
+            } else if (*pos != '\0') {
+                return false;
+            }
+        }
+        if (p.count == 0) return false;
+        *profile = p;
+        return true;
+    }
+
+    void format(const Profile& profile, char* buf, size_t len) {
+        size_t n = 0;
+        buf[0] = '\0';
+        for (size_t i = 0; i < profile.count && n < len; i++) {
+            const Step& s = profile.steps[i];
+            n += snprintf(buf + n, len - n, "%s%c:%" PRIu32 ":%" PRIu32 ":%" PRIu32, i ? "," : "",
+                          DIRECTION_CODES[(int)s.direction], s.duty, s.ramp_ms, s.hold_ms);
+        }
+        if (n < len && profile.repeat != 1) snprintf(buf + n, len - n, "*%" PRIu32, profile.repeat);
+    }
+
+    static void finish(const char* reason) {
+        l298n::stop();
+        portENTER_CRITICAL(&lock);
+        status.running = false;
+        portEXIT_CRITICAL(&lock);
+        ESP_LOGI(TAG, "Profile %s", reason);
+    }
+
+    // Шаг профиля: запуск fade и таймер на срок окончания шага
+    static void run_step(void*) {
+        int64_t now = esp_timer_get_time();
+        if (l298n::isInhibited()) {
+            finish("aborted: L298N inhibited");
+            return;
+        }
+
+        portENTER_CRITICAL(&lock);
+        bool running = status.running;
+        size_t index = status.step;
+        if (running && index >= active.count) {
+            index = 0;
+            status.cycle++;
+            if (active.repeat && status.cycle >= active.repeat) running = false;
+        }
+        Step step = active.steps[index];
+        status.step = index;
+        int32_t late = (int32_t)(now - deadline_us);
+        status.last_late_us = late;
+        if (late > status.max_late_us) status.max_late_us = late;
+        portEXIT_CRITICAL(&lock);
+        if (!running) {
+            finish("finished");
+            return;
+        }
+
+        bool forward = step.direction == Direction::Forward ||
+                       (step.direction == Direction::Coast && last_forward);
+        if (!l298n::fade(forward, step.duty, step.ramp_ms)) {
+            finish("aborted: fade failed");
+            return;
+        }
+        last_forward = forward;
+
+        // Срок считается от предыдущего срока, а не от момента вызова - задержки не копятся
+        deadline_us += (int64_t)(step.ramp_ms + step.hold_ms) * 1000;
+        portENTER_CRITICAL(&lock);
+        status.step = index + 1;
+        status.steps_done++;
+        portEXIT_CRITICAL(&lock);
+        int64_t wait_us = deadline_us - esp_timer_get_time();
+        esp_timer_start_once(timer, wait_us > 0 ? wait_us : 0);
+    }
+
+    void init() {
+        if (timer) return;
+        const esp_timer_create_args_t args = {
+            .callback = run_step,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "motion",
+            .skip_unhandled_events = false,
+        };
+        if (esp_timer_create(&args, &timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create motion timer");
+            timer = NULL;
+            return;
+        }
+
+        parse(BUILTIN_PROFILE, &default_profile);
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+            char spec[MAX_SPEC_LEN];
+            size_t len = sizeof(spec);
+            if (nvs_get_str(handle, NVS_KEY, spec, &len) == ESP_OK && !parse(spec, &default_profile)) {
+                ESP_LOGW(TAG, "Invalid stored profile: %s", spec);
+                parse(BUILTIN_PROFILE, &default_profile);
+            }
+            nvs_close(handle);
+        }
+    }
+
+    bool start(const Profile& profile) {
+        if (!timer || profile.count == 0 || l298n::isInhibited()) return false;
+        esp_timer_stop(timer);
+        if (motor_control::isRunning()) motor_control::stop();
+        portENTER_CRITICAL(&lock);
+        active = profile;
+        status = {};
+        status.running = true;
+        portEXIT_CRITICAL(&lock);
+        deadline_us = esp_timer_get_time();
+        esp_timer_start_once(timer, 0);
+        return true;
+    }
+
+    bool startDefault() {
+        return start(getDefault());
+    }
+
+    void stop() {
+        if (!timer) return;
+        esp_timer_stop(timer);
+        bool was_running = isRunning();
+        l298n::stop();
+        portENTER_CRITICAL(&lock);
+        status.running = false;
+        portEXIT_CRITICAL(&lock);
+        if (was_running) ESP_LOGI(TAG, "Profile stopped");
+    }
+
+    void stopAll() {
+        stop();
+        if (motor_control::isRunning()) motor_control::stop();
+        l298n::stopAll();
+    }
+
+    bool isRunning() {
+        portENTER_CRITICAL(&lock);
+        bool running = status.running;
+        portEXIT_CRITICAL(&lock);
+        return running;
+    }
+
+    Profile getDefault() {
+        portENTER_CRITICAL(&lock);
+        Profile p = default_profile;
+        portEXIT_CRITICAL(&lock);
+        return p;
+    }
+
+    bool saveDefault(const Profile& profile) {
+        char spec[MAX_SPEC_LEN];
+        format(profile, spec, sizeof(spec));
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to open NVS: %d", err);
+            return false;
+        }
+        err = nvs_set_str(handle, NVS_KEY, spec);
+        if (err == ESP_OK) err = nvs_commit(handle);
+        nvs_close(handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to save profile: %d", err);
+            return false;
+        }
+        portENTER_CRITICAL(&lock);
+        default_profile = profile;
+        portEXIT_CRITICAL(&lock);
+        return true;
+    }
+
+    bool setPwm(uint32_t freq_hz, uint32_t resolution_bits) {
+        stop();
+        if (motor_control::isRunning()) motor_control::stop();
+        return l298n::configurePwm(freq_hz, resolution_bits);
+    }
+
+    Status getStatus(Profile* profile) {
+        portENTER_CRITICAL(&lock);
+        Status s = status;
+        if (profile) *profile = active;
+        portEXIT_CRITICAL(&lock);
+        return s;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Профили движения L298N: последовательность шагов (направление, скважность,
+// время разгона, время удержания). Разгон - аппаратный fade LEDC, переходы между
+// шагами - по абсолютным срокам esp_timer (без накопления ошибки тика FreeRTOS).
+namespace motion {
+    static const size_t MAX_STEPS = 16;
+    static const uint32_t MAX_STEP_MS = 600000;
+    static const size_t MAX_SPEC_LEN = MAX_STEPS * 24 + 8;   // Строка format() с завершающим нулём
+
+    enum class Direction : uint8_t {
+        Forward,    // f
+        Backward,   // b
+        Coast,      // c - плавно до 0 в текущем направлении; при ENA = 0 мост закрыт и мотор
+                    // вращается свободно, IN1/IN2 остаются в прежнем состоянии
+    };
+
+    struct Step {
+        Direction direction;
+        uint32_t duty;       // 0..l298n::MAX_DUTY
+        uint32_t ramp_ms;
+        uint32_t hold_ms;    // После окончания разгона
+    };
+
+    struct Profile {
+        Step steps[MAX_STEPS];
+        size_t count;
+        uint32_t repeat;     // 0 - бесконечно
+    };
+
+    // "f:6191:300:2000,c:0:200:500*3" - шаги dir:duty:ramp_ms:hold_ms через запятую,
+    // *N - число повторов (*0 - бесконечно, без суффикса - один раз)
+    bool parse(const char* spec, Profile* profile);
+    void format(const Profile& profile, char* buf, size_t len);
+
+    void init();                       // Загружает сохранённый профиль по умолчанию из NVS
+    bool start(const Profile& profile);
+    bool startDefault();
+    void stop();
+    bool isRunning();
+    // Профиль, регулятор тока и все моторы - для команд остановки. Аварийные пути
+    // (protection из ISR, отключение по alerts) блокируют L298N, а профиль и регулятор
+    // снимаются сами на следующем шаге, увидев блокировку
+    void stopAll();
+
+    Profile getDefault();
+    bool saveDefault(const Profile& profile);
+
+    // Останавливает профиль и регулятор тока, затем меняет частоту/разрешение ШИМ
+    bool setPwm(uint32_t freq_hz, uint32_t resolution_bits);
+
+    struct Status {
+        bool running;
+        size_t step;            // Текущий шаг
+        uint32_t cycle;         // Текущий повтор, с 0
+        uint32_t steps_done;
+        int32_t last_late_us;   // Опоздание срабатывания таймера относительно срока
+        int32_t max_late_us;
+    };
+    Status getStatus(Profile* profile);
+}
+
+#endif
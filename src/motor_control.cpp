@@ -0,0 +1,253 @@
+#include "motor_control.h"
+#include "l298n.h"
+#include "acs712.h"
+#include "voltage.h"
+#include "motion.h"
+#include "protection.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <inttypes.h>
+
+namespace motor_control {
+    static const char* TAG = "motor_control";
+    static const int32_t MAX_TARGET_MA = 3000;
+    static const int32_t CUTOFF_MARGIN_MA = 200;   // Перерегулирование ПИД и шум ACS712 ниже порога отключения
+    // Пульсации тока за период ШИМ: при 150 Гц ток обмотки успевает подняться почти
+    // до V/R и пики срабатывают защиту при среднем ~1.5 А. На CONTROL_PWM_FREQ_HZ
+    // размах у мотора ~5 мГн / 2.5 Ом ~0.3 А; пик плюс перерегулирование - в запасе
+    static const uint32_t CONTROL_PWM_FREQ_HZ = 2000;
+    static const int32_t RIPPLE_MARGIN_MA = 500;
+
+    // Мотор ~4 Ом от 12.8 В: полная скважность даёт ~3 А при остановленном роторе
+    static const Gains DEFAULT_GAINS = { 500, 20000, 0, 0, l298n::MAX_DUTY };
+
+    static Gains gains = DEFAULT_GAINS;          // Под lock
+    static int32_t target_ma = 0;                // Под lock
+    static int32_t target_limit = MAX_TARGET_MA; // Под lock
+    static bool running = false;                 // Под lock
+    static bool reset_pending = false;           // Под lock: сбросить состояние на следующем шаге
+
+    // Состояние регулятора - только в задаче esp_timer
+    static int64_t integral = 0;                 // Единицы скважности * 1e6
+    static int32_t prev_measured = 0;
+    static int64_t last_us = 0;
+    static bool forward_dir = true;
+
+    static Telemetry telemetry = {};             // Под lock
+    static TracePoint trace[TRACE_SIZE];
+    static uint32_t trace_count = 0;
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    static esp_timer_handle_t timer = NULL;
+
+    static int32_t clamp(int64_t value, int32_t low, int32_t high) {
+        return value < low ? low : value > high ? high : (int32_t)value;
+    }
+
+    static void halt() {
+        if (timer) esp_timer_stop(timer);
+        l298n::setDuty(0);
+        portENTER_CRITICAL(&lock);
+        running = false;
+        telemetry.running = false;
+        telemetry.duty = 0;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    static void control_step(void*) {
+        int64_t start_us = esp_timer_get_time();
+
+        portENTER_CRITICAL(&lock);
+        Gains g = gains;
+        int32_t target = target_ma;
+        bool reset = reset_pending;
+        reset_pending = false;
+        portEXIT_CRITICAL(&lock);
+
+        if (l298n::isInhibited()) {
+            ESP_LOGW(TAG, "L298N inhibited, current control stopped");
+            halt();
+            return;
+        }
+
+        bool want_forward = target >= 0;
+        int32_t setpoint = want_forward ? target : -target;
+        if (reset || want_forward != forward_dir) {
+            integral = 0;
+            forward_dir = want_forward;
+            l298n::drive(forward_dir, 0);
+            prev_measured = 0;
+            last_us = start_us;
+            reset = true;
+        }
+
+        uint32_t dt_us = (uint32_t)(start_us - last_us);
+        bool overrun = !reset && dt_us > 2 * PERIOD_US;
+        if (reset || dt_us > 4 * PERIOD_US) dt_us = PERIOD_US;
+        last_us = start_us;
+
+        int32_t measured = acs712::readMilliamps();
+        if (measured < 0) measured = -measured;
+        int32_t supply_mv = voltage::isInitialized() ? voltage::readMillivolts(true) : 0;
+        int32_t max_duty = (int32_t)g.max_duty;
+
+        // Прямая связь: скважность, дающая на обмотке I*R при текущем питании
+        int32_t ff = 0;
+        if (g.r_mohm > 0 && supply_mv > 0) {
+            int64_t needed_mv = (int64_t)setpoint * g.r_mohm / 1000;
+            ff = clamp(needed_mv * l298n::MAX_DUTY / supply_mv, 0, max_duty);
+        }
+
+        int32_t error = setpoint - measured;
+        int32_t p = clamp((int64_t)g.kp * error / 1000, -max_duty, max_duty);
+        int32_t d = reset ? 0 : clamp((int64_t)g.kd * (prev_measured - measured) * 1000 / dt_us, -max_duty, max_duty);
+        prev_measured = measured;
+
+        // Anti-windup: интеграл не растёт в сторону насыщения и ограничен диапазоном выхода
+        int64_t i_term = integral / 1000000;
+        int64_t unclamped = (int64_t)ff + p + i_term + d;
+        bool saturated_high = unclamped >= max_duty;
+        bool saturated_low = unclamped <= 0;
+        if (!(saturated_high && error > 0) && !(saturated_low && error < 0)) {
+            integral += (int64_t)g.ki * error * dt_us / 1000;
+            int64_t limit = (int64_t)max_duty * 1000000;
+            if (integral > limit) integral = limit;
+            if (integral < -limit) integral = -limit;
+            i_term = integral / 1000000;
+        }
+        int32_t duty = clamp((int64_t)ff + p + i_term + d, 0, max_duty);
+        l298n::setDuty(duty);
+
+        uint32_t exec_us = (uint32_t)(esp_timer_get_time() - start_us);
+        portENTER_CRITICAL(&lock);
+        telemetry.running = running;
+        telemetry.target_ma = target;
+        telemetry.measured_ma = measured;
+        telemetry.supply_mv = supply_mv;
+        telemetry.duty = duty;
+        telemetry.p = p;
+        telemetry.i = (int32_t)i_term;
+        telemetry.d = d;
+        telemetry.ff = ff;
+        telemetry.saturated = duty == 0 ? saturated_low : duty >= max_duty;
+        telemetry.loops++;
+        if (overrun) telemetry.overruns++;
+        telemetry.exec_us = exec_us;
+        if (exec_us > telemetry.max_exec_us) telemetry.max_exec_us = exec_us;
+        if (telemetry.loops % TRACE_DECIMATION == 0) {
+            trace[trace_count % TRACE_SIZE] = { (uint32_t)(start_us / 1000), target, measured, (uint32_t)duty };
+            trace_count++;
+        }
+        portEXIT_CRITICAL(&lock);
+    }
+
+    void init() {
+        if (timer) return;
+        const esp_timer_create_args_t args = {
+            .callback = control_step,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "motor_control",
+            .skip_unhandled_events = true,
+        };
+        if (esp_timer_create(&args, &timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create control timer");
+            timer = NULL;
+        }
+    }
+
+    bool setTarget(int32_t value) {
+        int32_t limit = maxTarget();
+        if (!timer || value > limit || value < -limit) return false;
+        if (l298n::isInhibited()) return false;
+        if (motion::isRunning()) motion::stop();
+        if (!isRunning() && l298n::pwmFrequency() < CONTROL_PWM_FREQ_HZ) {
+            // Общий таймер ШИМ: остальные моторы тоже останавливаются
+            if (l298n::configurePwm(CONTROL_PWM_FREQ_HZ, l298n::pwmResolution())) {
+                ESP_LOGI(TAG, "PWM raised to %" PRIu32 " Hz for current control", CONTROL_PWM_FREQ_HZ);
+            } else {
+                ESP_LOGW(TAG, "PWM %" PRIu32 " Hz rejected, ripple may trip protection", CONTROL_PWM_FREQ_HZ);
+            }
+        }
+        portENTER_CRITICAL(&lock);
+        bool was_running = running;
+        target_ma = value;
+        running = true;
+        if (!was_running) reset_pending = true;
+        portEXIT_CRITICAL(&lock);
+        if (!was_running) {
+            esp_timer_start_periodic(timer, PERIOD_US);
+            ESP_LOGI(TAG, "Current control started, target %" PRId32 " mA", value);
+        }
+        return true;
+    }
+
+    void stop() {
+        if (!timer) return;
+        halt();
+        l298n::stop();
+        ESP_LOGI(TAG, "Current control stopped");
+    }
+
+    bool isRunning() {
+        portENTER_CRITICAL(&lock);
+        bool value = running;
+        portEXIT_CRITICAL(&lock);
+        return value;
+    }
+
+    Gains getGains() {
+        portENTER_CRITICAL(&lock);
+        Gains g = gains;
+        portEXIT_CRITICAL(&lock);
+        return g;
+    }
+
+    bool setGains(const Gains& value) {
+        if (value.kp < 0 || value.ki < 0 || value.kd < 0 || value.r_mohm < 0) return false;
+        if (value.max_duty > l298n::MAX_DUTY) return false;
+        portENTER_CRITICAL(&lock);
+        gains = value;
+        portEXIT_CRITICAL(&lock);
+        return true;
+    }
+
+    void setCutoffLimit(int32_t cutoff_ma) {
+        int32_t limit = cutoff_ma - CUTOFF_MARGIN_MA < MAX_TARGET_MA ? cutoff_ma - CUTOFF_MARGIN_MA : MAX_TARGET_MA;
+        if (limit < 0) limit = 0;
+        portENTER_CRITICAL(&lock);
+        target_limit = limit;
+        // Работающая уставка выше нового предела - прижимаем, а не ждём отключения
+        if (target_ma > limit) target_ma = limit;
+        if (target_ma < -limit) target_ma = -limit;
+        portEXIT_CRITICAL(&lock);
+        ESP_LOGI(TAG, "Target limit %" PRId32 " mA", limit);
+    }
+
+    int32_t maxTarget() {
+        int32_t trip_limit = protection::getStatus().trip_ma - RIPPLE_MARGIN_MA;
+        portENTER_CRITICAL(&lock);
+        int32_t limit = target_limit < trip_limit ? target_limit : trip_limit;
+        portEXIT_CRITICAL(&lock);
+        return limit > 0 ? limit : 0;
+    }
+
+    Telemetry getTelemetry() {
+        portENTER_CRITICAL(&lock);
+        Telemetry t = telemetry;
+        t.running = running;
+        portEXIT_CRITICAL(&lock);
+        return t;
+    }
+
+    size_t copyTrace(TracePoint* out, size_t max) {
+        portENTER_CRITICAL(&lock);
+        size_t available = trace_count < TRACE_SIZE ? trace_count : TRACE_SIZE;
+        size_t n = available < max ? available : max;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = trace[(trace_count - n + i) % TRACE_SIZE];
+        }
+        portEXIT_CRITICAL(&lock);
+        return n;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef MOTOR_CONTROL_H
+#define MOTOR_CONTROL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Регулятор тока мотора L298N по обратной связи ACS712: ПИД в целых числах на
+// периодическом esp_timer, опциональная прямая связь по напряжению питания.
+// Момент мотора пропорционален току, поэтому уставка задаётся в мА.
+namespace motor_control {
+    static const uint32_t PERIOD_US = 2000;   // 500 Гц; выход фильтра тока обновляется ~1.25 кГц
+
+    struct Gains {
+        int32_t kp;          // Единиц скважности на А ошибки
+        int32_t ki;          // Единиц скважности на А*с
+        int32_t kd;          // Единиц скважности на А/с (по измерению, без скачка от уставки)
+        int32_t r_mohm;      // Сопротивление обмотки для прямой связи, 0 - выключена
+        uint32_t max_duty;   // Ограничение выхода, 0..l298n::MAX_DUTY
+    };
+
+    struct Telemetry {
+        bool running;
+        int32_t target_ma;     // Знак задаёт направление
+        int32_t measured_ma;   // |I| по ACS712
+        int32_t supply_mv;
+        uint32_t duty;
+        int32_t p;             // Составляющие выхода, единицы скважности
+        int32_t i;
+        int32_t d;
+        int32_t ff;
+        bool saturated;
+        uint32_t loops;
+        uint32_t overruns;     // Интервал между вызовами больше двух периодов
+        uint32_t exec_us;      // Время последнего шага
+        uint32_t max_exec_us;
+    };
+
+    struct TracePoint {
+        uint32_t t_ms;
+        int32_t target_ma;
+        int32_t measured_ma;
+        uint32_t duty;
+    };
+    static const size_t TRACE_SIZE = 128;
+    static const uint32_t TRACE_DECIMATION = 10;   // Точка каждые 20 мс
+
+    void init();
+
+    // Запуск регулятора с уставкой; 0 - держать нулевой ток. Снимается stop() или блокировкой L298N.
+    // |target_ma| не больше maxTarget(). ШИМ ниже 2 кГц при запуске поднимается до 2 кГц
+    // (все моторы останавливаются), иначе пульсации тока достают до порога protection
+    bool setTarget(int32_t target_ma);
+    void stop();
+    bool isRunning();
+
+    // Наименьший порог тока правил alerts с отключением мотора (INT32_MAX - таких нет).
+    // Предел уставки - этот порог минус запас, порог срабатывания protection минус запас
+    // на пульсации и не больше 3000 мА: уставка выше порога привела бы к блокировке
+    // L298N вместо регулирования
+    void setCutoffLimit(int32_t cutoff_ma);
+    int32_t maxTarget();
+
+    Gains getGains();
+    bool setGains(const Gains& gains);
+
+    Telemetry getTelemetry();
+    size_t copyTrace(TracePoint* out, size_t max);   // От старых к новым
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "net_probe.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_netif.h"
+#include "lwip/sockets.h"
+#include "lwip/dns.h"
+#include <cstdio>
+#include <inttypes.h>
+#include <cstring>
+
+namespace net_probe {
+    static const char* TAG = "net_probe";
+
+    static int64_t now_ms() {
+        return esp_timer_get_time() / 1000;
+    }
+
+    static uint32_t sta_address() {
+        esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+        esp_netif_ip_info_t info;
+        if (!netif || esp_netif_get_ip_info(netif, &info) != ESP_OK) return 0;
+        return info.ip.addr;
+    }
+
+    // Сокет, исходящий с адреса STA; -1 - нет адреса или ошибка
+    static int sta_socket(int type, int protocol) {
+        uint32_t address = sta_address();
+        if (address == 0) return -1;
+        int sock = socket(AF_INET, type, protocol);
+        if (sock < 0) {
+            ESP_LOGE(TAG, "Socket creation failed, errno: %d", errno);
+            return -1;
+        }
+        struct sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = address;
+        if (bind(sock, (struct sockaddr*)&local, sizeof(local)) < 0) {
+            ESP_LOGE(TAG, "Bind to STA address failed, errno: %d", errno);
+            close(sock);
+            return -1;
+        }
+        return sock;
+    }
+
+    static bool tcp_address(uint32_t address, uint16_t port, int timeout_ms) {
+        int sock = sta_socket(SOCK_STREAM, IPPROTO_TCP);
+        if (sock < 0) return false;
+        int flags = fcntl(sock, F_GETFL, 0);
+        fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+
+        struct sockaddr_in remote = {};
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(port);
+        remote.sin_addr.s_addr = address;
+        bool ok = false;
+        if (connect(sock, (struct sockaddr*)&remote, sizeof(remote)) == 0) {
+            ok = true;
+        } else if (errno == EINPROGRESS) {
+            fd_set write_fds;
+            FD_ZERO(&write_fds);
+            FD_SET(sock, &write_fds);
+            struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            if (select(sock + 1, NULL, &write_fds, NULL, &tv) > 0 &&
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, &so_error, &len) == 0) {
+                ok = so_error == 0 || so_error == ECONNREFUSED;
+            }
+        } else {
+            ok = errno == ECONNREFUSED;
+        }
+        close(sock);
+        return ok;
+    }
+
+    bool tcp(const char* ip, uint16_t port, int timeout_ms, uint32_t* ms) {
+        int64_t start = now_ms();
+        struct in_addr addr;
+        bool ok = inet_pton(AF_INET, ip, &addr) == 1 && tcp_address(addr.s_addr, port, timeout_ms);
+        if (ms) *ms = (uint32_t)(now_ms() - start);
+        return ok;
+    }
+
+    bool gateway(uint16_t port, int timeout_ms, uint32_t* ms) {
+        int64_t start = now_ms();
+        esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+        esp_netif_ip_info_t info;
+        bool ok = netif && esp_netif_get_ip_info(netif, &info) == ESP_OK && info.gw.addr != 0 &&
+                  tcp_address(info.gw.addr, port, timeout_ms);
+        if (ms) *ms = (uint32_t)(now_ms() - start);
+        return ok;
+    }
+
+    // Запрос: заголовок (id, RD, 1 вопрос), имя метками, QTYPE A, QCLASS IN
+    static int build_query(uint8_t* packet, size_t size, uint16_t id, const char* label, const char* domain) {
+        char name[128];
+        int name_len = snprintf(name, sizeof(name), "%s.%s", label, domain);
+        if (name_len <= 0 || (size_t)name_len >= sizeof(name) || size < 12 + (size_t)name_len + 2 + 4) return -1;
+        memset(packet, 0, 12);
+        packet[0] = id >> 8;
+        packet[1] = id & 0xFF;
+        packet[2] = 0x01;    // RD
+        packet[5] = 1;       // QDCOUNT
+        size_t pos = 12;
+        const char* part = name;
+        while (*part) {
+            const char* dot = strchr(part, '.');
+            size_t len = dot ? (size_t)(dot - part) : strlen(part);
+            if (len == 0 || len > 63) return -1;
+            packet[pos++] = (uint8_t)len;
+            memcpy(packet + pos, part, len);
+            pos += len;
+            part += len + (dot ? 1 : 0);
+        }
+        packet[pos++] = 0;
+        packet[pos++] = 0;
+        packet[pos++] = 1;   // A
+        packet[pos++] = 0;
+        packet[pos++] = 1;   // IN
+        return (int)pos;
+    }
+
+    bool dns(const char* domain, int timeout_ms, uint32_t* ms) {
+        int64_t start = now_ms();
+        bool ok = false;
+        // Только IPv4-сервер: адрес берётся из u_addr.ip4; не заданный (ip_addr_any) - пропускаем
+        const ip_addr_t* server = dns_getserver(0);
+        bool usable = server && IP_IS_V4(server) && !ip_addr_isany(server);
+        int sock = usable ? sta_socket(SOCK_DGRAM, IPPROTO_UDP) : -1;
+        if (sock >= 0) {
+            uint8_t packet[160];
+            uint32_t random = esp_random();
+            char label[12];
+            snprintf(label, sizeof(label), "p%08" PRIx32, random);
+            uint16_t id = (uint16_t)(random >> 16);
+            int len = build_query(packet, sizeof(packet), id, label, domain);
+
+            struct sockaddr_in remote = {};
+            remote.sin_family = AF_INET;
+            remote.sin_port = htons(53);
+            remote.sin_addr.s_addr = server->u_addr.ip4.addr;
+            if (len > 0 && sendto(sock, packet, len, 0, (struct sockaddr*)&remote, sizeof(remote)) == len) {
+                // Чужие и запоздавшие ответы (другой id) пропускаются до конца таймаута
+                int64_t deadline = start + timeout_ms;
+                while (now_ms() < deadline) {
+                    int64_t left = deadline - now_ms();
+                    struct timeval tv = { .tv_sec = (long)(left / 1000), .tv_usec = (long)(left % 1000) * 1000 };
+                    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+                    int n = recv(sock, packet, sizeof(packet), 0);
+                    if (n < 0) break;
+                    if (n < 12 || packet[0] != (id >> 8) || packet[1] != (id & 0xFF) || !(packet[2] & 0x80)) continue;
+                    uint8_t rcode = packet[3] & 0x0F;
+                    ok = rcode == 0 || rcode == 3;
+                    break;
+                }
+            }
+            close(sock);
+        }
+        if (ms) *ms = (uint32_t)(now_ms() - start);
+        return ok;
+    }
+}
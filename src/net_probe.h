@@ -0,0 +1,22 @@
+#ifndef NET_PROBE_H
+#define NET_PROBE_H
+
+#include <cstdint>
+
+// Дешёвые проверки связи через STA (сокеты привязаны к адресу STA, а не AP):
+// шлюз, TCP-соединение с внешним узлом, DNS-запрос в обход кэша lwip.
+// Блокирующие, не дольше timeout_ms; *ms - время проверки.
+namespace net_probe {
+    // Отказ в соединении (RST) тоже ответ: узел достижим
+    bool tcp(const char* ip, uint16_t port, int timeout_ms, uint32_t* ms);
+
+    // Шлюз STA (из настроек интерфейса) - TCP на port; false без адреса STA
+    bool gateway(uint16_t port, int timeout_ms, uint32_t* ms);
+
+    // Запрос A случайного имени <метка>.domain первому DNS-серверу: ни lwip, ни
+    // роутер не могут ответить из кэша, ответ NOERROR/NXDOMAIN означает, что
+    // запрос прошёл до внешних серверов (SERVFAIL и таймаут - нет)
+    bool dns(const char* domain, int timeout_ms, uint32_t* ms);
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include "power_meter.h"
+#include "adc_sampler.h"
+#include "adc_cal.h"
+#include "acs712.h"
+#include "energy.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <inttypes.h>
+
+namespace power_meter {
+    static const char* TAG = "power_meter";
+    static const adc_channel_t VOLTAGE_CHANNEL = ADC_CHANNEL_4;
+    static const adc_channel_t CURRENT_CHANNEL = ADC_CHANNEL_5;
+    static const uint32_t MIN_WINDOW_MS = 10;
+    static const uint32_t MAX_WINDOW_MS = 10000;
+
+    // Суммы окна; 64 бит хватает на 10 с при 40 кГц: v^2 <= 2.7e8, |v*i| <= 5e8 на пару
+    struct Accumulator {
+        int64_t sum_v;
+        int64_t sum_i;
+        int64_t sum_v2;
+        int64_t sum_i2;
+        int64_t sum_p;
+        uint32_t pairs;
+    };
+
+    static Accumulator acc;               // Только задача выборки
+    static Result result;                 // Под lock
+    static bool has_result = false;
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    static volatile uint32_t window_ms = DEFAULT_WINDOW_MS;
+    static bool initialized = false;
+
+    static uint32_t isqrt64(uint64_t x) {
+        uint64_t root = 0;
+        uint64_t bit = 1ULL << 62;
+        while (bit > x) bit >>= 2;
+        while (bit) {
+            if (x >= root + bit) {
+                x -= root + bit;
+                root = (root >> 1) + bit;
+            } else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint32_t)root;
+    }
+
+    static int32_t div_round(int64_t num, int64_t den) {
+        return (int32_t)(num >= 0 ? (num + den / 2) / den : (num - den / 2) / den);
+    }
+
+    static void publish(uint32_t window) {
+        Result r;
+        int64_t n = acc.pairs;
+        r.window_ms = window;
+        r.pairs = acc.pairs;
+        r.v_mean_mv = div_round(acc.sum_v, n);
+        r.i_mean_ma = div_round(acc.sum_i, n);
+        r.v_rms_mv = isqrt64((uint64_t)((acc.sum_v2 + n / 2) / n));
+        r.i_rms_ma = isqrt64((uint64_t)((acc.sum_i2 + n / 2) / n));
+        r.real_mw = div_round(acc.sum_p, n * 1000);                  // мВ * мА = мкВт
+        r.apparent_mw = div_round((int64_t)r.v_rms_mv * r.i_rms_ma, 1000);
+        r.power_factor = r.apparent_mw ? div_round((int64_t)r.real_mw * 1000, r.apparent_mw) : 0;
+
+        portENTER_CRITICAL(&lock);
+        r.seq = result.seq + 1;
+        result = r;
+        has_result = true;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    // Слушатель adc_sampler: каждая пара (v[i], i[i]) снята с разносом в один слот шаблона
+    static void on_frame(const adc_sampler::Frame& frame, void*) {
+        int vc = -1, ic = -1;
+        for (size_t c = 0; c < frame.channels; c++) {
+            if (frame.ids[c] == VOLTAGE_CHANNEL) vc = (int)c;
+            if (frame.ids[c] == CURRENT_CHANNEL) ic = (int)c;
+        }
+        if (vc < 0 || ic < 0) return;
+
+        const uint16_t* vs = frame.samples[vc];
+        const uint16_t* is = frame.samples[ic];
+        uint32_t n = frame.counts[vc] < frame.counts[ic] ? frame.counts[vc] : frame.counts[ic];
+
+        // Пары имеют смысл только при равных частотах каналов (одинаковое число слотов в шаблоне)
+        uint32_t rate = adc_sampler::channelRate(VOLTAGE_CHANNEL);
+        if (rate == 0 || rate != adc_sampler::channelRate(CURRENT_CHANNEL)) {
+            static bool warned = false;
+            if (!warned) ESP_LOGW(TAG, "Voltage and current channel rates differ, pairing disabled");
+            warned = true;
+            return;
+        }
+        uint32_t window = window_ms;
+        uint32_t target = (uint32_t)((uint64_t)rate * window / 1000);
+        if (target == 0) target = 1;
+
+        int64_t frame_p = 0;
+        int64_t frame_i = 0;
+        for (uint32_t k = 0; k < n; k++) {
+            int64_t v = adc_cal::rawToMillivolts(adc_cal::VOLTAGE_DIVIDER, vs[k]);
+            int64_t i = acs712::millivoltsToMilliamps(adc_cal::rawToMillivolts(adc_cal::CURRENT_PIN, is[k]));
+            acc.sum_v += v;
+            acc.sum_i += i;
+            acc.sum_v2 += v * v;
+            acc.sum_i2 += i * i;
+            acc.sum_p += v * i;
+            frame_p += v * i;
+            frame_i += i;
+            if (++acc.pairs >= target) {
+                publish(window);
+                acc = Accumulator();
+            }
+        }
+        // Каждая пара интегрируется в счётчик энергии
+        energy::accumulate(frame_p, frame_i, n, rate);
+    }
+
+    void init() {
+        if (initialized) return;
+        // Оба канала с одной частотой - чередуются в шаблоне парами
+        adc_sampler::registerChannel(VOLTAGE_CHANNEL, ADC_ATTEN_DB_12, adc_sampler::DEFAULT_CHANNEL_RATE_HZ);
+        adc_sampler::registerChannel(CURRENT_CHANNEL, ADC_ATTEN_DB_12, adc_sampler::DEFAULT_CHANNEL_RATE_HZ);
+        if (!adc_sampler::addListener(on_frame, NULL)) {
+            ESP_LOGE(TAG, "Failed to register ADC listener");
+            return;
+        }
+        initialized = true;
+        ESP_LOGI(TAG, "Power meter started, window %" PRIu32 " ms", (uint32_t)window_ms);
+    }
+
+    bool setWindow(uint32_t ms) {
+        if (ms < MIN_WINDOW_MS || ms > MAX_WINDOW_MS) return false;
+        window_ms = ms;  // Текущее окно закроется по новой длине
+        return true;
+    }
+
+    uint32_t getWindow() {
+        return window_ms;
+    }
+
+    bool latest(Result* out) {
+        portENTER_CRITICAL(&lock);
+        bool ok = has_result;
+        if (ok) *out = result;
+        portEXIT_CRITICAL(&lock);
+        return ok;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef POWER_METER_H
+#define POWER_METER_H
+
+#include <cstdint>
+
+// Измерение мощности по синхронным парам отсчётов напряжения (делитель) и тока (ACS712)
+// из шаблона adc_sampler: true RMS, активная и полная мощность, коэффициент мощности.
+namespace power_meter {
+    static const uint32_t DEFAULT_WINDOW_MS = 200;  // 30 периодов ШИМ L298N (150 Гц)
+
+    struct Result {
+        uint32_t seq;          // Номер окна, растёт с каждым результатом
+        uint32_t window_ms;
+        uint32_t pairs;        // Пар отсчётов в окне
+        int32_t v_mean_mv;
+        int32_t v_rms_mv;
+        int32_t i_mean_ma;
+        int32_t i_rms_ma;
+        int32_t real_mw;       // Среднее мгновенной мощности v*i
+        int32_t apparent_mw;   // Vrms * Irms
+        int32_t power_factor;  // real / apparent, x1000
+    };
+
+    void init();
+    bool setWindow(uint32_t window_ms);
+    uint32_t getWindow();
+
+    // Последнее завершённое окно; false - результатов ещё нет
+    bool latest(Result* result);
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "protection.h"
+#include "adc_sampler.h"
+#include "adc_cal.h"
+#include "acs712.h"
+#include "l298n.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <inttypes.h>
+
+namespace protection {
+    static const char* TAG = "protection";
+    static const adc_channel_t CURRENT_CHANNEL = ADC_CHANNEL_5;
+    static const int32_t MAX_CODE = 4095;
+
+    static Status status = {};          // Пишет ISR; читатели копируют в критической секции
+    static int64_t first_event_us = 0;  // Только ISR
+    static int64_t last_event_us = 0;
+    static uint32_t streak = 0;
+    static uint32_t gap_us = 0;         // Превышения дальше друг от друга - не подряд
+    static TaskHandle_t task_handle = NULL;
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    // Обработчик монитора ADC (ISR): на каждое преобразование за порогом
+    static bool IRAM_ATTR on_threshold(bool high, void*) {
+        uint32_t entry = esp_cpu_get_cycle_count();
+        if (status.fault) return false;
+        int64_t now = esp_timer_get_time();
+        if (streak == 0 || now - last_event_us > gap_us) {
+            streak = 0;
+            first_event_us = now;
+        }
+        last_event_us = now;
+        if (++streak < status.trip_samples) return false;
+
+        l298n::emergencyStop();
+        uint32_t cycles = esp_cpu_get_cycle_count() - entry;
+
+        status.fault = true;
+        status.trips++;
+        status.trip_time_us = now;
+        status.trip_high = high;
+        status.detect_us = (uint32_t)(now - first_event_us);
+        status.cutoff_cycles = cycles;
+        status.cutoff_ns = cycles * 1000 / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+        streak = 0;
+
+        BaseType_t woken = pdFALSE;
+        if (task_handle) vTaskNotifyGiveFromISR(task_handle, &woken);
+        return woken == pdTRUE;
+    }
+
+    // Журнал и оповещение - вне ISR
+    static void protection_task(void* pvParameters) {
+        while (1) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            Status s = getStatus();
+            ESP_LOGE(TAG, "Overcurrent trip #%" PRIu32 " (%s, > %" PRId32 " mA): detected in %" PRIu32 " us, outputs off in %" PRIu32 " cycles (%" PRIu32 " ns)",
+                     s.trips, s.trip_high ? "forward" : "reverse", s.trip_ma,
+                     s.detect_us, s.cutoff_cycles, s.cutoff_ns);
+        }
+    }
+
+    // Наименьший код, дающий не меньше mv (таблица калибровки монотонна)
+    static int32_t code_at_or_above(int32_t mv) {
+        int32_t lo = 0, hi = MAX_CODE + 1;
+        while (lo < hi) {
+            int32_t mid = (lo + hi) / 2;
+            if (adc_cal::toMillivolts(adc_cal::CURRENT_PIN, mid << adc_filter::FRAC_BITS) >= mv) hi = mid;
+            else lo = mid + 1;
+        }
+        return lo;
+    }
+
+    bool configure(int32_t trip_ma, uint32_t trip_samples) {
+        if (trip_ma <= 0 || trip_samples < 1 || trip_samples > MAX_TRIP_SAMPLES) return false;
+
+        int32_t high = code_at_or_above(acs712::milliampsToMillivolts(trip_ma) + 1);
+        int32_t low = code_at_or_above(acs712::milliampsToMillivolts(-trip_ma)) - 1;
+        if (high > MAX_CODE) high = -1;
+        if (low < 0) low = -1;
+        if (high < 0 && low < 0) {
+            ESP_LOGE(TAG, "Trip current %" PRId32 " mA is outside the sensor range", trip_ma);
+            return false;
+        }
+
+        uint32_t rate = adc_sampler::channelRate(CURRENT_CHANNEL);
+        if (rate == 0) rate = adc_sampler::DEFAULT_CHANNEL_RATE_HZ;
+        portENTER_CRITICAL(&lock);
+        status.trip_ma = trip_ma;
+        status.trip_samples = trip_samples;
+        status.high_code = high;
+        status.low_code = low;
+        status.sample_period_us = 1000000 / rate;
+        gap_us = 3 * status.sample_period_us + 1;
+        streak = 0;
+        portEXIT_CRITICAL(&lock);
+
+        bool ok = adc_sampler::setMonitor(CURRENT_CHANNEL, high, low, on_threshold, NULL);
+        ESP_LOGI(TAG, "Trip at %" PRId32 " mA x %" PRIu32 " samples: codes < %" PRId32 " or > %" PRId32,
+                 trip_ma, trip_samples, low, high);
+        return ok;
+    }
+
+    void init() {
+        if (task_handle) return;
+        xTaskCreate(protection_task, "protection", 2560, NULL, 12, &task_handle);
+        adc_sampler::registerChannel(CURRENT_CHANNEL, ADC_ATTEN_DB_12, adc_sampler::DEFAULT_CHANNEL_RATE_HZ);
+        configure(DEFAULT_TRIP_MA, DEFAULT_TRIP_SAMPLES);
+    }
+
+    void clear() {
+        portENTER_CRITICAL(&lock);
+        status.fault = false;
+        streak = 0;
+        portEXIT_CRITICAL(&lock);
+        l298n::release();
+    }
+
+    Status getStatus() {
+        portENTER_CRITICAL(&lock);
+        Status s = status;
+        portEXIT_CRITICAL(&lock);
+        s.armed = adc_sampler::monitorActive();
+        return s;
+    }
+}
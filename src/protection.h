@@ -0,0 +1,36 @@
+#ifndef PROTECTION_H
+#define PROTECTION_H
+
+#include <cstdint>
+
+// Быстрая защита мотора от перегрузки по току: аппаратный монитор ADC на канале
+// ACS712 (оба направления тока), отключение L298N прямо из ISR и защёлка аварии
+// до явного сброса. Затянутая перегрузка (заклинивание) - правило stall в alerts.
+namespace protection {
+    static const int32_t DEFAULT_TRIP_MA = 3500;
+    static const uint32_t DEFAULT_TRIP_SAMPLES = 2;   // Подряд идущих превышений
+    static const uint32_t MAX_TRIP_SAMPLES = 16;
+
+    struct Status {
+        bool armed;                // Монитор ADC установлен и выборка идёт
+        bool fault;                // Защёлка аварии
+        int32_t trip_ma;
+        uint32_t trip_samples;
+        int32_t high_code;         // Пороги монитора в сырых кодах (-1 - нет)
+        int32_t low_code;
+        uint32_t sample_period_us; // Период отсчётов канала
+        uint32_t trips;            // Срабатываний с загрузки
+        int64_t trip_time_us;
+        bool trip_high;            // true - ток в прямом направлении (выход ACS712 выше нуля)
+        uint32_t detect_us;        // От первого превышения до срабатывания
+        uint32_t cutoff_cycles;    // Вход в обработчик -> выходы L298N в 0
+        uint32_t cutoff_ns;
+    };
+
+    void init();
+    bool configure(int32_t trip_ma, uint32_t trip_samples);   // Перезапускает выборку ADC
+    void clear();                  // Снимает защёлку и блокировку L298N
+    Status getStatus();
+}
+
+#endif
@@ -0,0 +1,184 @@
+#include "spectrum.h"
+#include "adc_sampler.h"
+#include "adc_cal.h"
+#include "acs712.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+
+namespace spectrum {
+    static const char* TAG = "spectrum";
+    static const adc_channel_t CURRENT_CHANNEL = ADC_CHANNEL_5;
+    static const uint32_t MIN_INTERVAL_MS = 50;
+    static const uint32_t BLOCK_TIMEOUT_MS = 2000;
+    static const int32_t SLOPE_SPAN = 256 << fft::FRAC_BITS;  // Наклон мВ/код по ±256 кодам вокруг среднего
+
+    // ШИМ L298N 150 Гц и гармоники попадают в "pwm"/"harmonics", щёточный шум - в "high"
+    static const fft::Band BANDS[] = {
+        { "mechanical", 1, 100 },
+        { "pwm", 100, 500 },
+        { "harmonics", 500, 2000 },
+        { "high", 2000, 1000000 },
+    };
+    static const size_t BAND_COUNT = sizeof(BANDS) / sizeof(BANDS[0]);
+
+    static fft::Plan plan;                          // ~8 КБ при MAX_SIZE
+    static uint16_t block[fft::MAX_SIZE];
+    static int32_t work[fft::MAX_SIZE];
+
+    // Сбор блока: задача взводит armed, слушатель кадров заполняет block и будит задачу
+    static volatile bool armed = false;
+    static volatile size_t fill = 0;
+    static size_t block_size = 0;                   // Размер текущего блока (пишет задача при !armed)
+    static volatile size_t pending_size = DEFAULT_SIZE;
+    static volatile uint32_t interval_ms = DEFAULT_INTERVAL_MS;
+    static TaskHandle_t task_handle = NULL;
+
+    static Result result;                           // Под lock
+    static bool has_result = false;
+    static Stats stats = {};
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    static bool initialized = false;
+
+    static void on_frame(const adc_sampler::Frame& frame, void*) {
+        if (!armed) return;
+        for (size_t c = 0; c < frame.channels; c++) {
+            if (frame.ids[c] != CURRENT_CHANNEL) continue;
+            size_t n = fill;
+            for (uint32_t i = 0; i < frame.counts[c] && n < block_size; i++) {
+                block[n++] = frame.samples[c][i];
+            }
+            fill = n;
+            if (n == block_size) {
+                armed = false;
+                xTaskNotifyGive(task_handle);
+            }
+            return;
+        }
+    }
+
+    // Амплитуда в кодах << FRAC_BITS -> мА по локальному наклону калибровочной таблицы
+    static int32_t to_milliamps(int64_t amplitude, int64_t span_ma) {
+        return (int32_t)((amplitude * span_ma + SLOPE_SPAN) / (2 * SLOPE_SPAN));
+    }
+
+    static void publish(const fft::Result& r, uint32_t cycles, uint32_t elapsed_us) {
+        int32_t low = r.dc - SLOPE_SPAN;
+        int32_t high = r.dc + SLOPE_SPAN;
+        int32_t span_mv = adc_cal::toMillivolts(adc_cal::CURRENT_PIN, high) - adc_cal::toMillivolts(adc_cal::CURRENT_PIN, low);
+        int64_t span_ma = acs712::millivoltsToMilliamps(span_mv) - acs712::millivoltsToMilliamps(0);
+
+        Result out;
+        out.size = r.size;
+        out.rate_hz = r.rate_hz;
+        out.bin_hz_x100 = r.bin_hz_x100;
+        out.dominant_hz_x100 = r.dominant_hz_x100;
+        out.dominant_ma = to_milliamps(r.dominant_amplitude, span_ma);
+        out.rms_ma = to_milliamps(r.rms, span_ma);
+        out.dc_ma = acs712::millivoltsToMilliamps(adc_cal::toMillivolts(adc_cal::CURRENT_PIN, r.dc));
+        out.band_count = r.band_count;
+        for (size_t b = 0; b < r.band_count; b++) {
+            out.band_names[b] = BANDS[b].name;
+            out.band_rms_ma[b] = to_milliamps(r.band_rms[b], span_ma);
+        }
+        for (size_t g = 0; g < fft::COMPACT_BINS; g++) {
+            out.compact_ma[g] = to_milliamps(r.compact[g], span_ma);
+        }
+
+        portENTER_CRITICAL(&lock);
+        out.seq = result.seq + 1;
+        result = out;
+        has_result = true;
+        stats.blocks++;
+        stats.last_cycles = cycles;
+        stats.last_us = elapsed_us;
+        stats.total_cycles += cycles;
+        if (stats.blocks == 1 || cycles < stats.min_cycles) stats.min_cycles = cycles;
+        if (cycles > stats.max_cycles) stats.max_cycles = cycles;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    static void spectrum_task(void* pvParameters) {
+        while (1) {
+            // Интервал - период между началами блоков, а не пауза после разбора;
+            // если сбор и разбор дольше интервала, следующий блок начинается сразу
+            TickType_t period_start = xTaskGetTickCount();
+            size_t size = pending_size;
+            if (size != plan.size) {
+                fft::init(plan, size);
+                ESP_LOGI(TAG, "Block size %u", (unsigned)size);
+            }
+            uint32_t rate = adc_sampler::channelRate(CURRENT_CHANNEL);
+            if (rate == 0) {
+                vTaskDelay(BLOCK_TIMEOUT_MS / portTICK_PERIOD_MS);
+                continue;
+            }
+
+            block_size = size;
+            fill = 0;
+            armed = true;
+            if (ulTaskNotifyTake(pdTRUE, BLOCK_TIMEOUT_MS / portTICK_PERIOD_MS) == 0) {
+                armed = false;
+                ESP_LOGW(TAG, "No current samples for %" PRIu32 " ms", BLOCK_TIMEOUT_MS);
+                continue;
+            }
+            // Частота могла смениться во время сбора - такой блок не разбираем
+            if (adc_sampler::channelRate(CURRENT_CHANNEL) != rate) continue;
+
+            fft::Result r;
+            int64_t start_us = esp_timer_get_time();
+            uint32_t start = esp_cpu_get_cycle_count();
+            fft::analyze(plan, block, rate, BANDS, BAND_COUNT, work, &r);
+            uint32_t cycles = esp_cpu_get_cycle_count() - start;
+            publish(r, cycles, (uint32_t)(esp_timer_get_time() - start_us));
+
+            vTaskDelayUntil(&period_start, interval_ms / portTICK_PERIOD_MS);
+        }
+    }
+
+    void init() {
+        if (initialized) return;
+        adc_sampler::registerChannel(CURRENT_CHANNEL, ADC_ATTEN_DB_12, adc_sampler::DEFAULT_CHANNEL_RATE_HZ);
+        if (!adc_sampler::addListener(on_frame, NULL)) {
+            ESP_LOGE(TAG, "Failed to register ADC listener");
+            return;
+        }
+        // Низкий приоритет: разбор блока не должен мешать выборке и сети
+        xTaskCreate(spectrum_task, "spectrum", 3072, NULL, 2, &task_handle);
+        initialized = true;
+    }
+
+    bool setSize(size_t size) {
+        if (!fft::validSize(size)) return false;
+        pending_size = size;
+        return true;
+    }
+
+    size_t getSize() {
+        return pending_size;
+    }
+
+    bool setInterval(uint32_t value) {
+        if (value < MIN_INTERVAL_MS) return false;
+        interval_ms = value;
+        return true;
+    }
+
+    bool latest(Result* out) {
+        portENTER_CRITICAL(&lock);
+        bool ok = has_result;
+        if (ok) *out = result;
+        portEXIT_CRITICAL(&lock);
+        return ok;
+    }
+
+    Stats getStats() {
+        portENTER_CRITICAL(&lock);
+        Stats s = stats;
+        portEXIT_CRITICAL(&lock);
+        return s;
+    }
+}
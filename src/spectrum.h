@@ -0,0 +1,48 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "fft.h"
+#include <cstddef>
+#include <cstdint>
+
+// Спектр тока мотора (ACS712): блоки подряд идущих отсчётов канала из adc_sampler,
+// вещественное БПФ в фиксированной точке (fft), энергия полос, доминирующая частота
+// и сжатый спектр. Расчёт идёт в отдельной задаче, не в задаче выборки.
+namespace spectrum {
+    static const size_t DEFAULT_SIZE = 1024;        // ~100 мс при 10 кГц, ~9.8 Гц на бин
+    static const uint32_t DEFAULT_INTERVAL_MS = 500;  // Период между началами блоков
+
+    struct Result {
+        uint32_t seq;
+        uint32_t size;
+        uint32_t rate_hz;
+        uint32_t bin_hz_x100;
+        uint32_t dominant_hz_x100;
+        int32_t dominant_ma;         // Амплитуда (пик) на доминирующей частоте
+        int32_t rms_ma;              // СКЗ переменной составляющей
+        int32_t dc_ma;
+        size_t band_count;
+        const char* band_names[fft::MAX_BANDS];
+        int32_t band_rms_ma[fft::MAX_BANDS];
+        int32_t compact_ma[fft::COMPACT_BINS];
+    };
+
+    struct Stats {
+        uint32_t blocks;
+        uint32_t last_cycles;        // Такты CPU на блок: окно + БПФ + разбор
+        uint32_t min_cycles;
+        uint32_t max_cycles;
+        uint64_t total_cycles;
+        uint32_t last_us;
+    };
+
+    void init();
+    bool setSize(size_t size);        // Применяется к следующему блоку
+    size_t getSize();
+    bool setInterval(uint32_t interval_ms);  // Не меньше 50 мс; длинный блок не растягивает период
+
+    bool latest(Result* result);      // false - спектра ещё нет
+    Stats getStats();
+}
+
+#endif
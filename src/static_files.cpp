@@ -0,0 +1,149 @@
+#include "static_files.h"
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <string.h>
+#include <inttypes.h>
+
+namespace static_files {
+    static const char* TAG = "static_files";
+
+    // Формат образа: см. tools/pack_www.py
+    static const char* PARTITION_LABEL = "www";
+    static const uint32_t IMAGE_MAGIC = 0x31575757; // "WWW1"
+    static const size_t SEND_CHUNK_SIZE = 4096;
+    static const char* CACHE_CONTROL = "no-cache"; // Всегда перепроверять по ETag -> 304
+
+    struct ImageHeader {
+        uint32_t magic;
+        uint32_t count;
+        uint32_t image_size;
+        uint32_t reserved;
+    };
+
+    struct Entry {
+        char path[64];
+        char type[32];
+        char etag[20];
+        uint32_t offset;
+        uint32_t size;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(ImageHeader) == 16, "ImageHeader layout must match pack_www.py");
+    static_assert(sizeof(Entry) == 128, "Entry layout must match pack_www.py");
+
+    static const uint8_t* image = nullptr;
+    static const Entry* entries = nullptr;
+    static uint32_t entry_count = 0;
+    static esp_partition_mmap_handle_t mmap_handle;
+
+    void init() {
+        if (image) return;
+
+        const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                               ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+        if (!part) {
+            ESP_LOGW(TAG, "Partition '%s' not found, static files disabled", PARTITION_LABEL);
+            return;
+        }
+
+        ImageHeader header;
+        if (esp_partition_read(part, 0, &header, sizeof(header)) != ESP_OK || header.magic != IMAGE_MAGIC) {
+            ESP_LOGW(TAG, "Partition '%s' holds no www image", PARTITION_LABEL);
+            return;
+        }
+        if (header.image_size > part->size ||
+            sizeof(ImageHeader) + (size_t)header.count * sizeof(Entry) > header.image_size) {
+            ESP_LOGE(TAG, "Corrupted www image header");
+            return;
+        }
+
+        // Отображаем только занятую часть раздела
+        const void* ptr = nullptr;
+        esp_err_t ret = esp_partition_mmap(part, 0, header.image_size, ESP_PARTITION_MMAP_DATA, &ptr, &mmap_handle);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to mmap partition '%s': %d", PARTITION_LABEL, ret);
+            return;
+        }
+
+        const uint8_t* base = static_cast<const uint8_t*>(ptr);
+        const Entry* table = reinterpret_cast<const Entry*>(base + sizeof(ImageHeader));
+        for (uint32_t i = 0; i < header.count; i++) {
+            if (table[i].offset > header.image_size || table[i].size > header.image_size - table[i].offset ||
+                table[i].path[sizeof(table[i].path) - 1] != '\0' ||
+                table[i].type[sizeof(table[i].type) - 1] != '\0' ||
+                table[i].etag[sizeof(table[i].etag) - 1] != '\0') {
+                ESP_LOGE(TAG, "Corrupted www image entry %" PRIu32, i);
+                esp_partition_munmap(mmap_handle);
+                return;
+            }
+        }
+
+        image = base;
+        entries = table;
+        entry_count = header.count;
+        ESP_LOGI(TAG, "Mapped %" PRIu32 " static files (%" PRIu32 " bytes)", entry_count, header.image_size);
+    }
+
+    static const Entry* find(const char* uri) {
+        size_t len = strcspn(uri, "?#");
+        if (len == 1 && uri[0] == '/') {
+            uri = "/index.html";
+            len = strlen(uri);
+        }
+        for (uint32_t i = 0; i < entry_count; i++) {
+            if (strlen(entries[i].path) == len && strncmp(entries[i].path, uri, len) == 0) {
+                return &entries[i];
+            }
+        }
+        return nullptr;
+    }
+
+    static bool accepts_gzip(httpd_req_t *req) {
+        char accept[96];
+        if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept, sizeof(accept)) != ESP_OK) {
+            return false;
+        }
+        return strstr(accept, "gzip") != nullptr;
+    }
+
+    esp_err_t getHandler(httpd_req_t *req) {
+        const Entry* entry = image ? find(req->uri) : nullptr;
+        if (!entry) {
+            return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+        }
+
+        // Строки заголовков указывают прямо во flash и живут всё время работы
+        httpd_resp_set_hdr(req, "ETag", entry->etag);
+        httpd_resp_set_hdr(req, "Cache-Control", CACHE_CONTROL);
+
+        char if_none_match[sizeof(entry->etag) + 8];
+        if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+            strcmp(if_none_match, entry->etag) == 0) {
+            httpd_resp_set_status(req, "304 Not Modified");
+            return httpd_resp_send(req, NULL, 0);
+        }
+
+        if (!accepts_gzip(req)) {
+            httpd_resp_set_status(req, "406 Not Acceptable");
+            return httpd_resp_send(req, "gzip required", HTTPD_RESP_USE_STRLEN);
+        }
+
+        httpd_resp_set_type(req, entry->type);
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+
+        // Отправка напрямую из отображённой flash, без копирования в RAM
+        const uint8_t* data = image + entry->offset;
+        size_t remaining = entry->size;
+        while (remaining > 0) {
+            size_t chunk = remaining < SEND_CHUNK_SIZE ? remaining : SEND_CHUNK_SIZE;
+            esp_err_t ret = httpd_resp_send_chunk(req, reinterpret_cast<const char*>(data), chunk);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to send %s: %d", entry->path, ret);
+                return ret;
+            }
+            data += chunk;
+            remaining -= chunk;
+        }
+        return httpd_resp_send_chunk(req, NULL, 0);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef STATIC_FILES_H
+#define STATIC_FILES_H
+
+#include <esp_http_server.h>
+
+namespace static_files {
+    // Отображает раздел "www" в адресное пространство (один раз)
+    void init();
+
+    // GET-обработчик для статических файлов (регистрируется последним, URI "/*")
+    esp_err_t getHandler(httpd_req_t *req);
+}
+
+#endif
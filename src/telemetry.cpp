@@ -0,0 +1,76 @@
+#include "telemetry.h"
+#include "voltage.h"
+#include "acs712.h"
+#include <esp_log.h>
+#include <inttypes.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace telemetry {
+    static const char* TAG = "telemetry";
+
+    // Кольцевой буфер отсчётов; пишет таймер, читают HTTP-обработчики
+    static telemetry_codec::Sample history[HISTORY_SIZE];
+    static size_t head = 0;   // Индекс следующей записи
+    static size_t count = 0;
+    static SemaphoreHandle_t lock = NULL;
+    static esp_timer_handle_t timer = NULL;
+
+    static void sample_callback(void* arg) {
+        telemetry_codec::Sample sample;
+        sample.t_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        sample.values[0] = voltage::readMillivolts(true);
+        sample.values[1] = acs712::readMilliamps();
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        history[head] = sample;
+        head = (head + 1) % HISTORY_SIZE;
+        if (count < HISTORY_SIZE) count++;
+        xSemaphoreGive(lock);
+    }
+
+    size_t snapshot(telemetry_codec::Sample* out, size_t max) {
+        if (!lock) return 0;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        size_t n = count < max ? count : max;
+        size_t start = (head + HISTORY_SIZE - n) % HISTORY_SIZE;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = history[(start + i) % HISTORY_SIZE];
+        }
+        xSemaphoreGive(lock);
+        return n;
+    }
+
+    void init() {
+        if (timer) {
+            ESP_LOGW(TAG, "Telemetry already running");
+            return;
+        }
+        if (!lock) lock = xSemaphoreCreateMutex();
+
+        const esp_timer_create_args_t args = {
+            .callback = sample_callback,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "telemetry",
+            .skip_unhandled_events = true,
+        };
+        if (esp_timer_create(&args, &timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create telemetry timer");
+            timer = NULL;
+            return;
+        }
+        esp_timer_start_periodic(timer, SAMPLE_PERIOD_MS * 1000);
+        ESP_LOGI(TAG, "Telemetry started: %u samples every %" PRIu32 " ms",
+                 (unsigned)HISTORY_SIZE, SAMPLE_PERIOD_MS);
+    }
+
+    void stop() {
+        if (!timer) return;
+        esp_timer_stop(timer);
+        esp_timer_delete(timer);
+        timer = NULL;
+        ESP_LOGI(TAG, "Telemetry stopped");
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "telemetry_codec.h"
+
+namespace telemetry {
+    void init();
+    void stop();
+
+    // Копирует последние max отсчётов (от старых к новым), возвращает их число
+    size_t snapshot(telemetry_codec::Sample* out, size_t max);
+
+    static const size_t HISTORY_SIZE = 256;       // Глубина истории
+    static const uint32_t SAMPLE_PERIOD_MS = 100; // Период опроса
+}
+
+#endif
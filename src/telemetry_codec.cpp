@@ -0,0 +1,161 @@
+#include "telemetry_codec.h"
+#include <cstring>
+
+namespace telemetry_codec {
+    const char* const CHANNEL_NAMES[CHANNELS] = { "voltage_mv", "current_ma" };
+
+    const char* contentType(Format format) {
+        switch (format) {
+            case Format::Cbor:   return "application/cbor";
+            case Format::Binary: return "application/octet-stream";
+            default:             return "application/json";
+        }
+    }
+
+    bool fromAccept(const char* accept, Format* format) {
+        if (strstr(accept, "application/cbor")) *format = Format::Cbor;
+        else if (strstr(accept, "application/octet-stream")) *format = Format::Binary;
+        else if (strstr(accept, "application/json")) *format = Format::Json;
+        else return false;
+        return true;
+    }
+
+    bool fromName(const char* name, Format* format) {
+        if (strcmp(name, "json") == 0) *format = Format::Json;
+        else if (strcmp(name, "cbor") == 0) *format = Format::Cbor;
+        else if (strcmp(name, "bin") == 0) *format = Format::Binary;
+        else return false;
+        return true;
+    }
+
+    // Целое в десятичную строку без printf
+    static void writeDecimal(cbor::Sink& sink, int64_t value) {
+        char buf[21];
+        size_t pos = sizeof(buf);
+        uint64_t v = value < 0 ? (uint64_t)(-(value + 1)) + 1 : (uint64_t)value;
+        do {
+            buf[--pos] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v);
+        if (value < 0) buf[--pos] = '-';
+        cbor::write(sink, buf + pos, sizeof(buf) - pos);
+    }
+
+    static void writeStr(cbor::Sink& sink, const char* s) {
+        cbor::write(sink, s, strlen(s));
+    }
+
+    static void putLe16(uint8_t* p, uint16_t v) {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    static void putLe32(uint8_t* p, uint32_t v) {
+        for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+    }
+
+    static int16_t saturate16(int32_t v) {
+        if (v > INT16_MAX) return INT16_MAX;
+        if (v < INT16_MIN) return INT16_MIN;
+        return (int16_t)v;
+    }
+
+    // Дельта между соседними отсчётами; счётчик мс переполняется раз в ~49 дней
+    static uint32_t delta(const Sample* samples, size_t i) {
+        return i == 0 ? 0 : samples[i].t_ms - samples[i - 1].t_ms;
+    }
+
+    static void encodeJson(const Sample* samples, size_t count, cbor::Sink& sink) {
+        writeStr(sink, "{\"t0\":");
+        writeDecimal(sink, count ? samples[0].t_ms : 0);
+        writeStr(sink, ",\"ch\":[");
+        for (size_t c = 0; c < CHANNELS; c++) {
+            if (c) writeStr(sink, ",");
+            writeStr(sink, "\"");
+            writeStr(sink, CHANNEL_NAMES[c]);
+            writeStr(sink, "\"");
+        }
+        writeStr(sink, "],\"dt\":[");
+        for (size_t i = 0; i < count; i++) {
+            if (i) writeStr(sink, ",");
+            writeDecimal(sink, delta(samples, i));
+        }
+        writeStr(sink, "],\"v\":[");
+        for (size_t c = 0; c < CHANNELS; c++) {
+            writeStr(sink, c ? ",[" : "[");
+            for (size_t i = 0; i < count; i++) {
+                if (i) writeStr(sink, ",");
+                writeDecimal(sink, samples[i].values[c]);
+            }
+            writeStr(sink, "]");
+        }
+        writeStr(sink, "]}");
+    }
+
+    static void encodeCbor(const Sample* samples, size_t count, cbor::Sink& sink) {
+        cbor::writeMap(sink, 4);
+        cbor::writeText(sink, "t0");
+        cbor::writeUint(sink, count ? samples[0].t_ms : 0);
+        cbor::writeText(sink, "ch");
+        cbor::writeArray(sink, CHANNELS);
+        for (size_t c = 0; c < CHANNELS; c++) cbor::writeText(sink, CHANNEL_NAMES[c]);
+        cbor::writeText(sink, "dt");
+        cbor::writeArray(sink, count);
+        for (size_t i = 0; i < count; i++) cbor::writeUint(sink, delta(samples, i));
+        cbor::writeText(sink, "v");
+        cbor::writeArray(sink, CHANNELS);
+        for (size_t c = 0; c < CHANNELS; c++) {
+            cbor::writeArray(sink, count);
+            for (size_t i = 0; i < count; i++) cbor::writeInt(sink, samples[i].values[c]);
+        }
+    }
+
+    static void encodeBinary(const Sample* samples, size_t count, cbor::Sink& sink) {
+        if (count > UINT16_MAX) count = UINT16_MAX;
+        uint8_t header[BINARY_HEADER_SIZE];
+        header[0] = 'E';
+        header[1] = 'T';
+        header[2] = BINARY_VERSION;
+        header[3] = (uint8_t)CHANNELS;
+        putLe16(header + 4, (uint16_t)count);
+        putLe16(header + 6, 0);
+        putLe32(header + 8, count ? samples[0].t_ms : 0);
+        cbor::write(sink, header, sizeof(header));
+
+        uint8_t record[2 + 2 * CHANNELS];
+        for (size_t i = 0; i < count; i++) {
+            uint32_t dt = delta(samples, i);
+            putLe16(record, dt > UINT16_MAX ? UINT16_MAX : (uint16_t)dt);
+            for (size_t c = 0; c < CHANNELS; c++) {
+                putLe16(record + 2 + 2 * c, (uint16_t)saturate16(samples[i].values[c]));
+            }
+            cbor::write(sink, record, sizeof(record));
+        }
+    }
+
+    void encodeBatch(Format format, const Sample* samples, size_t count, cbor::Sink& sink) {
+        switch (format) {
+            case Format::Cbor:   encodeCbor(samples, count, sink); break;
+            case Format::Binary: encodeBinary(samples, count, sink); break;
+            default:             encodeJson(samples, count, sink); break;
+        }
+    }
+
+    void encodeValue(Format format, const char* name, int32_t value, cbor::Sink& sink) {
+        if (format == Format::Cbor) {
+            cbor::writeMap(sink, 1);
+            cbor::writeText(sink, name);
+            cbor::writeInt(sink, value);
+        } else if (format == Format::Binary) {
+            uint8_t buf[4];
+            putLe32(buf, (uint32_t)value);
+            cbor::write(sink, buf, sizeof(buf));
+        } else {
+            writeStr(sink, "{\"");
+            writeStr(sink, name);
+            writeStr(sink, "\":");
+            writeDecimal(sink, value);
+            writeStr(sink, "}");
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include "cbor.h"
+#include <cstddef>
+#include <cstdint>
+
+// Кодирование пакетов телеметрии в JSON, CBOR и бинарный формат.
+// Без зависимостей от ESP-IDF - собирается и на хосте.
+namespace telemetry_codec {
+    static const size_t CHANNELS = 2;
+    extern const char* const CHANNEL_NAMES[CHANNELS];  // Каналы в целых единицах (мВ, мА)
+
+    struct Sample {
+        uint32_t t_ms;              // Время с загрузки, мс
+        int32_t values[CHANNELS];
+    };
+
+    enum class Format { Json, Cbor, Binary };
+
+    // Бинарный формат (little-endian):
+    //   заголовок 12 байт: magic "ET", version u8, channels u8, count u16, reserved u16, t0_ms u32
+    //   запись: dt_ms u16 (от предыдущей записи, первая = 0), значения int16 x channels (с насыщением)
+    static const uint8_t BINARY_VERSION = 1;
+    static const size_t BINARY_HEADER_SIZE = 12;
+
+    const char* contentType(Format format);
+
+    // Выбор формата по заголовку Accept; false, если ни один не запрошен явно
+    bool fromAccept(const char* accept, Format* format);
+    bool fromName(const char* name, Format* format);  // "json", "cbor", "bin"
+
+    // JSON/CBOR: {"t0":<мс>,"ch":[имена],"dt":[дельты],"v":[[значения канала 0],...]}
+    void encodeBatch(Format format, const Sample* samples, size_t count, cbor::Sink& sink);
+
+    // Одиночное значение: JSON {"<name>":v}, CBOR {name: v}, бинарный int32
+    void encodeValue(Format format, const char* name, int32_t value, cbor::Sink& sink);
+}
+
+#endif
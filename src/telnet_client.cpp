@@ -0,0 +1,522 @@
+#include "telnet_client.h"
+#include "expect.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <cstring>
+#include <freertos/FreeRTOS.h>
+
+namespace telnet_client {
+    static const char* TAG = "telnet";
+    static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+    // Telnet options
+    #define IAC   255
+    #define DONT  254
+    #define DO    253
+    #define WILL  251
+    #define WONT  252
+    #define SB    250
+    #define SE    240
+    #define ECHO  1
+    #define SGA   3
+    #define TERMINAL_TYPE 24
+    #define NAWS  31
+    #define TTYPE_IS   0
+    #define TTYPE_SEND 1
+    #define NAWS_WIDTH  200
+    #define NAWS_HEIGHT 50
+
+    static int64_t nowMs() {
+        return esp_timer_get_time() / 1000;
+    }
+
+    static void setError(Session& s, const char* error) {
+        strncpy(s.error, error, sizeof(s.error) - 1);
+        s.error[sizeof(s.error) - 1] = '\0';
+    }
+
+    // Send IAC command
+    static bool sendIACCommand(int sock, uint8_t command, uint8_t option) {
+        uint8_t iac_cmd[3] = {IAC, command, option};
+        if (send(sock, iac_cmd, 3, 0) < 0) {
+            ESP_LOGE(TAG, "Failed to send IAC command %d %d, errno: %d", command, option, errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Window size sent after WILL NAWS: wide enough that commands and their
+    // output are not wrapped by the router's shell
+    static bool sendWindowSize(int sock) {
+        uint8_t naws[] = {IAC, SB, NAWS, NAWS_WIDTH >> 8, NAWS_WIDTH & 0xFF, NAWS_HEIGHT >> 8, NAWS_HEIGHT & 0xFF, IAC, SE};
+        if (send(sock, naws, sizeof(naws), 0) < 0) {
+            ESP_LOGE(TAG, "Failed to send window size, errno: %d", errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Handle SB subnegotiation: data[i] is IAC, data[i + 1] is SB. Returns 1 and
+    // moves i past IAC SE, 0 if the sequence is not complete yet, -1 on error
+    static int handleSubnegotiation(int sock, const uint8_t* data, int len, int& i) {
+        int end = i + 2;
+        while (end + 1 < len && !(data[end] == IAC && data[end + 1] == SE)) end++;
+        if (end + 1 >= len) return 0;
+        if (end == i + 2) {
+            ESP_LOGE(TAG, "Empty SB subnegotiation");
+            return -1;
+        }
+        uint8_t option = data[i + 2];
+        if (option == TERMINAL_TYPE && end > i + 3 && data[i + 3] == TTYPE_SEND) {
+            static const uint8_t ttype[] = {IAC, SB, TERMINAL_TYPE, TTYPE_IS, 'V', 'T', '1', '0', '0', IAC, SE};
+            if (send(sock, ttype, sizeof(ttype), 0) < 0) {
+                ESP_LOGE(TAG, "Failed to send terminal type, errno: %d", errno);
+                return -1;
+            }
+        } else {
+            ESP_LOGD(TAG, "Ignored SB for option %d", option);
+        }
+        i = end + 2;
+        return 1;
+    }
+
+    // Strip telnet commands from received data, answering option requests, and
+    // copy the text to text. Returns how many bytes were consumed: a command cut
+    // by the segment boundary is left for the next read; -1 on error
+    static int parseTelnet(Session& s, const uint8_t* data, int len, uint8_t* text, size_t* text_len) {
+        int i = 0;
+        while (i < len) {
+            if (data[i] != IAC) {
+                text[(*text_len)++] = data[i++];
+                continue;
+            }
+            if (i + 1 >= len) break;
+            uint8_t command = data[i + 1];
+            if (command == IAC) {
+                text[(*text_len)++] = IAC;
+                i += 2;
+            } else if (command == SB) {
+                int result = handleSubnegotiation(s.sock, data, len, i);
+                if (result < 0) {
+                    setError(s, "bad subnegotiation");
+                    return -1;
+                }
+                if (result == 0) break;
+            } else if (command >= WILL) {
+                if (i + 2 >= len) break;
+                uint8_t option = data[i + 2];
+                bool sent = true;
+                if (command == DO) {
+                    if (option == NAWS) {
+                        sent = sendIACCommand(s.sock, WILL, option) && sendWindowSize(s.sock);
+                    } else if (option == TERMINAL_TYPE) {
+                        sent = sendIACCommand(s.sock, WILL, option);
+                    } else {
+                        sent = sendIACCommand(s.sock, WONT, option);
+                    }
+                } else if (command == DONT) {
+                    sent = sendIACCommand(s.sock, WONT, option);
+                } else if (command == WILL) {
+                    if (option == ECHO || option == SGA) {
+                        sent = sendIACCommand(s.sock, DO, option);
+                    } else {
+                        sent = sendIACCommand(s.sock, DONT, option);
+                    }
+                } else if (command == WONT) {
+                    sent = sendIACCommand(s.sock, DONT, option);
+                }
+                if (!sent) {
+                    setError(s, "send failed");
+                    return -1;
+                }
+                i += 3;
+            } else {
+                i += 2;    // NOP, GA and other two-byte commands
+            }
+        }
+        return i;
+    }
+
+    // Watched on every wait besides the expected prompt. "not found" only in the
+    // shell's own form, "sh: X: not found" at the end of a line (CR LF or bare LF):
+    // the words in the echoed command or in grep/cat output are not an error
+    static const char* const PAGER = "--More--";
+    struct ErrorPattern {
+        const char* text;
+        const char* message;
+    };
+    static const ErrorPattern ERRORS[] = {
+        { "Login incorrect", "Login incorrect" },
+        { "Permission denied", "Permission denied" },
+        { ": not found\r", "not found" },
+        { ": not found\n", "not found" },
+    };
+    static const size_t ERROR_COUNT = sizeof(ERRORS) / sizeof(ERRORS[0]);
+
+    // Data already queued after a prompt means it was not the end of output
+    static bool moreQueued(int sock) {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(sock, &read_fds);
+        struct timeval tv = { .tv_sec = 0, .tv_usec = 0 };
+        return select(sock + 1, &read_fds, NULL, NULL, &tv) > 0;
+    }
+
+    // Wait for prompt: the expected prompt at the end of output, the pager
+    // (answered with a space) and error messages (fail at once instead of
+    // waiting for the timeout), matched in one pass over the stream
+    static bool waitForPrompt(Session& s, const char* prompt, int timeout_ms) {
+        int sock = s.sock;
+        uint8_t buffer[sizeof(s.partial) + 256];
+        uint8_t text[sizeof(buffer)];
+        int64_t start_time = nowMs();
+
+        expect::Pattern patterns[2 + ERROR_COUNT] = {
+            { prompt, expect::Anchor::End },
+            { PAGER, expect::Anchor::Anywhere },
+        };
+        for (size_t e = 0; e < ERROR_COUNT; e++) patterns[2 + e] = { ERRORS[e].text, expect::Anchor::Anywhere };
+        expect::Automaton automaton;
+        if (!expect::build(automaton, patterns, 2 + ERROR_COUNT)) {
+            ESP_LOGE(TAG, "Prompt too long: %s", prompt);
+            setError(s, "prompt too long");
+            return false;
+        }
+        expect::Matcher matcher;
+        expect::reset(matcher, automaton);
+
+        int flags = fcntl(sock, F_GETFL, 0);
+        if (fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+            ESP_LOGE(TAG, "Failed to set non-blocking mode, errno: %d", errno);
+            setError(s, "socket error");
+            return false;
+        }
+
+        while ((nowMs() - start_time) < timeout_ms) {
+            fd_set read_fds;
+            FD_ZERO(&read_fds);
+            FD_SET(sock, &read_fds);
+            struct timeval tv = { .tv_sec = 0, .tv_usec = 50000 };
+            int select_result = select(sock + 1, &read_fds, NULL, NULL, &tv);
+
+            if (select_result < 0) {
+                ESP_LOGE(TAG, "Select error, errno: %d", errno);
+                setError(s, "socket error");
+                return false;
+            }
+
+            if (select_result > 0) {
+                // Data starts with a telnet command left incomplete by the last read
+                size_t carried = s.partial_len;
+                memcpy(buffer, s.partial, carried);
+                int len = recv(sock, buffer + carried, sizeof(buffer) - carried, 0);
+                if (len > 0) {
+                    size_t text_len = 0;
+                    int total = (int)carried + len;
+                    int parsed = parseTelnet(s, buffer, total, text, &text_len);
+                    if (parsed < 0) return false;
+                    if ((size_t)(total - parsed) > sizeof(s.partial)) {
+                        ESP_LOGE(TAG, "Telnet command too long");
+                        setError(s, "bad subnegotiation");
+                        return false;
+                    }
+                    s.partial_len = (uint8_t)(total - parsed);
+                    memcpy(s.partial, buffer + parsed, s.partial_len);
+                    ESP_LOGD(TAG, "Received: %.*s", (int)text_len, (const char*)text);
+
+                    size_t offset = 0;
+                    while (offset < text_len) {
+                        size_t used;
+                        int match = expect::feed(matcher, text + offset, text_len - offset, &used);
+                        offset += used;
+                        if (match == 1) {
+                            if (send(sock, " ", 1, 0) < 0) {
+                                ESP_LOGE(TAG, "Failed to answer pager, errno: %d", errno);
+                                setError(s, "send failed");
+                                return false;
+                            }
+                        } else if (match >= 2) {
+                            ESP_LOGE(TAG, "%s reported \"%s\" while waiting for %s", s.ip.c_str(), ERRORS[match - 2].message, prompt);
+                            setError(s, ERRORS[match - 2].message);
+                            return false;
+                        }
+                    }
+                    // The prompt counts only once nothing else is pending: no telnet
+                    // command half-read and no bytes queued in the socket
+                    if (s.partial_len == 0 && !moreQueued(sock) && expect::idle(matcher) == 0) {
+                        return true;
+                    }
+                } else if (len <= 0) {
+                    if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                        ESP_LOGE(TAG, "Receive error, errno: %d", errno);
+                        setError(s, "receive error");
+                        return false;
+                    }
+                    if (len == 0) {
+                        ESP_LOGE(TAG, "Connection closed by %s", s.ip.c_str());
+                        setError(s, "closed by peer");
+                        return false;
+                    }
+                }
+            }
+        }
+        ESP_LOGW(TAG, "Timeout waiting for prompt: %s", prompt);
+        setError(s, "prompt timeout");
+        return false;
+    }
+
+    // Send command
+    static bool sendCommand(Session& s, const char* cmd, const char* expected_prompt, int timeout_ms) {
+        ssize_t sent = send(s.sock, cmd, strlen(cmd), 0);
+        if (sent <= 0) {
+            ESP_LOGE(TAG, "Failed to send command: %s, errno: %d", cmd, errno);
+            setError(s, "send failed");
+            return false;
+        }
+        return waitForPrompt(s, expected_prompt, timeout_ms);
+    }
+
+    // Open a TCP connection with connect timeout; returns a blocking socket with
+    // send/receive timeouts set, or -1
+    static int connectSocket(const std::string& ip, int port, int timeout_ms, bool quiet) {
+        int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (sock < 0) {
+            ESP_LOGE(TAG, "Socket creation failed, errno: %d", errno);
+            return -1;
+        }
+
+        struct timeval timeout = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        if (setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0 ||
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+            ESP_LOGE(TAG, "Failed to set socket timeouts, errno: %d", errno);
+            ::close(sock);
+            return -1;
+        }
+
+        // Negotiation replies, username and password are small writes in a row:
+        // with Nagle each one waits for the ACK of the previous (delayed ACK, 40 ms)
+        int nodelay = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        struct sockaddr_in server_addr = {};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, ip.c_str(), &server_addr.sin_addr) <= 0) {
+            ESP_LOGE(TAG, "Invalid IP address: %s", ip.c_str());
+            ::close(sock);
+            return -1;
+        }
+
+        int flags = fcntl(sock, F_GETFL, 0);
+        if (fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+            ESP_LOGE(TAG, "Failed to set non-blocking mode, errno: %d", errno);
+            ::close(sock);
+            return -1;
+        }
+
+        int connect_result = connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr));
+        if (connect_result < 0 && errno != EINPROGRESS) {
+            if (!quiet) ESP_LOGE(TAG, "Connection failed for IP %s:%d, errno: %d", ip.c_str(), port, errno);
+            ::close(sock);
+            return -1;
+        }
+
+        fd_set write_fds;
+        FD_ZERO(&write_fds);
+        FD_SET(sock, &write_fds);
+        struct timeval connect_timeout = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        int select_result = select(sock + 1, NULL, &write_fds, NULL, &connect_timeout);
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        if (select_result <= 0 || getsockopt(sock, SOL_SOCKET, SO_ERROR, &so_error, &len) < 0 || so_error != 0) {
+            if (!quiet) {
+                ESP_LOGE(TAG, "Connection %s for IP %s:%d, errno: %d", select_result == 0 ? "timeout" : "failed",
+                         ip.c_str(), port, so_error ? so_error : errno);
+            }
+            ::close(sock);
+            return -1;
+        }
+
+        if (fcntl(sock, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+            ESP_LOGE(TAG, "Failed to reset blocking mode, errno: %d", errno);
+            ::close(sock);
+            return -1;
+        }
+        return sock;
+    }
+
+    bool reachable(const std::string& ip, int port, int timeout_ms) {
+        int sock = connectSocket(ip, port, timeout_ms, true);
+        if (sock < 0) return false;
+        ::close(sock);
+        return true;
+    }
+
+    // Telnet option negotiation and login up to the shell prompt
+    static bool login(Session& s) {
+        if (!sendIACCommand(s.sock, DONT, ECHO) ||
+            !sendIACCommand(s.sock, WILL, SGA) ||
+            !sendIACCommand(s.sock, DONT, TERMINAL_TYPE) ||
+            !sendIACCommand(s.sock, DONT, NAWS)) {
+            ESP_LOGE(TAG, "Failed to send initial IAC commands");
+            setError(s, "send failed");
+            return false;
+        }
+
+        const Options& o = s.options;
+        if (!waitForPrompt(s, "Login:", o.timeout_ms)) {
+            ESP_LOGE(TAG, "Failed to get Login prompt");
+            return false;
+        }
+        if (!sendCommand(s, (o.username + "\r").c_str(), "Password:", o.timeout_ms)) {
+            ESP_LOGE(TAG, "Failed to send username");
+            return false;
+        }
+        if (!sendCommand(s, (o.password + "\r").c_str(), "#", o.timeout_ms)) {
+            ESP_LOGE(TAG, "Failed to send password");
+            return false;
+        }
+        return true;
+    }
+
+    void close(Session& s) {
+        if (s.sock >= 0) {
+            ::close(s.sock);
+            s.sock = -1;
+        }
+        s.partial_len = 0;
+        portENTER_CRITICAL(&stats_lock);
+        s.stats.connected = false;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+
+    bool open(Session& s) {
+        close(s);
+        int64_t start = nowMs();
+        s.error[0] = '\0';
+        s.sock = connectSocket(s.ip, s.port, s.options.timeout_ms, false);
+        if (s.sock < 0) {
+            setError(s, "connect failed");
+        } else if (!login(s)) {
+            ::close(s.sock);
+            s.sock = -1;
+        }
+        portENTER_CRITICAL(&stats_lock);
+        if (s.sock < 0) {
+            s.stats.connect_failures++;
+        } else {
+            s.stats.connects++;
+            s.stats.connected = true;
+            s.stats.last_login_ms = (uint32_t)(nowMs() - start);
+        }
+        portEXIT_CRITICAL(&stats_lock);
+        if (s.sock < 0) return false;
+        s.last_used_ms = nowMs();
+        ESP_LOGI(TAG, "Session to %s:%d ready in %u ms", s.ip.c_str(), s.port,
+                 (unsigned)(s.last_used_ms - start));
+        return true;
+    }
+
+    // FIN or RST already received: no round-trip needed to know the session is gone
+    static bool closedByPeer(int sock) {
+        char c;
+        int len = recv(sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return len == 0 || (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+    }
+
+    // Discard output left from earlier commands (late lines, router messages) so
+    // it cannot satisfy the prompt match of the next command
+    static void drainInput(int sock) {
+        char buffer[256];
+        while (recv(sock, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+        }
+    }
+
+    bool probe(Session& s) {
+        if (s.sock < 0) return false;
+        int64_t start = nowMs();
+        drainInput(s.sock);
+        bool ok = sendCommand(s, s.options.probe_command.c_str(), "#", s.options.probe_timeout_ms);
+        portENTER_CRITICAL(&stats_lock);
+        s.stats.probes++;
+        if (ok) {
+            s.stats.last_probe_ms = (uint32_t)(nowMs() - start);
+        } else {
+            s.stats.probe_failures++;
+        }
+        portEXIT_CRITICAL(&stats_lock);
+        if (ok) {
+            s.last_used_ms = nowMs();
+        } else {
+            ESP_LOGW(TAG, "Session probe to %s failed", s.ip.c_str());
+        }
+        return ok;
+    }
+
+    bool ensure(Session& s) {
+        if (s.sock >= 0) {
+            if (closedByPeer(s.sock)) {
+                ESP_LOGW(TAG, "Session closed by %s", s.ip.c_str());
+            } else if (nowMs() - s.last_used_ms < s.options.probe_idle_ms || probe(s)) {
+                portENTER_CRITICAL(&stats_lock);
+                s.stats.reuses++;
+                portEXIT_CRITICAL(&stats_lock);
+                return true;
+            }
+            close(s);
+        }
+        return open(s);
+    }
+
+    bool run(Session& s, const Commands& commands) {
+        int64_t start = nowMs();
+        bool ok = s.sock >= 0;
+        if (!ok) setError(s, "no session");
+        if (ok) drainInput(s.sock);
+        for (const auto& cmd : commands) {
+            if (!ok) break;
+            if (cmd.second.empty()) {
+                // Ends the session (exit, reboot): done once written, the router may drop the connection first
+                if (send(s.sock, cmd.first.c_str(), cmd.first.size(), 0) != (ssize_t)cmd.first.size()) {
+                    setError(s, "send failed");
+                    ok = false;
+                }
+                close(s);
+                break;
+            }
+            if (!sendCommand(s, cmd.first.c_str(), cmd.second.c_str(), s.options.timeout_ms)) {
+                ESP_LOGE(TAG, "Failed to execute command: %s", cmd.first.c_str());
+                // Unknown CLI state after a timeout or a drop: start clean next time
+                close(s);
+                ok = false;
+                break;
+            }
+            s.last_used_ms = nowMs();
+        }
+        portENTER_CRITICAL(&stats_lock);
+        s.stats.sequences++;
+        if (ok) {
+            s.stats.last_sequence_ms = (uint32_t)(nowMs() - start);
+        } else {
+            s.stats.sequence_failures++;
+        }
+        portEXIT_CRITICAL(&stats_lock);
+        return ok;
+    }
+
+    void keepalive(Session& s) {
+        if (s.sock >= 0 && s.options.keepalive_ms > 0 &&
+            nowMs() - s.last_used_ms >= s.options.keepalive_ms && !probe(s)) {
+            close(s);
+        }
+    }
+
+    Stats getStats(const Session& s) {
+        portENTER_CRITICAL(&stats_lock);
+        Stats result = s.stats;
+        portEXIT_CRITICAL(&stats_lock);
+        return result;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef TELNET_CLIENT_H
+#define TELNET_CLIENT_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Telnet client for router CLIs (ZTE F660): option negotiation, login and
+// commands that wait for the shell prompt (expect). A session stays open
+// between command sequences and is replaced only when the router drops it or
+// stops answering the probe command. Not thread-safe per session: each session
+// belongs to one task, only getStats() may be called from others.
+namespace telnet_client {
+    // Command and expected prompt; an empty prompt means the command ends the session (exit)
+    typedef std::vector<std::pair<std::string, std::string>> Commands;
+
+    struct Options {
+        int timeout_ms = 15000;           // Connect and prompt wait
+        int probe_idle_ms = 5000;         // Probe a warm session idle longer than this before reuse
+        int keepalive_ms = 30000;         // Probe an idle session at least this often, 0 - never
+        int probe_timeout_ms = 3000;
+        std::string probe_command = "true\r\n";  // No-op answered with the shell prompt
+        std::string username = "root";
+        std::string password = "Zte521";
+    };
+
+    struct Stats {
+        bool connected;              // Session open right now
+        uint32_t connects;           // Connect + login
+        uint32_t connect_failures;
+        uint32_t reuses;             // Sequences started on a warm session
+        uint32_t probes;             // No-op commands checking an idle session
+        uint32_t probe_failures;
+        uint32_t sequences;
+        uint32_t sequence_failures;
+        uint32_t last_login_ms;      // Connect, negotiation and login
+        uint32_t last_sequence_ms;
+        uint32_t last_probe_ms;      // Round-trip of the probe command
+    };
+
+    struct Session {
+        std::string ip;
+        int port = 23;
+        Options options;
+        int sock = -1;
+        int64_t last_used_ms = 0;    // Last prompt received
+        char error[48] = "";         // Why the last operation failed
+        uint8_t partial[32];         // Telnet command cut by a segment boundary
+        uint8_t partial_len = 0;
+        Stats stats = {};
+    };
+
+    // TCP connect only (no login): true if something accepts on ip:port within timeout_ms
+    bool reachable(const std::string& ip, int port, int timeout_ms);
+
+    bool open(Session& session);                        // New connection and login
+    void close(Session& session);
+    bool ensure(Session& session);                      // Warm session if alive, otherwise open()
+    bool probe(Session& session);
+    bool run(Session& session, const Commands& commands);
+    void keepalive(Session& session);                   // probe() if idle for keepalive_ms; closes on failure
+    Stats getStats(const Session& session);
+}
+
+#endif
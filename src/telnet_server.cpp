@@ -30,12 +30,21 @@ namespace telnet_server {
 
     static bool stopFlag = false; // Флаг для остановки сервера
     static int server_sock = -1; // Сокет сервера для закрытия
+    static Stats stats = {};
+    static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
 
     typedef struct {
         int sock;
         char ip[16];
     } ClientData;
 
+    // Счётчики обновляются из нескольких задач, а читаются из консоли/HTTP
+    static void count(uint32_t& counter) {
+        portENTER_CRITICAL(&stats_lock);
+        counter++;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+
     static bool sendIACCommand(int sock, uint8_t command, uint8_t option, const char* client_ip) {
         uint8_t iac_cmd[3] = { IAC, command, option };
         if (send(sock, iac_cmd, 3, 0) < 0) {
@@ -51,7 +60,9 @@ namespace telnet_server {
         ESP_LOGD(TAG, "Client %s: Closing socket", client_ip);
         close(sock);
         ESP_LOGI(TAG, "Client %s: Disconnected", client_ip);
+        portENTER_CRITICAL(&stats_lock);
         active_clients--;
+        portEXIT_CRITICAL(&stats_lock);
         esp_task_wdt_delete(NULL);
         vTaskDelete(NULL);
     }
@@ -135,7 +146,9 @@ namespace telnet_server {
         vPortFree(pvParameters);
         bool authenticated = false;
 
+        portENTER_CRITICAL(&stats_lock);
         active_clients++;
+        portEXIT_CRITICAL(&stats_lock);
         ESP_LOGD(TAG, "Client %s: Active clients: %d", client_ip, active_clients);
 
         esp_task_wdt_add(NULL);
@@ -198,6 +211,7 @@ namespace telnet_server {
             ESP_LOGI(TAG, "Client %s: Authentication successful", client_ip);
         } else {
             ESP_LOGD(TAG, "Client %s: Sending auth failed message", client_ip);
+            count(stats.auth_failures);
             if (send(sock, "Authentication failed.\r\n", 26, 0) < 0) {
                 ESP_LOGE(TAG, "Client %s: Failed to send auth failed message: %d", client_ip, errno);
             }
@@ -268,6 +282,7 @@ namespace telnet_server {
                 } else {
                     ESP_LOGD(TAG, "Client %s: Processing command", client_ip);
                     console::processCommand(commandStr.c_str(), sendResponse);
+                    count(stats.commands);
                     ESP_LOGD(TAG, "Client %s: Command processed, sending prompt", client_ip);
                 }
                 int sent = send(sock, "> ", 2, 0);
@@ -332,6 +347,7 @@ namespace telnet_server {
                         ESP_LOGW(TAG, "Client %s: Too many connections", client_ip);
                         send(client_sock, "Too many connections.\r\n", 23, 0);
                         close(client_sock);
+                        count(stats.rejected);
                         continue;
                     }
                     ESP_LOGI(TAG, "Client %s: Connected", client_ip);
@@ -340,10 +356,12 @@ namespace telnet_server {
                         ESP_LOGE(TAG, "Client %s: Failed to allocate client data", client_ip);
                         send(client_sock, "Server error.\r\n", 15, 0);
                         close(client_sock);
+                        count(stats.rejected);
                         continue;
                     }
                     client_data->sock = client_sock;
                     strcpy(client_data->ip, client_ip);
+                    count(stats.accepted);
                     xTaskCreate(handleClient, "handle_client_t", 12288, client_data, 5, NULL);
                 } else {
                     ESP_LOGE(TAG, "Accept failed: %d, checking stop flag...", errno);
@@ -380,4 +398,12 @@ namespace telnet_server {
             server_sock = -1;
         }
     }
+
+    Stats getStats() {
+        portENTER_CRITICAL(&stats_lock);
+        Stats result = stats;
+        result.active = active_clients;
+        portEXIT_CRITICAL(&stats_lock);
+        return result;
+    }
 }
\ No newline at end of file
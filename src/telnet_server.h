@@ -1,9 +1,20 @@
 #ifndef TELNET_SERVER_H
 #define TELNET_SERVER_H
 
+#include <cstdint>
+
 namespace telnet_server {
+    struct Stats {
+        uint32_t accepted;       // Принятые соединения
+        uint32_t rejected;       // Отклонённые (лимит клиентов, нет памяти)
+        uint32_t auth_failures;  // Неудачные попытки входа
+        uint32_t commands;       // Выполненные команды
+        int active;              // Активные клиенты
+    };
+
     void init();
     void stop();
+    Stats getStats();
 }
 
 #endif
\ No newline at end of file
@@ -1,51 +1,37 @@
 #include "voltage.h"
+#include "adc_sampler.h"
+#include "adc_cal.h"
 #include "esp_log.h"
-#include "esp_adc/adc_oneshot.h"
-#include "driver/gpio.h"
 
 namespace voltage {
     const char *TAG = "voltage";
-    adc_oneshot_unit_handle_t adc_handle = nullptr;
-    float scaleFactor = 1.0;  // Фактор масштабирования
-    const float calibrationFactor_3v3 = 1.255;  // Коэффициент калибровки для 3.3V
-    const float calibrationFactor_r1_r2 = 1.262;  // Коэффициент калибровки для делителя
+    bool initialized = false;
     adc_channel_t adc_channel = ADC_CHANNEL_4;  // Канал ADC
-    float R1 = 30000.0;  // Значение резистора R1 
-    float R2 = 7500.0;   // Значение резистора R2
 
     void init() {
-        scaleFactor = (R1 + R2) / R2;  // По умолчанию используем делитель
-        ESP_LOGI(TAG, "Initializing ADC with R1=%.2f, R2=%.2f...", R1, R2);
-        gpio_num_t gpio_pin = static_cast<gpio_num_t>(adc_channel);
-        gpio_set_direction(gpio_pin, GPIO_MODE_INPUT);
-        adc_oneshot_unit_init_cfg_t unit_config = {
-            .unit_id = ADC_UNIT_1,
-            .clk_src = ADC_DIGI_CLK_SRC_DEFAULT,
-            .ulp_mode = ADC_ULP_MODE_DISABLE
-        };
-        adc_oneshot_new_unit(&unit_config, &adc_handle);
-        adc_oneshot_chan_cfg_t config = {
-            .atten = ADC_ATTEN_DB_12,
-            .bitwidth = ADC_BITWIDTH_12
-        };
-        adc_oneshot_config_channel(adc_handle, adc_channel, &config);
+        // Делитель R1/R2 и поправки - в adc_cal (NVS), здесь только запуск выборки
+        adc_cal::Calibration calibration = adc_cal::getCalibration();
+        ESP_LOGI(TAG, "Initializing ADC with R1=%u, R2=%u...",
+                 (unsigned)calibration.r1_ohm, (unsigned)calibration.r2_ohm);
+        // Канал сканируется adc_sampler через DMA; порядок с другими датчиками не важен
+        initialized = adc_sampler::registerChannel(adc_channel, ADC_ATTEN_DB_12, adc_sampler::DEFAULT_CHANNEL_RATE_HZ);
         ESP_LOGI(TAG, "ADC initialized successfully.");
     }
 
-    float readVoltage(bool useDivider) {
-        int raw_value;
-        esp_err_t err = adc_oneshot_read(adc_handle, adc_channel, &raw_value);
-        if (err != ESP_OK) {
-            return 0.0;  // Возврат 0 при ошибке
-        }
-        if (useDivider) {
-            return ((float)raw_value / 4095.0) * 3.3 * scaleFactor * calibrationFactor_r1_r2;
-        } else {
-            return ((float)raw_value / 4095.0) * 3.3 * calibrationFactor_3v3;
+    int32_t readMillivolts(bool useDivider) {
+        // Выход цепочки фильтров adc_sampler - без обращения к ADC из вызывающей задачи
+        int32_t filtered;
+        if (!adc_sampler::latestFiltered(adc_channel, &filtered)) {
+            return 0;  // Возврат 0, если данных ещё нет
         }
+        return adc_cal::toMillivolts(useDivider ? adc_cal::VOLTAGE_DIVIDER : adc_cal::VOLTAGE_PIN, filtered);
+    }
+
+    float readVoltage(bool useDivider) {
+        return readMillivolts(useDivider) / 1000.0f;
     }
 
-    adc_oneshot_unit_handle_t getAdcHandle() {
-        return adc_handle;
+    bool isInitialized() {
+        return initialized;
     }
-}
\ No newline at end of file
+}
@@ -1,14 +1,15 @@
 #ifndef VOLTAGE_H
 #define VOLTAGE_H
 
-#include "esp_adc/adc_oneshot.h"
+#include <cstdint>
 
 namespace voltage {
     void init();  // Без аргументов, по умолчанию с делителем
     
     float readVoltage(bool useDivider);  // Оставляем аргументы для выбора режима
+    int32_t readMillivolts(bool useDivider);  // То же в мВ, без плавающей точки
     
-    adc_oneshot_unit_handle_t getAdcHandle();
+    bool isInitialized();
 }
 
-#endif
\ No newline at end of file
+#endif
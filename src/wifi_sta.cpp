@@ -5,6 +5,9 @@
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "nvs_flash.h"
 #include "lwip/ip_addr.h"
 #include "lwip/dns.h"
 #include "freertos/FreeRTOS.h"
@@ -23,30 +26,247 @@ namespace wifi_sta {
         const char* gateway = "192.168.100.1";
         const char* dns1 = "192.168.100.1";
         const char* dns2 = "192.168.100.2";
-        uint32_t reconnect_delay_ms = 60000;
+        // Повторное подключение: пауза удваивается от retry_min_ms до retry_max_ms,
+        // со случайным разбросом ±jitter_percent (станции после сбоя точки доступа
+        // не подключаются все разом)
+        uint32_t retry_min_ms = 1000;
+        uint32_t retry_max_ms = 60000;
+        uint32_t auth_retry_min_ms = 15000;   // Отказ в аутентификации: сам не исправится
+        uint32_t jitter_percent = 25;
     };
 
+    // Причины отключения по тому, как на них отвечать
+    enum class Cause {
+        Transient,   // Потеря маяков, истёкшая ассоциация, роуминг: первая попытка сразу
+        NoAp,        // Точка доступа не найдена (перезагружается): обычная пауза
+        Auth,        // Неверный пароль / отказ: пауза от auth_retry_min_ms
+    };
+
+    static const char* NVS_NAMESPACE = "wifi_sta";
+    static const char* NVS_KEY = "ap";
+    static const uint8_t STORE_VERSION = 1;
+
+    // Последняя точка доступа, через которую получен IP: с ней подключение идёт
+    // сразу на её канале без перебора каналов
+    struct Stored {
+        uint8_t version;
+        char ssid[33];        // Сменился SSID в настройках - запись не действует
+        uint8_t bssid[6];
+        uint8_t channel;
+        uint8_t authmode;     // wifi_auth_mode_t
+    };
+
+    static ConfigSTA config;
+    static Stored cached = {};
+    static bool have_cached = false;
+    static Stored joined = {};      // Из WIFI_EVENT_STA_CONNECTED, сохраняется при получении IP
+    static bool directed = false;   // Текущая попытка - на канал и BSSID из cached
+    static esp_timer_handle_t retry_timer = NULL;
+    static Stats stats = {};
+    static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+    static uint32_t failures = 0;   // Неудачных подключений подряд (сброс при получении IP)
+    static int64_t attempt_us = 0;  // Начало текущей попытки
+    static int64_t down_us = 0;     // Первое отключение в серии, 0 - связь не терялась
+
+    static Cause classify(uint8_t reason) {
+        switch (reason) {
+        case WIFI_REASON_NO_AP_FOUND:
+        case WIFI_REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY:
+        case WIFI_REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD:
+        case WIFI_REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD:
+        case WIFI_REASON_ASSOC_TOO_MANY:
+            return Cause::NoAp;
+        case WIFI_REASON_AUTH_FAIL:
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_802_1X_AUTH_FAILED:
+            return Cause::Auth;
+        default:
+            return Cause::Transient;
+        }
+    }
+
+    static void load_cached() {
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return;
+        size_t len = sizeof(cached);
+        have_cached = nvs_get_blob(handle, NVS_KEY, &cached, &len) == ESP_OK && len == sizeof(cached) &&
+                      cached.version == STORE_VERSION && cached.channel != 0 &&
+                      strncmp(cached.ssid, config.ssid, sizeof(cached.ssid)) == 0;
+        nvs_close(handle);
+        if (have_cached) {
+            ESP_LOGI(TAG, "Cached AP %02x:%02x:%02x:%02x:%02x:%02x, channel %d", cached.bssid[0], cached.bssid[1],
+                     cached.bssid[2], cached.bssid[3], cached.bssid[4], cached.bssid[5], cached.channel);
+        }
+    }
+
+    // Вызывается при получении IP: пишет во flash, только если точка доступа сменилась
+    static void save_joined() {
+        joined.version = STORE_VERSION;
+        strncpy(joined.ssid, config.ssid, sizeof(joined.ssid) - 1);
+        if (have_cached && memcmp(&joined, &cached, sizeof(joined)) == 0) return;
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err == ESP_OK) {
+            err = nvs_set_blob(handle, NVS_KEY, &joined, sizeof(joined));
+            if (err == ESP_OK) err = nvs_commit(handle);
+            nvs_close(handle);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to save AP: %d", err);
+            return;
+        }
+        cached = joined;
+        have_cached = true;
+    }
+
+    // Направленное подключение: известные канал и BSSID, порог безопасности не ниже
+    // прежнего (WPA3 требует PMF). Иначе - перебор всех каналов
+    static bool apply_config(bool to_cached) {
+        wifi_config_t wifi_config = {};
+        strcpy((char*)wifi_config.sta.ssid, config.ssid);
+        strcpy((char*)wifi_config.sta.password, config.password);
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        wifi_config.sta.pmf_cfg.capable = true;
+        wifi_config.sta.pmf_cfg.required = false;
+        if (to_cached) {
+            wifi_config.sta.channel = cached.channel;
+            wifi_config.sta.bssid_set = true;
+            memcpy(wifi_config.sta.bssid, cached.bssid, sizeof(cached.bssid));
+            wifi_config.sta.threshold.authmode = (wifi_auth_mode_t)cached.authmode;
+            wifi_config.sta.pmf_cfg.required = cached.authmode == WIFI_AUTH_WPA3_PSK;
+        } else {
+            wifi_config.sta.channel = 0; // Автоматический выбор канала
+        }
+        esp_err_t ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set Wi-Fi config: %d", ret);
+            return false;
+        }
+        directed = to_cached;
+        return true;
+    }
+
+    static void start_attempt() {
+        portENTER_CRITICAL(&stats_lock);
+        attempt_us = esp_timer_get_time();
+        portEXIT_CRITICAL(&stats_lock);
+        esp_err_t ret = esp_wifi_connect();
+        if (ret != ESP_OK) ESP_LOGW(TAG, "Connect request failed: %d", ret);
+    }
+
+    static uint32_t backoff_ms(Cause cause, uint32_t failure) {
+        uint32_t delay = cause == Cause::Auth ? config.auth_retry_min_ms : config.retry_min_ms;
+        for (uint32_t i = 1; i < failure && delay < config.retry_max_ms; i++) delay *= 2;
+        if (delay > config.retry_max_ms) delay = config.retry_max_ms;
+        uint32_t spread = delay / 100 * config.jitter_percent;
+        if (spread > 0) delay = delay - spread + esp_random() % (2 * spread + 1);
+        return delay;
+    }
+
+    // Из задачи esp_timer: esp_wifi_connect() не блокирует, результат придёт событием
+    static void retry(void* arg) {
+        portENTER_CRITICAL(&stats_lock);
+        stats.attempts++;
+        stats.next_retry_ms = 0;
+        portEXIT_CRITICAL(&stats_lock);
+        start_attempt();
+    }
+
+    static void schedule_retry(uint8_t reason) {
+        Cause cause = classify(reason);
+        failures++;
+        portENTER_CRITICAL(&stats_lock);
+        bool was_connected = stats.connected;
+        if (was_connected) down_us = esp_timer_get_time();
+        portEXIT_CRITICAL(&stats_lock);
+
+        // Связь была - точка доступа скорее всего на том же канале; не нашлась
+        // на нём - сразу полный перебор, пауза только между переборами
+        bool missed = directed && !was_connected;
+        uint32_t delay;
+        if (missed && cause != Cause::Auth) {
+            delay = 0;
+        } else if (cause == Cause::Transient && failures == 1) {
+            delay = 0;   // Кратковременная потеря рабочего соединения
+        } else {
+            delay = backoff_ms(cause, failures);
+        }
+        bool to_cached = have_cached && was_connected;
+        if (to_cached != directed) apply_config(to_cached);
+
+        portENTER_CRITICAL(&stats_lock);
+        stats.connected = false;
+        stats.disconnects++;
+        stats.last_reason = reason;
+        stats.failures = failures;
+        stats.next_retry_ms = delay;
+        if (missed) stats.directed_misses++;
+        portEXIT_CRITICAL(&stats_lock);
+        ESP_LOGW(TAG, "Disconnected from SSID '%s', reason: %d, attempt %" PRIu32 ", %s in %" PRIu32 " ms",
+                 config.ssid, reason, failures, directed ? "directed reconnect" : "scanning", delay);
+        esp_timer_stop(retry_timer);   // Не запущен - ошибка, не важно
+        if (delay == 0) {
+            retry(NULL);
+        } else {
+            esp_timer_start_once(retry_timer, (uint64_t)delay * 1000);
+        }
+    }
+
+    static void got_ip() {
+        int64_t now = esp_timer_get_time();
+        save_joined();
+        portENTER_CRITICAL(&stats_lock);
+        stats.connected = true;
+        stats.failures = 0;
+        stats.channel = joined.channel;
+        stats.last_directed = directed;
+        if (directed) stats.directed_hits++;
+        stats.last_connect_ms = (uint32_t)((now - attempt_us) / 1000);
+        if (!stats.boot_to_ip_ms) stats.boot_to_ip_ms = (uint32_t)(now / 1000);
+        if (down_us) stats.last_outage_ms = (uint32_t)((now - down_us) / 1000);
+        down_us = 0;
+        Stats st = stats;
+        portEXIT_CRITICAL(&stats_lock);
+        ESP_LOGI(TAG, "STA got IP after %" PRIu32 " failed attempts (%s, channel %d): connect %" PRIu32
+                 " ms, outage %" PRIu32 " ms, boot %" PRIu32 " ms", failures, directed ? "directed" : "scan",
+                 joined.channel, st.last_connect_ms, st.last_outage_ms, st.boot_to_ip_ms);
+        failures = 0;
+    }
+
+    // Обработчик в задаче событий по умолчанию: только быстрые действия, паузы
+    // между попытками отсчитывает retry_timer
     static void event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
-        ConfigSTA* config = static_cast<ConfigSTA*>(arg);
         if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-            ESP_LOGI(TAG, "STA started, connecting to SSID '%s'", config->ssid);
-            esp_wifi_connect();
+            ESP_LOGI(TAG, "STA started, connecting to SSID '%s'", config.ssid);
+            start_attempt();
         } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
             wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*)event_data;
-            ESP_LOGW(TAG, "Disconnected from SSID '%s', reason: %d, waiting %" PRIu32 " ms before reconnecting...", 
-                     config->ssid, event->reason, config->reconnect_delay_ms);
-            vTaskDelay(config->reconnect_delay_ms / portTICK_PERIOD_MS);
-            esp_wifi_connect();
+            schedule_retry(event->reason);
         } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
             wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*)event_data;
-            ESP_LOGI(TAG, "STA connected to SSID '%s', channel: %d", config->ssid, event->channel);
+            ESP_LOGI(TAG, "STA connected to SSID '%s', channel: %d", config.ssid, event->channel);
+            joined = {};
+            memcpy(joined.bssid, event->bssid, sizeof(joined.bssid));
+            joined.channel = event->channel;
+            joined.authmode = (uint8_t)event->authmode;
         } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-            ESP_LOGI(TAG, "STA got IP");
+            got_ip();
         }
     }
 
     void init() {
-        static ConfigSTA config;
+        const esp_timer_create_args_t timer_args = {
+            .callback = retry,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "sta_retry",
+            .skip_unhandled_events = false,
+        };
+        if (esp_timer_create(&timer_args, &retry_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create reconnect timer");
+            return;
+        }
 
         esp_netif_t *sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
         if (!sta_netif) {
@@ -83,33 +303,30 @@ namespace wifi_sta {
         ipaddr_aton(config.dns2, &dns2_ip);
         dns_setserver(1, &dns2_ip);
 
-        wifi_config_t wifi_config = {};
-        strcpy((char*)wifi_config.sta.ssid, config.ssid);
-        strcpy((char*)wifi_config.sta.password, config.password);
-        wifi_config.sta.channel = 0; // Автоматический выбор канала
-        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
-        wifi_config.sta.pmf_cfg.capable = true;
-        wifi_config.sta.pmf_cfg.required = false;
-
-        ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to set Wi-Fi config: %d", ret);
-            return;
-        }
+        // При загрузке - сразу на известную точку доступа; не найдётся - перебор
+        load_cached();
+        if (!apply_config(have_cached)) return;
 
-        ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, &config);
+        ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to register WIFI event handler: %d", ret);
             return;
         }
 
-        ret = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, &config);
+        ret = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to register IP event handler: %d", ret);
             return;
         }
 
-        ESP_LOGI(TAG, "STA configured: SSID '%s'", config.ssid);
-        esp_wifi_connect();
+        ESP_LOGI(TAG, "STA configured: SSID '%s'%s", config.ssid, have_cached ? ", directed connect" : "");
+        start_attempt();
+    }
+
+    Stats getStats() {
+        portENTER_CRITICAL(&stats_lock);
+        Stats result = stats;
+        portEXIT_CRITICAL(&stats_lock);
+        return result;
     }
-}
\ No newline at end of file
+}
@@ -1,8 +1,27 @@
 #ifndef WIFI_STA_H
 #define WIFI_STA_H
 
+#include <cstdint>
+
 namespace wifi_sta {
+    struct Stats {
+        bool connected;          // IP получен
+        uint8_t last_reason;     // WIFI_REASON_* последнего отключения
+        uint32_t disconnects;    // События отключения, включая неудачные попытки
+        uint32_t attempts;       // Повторные подключения по таймеру
+        uint32_t failures;       // Неудачных попыток подряд
+        uint32_t next_retry_ms;  // Пауза до следующей попытки, 0 - не ожидается
+        uint8_t channel;         // Канал текущей/последней точки доступа
+        bool last_directed;      // Последний IP получен подключением на известный канал
+        uint32_t directed_hits;  // Направленные подключения: удачные
+        uint32_t directed_misses;//   и закончившиеся полным перебором каналов
+        uint32_t last_connect_ms;// Последняя попытка: esp_wifi_connect() - IP
+        uint32_t last_outage_ms; // Последнее отключение - IP
+        uint32_t boot_to_ip_ms;  // Загрузка - первый IP
+    };
+
     void init();
+    Stats getStats();
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+// Run the firmware ADC filter chain (src/adc_filter.cpp) over a recorded trace on the host.
+//
+// Build:
+//     g++ -O2 -std=c++17 -Isrc tools/adc_filter_trace.cpp src/adc_filter.cpp -o adc_filter_trace
+//
+// Record a trace (one raw 12-bit code per line, '#' lines are ignored):
+//     curl -s 'http://192.168.6.1/api/adc/raw?channel=4' > trace.txt
+//
+// Usage:
+//     adc_filter_trace [--bench] [--quiet] <trace|-> [spec]
+//     adc_filter_trace --bench trace.txt med:3,dec:8,ma:16
+//
+// Prints every filter output (raw code with fractional bits), then a summary of
+// input vs output noise. --bench replays the trace until ~20M samples have been
+// pushed and reports the cost per input sample.
+#include "adc_filter.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const char* DEFAULT_SPEC = "med:3,dec:8,ma:16";
+
+struct Summary {
+    double mean;
+    double stddev;
+    double min;
+    double max;
+};
+
+static Summary summarize(const std::vector<double>& values) {
+    Summary s = { 0, 0, 0, 0 };
+    if (values.empty()) return s;
+    s.min = s.max = values[0];
+    for (double v : values) {
+        s.mean += v;
+        if (v < s.min) s.min = v;
+        if (v > s.max) s.max = v;
+    }
+    s.mean /= values.size();
+    for (double v : values) s.stddev += (v - s.mean) * (v - s.mean);
+    s.stddev = std::sqrt(s.stddev / values.size());
+    return s;
+}
+
+static bool load_trace(const char* path, std::vector<int32_t>& trace) {
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char line[64];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        trace.push_back((int32_t)strtol(line, nullptr, 10));
+    }
+    if (f != stdin) fclose(f);
+    return true;
+}
+
+static void print_summary(const char* label, const std::vector<double>& values) {
+    Summary s = summarize(values);
+    fprintf(stderr, "%-7s %7zu samples  mean %9.3f  stddev %7.3f  p-p %8.3f\n",
+            label, values.size(), s.mean, s.stddev, s.max - s.min);
+}
+
+int main(int argc, char** argv) {
+    bool bench = false;
+    bool quiet = false;
+    const char* path = nullptr;
+    const char* spec = DEFAULT_SPEC;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) bench = true;
+        else if (strcmp(argv[i], "--quiet") == 0) quiet = true;
+        else if (!path) path = argv[i];
+        else spec = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [--bench] [--quiet] <trace|-> [spec]\n", argv[0]);
+        return 2;
+    }
+
+    adc_filter::StageConfig stages[adc_filter::MAX_STAGES];
+    size_t count = 0;
+    static adc_filter::Chain chain;
+    if (!adc_filter::parse(spec, stages, &count) || !adc_filter::configure(chain, stages, count)) {
+        fprintf(stderr, "invalid filter spec: %s\n", spec);
+        return 2;
+    }
+
+    std::vector<int32_t> trace;
+    if (!load_trace(path, trace)) return 1;
+    if (trace.empty()) {
+        fprintf(stderr, "empty trace\n");
+        return 1;
+    }
+
+    const double scale = 1.0 / (1 << adc_filter::FRAC_BITS);
+    std::vector<double> input(trace.begin(), trace.end());
+    std::vector<double> output;
+    for (int32_t raw : trace) {
+        int32_t y;
+        if (adc_filter::push(chain, raw, &y)) {
+            output.push_back(y * scale);
+            if (!quiet && !bench) printf("%.4f\n", y * scale);
+        }
+    }
+
+    char formatted[64];
+    adc_filter::format(stages, count, formatted, sizeof(formatted));
+    fprintf(stderr, "chain   %s\n", count ? formatted : "none");
+    print_summary("input", input);
+    print_summary("output", output);
+
+    if (bench) {
+        const size_t target = 20000000;
+        size_t rounds = (target + trace.size() - 1) / trace.size();
+        int64_t sink = 0;
+        adc_filter::reset(chain);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            for (int32_t raw : trace) {
+                int32_t y;
+                if (adc_filter::push(chain, raw, &y)) sink += y;
+            }
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        size_t pushed = rounds * trace.size();
+        fprintf(stderr, "bench   %zu samples  %.2f ns/sample  (checksum %lld)\n",
+                pushed, elapsed / pushed, (long long)sink);
+    }
+    return 0;
+}
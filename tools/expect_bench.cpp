@@ -0,0 +1,266 @@
+// Run the firmware expect engine (src/expect.cpp) over a captured telnet transcript
+// on the host: list the matches, cross-check them against a naive search and
+// measure throughput against the old append-and-find approach.
+//
+// Build:
+//     g++ -O2 -std=c++17 -Isrc tools/expect_bench.cpp src/expect.cpp -o expect_bench
+//
+// Capture a transcript (raw bytes as received, IAC sequences included or not):
+//     script -q -c 'telnet 192.168.100.1' transcript.txt
+//
+// Usage:
+//     expect_bench [--chunk N] [--random SEED] [--check] [--bench] [--quiet] <transcript|-> [pattern...]
+//     expect_bench --generate 16 big.txt     (synthetic 16 MB busybox-like transcript)
+//     expect_bench --check --bench big.txt 'end:#' any:--More-- 'any:not found'
+//
+// Patterns are "end:<text>" (prompt: only spaces may follow, and then the stream
+// goes idle) or "any:<text>"; default is the f660 set. The transcript is fed in
+// chunks of --chunk bytes (default 256, the f660 recv buffer) or random sizes 1..N
+// with --random, like TCP segments. The transcript records no pauses, so the only
+// idle point is its end. --check also feeds it in 1-byte chunks: the matches must
+// not depend on the chunking.
+#include "expect.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// The set telnet_client watches
+static const char* DEFAULT_PATTERNS[] = { "end:#", "any:--More--", "any:Login incorrect", "any:Permission denied",
+                                          "any:: not found\r", "any:: not found\n" };
+
+struct Match {
+    size_t end;        // Offset after the last byte of the match (End: the idle point)
+    int pattern;
+};
+
+static bool load(const char* path, std::string& data) {
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.append(buf, n);
+    if (f != stdin) fclose(f);
+    return true;
+}
+
+// Shell session of a busybox router: command echo, long listings with '#'
+// comments and "not found" lines, a pager page now and then, prompts
+static bool generate(const char* path, size_t megabytes) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    std::mt19937 rng(1);
+    size_t written = 0;
+    char line[160];
+    while (written < megabytes << 20) {
+        written += fprintf(f, "/ # cat /proc/net/dev\r\n");
+        int lines = 20 + rng() % 400;
+        for (int i = 0; i < lines; i++) {
+            int n;
+            switch (rng() % 16) {
+            case 0: n = snprintf(line, sizeof(line), "# comment line %u with a hash inside\r\n", (unsigned)rng()); break;
+            case 1: n = snprintf(line, sizeof(line), "sh: foo%u: not found\r\n", (unsigned)(rng() % 100)); break;
+            case 2: n = snprintf(line, sizeof(line), "--More--\r\n"); break;
+            default:
+                n = snprintf(line, sizeof(line), "  eth%u: %10u %8u    0    0    0     0          0         0 %10u\r\n",
+                             (unsigned)(rng() % 4), (unsigned)rng(), (unsigned)(rng() % 100000), (unsigned)rng());
+            }
+            written += fwrite(line, 1, n, f);
+        }
+    }
+    written += fprintf(f, "/ # ");
+    fclose(f);
+    fprintf(stderr, "generated %zu bytes\n", written);
+    return true;
+}
+
+static std::vector<size_t> make_chunks(size_t total, size_t chunk, uint32_t seed) {
+    std::vector<size_t> sizes;
+    std::mt19937 rng(seed);
+    for (size_t done = 0; done < total;) {
+        size_t n = seed ? 1 + rng() % chunk : chunk;
+        if (n > total - done) n = total - done;
+        sizes.push_back(n);
+        done += n;
+    }
+    return sizes;
+}
+
+static void run_engine(const expect::Automaton& automaton, const std::string& data,
+                       const std::vector<size_t>& chunks, std::vector<Match>* matches) {
+    expect::Matcher matcher;
+    expect::reset(matcher, automaton);
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+    size_t offset = 0;
+    for (size_t chunk : chunks) {
+        size_t end = offset + chunk;
+        while (offset < end) {
+            size_t used;
+            int m = expect::feed(matcher, p + offset, end - offset, &used);
+            offset += used;
+            if (m != expect::NO_MATCH && matches) matches->push_back({ offset, m });
+        }
+    }
+    // Input exhausted - nothing further pending
+    int m = expect::idle(matcher);
+    if (m != expect::NO_MATCH && matches) matches->push_back({ offset, m });
+}
+
+static bool ends_with(const std::string& data, size_t end, const std::string& pattern) {
+    return end >= pattern.size() && data.compare(end - pattern.size(), pattern.size(), pattern) == 0;
+}
+
+// Same contract as expect::feed and expect::idle, by brute force over the whole transcript
+static std::vector<Match> reference(const std::vector<std::string>& texts, const std::vector<bool>& anchored,
+                                    const std::string& data) {
+    std::vector<Match> matches;
+    size_t offset = 0;
+    for (size_t q = 1; q <= data.size(); q++) {
+        for (size_t p = 0; p < texts.size(); p++) {
+            if (!anchored[p] && ends_with(data, q, texts[p])) {
+                matches.push_back({ q, (int)p });
+                offset = q;
+                break;
+            }
+        }
+    }
+    // End at the idle point: earliest position after the last Anywhere match followed only by spaces
+    size_t end = data.size();
+    size_t q = end;
+    while (q > offset && (data[q - 1] == ' ' || data[q - 1] == '\t')) q--;
+    for (size_t start = q > offset ? q : offset + 1; start <= end; start++) {
+        for (size_t p = 0; p < texts.size(); p++) {
+            if (anchored[p] && ends_with(data, start, texts[p])) {
+                matches.push_back({ end, (int)p });
+                return matches;
+            }
+        }
+    }
+    return matches;
+}
+
+static bool same_matches(const char* what, const std::vector<Match>& got, const std::vector<Match>& expected) {
+    size_t i = 0;
+    while (i < got.size() && i < expected.size() &&
+           got[i].end == expected[i].end && got[i].pattern == expected[i].pattern) i++;
+    if (i == got.size() && i == expected.size()) return true;
+    fprintf(stderr, "check   FAIL (%s) at match %zu of %zu/%zu: engine %zd/%d, reference %zd/%d\n", what, i,
+            got.size(), expected.size(),
+            i < got.size() ? (ssize_t)got[i].end : -1, i < got.size() ? got[i].pattern : -1,
+            i < expected.size() ? (ssize_t)expected[i].end : -1, i < expected.size() ? expected[i].pattern : -1);
+    return false;
+}
+
+int main(int argc, char** argv) {
+    size_t chunk = 256;
+    uint32_t seed = 0;
+    bool check = false, bench = false, quiet = false;
+    size_t generate_mb = 0;
+    const char* path = nullptr;
+    std::vector<const char*> specs;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) chunk = (size_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--random") == 0 && i + 1 < argc) seed = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) generate_mb = (size_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--check") == 0) check = true;
+        else if (strcmp(argv[i], "--bench") == 0) bench = true;
+        else if (strcmp(argv[i], "--quiet") == 0) quiet = true;
+        else if (!path) path = argv[i];
+        else specs.push_back(argv[i]);
+    }
+    if (!path || chunk == 0) {
+        fprintf(stderr, "usage: %s [--chunk N] [--random SEED] [--check] [--bench] [--quiet] <transcript|-> [end:|any:pattern...]\n"
+                        "       %s --generate MB <file>\n", argv[0], argv[0]);
+        return 2;
+    }
+    if (generate_mb) return generate(path, generate_mb) ? 0 : 1;
+    if (specs.empty()) specs.assign(std::begin(DEFAULT_PATTERNS), std::end(DEFAULT_PATTERNS));
+
+    std::vector<std::string> texts;
+    std::vector<bool> anchored;
+    std::vector<expect::Pattern> patterns;
+    for (const char* spec : specs) {
+        bool end = strncmp(spec, "end:", 4) == 0;
+        if (!end && strncmp(spec, "any:", 4) != 0) {
+            fprintf(stderr, "pattern must start with end: or any: - %s\n", spec);
+            return 2;
+        }
+        texts.push_back(spec + 4);
+        anchored.push_back(end);
+    }
+    for (size_t p = 0; p < texts.size(); p++) {
+        patterns.push_back({ texts[p].c_str(), anchored[p] ? expect::Anchor::End : expect::Anchor::Anywhere });
+    }
+    static expect::Automaton automaton;
+    if (!expect::build(automaton, patterns.data(), patterns.size())) {
+        fprintf(stderr, "cannot build automaton (max %zu patterns, %zu states)\n", expect::MAX_PATTERNS, expect::MAX_STATES);
+        return 2;
+    }
+
+    std::string data;
+    if (!load(path, data)) return 1;
+    std::vector<size_t> chunks = make_chunks(data.size(), chunk, seed);
+
+    std::vector<Match> matches;
+    run_engine(automaton, data, chunks, &matches);
+    std::vector<size_t> per_pattern(texts.size());
+    for (const Match& m : matches) {
+        per_pattern[m.pattern]++;
+        if (!quiet && !bench) printf("%zu %s:%s\n", m.end, anchored[m.pattern] ? "end" : "any", texts[m.pattern].c_str());
+    }
+    fprintf(stderr, "%zu bytes in %zu chunks, %zu states, %zu matches:", data.size(), chunks.size(),
+            automaton.states, matches.size());
+    for (size_t p = 0; p < texts.size(); p++) fprintf(stderr, " \"%s\" %zu", texts[p].c_str(), per_pattern[p]);
+    fprintf(stderr, "\n");
+
+    int status = 0;
+    if (check) {
+        std::vector<Match> expected = reference(texts, anchored, data);
+        std::vector<Match> bytewise;
+        run_engine(automaton, data, make_chunks(data.size(), 1, 0), &bytewise);
+        if (same_matches("chunks", matches, expected) && same_matches("1-byte chunks", bytewise, expected)) {
+            fprintf(stderr, "check   PASS (%zu matches agree with brute force, also in 1-byte chunks)\n", matches.size());
+        } else {
+            status = 1;
+        }
+    }
+
+    if (bench) {
+        const size_t target = 256u << 20;
+        size_t rounds = (target + data.size() - 1) / data.size();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) run_engine(automaton, data, chunks, nullptr);
+        double engine_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fprintf(stderr, "bench   engine      %8.1f MB/s  (%zu MB, state %zu bytes)\n",
+                rounds * data.size() / engine_s / 1e6, rounds * data.size() >> 20,
+                sizeof(expect::Automaton) + sizeof(expect::Matcher));
+
+        // Old waitForPrompt: append every chunk to one string and search all of it
+        // again after each recv, for a prompt that has not arrived yet (one long
+        // command output). Stops at 10 s, the cost grows quadratically
+        std::string received;
+        size_t fed = 0, found = 0;
+        start = std::chrono::steady_clock::now();
+        double naive_s = 0;
+        for (size_t n : chunks) {
+            received.append(data, fed, n);
+            fed += n;
+            if (received.find("\x1b[prompt]") != std::string::npos) found++;
+            naive_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (naive_s > 10) break;
+        }
+        fprintf(stderr, "bench   find/append %8.1f MB/s  (%zu of %zu bytes in %.1f s, %zu bytes held)\n",
+                fed / naive_s / 1e6, fed, data.size(), naive_s, received.capacity());
+    }
+    return status;
+}
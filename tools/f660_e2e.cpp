@@ -0,0 +1,383 @@
+// End-to-end test of the router telnet client (src/telnet_client.cpp, used by
+// f660 and f660_fleet) and of f660's own cycle and monitor loops (src/f660.cpp,
+// net_probe stubbed here) on the host, against tools/f660_emulator.py or a real
+// router: connection setup time, sequence duration and recovery from faults.
+//
+// The sources are built against the IDF stand-in in tools/idf with the
+// real-time backend in tools/host (host threads, BSD sockets).
+//
+// Build (all host tools and their checks: tools/CMakeLists.txt):
+//     g++ -O2 -std=gnu++17 -pthread -Itools/idf/include -Itools/idf -Isrc -o f660_e2e tools/f660_e2e.cpp tools/idf/idf.cpp tools/host/host.cpp src/f660.cpp src/telnet_client.cpp src/expect.cpp
+//
+// Usage:
+//     f660_e2e [options] login [N]        open and close N sessions (default 20)
+//     f660_e2e [options] sequence [N]     N command sequences on one kept session
+//     f660_e2e [options] recover [N]      f660 cycle mode: N successful sequences
+//                                         through drops and hangs
+//     f660_e2e [options] reboot           reboot, wait until it is down and back
+//     f660_e2e [options] monitor          f660 monitor mode: upstream outage, one
+//                                         recovery reboot, healthy again
+//
+// Options:
+//     --host IP         default 127.0.0.1
+//     --port N          default 2323
+//     --timeout MS      prompt and connect timeout (default 3000)
+//     --commands LIST   "cmd1;cmd2", each waiting for '#' (default "true;echo ok")
+//     --delay MS        wait after a failed attempt (default 100)
+//     --max-failures N  recover: give up after N failed attempts (default 50)
+//     --wan-delay MS    monitor: upstream back this long after the router (default 2000)
+//     --holdoff MS      monitor: recovery_holdoff_ms (default 15000)
+//     --spawn ARGS      start the emulator on --host/--port with these extra
+//                       arguments and stop it at the end, e.g. --spawn "--split 3"
+//     --emulator PATH   default tools/f660_emulator.py
+//     --check           exit 1 unless every login/sequence succeeded (recover:
+//                       N sequences within --max-failures)
+//     --verbose         client INFO logs on stderr (twice: DEBUG)
+//
+// Regression run (from the repository root):
+//     f660_e2e --check --spawn "--negotiation full --split 3" login 50
+//     f660_e2e --check --spawn "--pager --latency 20" --commands "cat /proc/net/dev;true" sequence 20
+//     f660_e2e --check --timeout 1000 --spawn "--drop-prob 0.1 --hang-prob 0.02 --seed 1" recover 100
+//     f660_e2e --check --spawn "--reboot-time 3" reboot
+//     f660_e2e --check --spawn "--reboot-time 3" monitor
+#include "idf.h"
+#include "f660.h"
+#include "net_probe.h"
+#include "telnet_client.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 2323;
+    int timeout_ms = 3000;
+    std::string commands = "true;echo ok";
+    int delay_ms = 100;
+    int max_failures = 50;
+    int wan_delay_ms = 2000;
+    int holdoff_ms = 15000;
+    std::string spawn;
+    bool spawned = false;
+    std::string emulator = "tools/f660_emulator.py";
+    bool check = false;
+    int verbose = 0;
+};
+
+static int64_t now_ms() {
+    return esp_timer_get_time() / 1000;
+}
+
+static void report(const char* name, std::vector<uint32_t> values) {
+    if (values.empty()) {
+        printf("%-10s -\n", name);
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    uint64_t sum = 0;
+    for (uint32_t v : values) sum += v;
+    printf("%-10s n %-5zu min %-6u p50 %-6u p95 %-6u max %-6u mean %.1f ms\n", name, values.size(), values.front(),
+           values[values.size() / 2], values[std::min(values.size() - 1, values.size() * 95 / 100)], values.back(),
+           (double)sum / values.size());
+}
+
+static void report_stats(const telnet_client::Session& session) {
+    telnet_client::Stats st = telnet_client::getStats(session);
+    printf("client     %u connects (%u failed), %u reuses, %u probes (%u failed), %u sequences (%u failed)\n",
+           st.connects, st.connect_failures, st.reuses, st.probes, st.probe_failures, st.sequences, st.sequence_failures);
+}
+
+static telnet_client::Commands parse_commands(const std::string& list) {
+    telnet_client::Commands commands;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(';', start);
+        if (end == std::string::npos) end = list.size();
+        std::string cmd = list.substr(start, end - start);
+        if (!cmd.empty()) commands.push_back({cmd + "\r\n", "#"});
+        start = end + 1;
+    }
+    return commands;
+}
+
+// ---- net_probe for src/f660.cpp ----
+// The emulator is the STA gateway; upstream (TCP and DNS probes) is down until
+// the router has rebooted and then stayed up for --wan-delay ms
+struct Wan {
+    std::atomic<int> router_downs{0};
+    std::atomic<int64_t> back_ms{0};
+    bool router_up = true;
+};
+static Wan wan;
+static const Options* probe_target = NULL;
+
+namespace net_probe {
+    bool gateway(uint16_t port, int timeout_ms, uint32_t* ms) {
+        int64_t start = now_ms();
+        bool up = probe_target && telnet_client::reachable(probe_target->host, port, timeout_ms);
+        *ms = (uint32_t)(now_ms() - start);
+        if (wan.router_up && !up) wan.router_downs++;
+        if (!wan.router_up && up) wan.back_ms = now_ms();
+        wan.router_up = up;
+        return up;
+    }
+
+    static bool upstream(uint32_t* ms) {
+        *ms = 0;
+        return probe_target && wan.router_downs > 0 && wan.back_ms > 0 &&
+               now_ms() - wan.back_ms >= probe_target->wan_delay_ms;
+    }
+
+    bool tcp(const char*, uint16_t, int, uint32_t* ms) {
+        return upstream(ms);
+    }
+
+    bool dns(const char*, int, uint32_t* ms) {
+        return upstream(ms);
+    }
+}
+
+// Emulator as a child process; it prints "listening ..." on stdout once the
+// port is open (a connect probe would count against --refuse)
+static pid_t spawn_emulator(const Options& o) {
+    int ready[2];
+    if (pipe(ready) < 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(ready[1], STDOUT_FILENO);
+        close(ready[0]);
+        std::string cmd = "exec python3 " + o.emulator + " --host " + o.host + " --port " + std::to_string(o.port) +
+                          (o.verbose ? " " : " --quiet ") + o.spawn;
+        execl("/bin/sh", "sh", "-c", cmd.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    close(ready[1]);
+    char line[128];
+    FILE* out = fdopen(ready[0], "r");
+    bool ok = pid > 0 && out && fgets(line, sizeof(line), out) && strncmp(line, "listening", 9) == 0;
+    if (!ok) {
+        fprintf(stderr, "emulator did not start\n");
+        if (pid > 0) kill(pid, SIGTERM);
+        return -1;
+    }
+    return pid;
+}
+
+static telnet_client::Session make_session(const Options& o) {
+    telnet_client::Session session;
+    session.ip = o.host;
+    session.port = o.port;
+    session.options.timeout_ms = o.timeout_ms;
+    session.options.probe_timeout_ms = o.timeout_ms;
+    return session;
+}
+
+static f660::Config base_config(const Options& o) {
+    f660::Config config;
+    config.server_ip = o.host;
+    config.port = o.port;
+    config.session.timeout_ms = o.timeout_ms;
+    config.session.probe_timeout_ms = o.timeout_ms;
+    config.pause_after_attempts_ms = 1000;
+    return config;
+}
+
+// stop() only asks: the task runs the stop sequence first
+static void stop_f660() {
+    f660::stop();
+    int64_t deadline = now_ms() + 30000;
+    while (f660::isRunning() && now_ms() < deadline) vTaskDelay(10);
+}
+
+static bool run_login(const Options& o, int count) {
+    telnet_client::Session session = make_session(o);
+    std::vector<uint32_t> login;
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        if (telnet_client::open(session)) {
+            login.push_back(telnet_client::getStats(session).last_login_ms);
+        } else {
+            failures++;
+            if (o.verbose) fprintf(stderr, "login %d failed: %s\n", i, session.error);
+        }
+        telnet_client::close(session);
+    }
+    report("login", login);
+    report_stats(session);
+    return failures == 0;
+}
+
+static bool run_sequence(const Options& o, int count) {
+    telnet_client::Session session = make_session(o);
+    telnet_client::Commands commands = parse_commands(o.commands);
+    std::vector<uint32_t> sequence;
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        if (telnet_client::ensure(session) && telnet_client::run(session, commands)) {
+            sequence.push_back(telnet_client::getStats(session).last_sequence_ms);
+        } else {
+            failures++;
+            if (o.verbose) fprintf(stderr, "sequence %d failed: %s\n", i, session.error);
+        }
+    }
+    telnet_client::close(session);
+    report("sequence", sequence);
+    report_stats(session);
+    return failures == 0;
+}
+
+// f660 cycle mode (src/f660.cpp) with --commands as the cycle: its own
+// reconnect, retry and pause loop, until N sequences succeeded
+static bool run_recover(const Options& o, int count) {
+    f660::Config config = base_config(o);
+    config.cycle_commands = parse_commands(o.commands);
+    config.reconnect_delay_ms = o.delay_ms;
+    config.max_attempts_before_pause = o.max_failures + 1;   // Give up before the pause
+    if (!f660::setConfig(config)) return false;
+
+    int64_t start = now_ms();
+    f660::start(f660::Mode::Cycle);
+    f660::Stats st = {};
+    uint32_t successes = 0, failures = 0;
+    while (successes < (uint32_t)count && failures < (uint32_t)o.max_failures) {
+        vTaskDelay(10);
+        st = f660::getStats();
+        successes = st.sequences - st.sequence_failures;
+        failures = st.sequence_failures + st.connect_failures;
+    }
+    int64_t elapsed = now_ms() - start;
+    stop_f660();
+    printf("recover    %u sequences, %u failed attempts, %.1f s\n", successes, failures, elapsed / 1e3);
+    printf("client     %u connects (%u failed), %u reuses, %u probes (%u failed), last login %u ms, last sequence %u ms\n",
+           st.connects, st.connect_failures, st.reuses, st.probes, st.probe_failures, st.last_login_ms,
+           st.last_sequence_ms);
+    return successes >= (uint32_t)count;
+}
+
+// f660 monitor mode against the emulator as the STA gateway. Upstream is down
+// from the start and comes back --wan-delay ms after the router is up again,
+// so the gateway answers while upstream still fails: the monitor has to
+// detect the outage, reboot the router once, count nothing during the holdoff
+// and see upstream healthy again
+static bool run_monitor(const Options& o) {
+    f660::Config config = base_config(o);
+    config.health_interval_ms = 500;
+    config.health_retry_ms = 200;
+    config.health_timeout_ms = 300;
+    config.failures_before_recovery = 3;
+    config.recovery_holdoff_ms = o.holdoff_ms;
+    config.gateway_port = o.port;
+    if (!f660::setConfig(config)) return false;
+
+    probe_target = &o;
+    int64_t start = now_ms();
+    f660::start(f660::Mode::Monitor);
+    int64_t deadline = start + o.holdoff_ms + 30000;
+    int64_t healthy_since = 0;
+    f660::Health h = {};
+    while (now_ms() < deadline) {
+        vTaskDelay(50);
+        h = f660::getHealth();
+        bool healthy = h.healthy && h.recoveries > 0;
+        if (!healthy) {
+            healthy_since = 0;
+        } else if (!healthy_since) {
+            healthy_since = now_ms();
+        } else if (now_ms() - healthy_since >= 1000) {
+            break;
+        }
+    }
+    stop_f660();
+    probe_target = NULL;
+
+    printf("monitor    %u checks (%u failed, %u link down), detected in %u ms, outage %u ms\n", h.checks,
+           h.failed_checks, h.link_down_checks, h.last_detect_ms, h.last_outage_ms);
+    printf("recovery   %u run (%u failed), router went down %d times\n", h.recoveries, h.recovery_failures,
+           wan.router_downs.load());
+    bool ok = h.healthy && h.recoveries == 1 && h.recovery_failures == 0 && wan.router_downs == 1;
+    if (!ok) fprintf(stderr, "expected one recovery, one router reboot and upstream healthy at the end\n");
+    return ok;
+}
+
+static bool run_reboot(const Options& o) {
+    telnet_client::Session session = make_session(o);
+    if (!telnet_client::open(session)) {
+        fprintf(stderr, "login failed: %s\n", session.error);
+        return false;
+    }
+    if (!telnet_client::run(session, {{"reboot\r\n", ""}})) {
+        fprintf(stderr, "reboot failed: %s\n", session.error);
+        return false;
+    }
+    int64_t sent = now_ms();
+    while (now_ms() - sent < 30000 && telnet_client::reachable(o.host, o.port, 500)) vTaskDelay(100);
+    int64_t down = now_ms();
+    bool back = false;
+    while (!back && now_ms() - sent < 180000) {
+        back = telnet_client::open(session);
+        if (!back) vTaskDelay(200);
+    }
+    telnet_client::close(session);
+    printf("reboot     down after %u ms, %s after %u ms\n", (unsigned)(down - sent), back ? "back" : "not back",
+           (unsigned)(now_ms() - sent));
+    return back;
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool value = i + 1 < argc;
+        if (a == "--host" && value) o.host = argv[++i];
+        else if (a == "--port" && value) o.port = atoi(argv[++i]);
+        else if (a == "--timeout" && value) o.timeout_ms = atoi(argv[++i]);
+        else if (a == "--commands" && value) o.commands = argv[++i];
+        else if (a == "--delay" && value) o.delay_ms = atoi(argv[++i]);
+        else if (a == "--max-failures" && value) o.max_failures = atoi(argv[++i]);
+        else if (a == "--wan-delay" && value) o.wan_delay_ms = atoi(argv[++i]);
+        else if (a == "--holdoff" && value) o.holdoff_ms = atoi(argv[++i]);
+        else if (a == "--spawn" && value) { o.spawn = argv[++i]; o.spawned = true; }
+        else if (a == "--emulator" && value) o.emulator = argv[++i];
+        else if (a == "--check") o.check = true;
+        else if (a == "--verbose") o.verbose++;
+        else args.push_back(argv[i]);
+    }
+    if (args.empty()) {
+        fprintf(stderr, "usage: %s [options] login|sequence|recover [N] | reboot | monitor\n", argv[0]);
+        return 2;
+    }
+    idf::setLogLevel(o.verbose >= 2 ? ESP_LOG_DEBUG : o.verbose ? ESP_LOG_INFO : ESP_LOG_NONE);
+    signal(SIGPIPE, SIG_IGN);   // send() on a socket the emulator dropped
+
+    pid_t emulator = -1;
+    if (o.spawned && (emulator = spawn_emulator(o)) < 0) return 1;
+
+    std::string scenario = args[0];
+    int count = args.size() > 1 ? atoi(args[1]) : 20;
+    bool ok;
+    if (scenario == "login") ok = run_login(o, count);
+    else if (scenario == "sequence") ok = run_sequence(o, count);
+    else if (scenario == "recover") ok = run_recover(o, count);
+    else if (scenario == "reboot") ok = run_reboot(o);
+    else if (scenario == "monitor") ok = run_monitor(o);
+    else {
+        fprintf(stderr, "unknown scenario %s\n", scenario.c_str());
+        ok = false;
+        o.check = true;
+    }
+
+    if (emulator > 0) {
+        kill(emulator, SIGTERM);
+        waitpid(emulator, NULL, 0);
+    }
+    if (o.check) printf("check      %s\n", ok ? "PASS" : "FAIL");
+    return o.check && !ok ? 1 : 0;
+}
@@ -0,0 +1,387 @@
+#!/usr/bin/env python3
+"""Stand-in for the telnet CLI of a ZTE F660 router (BusyBox telnetd + ash).
+
+Speaks enough of the router's telnet dialogue for the f660 client: option
+negotiation, "Login:" / "Password:", the "/ # " prompt with echo, a few
+commands and a reboot that takes the device off the network for a while.
+Faults are scriptable so that the client's negotiation, expect matching and
+recovery can be exercised without a router (see tools/f660_e2e.cpp).
+
+Negotiation (--negotiation):
+    none      no options, plain text
+    busybox   DO ECHO, DO NAWS, WILL ECHO, WILL SGA (what BusyBox telnetd sends)
+    full      busybox + DO TTYPE; the login prompt is held back until the client
+              answered every request, sent its window size (SB NAWS) and
+              terminal type (SB TTYPE IS) - like telnetd builds that wait for it
+
+Commands: true, sleep N, echo ..., reboot, exit [N], ip ..., cat FILE (long
+output, paged with --More-- when --pager), anything else "sh: X: not found".
+
+Examples:
+    f660_emulator.py --port 2323
+    f660_emulator.py --port 2323 --negotiation full --split 3 --latency 50
+    f660_emulator.py --port 2323 --drop-prob 0.1 --hang-prob 0.05 --seed 7
+    f660_emulator.py --port 2323 --count 8 --reboot-time 20   (ports 2323..2330)
+"""
+import argparse
+import asyncio
+import random
+import signal
+import sys
+import time
+
+IAC, DONT, DO, WONT, WILL, SB, SE = 255, 254, 253, 252, 251, 250, 240
+ECHO, SGA, TTYPE, NAWS = 1, 3, 24, 31
+TTYPE_IS, TTYPE_SEND = 0, 1
+
+PROMPT = b"/ # "
+BANNER = b"\r\n\r\nBusyBox v1.01 (2019.06.17-08:47+0000) Built-in shell (ash)\r\nEnter 'help' for a list of built-in commands.\r\n\r\n"
+
+
+class Counters:
+    def __init__(self):
+        self.connects = 0
+        self.refused = 0
+        self.logins = 0
+        self.bad_logins = 0
+        self.commands = 0
+        self.drops = 0
+        self.hangs = 0
+        self.idle_closes = 0
+        self.reboots = 0
+        self.negotiation_errors = 0
+
+    def line(self):
+        return " ".join(f"{k}={v}" for k, v in vars(self).items())
+
+
+class Device:
+    """One emulated router listening on one port."""
+
+    def __init__(self, args, port, rng, counters):
+        self.args = args
+        self.port = port
+        self.rng = rng
+        self.counters = counters
+        self.server = None
+        self.sessions = set()
+
+    def log(self, msg):
+        if not self.args.quiet:
+            print(f"{time.strftime('%H:%M:%S')} :{self.port} {msg}", file=sys.stderr, flush=True)
+
+    async def start(self):
+        self.server = await asyncio.start_server(self.accept, self.args.host, self.port)
+
+    async def reboot(self):
+        self.counters.reboots += 1
+        self.log(f"reboot: down for {self.args.reboot_time} s")
+        await asyncio.sleep(self.args.reboot_delay)
+        self.server.close()
+        for session in list(self.sessions):
+            session.abort()
+        await asyncio.sleep(self.args.reboot_time)
+        await self.start()
+        self.log("reboot: up")
+
+    async def accept(self, reader, writer):
+        self.counters.connects += 1
+        if self.counters.refused < self.args.refuse:
+            self.counters.refused += 1
+            self.log("connection dropped (--refuse)")
+            writer.close()
+            return
+        session = Session(self, reader, writer)
+        self.sessions.add(session)
+        try:
+            await session.run()
+        except (ConnectionError, asyncio.IncompleteReadError, asyncio.CancelledError):
+            pass
+        finally:
+            self.sessions.discard(session)
+            writer.close()
+
+
+class Session:
+    def __init__(self, device, reader, writer):
+        self.device = device
+        self.args = device.args
+        self.rng = device.rng
+        self.reader = reader
+        self.writer = writer
+        self.pending = bytearray()    # Received text, telnet commands removed
+        self.telnet = bytearray()     # Incomplete telnet command across reads
+        self.echo = False
+        self.answered = set()         # (verb, option) replies received
+        self.naws = None
+        self.ttype = None
+        self.commands = 0
+        self.skip_lf = False          # Line ended with CR: drop a following LF/NUL
+
+    def abort(self):
+        self.writer.transport.abort()
+
+    async def send(self, data):
+        """Write in segments of 1..--split bytes (may cut IAC sequences)."""
+        if self.args.split <= 0:
+            self.writer.write(data)
+            await self.writer.drain()
+            return
+        pos = 0
+        while pos < len(data):
+            n = self.rng.randint(1, self.args.split)
+            self.writer.write(data[pos:pos + n])
+            await self.writer.drain()
+            pos += n
+            await asyncio.sleep(self.args.split_delay / 1000)
+
+    async def respond(self, data):
+        if self.args.latency > 0:
+            await asyncio.sleep(self.args.latency / 1000)
+        await self.send(data)
+
+    def parse(self, data):
+        """Split telnet commands from text; commands may span reads."""
+        buf = self.telnet + data
+        self.telnet = bytearray()
+        i = 0
+        while i < len(buf):
+            b = buf[i]
+            if b != IAC:
+                self.pending.append(b)
+                i += 1
+                continue
+            if i + 1 >= len(buf):
+                break
+            verb = buf[i + 1]
+            if verb == IAC:
+                self.pending.append(IAC)
+                i += 2
+            elif verb in (DO, DONT, WILL, WONT):
+                if i + 2 >= len(buf):
+                    break
+                self.answered.add((verb, buf[i + 2]))
+                i += 3
+            elif verb == SB:
+                end = buf.find(bytes([IAC, SE]), i + 2)
+                if end < 0:
+                    break
+                self.subnegotiation(bytes(buf[i + 2:end]))
+                i = end + 2
+            else:
+                i += 2
+        self.telnet = buf[i:]
+
+    def subnegotiation(self, data):
+        if not data:
+            return
+        if data[0] == NAWS and len(data) >= 5:
+            self.naws = (data[1] << 8 | data[2], data[3] << 8 | data[4])
+            self.device.log(f"window {self.naws[0]}x{self.naws[1]}")
+        elif data[0] == TTYPE and len(data) >= 2 and data[1] == TTYPE_IS:
+            self.ttype = data[2:].decode("ascii", "replace")
+            self.device.log(f"terminal {self.ttype}")
+
+    async def read_some(self, timeout=None):
+        data = await asyncio.wait_for(self.reader.read(1024), timeout)
+        if not data:
+            raise ConnectionResetError
+        self.parse(data)
+
+    async def read_line(self):
+        """One line of input (CR, LF, CR LF or CR NUL), echoed when the client let us echo."""
+        idle = self.args.idle_timeout or None
+        while True:
+            if self.skip_lf and self.pending[:1] in (b"\n", b"\x00"):
+                del self.pending[:1]
+            if self.pending:
+                self.skip_lf = False
+            ends = [pos for pos in (self.pending.find(b"\r"), self.pending.find(b"\n")) if pos >= 0]
+            if ends:
+                pos = min(ends)
+                line = bytes(self.pending[:pos])
+                self.skip_lf = self.pending[pos] == ord("\r")
+                del self.pending[:pos + 1]
+                if self.echo:
+                    await self.send(line + b"\r\n")
+                return line.decode("latin-1")
+            try:
+                await self.read_some(idle)
+            except asyncio.TimeoutError:
+                self.device.counters.idle_closes += 1
+                self.device.log("idle timeout, closing")
+                raise ConnectionResetError
+
+    async def negotiate(self):
+        mode = self.args.negotiation
+        if mode == "none":
+            return
+        requests = [(DO, ECHO), (DO, NAWS), (WILL, ECHO), (WILL, SGA)]
+        if mode == "full":
+            requests.append((DO, TTYPE))
+        await self.send(b"".join(bytes([IAC, verb, option]) for verb, option in requests))
+        self.echo = True
+        if mode != "full":
+            return
+        # Hold the login prompt until the client has answered everything
+        replies = {DO: (WILL, WONT), WILL: (DO, DONT)}
+        deadline = time.monotonic() + self.args.negotiation_timeout
+        ttype_requested = False
+        while time.monotonic() < deadline:
+            done = all(any((r, option) in self.answered for r in replies[verb]) for verb, option in requests)
+            if (WILL, TTYPE) in self.answered and not ttype_requested:
+                await self.send(bytes([IAC, SB, TTYPE, TTYPE_SEND, IAC, SE]))
+                ttype_requested = True
+            if (WILL, NAWS) in self.answered and self.naws is None:
+                done = False
+            if ttype_requested and self.ttype is None:
+                done = False
+            if done:
+                return
+            try:
+                await self.read_some(max(0.01, deadline - time.monotonic()))
+            except asyncio.TimeoutError:
+                break
+        self.device.counters.negotiation_errors += 1
+        missing = [f"{v}/{o}" for v, o in requests
+                   if not any((r, o) in self.answered for r in replies[v])]
+        self.device.log(f"negotiation incomplete: unanswered {missing}, naws={self.naws}, ttype={self.ttype}")
+        raise ConnectionResetError
+
+    async def login(self):
+        while True:
+            await self.respond(b"Login: ")
+            user = await self.read_line()
+            await self.respond(b"Password: ")
+            # Password is never echoed
+            echo, self.echo = self.echo, False
+            password = await self.read_line()
+            self.echo = echo
+            if self.device.counters.bad_logins < self.args.bad_logins or \
+                    user != self.args.user or password != self.args.password:
+                self.device.counters.bad_logins += 1
+                await self.respond(b"\r\nLogin incorrect\r\n")
+                continue
+            self.device.counters.logins += 1
+            await self.respond(BANNER + PROMPT)
+            return
+
+    def long_output(self, name):
+        lines = []
+        for i in range(self.args.output_lines):
+            lines.append(f"  eth{i % 4}: {self.rng.randrange(1 << 31):10d} {self.rng.randrange(100000):8d}"
+                         f"    0    0    0     0          0         0 {self.rng.randrange(1 << 31):10d}")
+        return lines
+
+    async def page(self, lines):
+        """--More-- after every 23 lines; the client must answer with a key."""
+        for start in range(0, len(lines), 23):
+            chunk = "\r\n".join(lines[start:start + 23]) + "\r\n"
+            await self.send(chunk.encode())
+            if start + 23 < len(lines):
+                await self.send(b"--More--")
+                while not self.pending:
+                    await self.read_some(self.args.idle_timeout or None)
+                del self.pending[:1]
+                await self.send(b"\r        \r")
+
+    async def shell(self):
+        while True:
+            line = (await self.read_line()).strip()
+            counters = self.device.counters
+            counters.commands += 1
+            self.commands += 1
+            if self.args.drop_after and self.commands > self.args.drop_after or \
+                    self.rng.random() < self.args.drop_prob:
+                counters.drops += 1
+                self.device.log(f"dropping session at command {self.commands}: {line!r}")
+                self.abort()
+                raise ConnectionResetError
+            if self.rng.random() < self.args.hang_prob:
+                counters.hangs += 1
+                self.device.log(f"hanging on {line!r}")
+                await asyncio.sleep(3600)
+            words = line.split()
+            out = b""
+            if not words or words[0] in ("true", ":"):
+                pass
+            elif words[0] == "sleep":
+                await asyncio.sleep(float(words[1]) if len(words) > 1 else 0)
+            elif words[0] == "echo":
+                out = (" ".join(words[1:]) + "\r\n").encode()
+            elif words[0] == "exit":
+                return
+            elif words[0] == "reboot":
+                # Goes ahead even if the client does not wait for the prompt
+                asyncio.ensure_future(self.device.reboot())
+            elif words[0] == "ip":
+                pass
+            elif words[0] == "cat":
+                lines = self.long_output(words[1] if len(words) > 1 else "")
+                if self.args.latency > 0:
+                    await asyncio.sleep(self.args.latency / 1000)
+                if self.args.pager:
+                    await self.page(lines)
+                else:
+                    await self.send(("\r\n".join(lines) + "\r\n").encode())
+                await self.send(PROMPT)
+                continue
+            else:
+                out = f"sh: {words[0]}: not found\r\n".encode()
+            await self.respond(out + PROMPT)
+
+    async def run(self):
+        await self.negotiate()
+        await self.login()
+        await self.shell()
+
+
+async def main(args):
+    rng = random.Random(args.seed)
+    counters = Counters()
+    devices = [Device(args, args.port + i, rng, counters) for i in range(args.count)]
+    for device in devices:
+        await device.start()
+    # On stdout, for harnesses waiting for the port (logs and counters go to stderr)
+    print(f"listening on {args.host}:{args.port}" + (f"..{args.port + args.count - 1}" if args.count > 1 else ""),
+          flush=True)
+    stop = asyncio.Event()
+    loop = asyncio.get_running_loop()
+    for sig in (signal.SIGINT, signal.SIGTERM):
+        loop.add_signal_handler(sig, stop.set)
+    await stop.wait()
+    print(counters.line(), file=sys.stderr, flush=True)
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    p.add_argument("--host", default="127.0.0.1")
+    p.add_argument("--port", type=int, default=2323)
+    p.add_argument("--count", type=int, default=1, help="devices on consecutive ports")
+    p.add_argument("--user", default="root")
+    p.add_argument("--password", default="Zte521")
+    p.add_argument("--negotiation", choices=("none", "busybox", "full"), default="busybox")
+    p.add_argument("--negotiation-timeout", type=float, default=5, help="s, full mode")
+    p.add_argument("--latency", type=float, default=0, help="ms before each response")
+    p.add_argument("--split", type=int, default=0, help="write in random segments of 1..N bytes")
+    p.add_argument("--split-delay", type=float, default=1, help="ms between segments")
+    p.add_argument("--pager", action="store_true", help="page cat output with --More--")
+    p.add_argument("--output-lines", type=int, default=200, help="lines printed by cat")
+    p.add_argument("--idle-timeout", type=float, default=0, help="s, close idle sessions")
+    p.add_argument("--refuse", type=int, default=0, help="drop the first N connections at once")
+    p.add_argument("--bad-logins", type=int, default=0, help="reject the first N logins")
+    p.add_argument("--drop-after", type=int, default=0, help="drop each session after N commands")
+    p.add_argument("--drop-prob", type=float, default=0, help="drop the session on a command")
+    p.add_argument("--hang-prob", type=float, default=0, help="never answer a command")
+    p.add_argument("--reboot-delay", type=float, default=0.5, help="s from reboot to going down")
+    p.add_argument("--reboot-time", type=float, default=5, help="s down after reboot")
+    p.add_argument("--seed", type=int, default=None)
+    p.add_argument("--quiet", action="store_true")
+    return p.parse_args()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main(parse_args()))
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,26 @@
+// Real-time backend of the IDF stand-in (see tools/idf/idf.h): the monotonic
+// clock, tasks as detached host threads that run as soon as they are created.
+// Only what the network client modules call is implemented.
+#include "idf.h"
+
+#include <chrono>
+#include <thread>
+
+static const auto start_time = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+// vTaskDelete(NULL) is the task function returning
+BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle) {
+    std::thread(fn, arg).detach();
+    if (handle) *handle = NULL;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {}
@@ -0,0 +1,243 @@
+// Run the HTTP API handlers (src/http_api_server.cpp) on the host: routing,
+// token check, JSON / CBOR / binary encoding and /api/cmd batching, timed per
+// request without sockets.
+//
+// The unmodified handler source is built against the IDF stand-in in tools/idf
+// with the simulation backend in tools/sim, plus tools/http_host (in-process
+// esp_http_server, stub spectrum / alerts / telemetry / console), so voltage,
+// adc_sampler, power_meter, energy, l298n, motor_control, motion and protection
+// are the firmware sources fed by the simulated motor. cJSON is the ESP-IDF
+// json component when IDF_PATH is set, else the subset in tools/http_host/cjson.
+//
+// Build (all host tools and their checks: tools/CMakeLists.txt):
+//     g++ -O2 -std=gnu++17 -pthread -Itools/idf/include -Itools/http_host/cjson -Itools/idf -Itools/http_host -Itools/sim -Isrc -o http_bench tools/http_bench.cpp tools/idf/idf.cpp tools/http_host/*.cpp tools/http_host/cjson/cJSON.cpp tools/sim/*.cpp src/http_api_server.cpp src/l298n.cpp src/adc_cal.cpp src/adc_filter.cpp src/adc_sampler.cpp src/voltage.cpp src/acs712.cpp src/power_meter.cpp src/energy.cpp src/motor_control.cpp src/motion.cpp src/protection.cpp src/telemetry_codec.cpp src/cbor.cpp src/utils.cpp
+//
+// Usage:
+//     http_bench [options]
+//
+// Options:
+//     --iterations N  requests per route (default 2000)
+//     --route PATH    only routes starting with PATH
+//     --check         status / content checks per route, the token check, the
+//                     refusal of server lifecycle commands on /api/cmd and the
+//                     deferred reboot; exit 1 on failure
+//     --verbose       firmware INFO logs on stderr
+//
+// Times are host wall-clock per handler call; they rank the routes and catch
+// regressions in the encoders, the ESP32-C6 runs the same code ~10-20x slower.
+#include "http_host.h"
+#include "sim.h"
+#include "motor_model.h"
+
+#include "acs712.h"
+#include "adc_cal.h"
+#include "adc_sampler.h"
+#include "energy.h"
+#include "http_api_server.h"
+#include "l298n.h"
+#include "motion.h"
+#include "motor_control.h"
+#include "power_meter.h"
+#include "protection.h"
+#include "voltage.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const int64_t STEP_US = 10;
+static const int64_t WARMUP_US = 250000;  // Filter chains full, one power_meter window (200 ms) closed
+static const char* TOKEN = "bench-token-0001";
+
+struct Options {
+    int iterations;
+    const char* route;
+    bool check;
+    bool verbose;
+};
+
+struct Case {
+    httpd_method_t method;
+    const char* uri;
+    const char* body;
+    bool auth;
+    int status;
+    const char* type;          // Expected Content-Type prefix, NULL - any
+    const char* contains;      // Expected body fragment, NULL - any
+};
+
+static const Case CASES[] = {
+    { HTTP_GET,  "/api/voltage_r1_r2",            NULL, false, 200, NULL, "." },
+    { HTTP_GET,  "/api/voltage_r1_r2?format=json", NULL, false, 200, "application/json", "voltage_mv" },
+    { HTTP_GET,  "/api/voltage_r1_r2?format=cbor", NULL, false, 200, "application/cbor", NULL },
+    { HTTP_GET,  "/api/voltage_3v3",              NULL, false, 200, NULL, "." },
+    { HTTP_GET,  "/api/telemetry",                NULL, false, 200, "application/json", NULL },
+    { HTTP_GET,  "/api/telemetry?format=cbor",    NULL, false, 200, "application/cbor", NULL },
+    { HTTP_GET,  "/api/telemetry?format=bin",     NULL, false, 200, "application/octet-stream", NULL },
+    { HTTP_GET,  "/api/telemetry?n=16",           NULL, false, 200, "application/json", NULL },
+    { HTTP_GET,  "/metrics",                      NULL, false, 200, "text/plain", "http_request_duration_seconds" },
+    { HTTP_GET,  "/api/adc/raw",                  NULL, false, 200, NULL, NULL },
+    { HTTP_GET,  "/api/power",                    NULL, false, 200, "application/json", "v_rms_mv" },
+    { HTTP_GET,  "/api/energy",                   NULL, false, 200, "application/json", "energy_uwh" },
+    { HTTP_GET,  "/api/alerts",                   NULL, false, 200, "application/json", "overcurrent" },
+    { HTTP_GET,  "/api/spectrum",                 NULL, false, 200, "application/json", "dominant" },
+    { HTTP_GET,  "/api/motor",                    NULL, false, 200, "application/json", NULL },
+    { HTTP_GET,  "/api/motion",                   NULL, false, 200, "application/json", NULL },
+    { HTTP_GET,  "/api/motors",                   NULL, false, 200, "application/json", NULL },
+    { HTTP_POST, "/api/cmd", "{\"cmd\":\"status\"}",                      true,  200, "application/json", "ok: status" },
+    { HTTP_POST, "/api/cmd", "{\"cmds\":[\"status\",\"voltage\",\"ip\"]}", true,  200, "application/json", "ok: ip" },
+    { HTTP_POST, "/api/cmd", "{\"cmd\":\"status\"}",                      false, 401, NULL, NULL },
+    { HTTP_GET,  "/index.html",                   NULL, false, 404, NULL, NULL },
+};
+
+static void usage() {
+    fprintf(stderr, "usage: http_bench [--iterations N] [--route PATH] [--check] [--verbose]\n");
+    exit(2);
+}
+
+static Options parse_options(int argc, char** argv) {
+    Options opt = { 2000, NULL, false, false };
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strcmp(a, "--iterations") == 0 && i + 1 < argc) opt.iterations = atoi(argv[++i]);
+        else if (strcmp(a, "--route") == 0 && i + 1 < argc) opt.route = argv[++i];
+        else if (strcmp(a, "--check") == 0) opt.check = true;
+        else if (strcmp(a, "--verbose") == 0) opt.verbose = true;
+        else usage();
+    }
+    if (opt.iterations <= 0) usage();
+    return opt;
+}
+
+static http_host::Response send(const Case& c) {
+    http_host::Headers headers;
+    if (c.auth) headers.push_back({ "Authorization", std::string("Bearer ") + TOKEN });
+    if (c.body) headers.push_back({ "Content-Type", "application/json" });
+    return http_host::request(c.method, c.uri, headers, c.body ? c.body : "");
+}
+
+static bool check_case(const Case& c, const http_host::Response& r) {
+    const char* method = c.method == HTTP_GET ? "GET" : "POST";
+    bool ok = true;
+    if (r.status != c.status) {
+        fprintf(stderr, "FAIL %s %s: status %d, expected %d\n", method, c.uri, r.status, c.status);
+        ok = false;
+    }
+    if (c.type && r.type.compare(0, strlen(c.type), c.type) != 0) {
+        fprintf(stderr, "FAIL %s %s: type %s, expected %s\n", method, c.uri, r.type.c_str(), c.type);
+        ok = false;
+    }
+    if (c.contains && r.body.find(c.contains) == std::string::npos) {
+        fprintf(stderr, "FAIL %s %s: body has no \"%s\": %.200s\n", method, c.uri, c.contains, r.body.c_str());
+        ok = false;
+    }
+    return ok;
+}
+
+// /api/cmd runs inside the httpd task: stopping or restarting the server from
+// there would wait for that task itself, the handler must refuse it. reboot
+// and poweroff are answered first and run from a timer 500 ms later
+static bool check_lifecycle() {
+    bool ok = true;
+    static const char* COMMANDS[] = { "http_api_server_stop", "http_api_server_init" };
+    for (const char* command : COMMANDS) {
+        size_t before = http_host::consoleCommands().size();
+        std::string body = std::string("{\"cmd\":\"") + command + "\"}";
+        Case c = { HTTP_POST, "/api/cmd", body.c_str(), true, 200, "application/json", "\"ok\":false" };
+        http_host::Response r = send(c);
+        ok &= check_case(c, r);
+        if (http_host::consoleCommands().size() != before) {
+            fprintf(stderr, "FAIL /api/cmd %s: passed to the console\n", command);
+            ok = false;
+        }
+        if (!http_host::running()) {
+            fprintf(stderr, "FAIL /api/cmd %s: server stopped\n", command);
+            ok = false;
+        }
+    }
+
+    size_t before = http_host::consoleCommands().size();
+    Case reboot = { HTTP_POST, "/api/cmd", "{\"cmd\":\"reboot\"}", true, 200, "application/json", "\"ok\":true" };
+    ok &= check_case(reboot, send(reboot));
+    if (http_host::consoleCommands().size() != before) {
+        fprintf(stderr, "FAIL /api/cmd reboot: ran before the response\n");
+        ok = false;
+    }
+    sim::advanceTo(sim::now() + 600000);
+    if (http_host::consoleCommands().size() != before + 1 || http_host::consoleCommands().back() != "reboot") {
+        fprintf(stderr, "FAIL /api/cmd reboot: not run 500 ms after the response\n");
+        ok = false;
+    }
+    return ok;
+}
+
+static bool check_token() {
+    bool ok = true;
+    Case wrong = { HTTP_POST, "/api/cmd", "{\"cmd\":\"status\"}", false, 401, NULL, NULL };
+    http_host::Response r = http_host::request(wrong.method, wrong.uri,
+                                               { { "Authorization", "Bearer bench-token-0002" } }, wrong.body);
+    ok &= check_case(wrong, r);
+    if (http_api_server::setToken("short")) {
+        fprintf(stderr, "FAIL setToken: accepted a 5 character token\n");
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    Options opt = parse_options(argc, argv);
+
+    idf::setLogLevel(opt.verbose ? ESP_LOG_INFO : ESP_LOG_ERROR);
+    sim::MotorModel model(sim::defaultMotorParams(), { 8, 0, 1 });
+    sim::setAnalogSource(sim::MotorModel::analogSource, &model);
+    sim::setAdcNoise(2, 1);
+
+    adc_sampler::init();
+    adc_cal::init();
+    voltage::init();
+    acs712::init();
+    energy::init();
+    power_meter::init();
+    l298n::init();
+    protection::init();
+    motor_control::init();
+    motion::init();
+
+    for (int64_t t = 0; t < WARMUP_US; t += STEP_US) {
+        model.step(STEP_US * 1e-6);
+        sim::advanceTo(t + STEP_US);
+        sim::pollAdc();
+    }
+
+    http_api_server::init();
+    if (!http_host::running() || !http_api_server::setToken(TOKEN)) {
+        fprintf(stderr, "http_api_server failed to start\n");
+        return 1;
+    }
+
+    bool ok = true;
+    printf("%-36s %6s %8s %10s\n", "route", "status", "bytes", "ns/req");
+    for (const Case& c : CASES) {
+        if (opt.route && strncmp(c.uri, opt.route, strlen(opt.route)) != 0) continue;
+
+        http_host::Response r = send(c);
+        if (opt.check) ok &= check_case(c, r);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < opt.iterations; i++) send(c);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        char name[64];
+        snprintf(name, sizeof(name), "%s %s%s", c.method == HTTP_GET ? "GET" : "POST", c.uri,
+                 c.method == HTTP_POST && !c.auth ? " (no token)" : "");
+        printf("%-36s %6d %8zu %10.0f\n", name, r.status, r.body.size(), ns / opt.iterations);
+    }
+
+    if (opt.check) {
+        ok &= check_token();
+        ok &= check_lifecycle();
+        printf("check: %s\n", ok ? "pass" : "FAIL");
+    }
+    return ok ? 0 : 1;
+}
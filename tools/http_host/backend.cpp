@@ -0,0 +1,173 @@
+// Stub backend for the modules behind http_api_server that http_bench does not
+// build (they need the network or their own hardware): spectrum, alerts and
+// telemetry return fixed, plausible data; console commands are recorded and
+// echoed; the services report zero counters. Heap, task and Wi-Fi statistics
+// of the IDF runtime are fixed too. voltage, adc_sampler, power_meter, energy,
+// l298n, motor_control, motion and protection are the firmware sources on
+// tools/sim.
+#include "http_host.h"
+
+#include "alerts.h"
+#include "console.h"
+#include "dns_server.h"
+#include "spectrum.h"
+#include "static_files.h"
+#include "telemetry.h"
+#include "telnet_server.h"
+
+#include <cstring>
+#include <random>
+
+// ---- IDF runtime ----
+uint32_t esp_random(void) {
+    static std::mt19937 rng(1);
+    return rng();
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t max, configRUN_TIME_COUNTER_TYPE* total) {
+    static const char* NAMES[] = { "main", "IDLE", "httpd", "adc_sampler", "alerts", "telemetry", "uartTask", "tiT" };
+    const UBaseType_t count = sizeof(NAMES) / sizeof(NAMES[0]);
+    if (max < count) return 0;
+    for (UBaseType_t i = 0; i < count; i++) {
+        status[i] = {};
+        status[i].pcTaskName = NAMES[i];
+        status[i].xTaskNumber = i + 1;
+        status[i].ulRunTimeCounter = 1000000 * (i + 1);
+        status[i].usStackHighWaterMark = 512 + 64 * i;
+    }
+    if (total) *total = 100000000;
+    return count;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void) {
+    return 8;
+}
+
+size_t heap_caps_get_free_size(uint32_t) { return 180000; }
+size_t heap_caps_get_minimum_free_size(uint32_t) { return 150000; }
+size_t heap_caps_get_largest_free_block(uint32_t) { return 110000; }
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* info) {
+    *info = {};
+    info->primary = 6;
+    info->rssi = -58;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t* list) {
+    list->num = 1;
+    return ESP_OK;
+}
+
+// ---- spectrum: a 150 Hz PWM ripple ----
+namespace spectrum {
+    bool latest(Result* result) {
+        static const char* BANDS[] = { "dc_10hz", "10_100hz", "100_500hz", "500hz_2khz", "2khz_5khz" };
+        *result = {};
+        result->seq = 1;
+        result->size = DEFAULT_SIZE;
+        result->rate_hz = 10000;
+        result->bin_hz_x100 = 977;
+        result->dominant_hz_x100 = 14648;
+        result->dominant_ma = 310;
+        result->rms_ma = 240;
+        result->dc_ma = 850;
+        result->band_count = sizeof(BANDS) / sizeof(BANDS[0]);
+        for (size_t b = 0; b < result->band_count; b++) {
+            result->band_names[b] = BANDS[b];
+            result->band_rms_ma[b] = b == 2 ? 220 : 20;
+        }
+        for (size_t g = 0; g < fft::COMPACT_BINS; g++) result->compact_ma[g] = g == 1 ? 310 : 5;
+        return true;
+    }
+
+    Stats getStats() {
+        return { 120, 910000, 880000, 990000, 109200000, 5700 };
+    }
+}
+
+// ---- alerts: the default rule table, nothing raised ----
+namespace alerts {
+    static const Rule RULES[] = {
+        { "undervoltage", Source::Voltage, Kind::Under, 11500, 300, 200, ACTION_LOG | ACTION_PUSH, true },
+        { "overvoltage",  Source::Voltage, Kind::Over,  14600, 200, 100, ACTION_LOG | ACTION_PUSH, true },
+        { "overcurrent",  Source::Current, Kind::Over,   2500, 300,  20, ACTION_LOG | ACTION_PUSH | ACTION_CUTOFF, true },
+        { "stall",        Source::Current, Kind::Over,   1800, 300, 500, ACTION_LOG | ACTION_PUSH | ACTION_CUTOFF, true },
+        { "voltage_sag",  Source::Voltage, Kind::Fall,   3000, 1000, 50, ACTION_LOG | ACTION_PUSH, true },
+    };
+    static const size_t RULE_COUNT = sizeof(RULES) / sizeof(RULES[0]);
+
+    size_t ruleCount() {
+        return RULE_COUNT;
+    }
+
+    bool getRule(size_t index, Rule* rule, bool* active) {
+        if (index >= RULE_COUNT) return false;
+        *rule = RULES[index];
+        *active = false;
+        return true;
+    }
+
+    size_t recentEvents(Event* out, size_t max) {
+        static const Event EVENTS[] = {
+            { 1, 4, true, 2950, 12000000 },
+            { 2, 4, false, 1100, 12080000 },
+        };
+        size_t n = sizeof(EVENTS) / sizeof(EVENTS[0]);
+        if (n > max) n = max;
+        memcpy(out, EVENTS, n * sizeof(Event));
+        return n;
+    }
+}
+
+// ---- telemetry: full history, 100 ms apart ----
+namespace telemetry {
+    size_t snapshot(telemetry_codec::Sample* out, size_t max) {
+        size_t n = max < HISTORY_SIZE ? max : HISTORY_SIZE;
+        for (size_t i = 0; i < n; i++) {
+            out[i].t_ms = 60000 + (uint32_t)i * SAMPLE_PERIOD_MS;
+            for (size_t c = 0; c < telemetry_codec::CHANNELS; c++) {
+                out[i].values[c] = 12400 - (int32_t)(i % 7) * 3 + (int32_t)c * 1000;
+            }
+        }
+        return n;
+    }
+}
+
+// ---- services ----
+namespace dns_server {
+    Stats getStats() {
+        return {};
+    }
+}
+
+namespace telnet_server {
+    Stats getStats() {
+        return {};
+    }
+}
+
+namespace static_files {
+    void init() {}
+
+    esp_err_t getHandler(httpd_req_t* req) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+    }
+}
+
+namespace console {
+    static std::vector<std::string> commands;
+
+    bool processCommand(const char* command, std::function<void(const char*)> sendResponse) {
+        commands.push_back(command);
+        std::string line = std::string("ok: ") + command;
+        sendResponse(line.c_str());
+        return true;
+    }
+}
+
+namespace http_host {
+    const std::vector<std::string>& consoleCommands() {
+        return console::commands;
+    }
+}
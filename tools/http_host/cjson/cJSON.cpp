@@ -0,0 +1,377 @@
+// Minimal cJSON for the host build (see cJSON.h): parser and compact
+// printer with the library's conventions - case-insensitive object lookup,
+// valueint saturated from valuedouble, integers printed without a fraction.
+#include "cJSON.h"
+
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+
+static cJSON* new_item(int type) {
+    cJSON* item = static_cast<cJSON*>(calloc(1, sizeof(cJSON)));
+    if (item) item->type = type;
+    return item;
+}
+
+static char* copy_string(const char* s) {
+    size_t len = strlen(s) + 1;
+    char* copy = static_cast<char*>(malloc(len));
+    if (copy) memcpy(copy, s, len);
+    return copy;
+}
+
+static void set_number(cJSON* item, double num) {
+    item->valuedouble = num;
+    if (num >= INT_MAX) item->valueint = INT_MAX;
+    else if (num <= (double)INT_MIN) item->valueint = INT_MIN;
+    else item->valueint = (int)num;
+}
+
+void cJSON_Delete(cJSON* item) {
+    while (item) {
+        cJSON* next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+void cJSON_free(void* object) {
+    free(object);
+}
+
+cJSON* cJSON_CreateObject(void) { return new_item(cJSON_Object); }
+cJSON* cJSON_CreateArray(void) { return new_item(cJSON_Array); }
+cJSON* cJSON_CreateBool(cJSON_bool boolean) { return new_item(boolean ? cJSON_True : cJSON_False); }
+
+cJSON* cJSON_CreateString(const char* string) {
+    cJSON* item = new_item(cJSON_String);
+    if (item) item->valuestring = copy_string(string ? string : "");
+    return item;
+}
+
+cJSON* cJSON_CreateNumber(double num) {
+    cJSON* item = new_item(cJSON_Number);
+    if (item) set_number(item, num);
+    return item;
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item) {
+    if (!array || !item) return 0;
+    if (!array->child) {
+        array->child = item;
+        item->prev = item;   // cJSON keeps the tail in child->prev
+    } else {
+        cJSON* tail = array->child->prev;
+        tail->next = item;
+        item->prev = tail;
+        array->child->prev = item;
+    }
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON* object, const char* string, cJSON* item) {
+    if (!object || !string || !item) return 0;
+    free(item->string);
+    item->string = copy_string(string);
+    return cJSON_AddItemToArray(object, item);
+}
+
+static cJSON* add(cJSON* object, const char* name, cJSON* item) {
+    if (!cJSON_AddItemToObject(object, name, item)) {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    return add(object, name, cJSON_CreateString(string));
+}
+
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    return add(object, name, cJSON_CreateNumber(number));
+}
+
+cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, cJSON_bool boolean) {
+    return add(object, name, cJSON_CreateBool(boolean));
+}
+
+cJSON* cJSON_AddObjectToObject(cJSON* object, const char* name) {
+    return add(object, name, cJSON_CreateObject());
+}
+
+cJSON* cJSON_AddArrayToObject(cJSON* object, const char* name) {
+    return add(object, name, cJSON_CreateArray());
+}
+
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* string) {
+    if (!object || !string) return NULL;
+    for (cJSON* item = object->child; item; item = item->next) {
+        if (item->string && strcasecmp(item->string, string) == 0) return item;
+    }
+    return NULL;
+}
+
+int cJSON_GetArraySize(const cJSON* array) {
+    int n = 0;
+    for (cJSON* item = array ? array->child : NULL; item; item = item->next) n++;
+    return n;
+}
+
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index) {
+    cJSON* item = array ? array->child : NULL;
+    while (item && index-- > 0) item = item->next;
+    return item;
+}
+
+cJSON_bool cJSON_IsString(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_String; }
+cJSON_bool cJSON_IsNumber(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Number; }
+cJSON_bool cJSON_IsArray(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Array; }
+cJSON_bool cJSON_IsObject(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Object; }
+cJSON_bool cJSON_IsTrue(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_True; }
+cJSON_bool cJSON_IsBool(const cJSON* item) { return item && (item->type & (cJSON_True | cJSON_False)); }
+
+// ---- Parser ----
+struct Parser {
+    const char* p;
+    int depth;
+};
+
+static const int MAX_DEPTH = 1000;   // CJSON_NESTING_LIMIT
+
+static void skip_ws(Parser& ps) {
+    while (*ps.p && isspace((unsigned char)*ps.p)) ps.p++;
+}
+
+static void append_utf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+static bool parse_hex4(const char* p, unsigned* out) {
+    unsigned v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return false;
+    }
+    *out = v;
+    return true;
+}
+
+static bool parse_string(Parser& ps, std::string& out) {
+    if (*ps.p != '"') return false;
+    ps.p++;
+    while (*ps.p && *ps.p != '"') {
+        char c = *ps.p++;
+        if ((unsigned char)c < 0x20) return false;
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        char e = *ps.p++;
+        switch (e) {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            unsigned cp;
+            if (!parse_hex4(ps.p, &cp)) return false;
+            ps.p += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                unsigned low;
+                if (ps.p[0] != '\\' || ps.p[1] != 'u' || !parse_hex4(ps.p + 2, &low) || low < 0xDC00 || low > 0xDFFF) return false;
+                ps.p += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            append_utf8(out, cp);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    if (*ps.p != '"') return false;
+    ps.p++;
+    return true;
+}
+
+static cJSON* parse_value(Parser& ps);
+
+static cJSON* parse_container(Parser& ps, bool object) {
+    if (++ps.depth > MAX_DEPTH) return NULL;
+    cJSON* item = object ? cJSON_CreateObject() : cJSON_CreateArray();
+    ps.p++;
+    skip_ws(ps);
+    char close = object ? '}' : ']';
+    if (*ps.p == close) {
+        ps.p++;
+        ps.depth--;
+        return item;
+    }
+    for (;;) {
+        std::string name;
+        if (object) {
+            skip_ws(ps);
+            if (!parse_string(ps, name)) break;
+            skip_ws(ps);
+            if (*ps.p++ != ':') break;
+        }
+        cJSON* child = parse_value(ps);
+        if (!child) break;
+        if (object) cJSON_AddItemToObject(item, name.c_str(), child);
+        else cJSON_AddItemToArray(item, child);
+        skip_ws(ps);
+        if (*ps.p == ',') {
+            ps.p++;
+            continue;
+        }
+        if (*ps.p == close) {
+            ps.p++;
+            ps.depth--;
+            return item;
+        }
+        break;
+    }
+    cJSON_Delete(item);
+    return NULL;
+}
+
+static cJSON* parse_value(Parser& ps) {
+    skip_ws(ps);
+    const char* p = ps.p;
+    if (strncmp(p, "null", 4) == 0) { ps.p += 4; return new_item(cJSON_NULL); }
+    if (strncmp(p, "true", 4) == 0) { ps.p += 4; return new_item(cJSON_True); }
+    if (strncmp(p, "false", 5) == 0) { ps.p += 5; return new_item(cJSON_False); }
+    if (*p == '"') {
+        std::string s;
+        if (!parse_string(ps, s)) return NULL;
+        return cJSON_CreateString(s.c_str());
+    }
+    if (*p == '{') return parse_container(ps, true);
+    if (*p == '[') return parse_container(ps, false);
+    if (*p == '-' || isdigit((unsigned char)*p)) {
+        char* end;
+        double num = strtod(p, &end);
+        if (end == p) return NULL;
+        ps.p = end;
+        return cJSON_CreateNumber(num);
+    }
+    return NULL;
+}
+
+cJSON* cJSON_Parse(const char* value) {
+    if (!value) return NULL;
+    Parser ps = { value, 0 };
+    cJSON* item = parse_value(ps);
+    if (!item) return NULL;
+    skip_ws(ps);
+    if (*ps.p != '\0') {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+// ---- Printer ----
+static void print_string(std::string& out, const char* s) {
+    out += '"';
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += (char)c;
+            }
+        }
+    }
+    out += '"';
+}
+
+static void print_number(std::string& out, double d) {
+    char buf[32];
+    if (std::isnan(d) || std::isinf(d)) {
+        snprintf(buf, sizeof(buf), "null");
+    } else if (fabs(d) < 2e9 && d == (double)(int)d) {
+        snprintf(buf, sizeof(buf), "%d", (int)d);
+    } else {
+        // Shortest of 15/17 significant digits that reads back exactly, as cJSON does
+        snprintf(buf, sizeof(buf), "%1.15g", d);
+        if (strtod(buf, NULL) != d) snprintf(buf, sizeof(buf), "%1.17g", d);
+    }
+    out += buf;
+}
+
+static void print_value(std::string& out, const cJSON* item) {
+    switch (item->type & 0xFF) {
+    case cJSON_NULL: out += "null"; break;
+    case cJSON_False: out += "false"; break;
+    case cJSON_True: out += "true"; break;
+    case cJSON_Number: print_number(out, item->valuedouble); break;
+    case cJSON_String: print_string(out, item->valuestring ? item->valuestring : ""); break;
+    case cJSON_Array:
+    case cJSON_Object: {
+        bool object = (item->type & 0xFF) == cJSON_Object;
+        out += object ? '{' : '[';
+        for (const cJSON* child = item->child; child; child = child->next) {
+            if (child != item->child) out += ',';
+            if (object) {
+                print_string(out, child->string ? child->string : "");
+                out += ':';
+            }
+            print_value(out, child);
+        }
+        out += object ? '}' : ']';
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+char* cJSON_PrintUnformatted(const cJSON* item) {
+    if (!item) return NULL;
+    std::string out;
+    print_value(out, item);
+    return copy_string(out.c_str());
+}
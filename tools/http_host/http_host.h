@@ -0,0 +1,37 @@
+// Harness side of the in-process esp_http_server (httpd.cpp, declared in
+// tools/idf/idf.h): requests go straight to the URI handlers registered by
+// http_api_server::init(), without sockets.
+#ifndef HTTP_HOST_H
+#define HTTP_HOST_H
+
+#include "idf.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace http_host {
+    typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+    struct Response {
+        int status;             // 404 - no handler matched, 0 - handler sent nothing
+        std::string type;
+        Headers headers;
+        std::string body;
+        bool chunked;
+        esp_err_t result;       // Handler return value
+    };
+
+    // Matches the registered handlers in registration order with the server's
+    // uri_match_fn (path only, the query string stays in req->uri)
+    Response request(httpd_method_t method, const std::string& uri, const Headers& headers = {},
+                     const std::string& body = "");
+
+    bool running();              // httpd_start() called and not stopped
+    size_t handlerCount();
+
+    // ---- Stub backend (backend.cpp) ----
+    // console::processCommand: every command succeeds and echoes "ok: <cmd>"
+    const std::vector<std::string>& consoleCommands();
+}
+
+#endif
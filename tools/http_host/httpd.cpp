@@ -0,0 +1,219 @@
+// In-process esp_http_server for the host build: one server, handlers kept in
+// registration order, responses collected into http_host::Response.
+#include "http_host.h"
+
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+namespace {
+    struct Handler {
+        std::string uri;
+        httpd_method_t method;
+        esp_err_t (*fn)(httpd_req_t* r);
+        void* user_ctx;
+    };
+
+    struct Request {
+        const http_host::Headers* headers;
+        const std::string* body;
+        size_t body_pos;
+        std::string query;
+        http_host::Response* response;
+        bool sent;
+    };
+
+    struct Server {
+        bool running;
+        httpd_config_t config;
+        std::vector<Handler> handlers;
+    };
+
+    Server server = {};
+
+    bool status_code(const char* status, int* code) {
+        return sscanf(status, "%d", code) == 1;
+    }
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config) {
+    if (server.running) return ESP_ERR_INVALID_STATE;
+    server.running = true;
+    server.config = *config;
+    server.handlers.clear();
+    *handle = &server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle) {
+    if (handle != &server || !server.running) return ESP_ERR_INVALID_ARG;
+    server.running = false;
+    server.handlers.clear();
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler) {
+    if (handle != &server || !server.running) return ESP_ERR_INVALID_ARG;
+    if (server.handlers.size() >= server.config.max_uri_handlers) return ESP_ERR_NO_MEM;
+    for (const auto& h : server.handlers) {
+        if (h.uri == uri_handler->uri && h.method == uri_handler->method) return ESP_ERR_INVALID_ARG;
+    }
+    server.handlers.push_back({ uri_handler->uri, uri_handler->method, uri_handler->handler, uri_handler->user_ctx });
+    return ESP_OK;
+}
+
+// Same rules as esp_http_server: a trailing '*' matches any rest, a trailing
+// '?' makes the preceding character (usually '/') optional
+bool httpd_uri_match_wildcard(const char* template_uri, const char* uri_to_match, size_t match_upto) {
+    size_t tpl_len = strlen(template_uri);
+    bool star = tpl_len > 0 && template_uri[tpl_len - 1] == '*';
+    if (star) tpl_len--;
+    bool question = tpl_len > 0 && template_uri[tpl_len - 1] == '?';
+    if (question) tpl_len--;
+    if (star) {
+        if (match_upto >= tpl_len) return strncmp(template_uri, uri_to_match, tpl_len) == 0;
+        return question && match_upto == tpl_len - 1 && strncmp(template_uri, uri_to_match, match_upto) == 0;
+    }
+    if (question) {
+        if (match_upto == tpl_len) return strncmp(template_uri, uri_to_match, tpl_len) == 0;
+        return match_upto == tpl_len - 1 && strncmp(template_uri, uri_to_match, match_upto) == 0;
+    }
+    return match_upto == tpl_len && strncmp(template_uri, uri_to_match, tpl_len) == 0;
+}
+
+static Request* state(httpd_req_t* r) {
+    return static_cast<Request*>(r->aux);
+}
+
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len) {
+    Request* s = state(r);
+    size_t left = s->body->size() - s->body_pos;
+    size_t n = buf_len < left ? buf_len : left;
+    memcpy(buf, s->body->data() + s->body_pos, n);
+    s->body_pos += n;
+    return (int)n;
+}
+
+static esp_err_t copy_value(const std::string& value, char* out, size_t out_size) {
+    if (out_size == 0) return ESP_ERR_INVALID_ARG;
+    snprintf(out, out_size, "%s", value.c_str());
+    return value.size() >= out_size ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* r, const char* field, char* val, size_t val_size) {
+    for (const auto& h : *state(r)->headers) {
+        if (strcasecmp(h.first.c_str(), field) == 0) return copy_value(h.second, val, val_size);
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* r, char* buf, size_t buf_len) {
+    const std::string& query = state(r)->query;
+    if (query.empty()) return ESP_ERR_NOT_FOUND;
+    return copy_value(query, buf, buf_len);
+}
+
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size) {
+    size_t key_len = strlen(key);
+    const char* p = qry;
+    while (p && *p) {
+        const char* end = strchr(p, '&');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > key_len && strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            return copy_value(std::string(p + key_len + 1, len - key_len - 1), val, val_size);
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status) {
+    int code;
+    if (!status_code(status, &code)) return ESP_ERR_INVALID_ARG;
+    state(r)->response->status = code;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type) {
+    state(r)->response->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value) {
+    state(r)->response->headers.push_back({ field, value });
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len) {
+    Request* s = state(r);
+    if (s->sent) return ESP_ERR_INVALID_STATE;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) buf_len = buf ? strlen(buf) : 0;
+    if (buf && buf_len > 0) s->response->body.append(buf, buf_len);
+    s->sent = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t buf_len) {
+    Request* s = state(r);
+    if (s->sent) return ESP_ERR_INVALID_STATE;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) buf_len = buf ? strlen(buf) : 0;
+    s->response->chunked = true;
+    if (!buf || buf_len == 0) {
+        s->sent = true;
+        return ESP_OK;
+    }
+    s->response->body.append(buf, buf_len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t* req, httpd_err_code_t error, const char* msg) {
+    static const int CODES[] = { 400, 401, 404, 405, 500 };
+    Request* s = state(req);
+    if (s->sent) return ESP_ERR_INVALID_STATE;
+    s->response->status = CODES[error];
+    s->response->type = "text/html";
+    s->response->body = msg ? msg : "";
+    s->sent = true;
+    return ESP_OK;
+}
+
+namespace http_host {
+    Response request(httpd_method_t method, const std::string& uri, const Headers& headers, const std::string& body) {
+        Response response = { 404, "text/html", {}, "", false, ESP_OK };
+        size_t path_len = uri.find('?');
+        if (path_len == std::string::npos) path_len = uri.size();
+        httpd_uri_match_func_t match = server.config.uri_match_fn;
+
+        for (const auto& h : server.handlers) {
+            bool matched = match ? match(h.uri.c_str(), uri.c_str(), path_len)
+                                 : h.uri.size() == path_len && uri.compare(0, path_len, h.uri) == 0;
+            if (!matched || h.method != method) continue;
+
+            Request s = { &headers, &body, 0, "", &response, false };
+            if (path_len < uri.size()) s.query = uri.substr(path_len + 1);
+            httpd_req_t req = {};
+            req.handle = &server;
+            req.method = method;
+            snprintf(req.uri, sizeof(req.uri), "%s", uri.c_str());
+            req.content_len = body.size();
+            req.aux = &s;
+            req.user_ctx = h.user_ctx;
+
+            response.status = 200;
+            response.type = "text/html";
+            response.result = h.fn(&req);
+            if (!s.sent) response.status = 0;
+            return response;
+        }
+        response.body = "Nothing matches the given URI";
+        return response;
+    }
+
+    bool running() {
+        return server.running;
+    }
+
+    size_t handlerCount() {
+        return server.handlers.size();
+    }
+}
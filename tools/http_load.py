@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Load-test the device HTTP API.
+
+Drives one or more URIs with N concurrent HTTP/1.1 clients and reports
+throughput, latency percentiles and error counts. With keep-alive each
+client reuses its connection; a connection that the server closes between
+requests (httpd LRU purge when CONFIG_LWIP_MAX_SOCKETS runs out) is
+counted as "purged" and reopened.
+
+Examples:
+    http_load.py 192.168.6.1 -c 4 -d 30 /api/voltage_r1_r2
+    http_load.py 192.168.6.1 -c 12 --no-keepalive /metrics
+    http_load.py 192.168.6.1 -c 2 -m POST -b '{"cmd":"voltage_3v3"}' \\
+        -H 'Authorization: Bearer <token>' /api/cmd
+
+The token is per device: it is generated on first boot (logged once on
+the serial console) and changed with the http_api_token console command.
+"""
+import argparse
+import asyncio
+import collections
+import time
+
+
+class Stats:
+    def __init__(self):
+        self.latencies = []
+        self.status = collections.Counter()
+        self.errors = collections.Counter()
+        self.connects = 0
+        self.purged = 0
+
+
+def build_request(args, uri):
+    headers = [f"{args.method} {uri} HTTP/1.1", f"Host: {args.host}"]
+    headers.append("Connection: keep-alive" if args.keepalive else "Connection: close")
+    headers.extend(args.header)
+    body = args.body.encode() if args.body else b""
+    if body:
+        headers.append(f"Content-Length: {len(body)}")
+    return ("\r\n".join(headers) + "\r\n\r\n").encode() + body
+
+
+async def read_response(reader):
+    status_line = await reader.readline()
+    if not status_line:
+        raise ConnectionResetError("closed before status line")
+    version, status = status_line.split()[:2]
+    status = int(status)
+    length, chunked = None, False
+    close = version == b"HTTP/1.0"
+    while True:
+        line = (await reader.readline()).decode("latin-1").strip()
+        if not line:
+            break
+        name, _, value = line.partition(":")
+        name, value = name.strip().lower(), value.strip().lower()
+        if name == "content-length":
+            length = int(value)
+        elif name == "transfer-encoding" and "chunked" in value:
+            chunked = True
+        elif name == "connection":
+            close = value == "close"
+    if chunked:
+        while True:
+            size = int((await reader.readline()).split(b";")[0], 16)
+            await reader.readexactly(size + 2)
+            if size == 0:
+                break
+    elif length is not None:
+        await reader.readexactly(length)
+    else:
+        await reader.read()
+        close = True
+    return status, close
+
+
+async def client(args, requests, stats, deadline):
+    reader = writer = None
+    i = 0
+    while time.monotonic() < deadline:
+        request = requests[i % len(requests)]
+        i += 1
+        reused = writer is not None
+        start = time.perf_counter()
+        try:
+            if writer is None:
+                reader, writer = await asyncio.wait_for(
+                    asyncio.open_connection(args.host, args.port), args.timeout)
+                stats.connects += 1
+            writer.write(request)
+            await writer.drain()
+            status, close = await asyncio.wait_for(read_response(reader), args.timeout)
+        except (ConnectionError, asyncio.IncompleteReadError) as e:
+            if writer is not None:
+                writer.close()
+            reader = writer = None
+            if reused:
+                # The server closed an idle connection (LRU purge); retry on a new one
+                stats.purged += 1
+            else:
+                stats.errors[type(e).__name__] += 1
+            continue
+        except (OSError, asyncio.TimeoutError, ValueError) as e:
+            if writer is not None:
+                writer.close()
+            reader = writer = None
+            stats.errors[type(e).__name__] += 1
+            continue
+        stats.latencies.append(time.perf_counter() - start)
+        stats.status[status] += 1
+        if close or not args.keepalive:
+            writer.close()
+            reader = writer = None
+        if args.think > 0:
+            await asyncio.sleep(args.think / 1000)
+    if writer is not None:
+        writer.close()
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return float("nan")
+    k = min(len(sorted_values) - 1, int(round(p / 100 * (len(sorted_values) - 1))))
+    return sorted_values[k]
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host")
+    parser.add_argument("uri", nargs="+")
+    parser.add_argument("-p", "--port", type=int, default=80)
+    parser.add_argument("-c", "--concurrency", type=int, default=4)
+    parser.add_argument("-d", "--duration", type=float, default=10, help="seconds")
+    parser.add_argument("-m", "--method", default="GET")
+    parser.add_argument("-b", "--body", default="")
+    parser.add_argument("-H", "--header", action="append", default=[])
+    parser.add_argument("--timeout", type=float, default=5, help="per-request timeout, seconds")
+    parser.add_argument("--think", type=float, default=0, help="pause between requests per client, ms")
+    parser.add_argument("--no-keepalive", dest="keepalive", action="store_false")
+    args = parser.parse_args()
+
+    requests = [build_request(args, uri) for uri in args.uri]
+    stats = Stats()
+    start = time.monotonic()
+    deadline = start + args.duration
+    await asyncio.gather(*(client(args, requests, stats, deadline) for _ in range(args.concurrency)))
+    elapsed = time.monotonic() - start
+
+    lat = sorted(stats.latencies)
+    ms = lambda v: f"{v * 1000:.1f} ms"
+    print(f"clients:     {args.concurrency} ({'keep-alive' if args.keepalive else 'close'})")
+    print(f"requests:    {len(lat)} in {elapsed:.1f} s -> {len(lat) / elapsed:.1f} req/s")
+    print(f"connections: {stats.connects} opened, {stats.purged} purged by server")
+    print(f"latency:     p50 {ms(percentile(lat, 50))}  p90 {ms(percentile(lat, 90))}  "
+          f"p99 {ms(percentile(lat, 99))}  max {ms(lat[-1]) if lat else '-'}")
+    print(f"status:      {dict(sorted(stats.status.items()))}")
+    print(f"errors:      {dict(stats.errors) or 0}")
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
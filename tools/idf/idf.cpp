@@ -0,0 +1,62 @@
+// Part of the IDF stand-in common to the simulation and the real-time backend
+// (see idf.h): logging and critical sections. The clock behind the log
+// timestamps is the backend's esp_timer_get_time().
+#include "idf.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <thread>
+
+static esp_log_level_t log_level = ESP_LOG_WARN;
+static thread_local int held = 0;      // Critical sections entered by this thread
+
+void idf_log(esp_log_level_t level, const char* tag, const char* fmt, ...) {
+    if (level > log_level) return;
+    static const char LETTERS[] = "NEWIDV";
+    // One write per line: tasks on the real-time backend log while the harness does
+    char line[512];
+    int len = snprintf(line, sizeof(line), "[%11.6f] %c %s: ", esp_timer_get_time() / 1e6, LETTERS[level], tag);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line + len, sizeof(line) - len, fmt, args);
+    va_end(args);
+    fprintf(stderr, "%s\n", line);
+}
+
+// Owner ids start at 1: 0 marks a free mux
+static int thread_id() {
+    static std::atomic<int> next{ 1 };
+    thread_local int id = next++;
+    return id;
+}
+
+void idf_critical_enter(portMUX_TYPE* mux) {
+    int self = thread_id();
+    held++;
+    if (__atomic_load_n(&mux->owner, __ATOMIC_RELAXED) == self) {
+        mux->depth++;
+        return;
+    }
+    int expected = 0;
+    while (!__atomic_compare_exchange_n(&mux->owner, &expected, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = 0;
+        std::this_thread::yield();
+    }
+    mux->depth = 1;
+}
+
+void idf_critical_exit(portMUX_TYPE* mux) {
+    held--;
+    if (--mux->depth == 0) __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+}
+
+namespace idf {
+    void setLogLevel(esp_log_level_t level) {
+        log_level = level;
+    }
+
+    int criticalNesting() {
+        return held;
+    }
+}
@@ -0,0 +1,420 @@
+// Linux stand-in for the ESP-IDF surface used by the firmware modules that run
+// on the host. The sources in src/ compile unchanged against these headers
+// (tools/idf/include forwards every IDF header here); two backends implement
+// the calls:
+//
+//   tools/sim/sim.cpp    virtual time: esp_timer callbacks, FreeRTOS tasks and
+//                        the ADC DMA driver run when the harness advances the
+//                        clock (sim.h); LEDC / MCPWM / GPIO pin levels, NVS in
+//                        memory. Motor, sensor and HTTP modules.
+//   tools/host/host.cpp  real time: the monotonic clock, tasks as free-running
+//                        threads, lwIP sockets are the host's BSD sockets.
+//                        Network client modules (telnet_client, f660).
+//
+// A tool links exactly one of them; calls its backend does not implement fail
+// at link time. idf.cpp is common to both (logging, critical sections).
+// esp_http_server is in-process in tools/http_host, the HTTP statistics
+// (heap, tasks, Wi-Fi) come from tools/http_host/backend.cpp.
+#ifndef IDF_H
+#define IDF_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// ---- esp_err / attributes / sdkconfig ----
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define IRAM_ATTR
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 160
+
+// ---- esp_log ----
+typedef enum { ESP_LOG_NONE, ESP_LOG_ERROR, ESP_LOG_WARN, ESP_LOG_INFO, ESP_LOG_DEBUG, ESP_LOG_VERBOSE } esp_log_level_t;
+void idf_log(esp_log_level_t level, const char* tag, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+#define ESP_LOGE(tag, fmt, ...) idf_log(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) idf_log(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) idf_log(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) idf_log(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) idf_log(ESP_LOG_VERBOSE, tag, fmt, ##__VA_ARGS__)
+
+// ---- FreeRTOS ----
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+
+// Critical sections: one recursive spinlock per mux (idf.cpp), nestable by the
+// thread that holds it, as a core can on the chip
+typedef struct { volatile int owner; int depth; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+void idf_critical_enter(portMUX_TYPE* mux);
+void idf_critical_exit(portMUX_TYPE* mux);
+#define portENTER_CRITICAL(mux) idf_critical_enter(mux)
+#define portEXIT_CRITICAL(mux) idf_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux) idf_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux) idf_critical_exit(mux)
+#define portYIELD_FROM_ISR(x) ((void)(x))
+
+typedef struct idf_task* TaskHandle_t;
+typedef struct idf_semaphore* SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void*);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t priority,
+                       TaskHandle_t* handle);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment);
+TickType_t xTaskGetTickCount(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+typedef struct {
+    TaskHandle_t xHandle;
+    const char* pcTaskName;
+    UBaseType_t xTaskNumber;
+    int eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    configRUN_TIME_COUNTER_TYPE ulRunTimeCounter;
+    uint32_t usStackHighWaterMark;
+} TaskStatus_t;
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t max, configRUN_TIME_COUNTER_TYPE* total);
+UBaseType_t uxTaskGetNumberOfTasks(void);
+
+// ---- esp_timer / esp_cpu / esp_random / heap ----
+typedef struct sim_timer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+typedef enum { ESP_TIMER_TASK, ESP_TIMER_ISR } esp_timer_dispatch_t;
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+int64_t esp_timer_get_time(void);
+uint32_t esp_cpu_get_cycle_count(void);
+uint32_t esp_random(void);
+
+#define MALLOC_CAP_8BIT (1 << 2)
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+// ---- GPIO ----
+typedef int gpio_num_t;
+typedef enum { GPIO_MODE_DISABLE = 0, GPIO_MODE_INPUT = 1, GPIO_MODE_OUTPUT = 2 } gpio_mode_t;
+#define GPIO_PIN_COUNT 31
+#define GPIO_IS_VALID_OUTPUT_GPIO(n) ((n) >= 0 && (n) < GPIO_PIN_COUNT)
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+esp_err_t gpio_reset_pin(gpio_num_t gpio);
+typedef struct sim_gpio_dev gpio_dev_t;
+#define GPIO_PORT_0 0
+#define GPIO_LL_GET_HW(num) ((gpio_dev_t*)nullptr)
+void gpio_ll_set_level(gpio_dev_t* hw, uint32_t gpio, uint32_t level);
+#define SIG_GPIO_OUT_IDX 128
+void esp_rom_gpio_connect_out_signal(uint32_t gpio, uint32_t signal, bool out_inv, bool oen_inv);
+
+// ---- LEDC ----
+typedef enum { LEDC_LOW_SPEED_MODE } ledc_mode_t;
+typedef enum { LEDC_TIMER_0, LEDC_TIMER_1, LEDC_TIMER_2, LEDC_TIMER_3 } ledc_timer_t;
+typedef enum { LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2, LEDC_CHANNEL_3, LEDC_CHANNEL_4, LEDC_CHANNEL_5, LEDC_CHANNEL_MAX } ledc_channel_t;
+typedef enum { LEDC_TIMER_1_BIT = 1, LEDC_TIMER_13_BIT = 13, LEDC_TIMER_14_BIT = 14, LEDC_TIMER_BIT_MAX = 20 } ledc_timer_bit_t;
+typedef enum { LEDC_AUTO_CLK } ledc_clk_cfg_t;
+typedef enum { LEDC_INTR_DISABLE } ledc_intr_type_t;
+typedef enum { LEDC_SLEEP_MODE_KEEP_ALIVE } ledc_sleep_mode_t;
+typedef enum { LEDC_FADE_NO_WAIT, LEDC_FADE_WAIT_DONE } ledc_fade_mode_t;
+typedef struct {
+    ledc_mode_t speed_mode;
+    ledc_timer_bit_t duty_resolution;
+    ledc_timer_t timer_num;
+    uint32_t freq_hz;
+    ledc_clk_cfg_t clk_cfg;
+    bool deconfigure;
+} ledc_timer_config_t;
+typedef struct {
+    int gpio_num;
+    ledc_mode_t speed_mode;
+    ledc_channel_t channel;
+    ledc_intr_type_t intr_type;
+    ledc_timer_t timer_sel;
+    uint32_t duty;
+    int hpoint;
+    ledc_sleep_mode_t sleep_mode;
+    struct { unsigned int output_invert: 1; } flags;
+} ledc_channel_config_t;
+esp_err_t ledc_timer_config(const ledc_timer_config_t* config);
+esp_err_t ledc_channel_config(const ledc_channel_config_t* config);
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty);
+esp_err_t ledc_set_duty_with_hpoint(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint);
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel);
+uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel);
+esp_err_t ledc_stop(ledc_mode_t mode, ledc_channel_t channel, uint32_t idle_level);
+esp_err_t ledc_fade_func_install(int intr_alloc_flags);
+esp_err_t ledc_set_fade_with_time(ledc_mode_t mode, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms);
+esp_err_t ledc_fade_start(ledc_mode_t mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode);
+esp_err_t ledc_fade_stop(ledc_mode_t mode, ledc_channel_t channel);
+
+// ---- MCPWM (one group: 3 timers, 3 operators) ----
+typedef struct sim_mcpwm_timer* mcpwm_timer_handle_t;
+typedef struct sim_mcpwm_oper* mcpwm_oper_handle_t;
+typedef struct sim_mcpwm_cmpr* mcpwm_cmpr_handle_t;
+typedef struct sim_mcpwm_gen* mcpwm_gen_handle_t;
+typedef struct sim_mcpwm_sync* mcpwm_sync_handle_t;
+typedef enum { MCPWM_TIMER_CLK_SRC_DEFAULT } mcpwm_timer_clock_source_t;
+typedef enum { MCPWM_TIMER_COUNT_MODE_UP } mcpwm_timer_count_mode_t;
+typedef enum { MCPWM_TIMER_DIRECTION_UP } mcpwm_timer_direction_t;
+typedef enum { MCPWM_TIMER_EVENT_EMPTY, MCPWM_TIMER_EVENT_FULL } mcpwm_timer_event_t;
+typedef enum { MCPWM_TIMER_START_NO_STOP, MCPWM_TIMER_STOP_EMPTY } mcpwm_timer_start_stop_cmd_t;
+typedef enum { MCPWM_GEN_ACTION_KEEP, MCPWM_GEN_ACTION_LOW, MCPWM_GEN_ACTION_HIGH } mcpwm_generator_action_t;
+typedef struct {
+    int group_id;
+    mcpwm_timer_clock_source_t clk_src;
+    uint32_t resolution_hz;
+    mcpwm_timer_count_mode_t count_mode;
+    uint32_t period_ticks;
+    int intr_priority;
+    struct { uint32_t update_period_on_empty: 1; } flags;
+} mcpwm_timer_config_t;
+typedef struct {
+    int group_id;
+    int intr_priority;
+    struct { uint32_t update_gen_action_on_tez: 1; uint32_t update_dead_time_on_tez: 1; } flags;
+} mcpwm_operator_config_t;
+typedef struct {
+    int intr_priority;
+    struct { uint32_t update_cmp_on_tez: 1; uint32_t update_cmp_on_tep: 1; uint32_t update_cmp_on_sync: 1; } flags;
+} mcpwm_comparator_config_t;
+typedef struct { int gen_gpio_num; struct { uint32_t invert_pwm: 1; } flags; } mcpwm_generator_config_t;
+typedef struct { mcpwm_timer_event_t timer_event; struct { uint32_t propagate_input_sync: 1; } flags; } mcpwm_timer_sync_src_config_t;
+typedef struct { mcpwm_sync_handle_t sync_src; uint32_t count_value; mcpwm_timer_direction_t direction; } mcpwm_timer_sync_phase_config_t;
+typedef struct { uint32_t posedge_delay_ticks; uint32_t negedge_delay_ticks; struct { uint32_t invert_output: 1; } flags; } mcpwm_dead_time_config_t;
+typedef struct { mcpwm_timer_direction_t direction; mcpwm_timer_event_t event; mcpwm_generator_action_t action; } mcpwm_gen_timer_event_action_t;
+typedef struct { mcpwm_timer_direction_t direction; mcpwm_cmpr_handle_t comparator; mcpwm_generator_action_t action; } mcpwm_gen_compare_event_action_t;
+#define MCPWM_GEN_TIMER_EVENT_ACTION(dir, ev, act) (mcpwm_gen_timer_event_action_t) { .direction = dir, .event = ev, .action = act }
+#define MCPWM_GEN_COMPARE_EVENT_ACTION(dir, cmp, act) (mcpwm_gen_compare_event_action_t) { .direction = dir, .comparator = cmp, .action = act }
+esp_err_t mcpwm_new_timer(const mcpwm_timer_config_t* config, mcpwm_timer_handle_t* out);
+esp_err_t mcpwm_del_timer(mcpwm_timer_handle_t timer);
+esp_err_t mcpwm_timer_enable(mcpwm_timer_handle_t timer);
+esp_err_t mcpwm_timer_disable(mcpwm_timer_handle_t timer);
+esp_err_t mcpwm_timer_start_stop(mcpwm_timer_handle_t timer, mcpwm_timer_start_stop_cmd_t cmd);
+esp_err_t mcpwm_new_timer_sync_src(mcpwm_timer_handle_t timer, const mcpwm_timer_sync_src_config_t* config, mcpwm_sync_handle_t* out);
+esp_err_t mcpwm_del_sync_src(mcpwm_sync_handle_t sync);
+esp_err_t mcpwm_timer_set_phase_on_sync(mcpwm_timer_handle_t timer, const mcpwm_timer_sync_phase_config_t* config);
+esp_err_t mcpwm_new_operator(const mcpwm_operator_config_t* config, mcpwm_oper_handle_t* out);
+esp_err_t mcpwm_del_operator(mcpwm_oper_handle_t oper);
+esp_err_t mcpwm_operator_connect_timer(mcpwm_oper_handle_t oper, mcpwm_timer_handle_t timer);
+esp_err_t mcpwm_new_comparator(mcpwm_oper_handle_t oper, const mcpwm_comparator_config_t* config, mcpwm_cmpr_handle_t* out);
+esp_err_t mcpwm_del_comparator(mcpwm_cmpr_handle_t cmpr);
+esp_err_t mcpwm_comparator_set_compare_value(mcpwm_cmpr_handle_t cmpr, uint32_t ticks);
+esp_err_t mcpwm_new_generator(mcpwm_oper_handle_t oper, const mcpwm_generator_config_t* config, mcpwm_gen_handle_t* out);
+esp_err_t mcpwm_del_generator(mcpwm_gen_handle_t gen);
+esp_err_t mcpwm_generator_set_action_on_timer_event(mcpwm_gen_handle_t gen, mcpwm_gen_timer_event_action_t action);
+esp_err_t mcpwm_generator_set_action_on_compare_event(mcpwm_gen_handle_t gen, mcpwm_gen_compare_event_action_t action);
+esp_err_t mcpwm_generator_set_force_level(mcpwm_gen_handle_t gen, int level, bool hold_on);
+esp_err_t mcpwm_generator_set_dead_time(mcpwm_gen_handle_t in, mcpwm_gen_handle_t out, const mcpwm_dead_time_config_t* config);
+
+// ---- NVS (in memory, empty at start) ----
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* out);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out, size_t* len);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t len);
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out, size_t* len);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value);
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out);
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value);
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out);
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key);
+
+// ---- ADC: continuous (DMA) driver, digital monitor, calibration ----
+typedef enum { ADC_UNIT_1, ADC_UNIT_2 } adc_unit_t;
+typedef enum { ADC_CHANNEL_0, ADC_CHANNEL_1, ADC_CHANNEL_2, ADC_CHANNEL_3, ADC_CHANNEL_4, ADC_CHANNEL_5, ADC_CHANNEL_6 } adc_channel_t;
+typedef enum { ADC_ATTEN_DB_0 = 0, ADC_ATTEN_DB_2_5 = 1, ADC_ATTEN_DB_6 = 2, ADC_ATTEN_DB_12 = 3 } adc_atten_t;
+typedef enum { ADC_BITWIDTH_DEFAULT = 0, ADC_BITWIDTH_12 = 12 } adc_bitwidth_t;
+typedef enum { ADC_CONV_SINGLE_UNIT_1 = 1 } adc_digi_convert_mode_t;
+typedef enum { ADC_DIGI_OUTPUT_FORMAT_TYPE1, ADC_DIGI_OUTPUT_FORMAT_TYPE2 } adc_digi_output_format_t;
+
+// ESP32-C6 limits
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define SOC_ADC_PATT_LEN_MAX 8
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH 83333
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW 611
+#define SOC_ADC_DIGI_RESULT_BYTES 4
+
+typedef struct sim_adc_continuous* adc_continuous_handle_t;
+typedef struct {
+    uint32_t max_store_buf_size;
+    uint32_t conv_frame_size;
+    struct { uint32_t flush_pool: 1; } flags;
+} adc_continuous_handle_cfg_t;
+typedef struct { uint8_t atten; uint8_t channel; uint8_t unit; uint8_t bit_width; } adc_digi_pattern_config_t;
+typedef struct {
+    uint32_t pattern_num;
+    adc_digi_pattern_config_t* adc_pattern;
+    uint32_t sample_freq_hz;
+    adc_digi_convert_mode_t conv_mode;
+    adc_digi_output_format_t format;
+} adc_continuous_config_t;
+typedef struct { uint8_t* conv_frame_buffer; uint32_t size; } adc_continuous_evt_data_t;
+typedef bool (*adc_continuous_callback_t)(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata, void* user_data);
+typedef struct { adc_continuous_callback_t on_conv_done; adc_continuous_callback_t on_pool_ovf; } adc_continuous_evt_cbs_t;
+typedef struct {
+    union {
+        struct { uint32_t data: 12; uint32_t reserved12: 1; uint32_t channel: 3; uint32_t unit: 1; uint32_t reserved17_31: 15; } type2;
+        uint32_t val;
+    };
+} adc_digi_output_data_t;
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t* config, adc_continuous_handle_t* out);
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t* config);
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t handle, const adc_continuous_evt_cbs_t* cbs, void* user_data);
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle);
+esp_err_t adc_continuous_stop(adc_continuous_handle_t handle);
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t handle);
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t* buf, uint32_t length_max, uint32_t* out_length, uint32_t timeout_ms);
+
+typedef struct sim_adc_monitor* adc_monitor_handle_t;
+typedef struct { adc_unit_t adc_unit; adc_channel_t channel; int32_t h_threshold; int32_t l_threshold; } adc_monitor_config_t;
+typedef struct { int unused; } adc_monitor_evt_data_t;
+typedef bool (*adc_monitor_evt_cb_t)(adc_monitor_handle_t handle, const adc_monitor_evt_data_t* event, void* user_data);
+typedef struct { adc_monitor_evt_cb_t on_over_high_thresh; adc_monitor_evt_cb_t on_below_low_thresh; } adc_monitor_evt_cbs_t;
+esp_err_t adc_new_continuous_monitor(adc_continuous_handle_t handle, const adc_monitor_config_t* config, adc_monitor_handle_t* out);
+esp_err_t adc_continuous_monitor_register_event_callbacks(adc_monitor_handle_t monitor, const adc_monitor_evt_cbs_t* cbs, void* user_data);
+esp_err_t adc_continuous_monitor_enable(adc_monitor_handle_t monitor);
+esp_err_t adc_continuous_monitor_disable(adc_monitor_handle_t monitor);
+esp_err_t adc_del_continuous_monitor(adc_monitor_handle_t monitor);
+
+typedef struct sim_adc_cali* adc_cali_handle_t;
+typedef struct { adc_unit_t unit_id; adc_channel_t chan; adc_atten_t atten; adc_bitwidth_t bitwidth; } adc_cali_curve_fitting_config_t;
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t* config, adc_cali_handle_t* out);
+esp_err_t adc_cali_delete_scheme_curve_fitting(adc_cali_handle_t handle);
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int* mv);
+
+// ---- Wi-Fi ----
+typedef struct { uint8_t bssid[6]; uint8_t ssid[33]; uint8_t primary; int8_t rssi; } wifi_ap_record_t;
+typedef struct { int num; } wifi_sta_list_t;
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* info);
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t* list);
+
+// ---- lwIP: BSD sockets from the host, statistics compiled out ----
+#define LWIP_SOCKET_OFFSET 54
+#define CONFIG_LWIP_MAX_SOCKETS 10
+#define LINK_STATS 0
+#define MEMP_STATS 0
+#define MEM_STATS 0
+#define IP_NAPT 0
+
+// ---- esp_http_server (in-process, tools/http_host/httpd.cpp) ----
+#define ESP_ERR_HTTPD_BASE 0xb000
+#define ESP_ERR_HTTPD_RESULT_TRUNC (ESP_ERR_HTTPD_BASE + 8)
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+#define HTTPD_RESP_USE_STRLEN -1
+
+typedef void* httpd_handle_t;
+typedef enum { HTTP_DELETE = 0, HTTP_GET = 1, HTTP_HEAD = 2, HTTP_POST = 3, HTTP_PUT = 4 } httpd_method_t;
+typedef enum {
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_401_UNAUTHORIZED,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_405_METHOD_NOT_ALLOWED,
+    HTTPD_500_INTERNAL_SERVER_ERROR,
+} httpd_err_code_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    char uri[513];
+    size_t content_len;
+    void* aux;           // http_host request state
+    void* user_ctx;
+} httpd_req_t;
+
+typedef esp_err_t (*httpd_open_func_t)(httpd_handle_t hd, int sockfd);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+typedef bool (*httpd_uri_match_func_t)(const char* reference_uri, const char* uri_to_match, size_t match_upto);
+
+typedef struct {
+    unsigned task_priority;
+    size_t stack_size;
+    uint16_t server_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    bool lru_purge_enable;
+    bool keep_alive_enable;
+    httpd_open_func_t open_fn;
+    httpd_close_func_t close_fn;
+    httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() { 5, 4096, 80, 7, 8, false, false, NULL, NULL, NULL }
+
+typedef struct httpd_uri {
+    const char* uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t* r);
+    void* user_ctx;
+} httpd_uri_t;
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler);
+bool httpd_uri_match_wildcard(const char* template_uri, const char* uri_to_match, size_t match_upto);
+
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* r, const char* field, char* val, size_t val_size);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size);
+
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status);
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value);
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_err(httpd_req_t* req, httpd_err_code_t error, const char* msg);
+
+// ---- Harness side, common to both backends ----
+namespace idf {
+    void setLogLevel(esp_log_level_t level);   // Default ESP_LOG_WARN
+    int criticalNesting();                     // Critical sections the calling thread is in
+}
+
+#endif
@@ -0,0 +1,2 @@
+// IDF stand-in: see tools/idf/idf.h
+#include "idf.h"
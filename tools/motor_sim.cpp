@@ -0,0 +1,326 @@
+// Run the motor firmware (L298N driver, current PID, motion profiles, overcurrent
+// protection) against a simulated DC motor on the host, faster than real time.
+//
+// The unmodified sources in src/ are built against the IDF stand-in in
+// tools/idf with the simulation backend in tools/sim: virtual-time esp_timer
+// and FreeRTOS tasks, LEDC / MCPWM / GPIO pin levels, in-memory NVS and the ADC
+// DMA driver fed by the motor model (ACS712 + supply divider), read by the
+// adc_sampler task as on the device.
+//
+// Build (all host tools and their checks: tools/CMakeLists.txt):
+//     g++ -O2 -std=gnu++17 -pthread -Itools/idf/include -Itools/idf -Itools/sim -Isrc -o motor_sim tools/motor_sim.cpp tools/idf/idf.cpp tools/sim/*.cpp src/l298n.cpp src/adc_cal.cpp src/adc_filter.cpp src/adc_sampler.cpp src/voltage.cpp src/acs712.cpp src/power_meter.cpp src/energy.cpp src/motor_control.cpp src/motion.cpp src/protection.cpp
+//
+// Usage:
+//     motor_sim [options] current <mA>         current PID step response, rotor held
+//     motor_sim [options] profile <spec>       motion profile, e.g. "f:6191:300:1000,c:0:200:300"
+//     motor_sim [options] stall [jam_ms]       full duty, rotor jammed at jam_ms (default 1000)
+//
+// Options:
+//     --duration S    simulated seconds (default 2)
+//     --csv FILE|-    1 ms trace: t_ms, true/measured current, duty, ENA level, rpm, supply
+//     --seed N        ADC noise seed
+//     --noise CODES   ADC noise sigma (default 2)
+//     --load NM       Coulomb load torque (default 0.001; an unloaded motor only
+//                     draws ~0.3 A at full speed)
+//     --locked        rotor held at standstill from the start (always for current:
+//                     the current loop is checked as a locked-rotor test)
+//     --free          current: let the rotor turn. The target is held only when the
+//                     load torque reaches Kt * I (0.02 N*m per A); with less the
+//                     rotor speeds up until the bridge saturates and --check fails
+//                     saying so
+//     --pwm HZ        PWM frequency (default 150 Hz; current control raises it to
+//                     2 kHz when it starts, as on the device). The model is stepped
+//                     every 10 us, keep HZ at a few kHz at most
+//     --check         exit 1 when the scenario expectation fails
+//     --bench         report simulated time per wall-clock second
+//     --verbose       firmware INFO logs on stderr
+#include "sim.h"
+#include "motor_model.h"
+
+#include "acs712.h"
+#include "adc_cal.h"
+#include "adc_sampler.h"
+#include "l298n.h"
+#include "motion.h"
+#include "motor_control.h"
+#include "protection.h"
+#include "voltage.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const int64_t STEP_US = 10;
+static const int64_t SAMPLE_US = 1000;
+static const int64_t WARMUP_US = 50000;   // Filter chains full before the scenario starts
+static const size_t SETTLE_WINDOW = 20;    // 1 ms samples: 3 periods of the default PWM
+
+enum class Scenario { Current, Profile, Stall };
+
+struct Options {
+    Scenario scenario;
+    int32_t target_ma;
+    const char* spec;
+    int64_t jam_us;
+    double duration_s;
+    const char* csv;
+    uint32_t seed;
+    double noise;
+    double load_nm;
+    bool locked;
+    bool free;
+    uint32_t pwm_hz;
+    bool check;
+    bool bench;
+    bool verbose;
+};
+
+struct Results {
+    int64_t settle_us;         // Current: last time the 20 ms mean of the measurement left the band
+    double mean_true_ma;       // Current: second half of the run
+    double mean_measured_ma;
+    double peak_ma;
+    double final_rpm;
+    bool tripped;
+    int64_t trip_us;
+    int64_t zero_us;           // Stall: true current back to zero
+};
+
+static void usage(const char* name) {
+    fprintf(stderr,
+            "usage: %s [--duration S] [--csv FILE|-] [--seed N] [--noise CODES] [--load NM] [--locked] [--free] [--pwm HZ] [--check] [--bench] [--verbose]\n"
+            "          current <mA> | profile <spec> | stall [jam_ms]\n", name);
+}
+
+static bool parse_args(int argc, char** argv, Options* opt) {
+    *opt = { Scenario::Current, 0, nullptr, 1000000, 2.0, nullptr, 1, 2.0, -1.0, false, false, 0, false, false, false };
+    const char* scenario = nullptr;
+    const char* arg = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) opt->duration_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) opt->csv = argv[++i];
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) opt->seed = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--noise") == 0 && i + 1 < argc) opt->noise = atof(argv[++i]);
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) opt->load_nm = atof(argv[++i]);
+        else if (strcmp(argv[i], "--locked") == 0) opt->locked = true;
+        else if (strcmp(argv[i], "--free") == 0) opt->free = true;
+        else if (strcmp(argv[i], "--pwm") == 0 && i + 1 < argc) opt->pwm_hz = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--check") == 0) opt->check = true;
+        else if (strcmp(argv[i], "--bench") == 0) opt->bench = true;
+        else if (strcmp(argv[i], "--verbose") == 0) opt->verbose = true;
+        else if (!scenario) scenario = argv[i];
+        else if (!arg) arg = argv[i];
+        else return false;
+    }
+    if (!scenario || opt->duration_s <= 0) return false;
+    if (strcmp(scenario, "current") == 0 && arg) {
+        opt->scenario = Scenario::Current;
+        opt->target_ma = atoi(arg);
+        // Locked-rotor test: with a turning rotor the current settles at load / Kt,
+        // whatever the target, once the load torque is below Kt * target
+        if (!opt->free) opt->locked = true;
+    } else if (strcmp(scenario, "profile") == 0 && arg) {
+        opt->scenario = Scenario::Profile;
+        opt->spec = arg;
+    } else if (strcmp(scenario, "stall") == 0) {
+        opt->scenario = Scenario::Stall;
+        if (arg) opt->jam_us = (int64_t)atoi(arg) * 1000;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool start_scenario(const Options& opt, motion::Profile* profile) {
+    switch (opt.scenario) {
+    case Scenario::Current:
+        return motor_control::setTarget(opt.target_ma);
+    case Scenario::Profile:
+        if (!motion::parse(opt.spec, profile)) {
+            fprintf(stderr, "bad profile: %s\n", opt.spec);
+            return false;
+        }
+        return motion::start(*profile);
+    case Scenario::Stall:
+        motion::parse("f:8191:300:600000", profile);
+        return motion::start(*profile);
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, &opt)) {
+        usage(argv[0]);
+        return 2;
+    }
+    FILE* csv = nullptr;
+    if (opt.csv) {
+        csv = strcmp(opt.csv, "-") == 0 ? stdout : fopen(opt.csv, "w");
+        if (!csv) {
+            perror(opt.csv);
+            return 2;
+        }
+        fprintf(csv, "t_ms,true_ma,measured_ma,duty,ena,rpm,supply_mv,fault\n");
+    }
+
+    idf::setLogLevel(opt.verbose ? ESP_LOG_INFO : ESP_LOG_ERROR);
+    sim::MotorParams params = sim::defaultMotorParams();
+    if (opt.load_nm >= 0) params.load_nm = opt.load_nm;
+    sim::MotorModel model(params, { 8, 0, 1 });
+    model.setLocked(opt.locked);
+    sim::setAnalogSource(sim::MotorModel::analogSource, &model);
+    sim::setAdcNoise(opt.noise, opt.seed);
+
+    // Same order as app_main: calibration tables, sensors, driver, consumers, sampling
+    adc_sampler::init();
+    adc_cal::init();
+    voltage::init();
+    acs712::init();
+    l298n::init();
+    protection::init();
+    motor_control::init();
+    motion::init();
+    if (opt.pwm_hz && !motion::setPwm(opt.pwm_hz, l298n::pwmResolution())) {
+        fprintf(stderr, "PWM %u Hz rejected\n", (unsigned)opt.pwm_hz);
+        return 2;
+    }
+
+    const int64_t start_us = WARMUP_US;
+    const int64_t end_us = start_us + (int64_t)(opt.duration_s * 1e6);
+    const int64_t jam_at_us = start_us + opt.jam_us;
+    const double rad_to_rpm = 60.0 / (2 * M_PI);
+    motion::Profile profile = {};
+    bool started = false;
+    bool jammed = false;
+
+    Results res = { -1, 0, 0, 0, 0, false, -1, -1 };
+    double sum_true = 0, sum_measured = 0, ms_current = 0, ms_ena = 0;
+    uint32_t averaged = 0, ms_steps = 0;
+    int32_t window[SETTLE_WINDOW] = {};
+    size_t window_count = 0;
+
+    auto wall_start = std::chrono::steady_clock::now();
+    for (int64_t t = 0; t < end_us; t += STEP_US) {
+        if (!started && t >= start_us) {
+            started = true;
+            if (!start_scenario(opt, &profile)) {
+                fprintf(stderr, "scenario did not start\n");
+                return 1;
+            }
+        }
+        if (opt.scenario == Scenario::Stall && !jammed && t >= jam_at_us) {
+            jammed = true;
+            model.setLocked(true);
+        }
+
+        model.step(STEP_US * 1e-6);
+        sim::advanceTo(t + STEP_US);
+        sim::pollAdc();
+
+        const sim::MotorState& s = model.state();
+        ms_current += s.current_a * 1000.0;
+        ms_ena += s.driven ? 1 : 0;
+        ms_steps++;
+        if (fabs(s.current_a * 1000.0) > res.peak_ma) res.peak_ma = fabs(s.current_a * 1000.0);
+
+        protection::Status prot = protection::getStatus();
+        if (prot.fault && !res.tripped) {
+            res.tripped = true;
+            res.trip_us = prot.trip_time_us;
+        }
+        if (res.tripped && res.zero_us < 0 && s.current_a == 0.0) res.zero_us = t + STEP_US;
+
+        if ((t + STEP_US) % SAMPLE_US != 0) continue;
+        double true_ma = ms_current / ms_steps;
+        int32_t measured = acs712::readMilliamps();
+        if (csv) {
+            fprintf(csv, "%.0f,%.1f,%d,%u,%.3f,%.0f,%d,%d\n",
+                    (t + STEP_US) / 1000.0, true_ma, (int)measured, (unsigned)l298n::getDuty(),
+                    ms_ena / ms_steps, s.omega * rad_to_rpm, (int)model.dividerMv() * 5, prot.fault ? 1 : 0);
+        }
+        ms_current = ms_ena = 0;
+        ms_steps = 0;
+
+        if (t < start_us) continue;
+        if (opt.scenario == Scenario::Current) {
+            window[window_count++ % SETTLE_WINDOW] = measured;
+            // The filter window (12.8 ms) beats with the 150 Hz PWM: a ~160 ms swing of
+            // the 20 ms mean, up to ~85 mA at any target with the rotor held
+            int32_t band = abs(opt.target_ma) / 10 > 100 ? abs(opt.target_ma) / 10 : 100;
+            int32_t mean = 0;
+            size_t n = window_count < SETTLE_WINDOW ? window_count : SETTLE_WINDOW;
+            for (size_t i = 0; i < n; i++) mean += window[i];
+            mean /= (int32_t)n;
+            if (n < SETTLE_WINDOW || abs(mean - opt.target_ma) > band) res.settle_us = t + STEP_US - start_us;
+            if (t >= start_us + (end_us - start_us) / 2) {
+                sum_true += true_ma;
+                sum_measured += measured;
+                averaged++;
+            }
+        }
+    }
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    if (csv && csv != stdout) fclose(csv);
+
+    res.final_rpm = model.state().omega * rad_to_rpm;
+    if (averaged) {
+        res.mean_true_ma = sum_true / averaged;
+        res.mean_measured_ma = sum_measured / averaged;
+    }
+
+    bool ok = true;
+    FILE* out = csv == stdout ? stderr : stdout;
+    protection::Status prot = protection::getStatus();
+    switch (opt.scenario) {
+    case Scenario::Current: {
+        motor_control::Telemetry tm = motor_control::getTelemetry();
+        fprintf(out, "current %d mA: settled after %.1f ms, second half true %.0f mA / measured %.0f mA, "
+                "duty %u, %.0f rpm, %u loops\n",
+                (int)opt.target_ma, res.settle_us < 0 ? 0.0 : res.settle_us / 1000.0,
+                res.mean_true_ma, res.mean_measured_ma, (unsigned)tm.duty, res.final_rpm, (unsigned)tm.loops);
+        double tolerance = fabs(opt.target_ma) * 0.05 > 50 ? fabs(opt.target_ma) * 0.05 : 50;
+        ok = !res.tripped && res.settle_us < (end_us - start_us) / 2 &&
+             fabs(res.mean_true_ma - opt.target_ma) <= tolerance;
+        double hold_nm = params.ke * fabs(opt.target_ma) / 1000.0;
+        if (!opt.locked && params.load_nm < hold_nm) {
+            fprintf(out, "free rotor: load %.3f N*m < Kt * I = %.3f N*m, the target cannot be held "
+                    "(use the default locked rotor or --load)\n", params.load_nm, hold_nm);
+            ok = false;
+        }
+        break;
+    }
+    case Scenario::Profile: {
+        motion::Status st = motion::getStatus(nullptr);
+        fprintf(out, "profile: %u steps done, %s, peak %.0f mA, %.0f rpm, timer late max %d us\n",
+                (unsigned)st.steps_done, st.running ? "running" : "finished", res.peak_ma, res.final_rpm,
+                (int)st.max_late_us);
+        ok = !res.tripped && st.steps_done >= profile.count;
+        break;
+    }
+    case Scenario::Stall:
+        if (res.tripped) {
+            fprintf(out, "stall: jam at %.1f ms, trip %.3f ms later (detect %u us), current zero %.3f ms after trip, "
+                    "peak %.0f mA\n",
+                    (jam_at_us - start_us) / 1000.0, (res.trip_us - jam_at_us) / 1000.0, (unsigned)prot.detect_us,
+                    res.zero_us < 0 ? -1.0 : (res.zero_us - res.trip_us) / 1000.0, res.peak_ma);
+        } else {
+            fprintf(out, "stall: no trip, peak %.0f mA\n", res.peak_ma);
+        }
+        ok = res.tripped && res.trip_us >= jam_at_us && res.trip_us - jam_at_us < 5000 &&
+             res.zero_us >= 0 && res.zero_us - res.trip_us < 20000 && l298n::isInhibited();
+        break;
+    }
+    if (opt.bench) {
+        double sim_s = end_us / 1e6;
+        fprintf(out, "bench: %.2f s simulated in %.3f s wall (%.1fx real time), %llu timer callbacks\n",
+                sim_s, wall_s, sim_s / wall_s, (unsigned long long)sim::timerCallbacks());
+    }
+    if (opt.check) {
+        fprintf(out, "check: %s\n", ok ? "PASS" : "FAIL");
+        return ok ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Pack a directory of static files into a `www` partition image.
+
+Every file is gzip-compressed (deterministically, mtime=0) and stored with
+its content type and a strong ETag derived from the compressed payload.
+The layout must match src/static_files.cpp:
+
+    header:  magic "WWW1", u32 count, u32 image_size, u32 reserved
+    entries: count x { char path[64], char type[32], char etag[20],
+                       u32 offset, u32 size, u32 reserved }
+    data:    gzip payloads, 4-byte aligned
+
+Usage: pack_www.py <source_dir> <output.bin> [partition_size]
+"""
+import gzip
+import hashlib
+import mimetypes
+import os
+import struct
+import sys
+
+MAGIC = b"WWW1"
+HEADER = struct.Struct("<4sIII")
+ENTRY = struct.Struct("<64s32s20sIII")
+
+TYPES = {
+    ".html": "text/html",
+    ".js": "application/javascript",
+    ".css": "text/css",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".png": "image/png",
+}
+
+
+def content_type(path):
+    ext = os.path.splitext(path)[1].lower()
+    return TYPES.get(ext) or mimetypes.guess_type(path)[0] or "application/octet-stream"
+
+
+def collect(source_dir):
+    files = []
+    for root, _, names in os.walk(source_dir):
+        for name in sorted(names):
+            full = os.path.join(root, name)
+            rel = "/" + os.path.relpath(full, source_dir).replace(os.sep, "/")
+            if len(rel) >= 64:
+                sys.exit(f"path too long (max 63 bytes): {rel}")
+            with open(full, "rb") as f:
+                data = gzip.compress(f.read(), compresslevel=9, mtime=0)
+            etag = '"' + hashlib.sha256(data).hexdigest()[:16] + '"'
+            files.append((rel, content_type(rel), etag, data))
+    return sorted(files)
+
+
+def align4(n):
+    return (n + 3) & ~3
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.exit(__doc__)
+    source_dir, output = sys.argv[1], sys.argv[2]
+    limit = int(sys.argv[3], 0) if len(sys.argv) == 4 else None
+
+    files = collect(source_dir)
+    offset = HEADER.size + ENTRY.size * len(files)
+    entries, blobs = [], []
+    for path, ctype, etag, data in files:
+        offset = align4(offset)
+        entries.append(ENTRY.pack(path.encode(), ctype.encode(), etag.encode(), offset, len(data), 0))
+        blobs.append((offset, data))
+        offset += len(data)
+    image_size = align4(offset)
+
+    if limit is not None and image_size > limit:
+        sys.exit(f"image is {image_size} bytes, partition holds {limit}")
+
+    image = bytearray(image_size)
+    image[0:HEADER.size] = HEADER.pack(MAGIC, len(files), image_size, 0)
+    pos = HEADER.size
+    for entry in entries:
+        image[pos:pos + ENTRY.size] = entry
+        pos += ENTRY.size
+    for start, data in blobs:
+        image[start:start + len(data)] = data
+
+    with open(output, "wb") as f:
+        f.write(image)
+    print(f"www image: {len(files)} files, {image_size} bytes -> {output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,57 @@
+"""PlatformIO extra script: pack www/ and flash it with the firmware.
+
+The ESP-IDF CMake target in src/CMakeLists.txt (www_image +
+esptool_py_flash_to_partition) only runs under idf.py; PlatformIO builds
+with SCons and would never write the `www` partition. This script packs
+www/ into $BUILD_DIR/www.bin with tools/pack_www.py as part of the build and
+adds it to FLASH_EXTRA_IMAGES at the offset of the `www` entry in the
+partition table, so `pio run -t upload` writes it next to the app.
+
+`pio run -t uploadwww` flashes only the www partition (dashboard changes
+without reflashing the firmware).
+
+Enabled in platformio.ini as `extra_scripts = pre:tools/pio_www.py`: it has
+to run before the platform builder turns FLASH_EXTRA_IMAGES into esptool
+arguments.
+"""
+import csv
+import os
+
+Import("env")  # noqa: F821 - provided by PlatformIO
+
+PARTITION = "www"
+
+
+def partition_entry(table, name):
+    with open(table, newline="") as f:
+        for row in csv.reader(f):
+            fields = [field.strip() for field in row]
+            if fields and not fields[0].startswith("#") and fields[0] == name:
+                return int(fields[3], 0), int(fields[4], 0)
+    raise SystemExit(f"{table}: no '{name}' partition")
+
+
+project_dir = env.subst("$PROJECT_DIR")  # noqa: F821
+table = os.path.join(project_dir, env.GetProjectOption("board_build.partitions"))  # noqa: F821
+offset, size = partition_entry(table, PARTITION)
+
+www_dir = os.path.join(project_dir, "www")
+packer = os.path.join(project_dir, "tools", "pack_www.py")
+image = os.path.join(env.subst("$BUILD_DIR"), "www.bin")  # noqa: F821
+
+sources = [os.path.join(root, name) for root, _, names in os.walk(www_dir) for name in names]
+www_bin = env.Command(  # noqa: F821
+    image, sources + [packer],
+    f'"$PYTHONEXE" "{packer}" "{www_dir}" "$TARGET" {size:#x}')
+env.Default(www_bin)  # noqa: F821
+env.Depends(env.Alias("upload"), www_bin)  # noqa: F821
+
+env.Append(FLASH_EXTRA_IMAGES=[(f"{offset:#x}", image)])  # noqa: F821
+
+env.AddCustomTarget(  # noqa: F821
+    name="uploadwww",
+    dependencies=www_bin,
+    actions=[f'"$PYTHONEXE" "$UPLOADER" --chip esp32c6 --port "$UPLOAD_PORT" --baud $UPLOAD_SPEED '
+             f'write_flash {offset:#x} "{image}"'],
+    title="Upload www",
+    description=f"Flash {PARTITION} partition ({offset:#x}, {size:#x} bytes)")
@@ -0,0 +1,95 @@
+#include "motor_model.h"
+#include "sim.h"
+
+#include <cmath>
+
+namespace sim {
+    // Same front end as the firmware: acs712.cpp and the adc_cal defaults
+    static const adc_channel_t DIVIDER_CHANNEL = ADC_CHANNEL_4;
+    static const adc_channel_t CURRENT_CHANNEL = ADC_CHANNEL_5;
+    static const double ACS712_ZERO_MV = 1650.0;
+    static const double ACS712_MV_PER_A = 66.0;
+    static const double DIVIDER_R1 = 30000.0;
+    static const double DIVIDER_R2 = 7500.0;
+
+    MotorParams defaultMotorParams() {
+        MotorParams p;
+        p.r_ohm = 2.5;
+        p.l_h = 0.005;
+        p.ke = 0.02;
+        p.j = 2e-5;
+        p.b = 1e-5;
+        p.load_nm = 0.001;
+        p.battery_v = 12.8;
+        p.battery_r_ohm = 0.05;
+        p.bridge_drop_v = 2.0;
+        p.diode_drop_v = 0.7;
+        return p;
+    }
+
+    MotorModel::MotorModel(const MotorParams& params, const MotorPins& pins)
+        : params_(params), pins_(pins), state_{ 0.0, 0.0, params.battery_v, false }, locked_(false) {}
+
+    void MotorModel::step(double dt_s) {
+        const MotorParams& p = params_;
+        double i = state_.current_a;
+        double emf = p.ke * state_.omega;
+        bool ena = pinLevel(pins_.ena) != 0;
+        int dir = pinLevel(pins_.in1) - pinLevel(pins_.in2);
+
+        double di;
+        if (ena && dir != 0) {
+            // Both switches on: the winding sees the supply minus the bridge drop
+            double supply = p.battery_v - p.battery_r_ohm * std::fabs(i);
+            di = (dir * (supply - p.bridge_drop_v) - p.r_ohm * i - emf) / p.l_h;
+            state_.supply_v = supply;
+        } else if (ena) {
+            // IN1 == IN2: both low (or high) side switches on - brake
+            di = (-p.r_ohm * i - emf) / p.l_h;
+            state_.supply_v = p.battery_v;
+        } else if (i != 0.0) {
+            // Outputs off: fast decay through the free-wheel diodes back into the
+            // supply until the current reaches zero
+            double back = p.battery_v + 2 * p.diode_drop_v;
+            di = (-(i > 0 ? back : -back) - p.r_ohm * i - emf) / p.l_h;
+            state_.supply_v = p.battery_v + p.battery_r_ohm * std::fabs(i);
+        } else {
+            di = 0.0;
+            state_.supply_v = p.battery_v;
+        }
+        double next = i + di * dt_s;
+        // Diodes block: the decaying current stops at zero instead of reversing
+        if (!ena && i != 0.0 && (next > 0) != (i > 0)) next = 0.0;
+        state_.current_a = next;
+        state_.driven = ena;
+
+        if (locked_) {
+            state_.omega = 0.0;
+            return;
+        }
+        double torque = p.ke * i;
+        double omega = state_.omega;
+        if (omega == 0.0 && std::fabs(torque) <= p.load_nm) return;   // Static friction holds
+        double moving = omega != 0.0 ? omega : torque;
+        double friction = p.b * omega + (moving > 0 ? p.load_nm : -p.load_nm);
+        double next_omega = omega + (torque - friction) / p.j * dt_s;
+        // Friction alone never reverses the rotor
+        if (omega != 0.0 && (next_omega > 0) != (omega > 0) && std::fabs(torque) <= p.load_nm) next_omega = 0.0;
+        state_.omega = next_omega;
+    }
+
+    int32_t MotorModel::currentSensorMv() const {
+        return (int32_t)lround(ACS712_ZERO_MV + ACS712_MV_PER_A * state_.current_a);
+    }
+
+    int32_t MotorModel::dividerMv() const {
+        return (int32_t)lround(state_.supply_v * 1000.0 * DIVIDER_R2 / (DIVIDER_R1 + DIVIDER_R2));
+    }
+
+    int32_t MotorModel::analogSource(adc_channel_t channel, int64_t, void* ctx) {
+        const MotorModel* model = static_cast<const MotorModel*>(ctx);
+        if (channel == CURRENT_CHANNEL) return model->currentSensorMv();
+        if (channel == DIVIDER_CHANNEL) return model->dividerMv();
+        return 0;
+    }
+}
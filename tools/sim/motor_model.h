@@ -0,0 +1,71 @@
+// Brushed DC motor behind one L298N bridge, driven by the simulated pin levels
+// (sim::pinLevel) of ENA / IN1 / IN2, plus the analog front end the firmware
+// reads back: ACS712-30A on ADC channel 5 and the R1/R2 supply divider on
+// channel 4.
+#ifndef MOTOR_MODEL_H
+#define MOTOR_MODEL_H
+
+#include "idf.h"
+#include <cstdint>
+
+namespace sim {
+    struct MotorParams {
+        double r_ohm;            // Winding resistance
+        double l_h;              // Winding inductance
+        double ke;               // Back-EMF constant, V*s/rad (= Kt, N*m/A)
+        double j;                // Rotor + load inertia, kg*m^2
+        double b;                // Viscous friction, N*m*s/rad
+        double load_nm;          // Coulomb load torque, opposes rotation
+        double battery_v;        // Open-circuit supply
+        double battery_r_ohm;    // Supply internal resistance
+        double bridge_drop_v;    // L298N saturation drop, both switches
+        double diode_drop_v;     // Free-wheel diode drop, per diode
+    };
+
+    // 12 V gear motor whose stall current (~4.3 A at full duty) is above the
+    // default protection trip and whose no-load current is ~0.1 A
+    MotorParams defaultMotorParams();
+
+    struct MotorPins {
+        int ena;
+        int in1;
+        int in2;
+    };
+
+    struct MotorState {
+        double current_a;        // Signed, positive with IN1 high / IN2 low
+        double omega;            // rad/s
+        double supply_v;         // Battery terminal voltage
+        bool driven;             // ENA high in the last step
+    };
+
+    class MotorModel {
+    public:
+        MotorModel(const MotorParams& params, const MotorPins& pins);
+
+        // One explicit Euler step with the bridge state sampled at its start
+        void step(double dt_s);
+
+        // Rotor held at standstill (stall / jam) while set
+        void setLocked(bool locked) { locked_ = locked; }
+        void setLoad(double load_nm) { params_.load_nm = load_nm; }
+
+        const MotorState& state() const { return state_; }
+        const MotorParams& params() const { return params_; }
+
+        // Pin voltages seen by the ADC, mV
+        int32_t currentSensorMv() const;
+        int32_t dividerMv() const;
+
+        // sim::AnalogSource over the two channels above, ctx = MotorModel*
+        static int32_t analogSource(adc_channel_t channel, int64_t t_us, void* ctx);
+
+    private:
+        MotorParams params_;
+        MotorPins pins_;
+        MotorState state_;
+        bool locked_;
+    };
+}
+
+#endif
@@ -0,0 +1,1046 @@
+// Virtual-time backend of the IDF stand-in (see tools/idf/idf.h and sim.h):
+// esp_timer, a cooperative FreeRTOS scheduler, LEDC / MCPWM / GPIO pin levels,
+// the ADC DMA driver with its digital monitor, in-memory NVS.
+#include "sim.h"
+
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int64_t clock_us = 0;
+static uint64_t callbacks = 0;
+
+static void run_ready();
+static bool step(int64_t limit_us);
+
+// ---- Tasks ----
+//
+// Each task is a host thread, but only one context runs at a time: the harness
+// (the main thread, also where esp_timer and driver callbacks run) or a single
+// task. A task runs from a scheduling point until it blocks or returns, there
+// is no preemption. Scheduling points on the harness side: a timer callback or
+// a task timeout in advanceTo(), driver callbacks in pollAdc(), xTaskCreate,
+// xTaskNotifyGive and xSemaphoreGive outside critical sections, and every
+// blocking call - the harness then runs tasks and advances the clock event by
+// event until the call returns. Ready tasks run highest priority first.
+
+struct sim_task_exit {};   // vTaskDelete(NULL) unwinds the task function
+
+struct idf_task {
+    TaskFunction_t fn;
+    void* arg;
+    std::string name;
+    UBaseType_t priority;
+    bool ready;
+    bool done;
+    int64_t wake_us;              // Timeout of the blocking call, -1 - none
+    uint32_t notified;            // Notification value
+    bool waiting_notify;
+    idf_semaphore* waiting_sem;
+    std::condition_variable cv;
+};
+
+struct idf_semaphore {
+    uint32_t count;
+    uint32_t max;
+};
+
+// Leaked: task threads blocked for good still wait on them at exit
+static std::mutex& sched_lock = *new std::mutex;
+static std::condition_variable& harness_cv = *new std::condition_variable;
+static std::vector<idf_task*> tasks;
+static idf_task* running_task = nullptr;    // nullptr - the harness runs
+static thread_local idf_task* self = nullptr;
+
+static void task_main(idf_task* t) {
+    self = t;
+    {
+        std::unique_lock<std::mutex> lock(sched_lock);
+        t->cv.wait(lock, [t] { return running_task == t; });
+    }
+    try {
+        t->fn(t->arg);
+    } catch (const sim_task_exit&) {
+    }
+    std::lock_guard<std::mutex> lock(sched_lock);
+    t->done = true;
+    t->ready = false;
+    running_task = nullptr;
+    harness_cv.notify_one();
+}
+
+// Harness side: the task runs until it blocks or ends
+static void run_task(idf_task* t) {
+    std::unique_lock<std::mutex> lock(sched_lock);
+    running_task = t;
+    t->cv.notify_one();
+    harness_cv.wait(lock, [] { return running_task == nullptr; });
+}
+
+static void run_ready() {
+    if (self || idf::criticalNesting() > 0) return;
+    while (true) {
+        idf_task* next = nullptr;
+        for (idf_task* t : tasks) {
+            if (t->ready && (!next || t->priority > next->priority)) next = t;
+        }
+        if (!next) break;
+        run_task(next);
+    }
+}
+
+// Task side: blocks until woken or until wake_us (-1 - no timeout)
+static void block(int64_t wake_us) {
+    idf_task* t = self;
+    t->ready = false;
+    t->wake_us = wake_us;
+    std::unique_lock<std::mutex> lock(sched_lock);
+    running_task = nullptr;
+    harness_cv.notify_one();
+    t->cv.wait(lock, [t] { return running_task == t; });
+}
+
+static void wake(idf_task* t) {
+    t->ready = true;
+    t->wake_us = -1;
+    t->waiting_notify = false;
+    t->waiting_sem = nullptr;
+}
+
+static int64_t deadline_after(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? -1 : clock_us + (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+// Harness side of a blocking call: tasks and events run until done() holds
+// or the deadline (-1 - none) passes
+template <typename Done>
+static bool harness_wait(Done done, int64_t deadline) {
+    while (true) {
+        run_ready();
+        if (done()) return true;
+        if (!step(deadline < 0 ? INT64_MAX : deadline)) break;
+    }
+    if (deadline < 0) {
+        fprintf(stderr, "sim: the harness waits forever, no task or timer left to wake it\n");
+        abort();
+    }
+    if (deadline > clock_us) clock_us = deadline;
+    return done();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t, void* arg, UBaseType_t priority,
+                       TaskHandle_t* handle) {
+    idf_task* t = new idf_task();
+    t->fn = fn;
+    t->arg = arg;
+    t->name = name ? name : "";
+    t->priority = priority;
+    t->ready = true;
+    t->wake_us = -1;
+    tasks.push_back(t);
+    if (handle) *handle = t;
+    std::thread(task_main, t).detach();
+    run_ready();
+    return pdPASS;
+}
+
+// Another task is only marked done: its thread stays parked until exit
+void vTaskDelete(TaskHandle_t task) {
+    if (!task || task == self) {
+        if (!self) {
+            fprintf(stderr, "sim: vTaskDelete(NULL) outside a task\n");
+            abort();
+        }
+        throw sim_task_exit();
+    }
+    task->done = true;
+    task->ready = false;
+    task->wake_us = -1;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (self) block(clock_us + (int64_t)ticks * portTICK_PERIOD_MS * 1000);
+    else harness_wait([] { return false; }, clock_us + (int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment) {
+    *previous_wake += increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*previous_wake - now) > 0) vTaskDelay(*previous_wake - now);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(clock_us / 1000 / portTICK_PERIOD_MS);
+}
+
+static void notify(idf_task* t) {
+    t->notified++;
+    if (t->waiting_notify) wake(t);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    notify(task);
+    run_ready();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    notify(task);
+    if (woken) *woken = task->ready ? pdTRUE : pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+    if (!self) {
+        fprintf(stderr, "sim: ulTaskNotifyTake outside a task\n");
+        abort();
+    }
+    if (self->notified == 0 && wait > 0) {
+        self->waiting_notify = true;
+        block(deadline_after(wait));
+        self->waiting_notify = false;
+    }
+    uint32_t value = self->notified;
+    if (value) self->notified = clear ? 0 : value - 1;
+    return value;
+}
+
+// Mutexes are binary semaphores given once at creation: no owner, no
+// priority inheritance
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return new idf_semaphore{ 1, 1 };
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return new idf_semaphore{ 0, 1 };
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+    if (sem->count == 0 && wait > 0) {
+        int64_t deadline = deadline_after(wait);
+        if (!self) {
+            harness_wait([sem] { return sem->count > 0; }, deadline);
+        } else {
+            while (sem->count == 0 && (deadline < 0 || clock_us < deadline)) {
+                self->waiting_sem = sem;
+                block(deadline);
+                self->waiting_sem = nullptr;
+            }
+        }
+    }
+    if (sem->count == 0) return pdFALSE;
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (sem->count == sem->max) return pdFALSE;
+    sem->count++;
+    idf_task* waiter = nullptr;
+    for (idf_task* t : tasks) {
+        if (t->waiting_sem == sem && (!waiter || t->priority > waiter->priority)) waiter = t;
+    }
+    if (waiter) wake(waiter);
+    run_ready();
+    return pdTRUE;
+}
+
+// ---- esp_timer ----
+
+struct sim_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::string name;
+    bool active;
+    int64_t deadline;
+    uint64_t period;     // 0 - one-shot
+};
+
+static std::vector<sim_timer*> timers;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+    sim_timer* t = new sim_timer{ args->callback, args->arg, args->name ? args->name : "", false, 0, 0 };
+    timers.push_back(t);
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->active = true;
+    timer->deadline = clock_us + (int64_t)timeout_us;
+    timer->period = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->active = true;
+    timer->deadline = clock_us + (int64_t)period_us;
+    timer->period = period_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer->active) return ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    for (size_t i = 0; i < timers.size(); i++) {
+        if (timers[i] == timer) timers.erase(timers.begin() + i);
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    return timer->active;
+}
+
+int64_t esp_timer_get_time(void) {
+    return clock_us;
+}
+
+uint32_t esp_cpu_get_cycle_count(void) {
+    return (uint32_t)(clock_us * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+}
+
+// ---- GPIO routing ----
+
+enum class Route { Gpio, Ledc, Mcpwm };
+
+struct Pin {
+    Route route;
+    int source;          // LEDC channel / MCPWM generator index
+    int level;
+};
+
+static Pin pins[GPIO_PIN_COUNT];
+
+static bool valid_pin(int gpio) {
+    return gpio >= 0 && gpio < GPIO_PIN_COUNT;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t) {
+    return valid_pin(gpio) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level) {
+    if (!valid_pin(gpio)) return ESP_ERR_INVALID_ARG;
+    pins[gpio].level = level ? 1 : 0;
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio) {
+    if (!valid_pin(gpio)) return ESP_ERR_INVALID_ARG;
+    pins[gpio] = Pin{ Route::Gpio, 0, 0 };
+    return ESP_OK;
+}
+
+void gpio_ll_set_level(gpio_dev_t*, uint32_t gpio, uint32_t level) {
+    if (valid_pin((int)gpio)) pins[gpio].level = level ? 1 : 0;
+}
+
+void esp_rom_gpio_connect_out_signal(uint32_t gpio, uint32_t signal, bool, bool) {
+    if (valid_pin((int)gpio) && signal == SIG_GPIO_OUT_IDX) pins[gpio].route = Route::Gpio;
+}
+
+// ---- LEDC ----
+
+struct LedcTimer {
+    uint32_t freq_hz;
+    uint32_t bits;
+};
+
+struct LedcChannel {
+    bool configured;
+    bool stopped;
+    int idle_level;
+    ledc_timer_t timer;
+    uint32_t duty;         // Applied duty (fade start value while fading)
+    uint32_t pending;
+    uint32_t hpoint;
+    uint32_t pending_hpoint;
+    bool fading;
+    uint32_t fade_target;
+    int64_t fade_start_us;
+    int64_t fade_end_us;
+};
+
+static LedcTimer ledc_timers[4];
+static LedcChannel ledc_channels[LEDC_CHANNEL_MAX];
+static const uint64_t LEDC_SOURCE_CLOCK_HZ = 80000000;
+
+static bool valid_channel(ledc_channel_t channel) {
+    return channel >= LEDC_CHANNEL_0 && channel < LEDC_CHANNEL_MAX;
+}
+
+static uint32_t ledc_current_duty(const LedcChannel& ch) {
+    if (!ch.fading) return ch.duty;
+    if (clock_us >= ch.fade_end_us) return ch.fade_target;
+    int64_t span = ch.fade_end_us - ch.fade_start_us;
+    int64_t delta = (int64_t)ch.fade_target - ch.duty;
+    return (uint32_t)(ch.duty + delta * (clock_us - ch.fade_start_us) / span);
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t* config) {
+    if (config->timer_num > LEDC_TIMER_3 || config->freq_hz == 0) return ESP_ERR_INVALID_ARG;
+    uint32_t bits = config->duty_resolution;
+    if (bits < 1 || bits > 20 || ((uint64_t)config->freq_hz << bits) > LEDC_SOURCE_CLOCK_HZ) {
+        idf_log(ESP_LOG_ERROR, "ledc", "requested frequency %u and duty resolution %u cannot be achieved",
+                (unsigned)config->freq_hz, (unsigned)bits);
+        return ESP_FAIL;
+    }
+    ledc_timers[config->timer_num] = { config->freq_hz, bits };
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t* config) {
+    if (!valid_channel(config->channel) || !valid_pin(config->gpio_num)) return ESP_ERR_INVALID_ARG;
+    LedcChannel& ch = ledc_channels[config->channel];
+    ch = LedcChannel{};
+    ch.configured = true;
+    ch.timer = config->timer_sel;
+    ch.duty = ch.pending = config->duty;
+    ch.hpoint = ch.pending_hpoint = config->hpoint;
+    pins[config->gpio_num].route = Route::Ledc;
+    pins[config->gpio_num].source = config->channel;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty_with_hpoint(ledc_mode_t, ledc_channel_t channel, uint32_t duty, uint32_t hpoint) {
+    if (!valid_channel(channel)) return ESP_ERR_INVALID_ARG;
+    ledc_channels[channel].pending = duty;
+    ledc_channels[channel].pending_hpoint = hpoint;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty) {
+    if (!valid_channel(channel)) return ESP_ERR_INVALID_ARG;
+    return ledc_set_duty_with_hpoint(mode, channel, duty, ledc_channels[channel].pending_hpoint);
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t, ledc_channel_t channel) {
+    if (!valid_channel(channel)) return ESP_ERR_INVALID_ARG;
+    LedcChannel& ch = ledc_channels[channel];
+    ch.fading = false;
+    ch.stopped = false;
+    ch.duty = ch.pending;
+    ch.hpoint = ch.pending_hpoint;
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t, ledc_channel_t channel) {
+    return valid_channel(channel) ? ledc_current_duty(ledc_channels[channel]) : 0;
+}
+
+esp_err_t ledc_stop(ledc_mode_t, ledc_channel_t channel, uint32_t idle_level) {
+    if (!valid_channel(channel)) return ESP_ERR_INVALID_ARG;
+    ledc_channels[channel].stopped = true;
+    ledc_channels[channel].idle_level = idle_level ? 1 : 0;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int) {
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms) {
+    if (!valid_channel(channel) || max_fade_time_ms < 0) return ESP_ERR_INVALID_ARG;
+    LedcChannel& ch = ledc_channels[channel];
+    ch.duty = ledc_current_duty(ch);
+    ch.fade_target = target_duty;
+    ch.fade_start_us = clock_us;
+    ch.fade_end_us = clock_us + (int64_t)max_fade_time_ms * 1000;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t, ledc_channel_t channel, ledc_fade_mode_t) {
+    if (!valid_channel(channel)) return ESP_ERR_INVALID_ARG;
+    LedcChannel& ch = ledc_channels[channel];
+    ch.fading = ch.fade_end_us > ch.fade_start_us;
+    if (!ch.fading) ch.duty = ch.fade_target;
+    ch.stopped = false;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t, ledc_channel_t channel) {
+    if (!valid_channel(channel)) return ESP_ERR_INVALID_ARG;
+    LedcChannel& ch = ledc_channels[channel];
+    ch.duty = ch.pending = ledc_current_duty(ch);
+    ch.fading = false;
+    return ESP_OK;
+}
+
+static int ledc_level(int channel) {
+    const LedcChannel& ch = ledc_channels[channel];
+    if (!ch.configured) return 0;
+    if (ch.stopped) return ch.idle_level;
+    const LedcTimer& t = ledc_timers[ch.timer];
+    if (t.freq_hz == 0) return 0;
+    uint64_t counts = 1ull << t.bits;
+    uint64_t pos = (uint64_t)clock_us * t.freq_hz * counts / 1000000 % counts;
+    uint32_t duty = ledc_current_duty(ch);
+    return pos >= ch.hpoint && pos < (uint64_t)ch.hpoint + duty ? 1 : 0;
+}
+
+// ---- MCPWM ----
+
+struct sim_mcpwm_timer {
+    uint32_t resolution_hz;
+    uint32_t period;
+    uint32_t phase;
+    bool running;
+};
+
+struct sim_mcpwm_oper {
+    sim_mcpwm_timer* timer;
+};
+
+struct sim_mcpwm_cmpr {
+    sim_mcpwm_oper* oper;
+    uint32_t value;
+};
+
+struct sim_mcpwm_gen {
+    sim_mcpwm_oper* oper;
+    sim_mcpwm_cmpr* cmpr;
+    int gpio;
+    int force;           // -1 - none
+    sim_mcpwm_gen* source;   // Dead-time copy of another generator
+    bool invert;
+};
+
+struct sim_mcpwm_sync {
+    sim_mcpwm_timer* timer;
+};
+
+static const size_t MCPWM_UNITS = 3;
+static std::vector<sim_mcpwm_gen*> generators;
+static size_t mcpwm_timer_count = 0;
+static size_t mcpwm_oper_count = 0;
+
+esp_err_t mcpwm_new_timer(const mcpwm_timer_config_t* config, mcpwm_timer_handle_t* out) {
+    if (mcpwm_timer_count == MCPWM_UNITS) return ESP_ERR_NOT_FOUND;
+    if (config->period_ticks < 2 || config->period_ticks > 65535 || config->resolution_hz == 0) return ESP_ERR_INVALID_ARG;
+    mcpwm_timer_count++;
+    *out = new sim_mcpwm_timer{ config->resolution_hz, config->period_ticks, 0, false };
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_timer(mcpwm_timer_handle_t timer) {
+    delete timer;
+    mcpwm_timer_count--;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_enable(mcpwm_timer_handle_t) {
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_disable(mcpwm_timer_handle_t) {
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_timer_start_stop(mcpwm_timer_handle_t timer, mcpwm_timer_start_stop_cmd_t cmd) {
+    timer->running = cmd == MCPWM_TIMER_START_NO_STOP;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_timer_sync_src(mcpwm_timer_handle_t timer, const mcpwm_timer_sync_src_config_t*, mcpwm_sync_handle_t* out) {
+    *out = new sim_mcpwm_sync{ timer };
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_sync_src(mcpwm_sync_handle_t sync) {
+    delete sync;
+    return ESP_OK;
+}
+
+// All timers share one time base here, so the phase is simply a counter offset
+esp_err_t mcpwm_timer_set_phase_on_sync(mcpwm_timer_handle_t timer, const mcpwm_timer_sync_phase_config_t* config) {
+    if (config->count_value >= timer->period) return ESP_ERR_INVALID_ARG;
+    timer->phase = config->count_value;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_operator(const mcpwm_operator_config_t*, mcpwm_oper_handle_t* out) {
+    if (mcpwm_oper_count == MCPWM_UNITS) return ESP_ERR_NOT_FOUND;
+    mcpwm_oper_count++;
+    *out = new sim_mcpwm_oper{ nullptr };
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_operator(mcpwm_oper_handle_t oper) {
+    delete oper;
+    mcpwm_oper_count--;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_operator_connect_timer(mcpwm_oper_handle_t oper, mcpwm_timer_handle_t timer) {
+    oper->timer = timer;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_comparator(mcpwm_oper_handle_t oper, const mcpwm_comparator_config_t*, mcpwm_cmpr_handle_t* out) {
+    *out = new sim_mcpwm_cmpr{ oper, 0 };
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_comparator(mcpwm_cmpr_handle_t cmpr) {
+    delete cmpr;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_comparator_set_compare_value(mcpwm_cmpr_handle_t cmpr, uint32_t ticks) {
+    if (cmpr->oper->timer && ticks > cmpr->oper->timer->period) return ESP_ERR_INVALID_ARG;
+    cmpr->value = ticks;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_generator(mcpwm_oper_handle_t oper, const mcpwm_generator_config_t* config, mcpwm_gen_handle_t* out) {
+    if (!valid_pin(config->gen_gpio_num)) return ESP_ERR_INVALID_ARG;
+    sim_mcpwm_gen* gen = new sim_mcpwm_gen{ oper, nullptr, config->gen_gpio_num, -1, nullptr, false };
+    generators.push_back(gen);
+    pins[gen->gpio].route = Route::Mcpwm;
+    pins[gen->gpio].source = (int)generators.size() - 1;
+    *out = gen;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_generator(mcpwm_gen_handle_t gen) {
+    for (size_t i = 0; i < generators.size(); i++) {
+        if (generators[i] == gen) generators[i] = nullptr;
+    }
+    if (pins[gen->gpio].route == Route::Mcpwm) pins[gen->gpio].route = Route::Gpio;
+    delete gen;
+    return ESP_OK;
+}
+
+// Only the pattern l298n uses is modelled: high on timer empty, low on compare
+esp_err_t mcpwm_generator_set_action_on_timer_event(mcpwm_gen_handle_t, mcpwm_gen_timer_event_action_t) {
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_generator_set_action_on_compare_event(mcpwm_gen_handle_t gen, mcpwm_gen_compare_event_action_t action) {
+    gen->cmpr = action.comparator;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_generator_set_force_level(mcpwm_gen_handle_t gen, int level, bool) {
+    gen->force = level;
+    return ESP_OK;
+}
+
+// Dead time itself (~1 us) is below the simulation step and is ignored
+esp_err_t mcpwm_generator_set_dead_time(mcpwm_gen_handle_t in, mcpwm_gen_handle_t out, const mcpwm_dead_time_config_t* config) {
+    if (in != out) {
+        out->source = in;
+        out->invert = config->flags.invert_output;
+    }
+    return ESP_OK;
+}
+
+static int mcpwm_level(const sim_mcpwm_gen* gen) {
+    if (!gen) return 0;
+    if (gen->source) {
+        int level = mcpwm_level(gen->source);
+        return gen->invert ? !level : level;
+    }
+    if (gen->force >= 0) return gen->force;
+    const sim_mcpwm_timer* t = gen->oper ? gen->oper->timer : nullptr;
+    if (!t || !t->running || !gen->cmpr) return 0;
+    uint64_t ticks = (uint64_t)clock_us * t->resolution_hz / 1000000 + t->phase;
+    return ticks % t->period < gen->cmpr->value ? 1 : 0;
+}
+
+// ---- NVS ----
+
+typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+static std::map<std::string, Namespace> nvs_store;
+static std::vector<std::string> nvs_handles;
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* out) {
+    if (mode == NVS_READONLY && nvs_store.find(ns) == nvs_store.end()) return ESP_ERR_NVS_NOT_FOUND;
+    nvs_store[ns];
+    nvs_handles.push_back(ns);
+    *out = (nvs_handle_t)nvs_handles.size();
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t) {
+}
+
+esp_err_t nvs_commit(nvs_handle_t) {
+    return ESP_OK;
+}
+
+static Namespace* nvs_namespace(nvs_handle_t handle) {
+    if (handle == 0 || handle > nvs_handles.size()) return nullptr;
+    return &nvs_store[nvs_handles[handle - 1]];
+}
+
+static esp_err_t nvs_get(nvs_handle_t handle, const char* key, void* out, size_t* len, bool exact) {
+    Namespace* ns = nvs_namespace(handle);
+    if (!ns) return ESP_ERR_INVALID_ARG;
+    auto it = ns->find(key);
+    if (it == ns->end()) return ESP_ERR_NVS_NOT_FOUND;
+    if (exact ? *len != it->second.size() : *len < it->second.size()) return ESP_ERR_INVALID_ARG;
+    memcpy(out, it->second.data(), it->second.size());
+    *len = it->second.size();
+    return ESP_OK;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char* key, const void* value, size_t len) {
+    Namespace* ns = nvs_namespace(handle);
+    if (!ns) return ESP_ERR_INVALID_ARG;
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    (*ns)[key] = std::vector<uint8_t>(bytes, bytes + len);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out, size_t* len) {
+    return nvs_get(handle, key, out, len, false);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t len) {
+    return nvs_set(handle, key, value, len);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out, size_t* len) {
+    return nvs_get(handle, key, out, len, false);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    return nvs_set(handle, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out) {
+    size_t len = sizeof(*out);
+    return nvs_get(handle, key, out, &len, true);
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+    return nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out) {
+    size_t len = sizeof(*out);
+    return nvs_get(handle, key, out, &len, true);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+    return nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    Namespace* ns = nvs_namespace(handle);
+    if (!ns) return ESP_ERR_INVALID_ARG;
+    return ns->erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+// ---- ADC continuous driver and digital monitor ----
+//
+// Conversions at sample_freq_hz walk the pattern. The monitor compares every
+// result of its channel and calls back per conversion past a threshold; the
+// result, a type2 record, goes into the current frame. A full frame enters the
+// pool and on_conv_done fires, or on_pool_ovf when the pool is full (the frame
+// is lost). Conversions happen in pollAdc(): the pin voltage comes from the
+// harness source, plus Gaussian noise in codes, on the linear 0..3300 mV
+// transfer.
+
+struct sim_adc_monitor {
+    sim_adc_continuous* adc;
+    adc_monitor_config_t config;
+    adc_monitor_evt_cbs_t cbs;
+    void* user_data;
+    bool enabled;
+};
+
+struct sim_adc_continuous {
+    uint32_t frame_bytes;
+    size_t pool_frames;
+    std::vector<adc_digi_pattern_config_t> pattern;
+    uint32_t freq_hz;
+    adc_continuous_evt_cbs_t cbs;
+    void* user_data;
+    sim_adc_monitor* monitor;
+    bool started;
+    int64_t started_us;
+    uint64_t converted;             // Since start
+    std::vector<uint8_t> frame;
+    std::deque<std::vector<uint8_t>> pool;
+};
+
+static const int32_t ADC_MAX_CODE = 4095;
+static const int32_t ADC_FULL_SCALE_MV = 3300;
+static sim_adc_continuous* adc = nullptr;   // One DMA ADC on the chip
+static sim::AnalogSource analog_source = nullptr;
+static void* analog_ctx = nullptr;
+static double noise_sigma = 2.0;
+static std::mt19937 noise_rng(1);
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t* config, adc_continuous_handle_t* out) {
+    if (adc) return ESP_ERR_INVALID_STATE;
+    if (config->conv_frame_size == 0 || config->conv_frame_size % SOC_ADC_DIGI_RESULT_BYTES != 0 ||
+        config->max_store_buf_size < config->conv_frame_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    adc = new sim_adc_continuous();
+    adc->frame_bytes = config->conv_frame_size;
+    adc->pool_frames = config->max_store_buf_size / config->conv_frame_size;
+    *out = adc;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t* config) {
+    if (handle->started) return ESP_ERR_INVALID_STATE;
+    if (config->pattern_num == 0 || config->pattern_num > SOC_ADC_PATT_LEN_MAX ||
+        config->sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW || config->sample_freq_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH ||
+        config->format != ADC_DIGI_OUTPUT_FORMAT_TYPE2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    handle->pattern.assign(config->adc_pattern, config->adc_pattern + config->pattern_num);
+    handle->freq_hz = config->sample_freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t handle, const adc_continuous_evt_cbs_t* cbs,
+                                                  void* user_data) {
+    if (handle->started) return ESP_ERR_INVALID_STATE;
+    handle->cbs = *cbs;
+    handle->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle) {
+    if (handle->started || handle->pattern.empty()) return ESP_ERR_INVALID_STATE;
+    handle->started = true;
+    handle->started_us = clock_us;
+    handle->converted = 0;
+    handle->frame.clear();
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_stop(adc_continuous_handle_t handle) {
+    if (!handle->started) return ESP_ERR_INVALID_STATE;
+    handle->started = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t handle) {
+    if (handle->started) return ESP_ERR_INVALID_STATE;
+    if (handle->monitor) handle->monitor->adc = nullptr;
+    if (adc == handle) adc = nullptr;
+    delete handle;
+    return ESP_OK;
+}
+
+// No waiting: an empty pool answers ESP_ERR_TIMEOUT whatever timeout_ms is
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t* buf, uint32_t length_max, uint32_t* out_length,
+                              uint32_t) {
+    if (handle->pool.empty()) return ESP_ERR_TIMEOUT;
+    std::vector<uint8_t>& frame = handle->pool.front();
+    uint32_t n = frame.size() < length_max ? (uint32_t)frame.size() : length_max;
+    memcpy(buf, frame.data(), n);
+    if (n == frame.size()) handle->pool.pop_front();
+    else frame.erase(frame.begin(), frame.begin() + n);
+    *out_length = n;
+    return ESP_OK;
+}
+
+esp_err_t adc_new_continuous_monitor(adc_continuous_handle_t handle, const adc_monitor_config_t* config,
+                                     adc_monitor_handle_t* out) {
+    if (handle->started) return ESP_ERR_INVALID_STATE;
+    if (handle->monitor) return ESP_ERR_NOT_FOUND;
+    handle->monitor = new sim_adc_monitor{ handle, *config, {}, nullptr, false };
+    *out = handle->monitor;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_monitor_register_event_callbacks(adc_monitor_handle_t monitor, const adc_monitor_evt_cbs_t* cbs,
+                                                          void* user_data) {
+    monitor->cbs = *cbs;
+    monitor->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_monitor_enable(adc_monitor_handle_t monitor) {
+    monitor->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_monitor_disable(adc_monitor_handle_t monitor) {
+    monitor->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_del_continuous_monitor(adc_monitor_handle_t monitor) {
+    if (monitor->enabled) return ESP_ERR_INVALID_STATE;
+    if (monitor->adc) monitor->adc->monitor = nullptr;
+    delete monitor;
+    return ESP_OK;
+}
+
+static uint16_t adc_convert(adc_channel_t channel, int64_t t_us) {
+    int32_t mv = analog_source ? analog_source(channel, t_us, analog_ctx) : 0;
+    std::normal_distribution<double> noise(0.0, noise_sigma);
+    double code = (double)mv * ADC_MAX_CODE / ADC_FULL_SCALE_MV + (noise_sigma > 0 ? noise(noise_rng) : 0.0);
+    long rounded = lround(code);
+    return (uint16_t)(rounded < 0 ? 0 : rounded > ADC_MAX_CODE ? ADC_MAX_CODE : rounded);
+}
+
+// One conversion; true when a driver callback ran
+static bool adc_conversion(sim_adc_continuous* a, const adc_digi_pattern_config_t& slot, uint16_t code) {
+    bool called = false;
+    sim_adc_monitor* m = a->monitor;
+    if (m && m->enabled && m->config.channel == slot.channel) {
+        static const adc_monitor_evt_data_t event = {};
+        if (m->config.h_threshold >= 0 && code > m->config.h_threshold && m->cbs.on_over_high_thresh) {
+            m->cbs.on_over_high_thresh(m, &event, m->user_data);
+            called = true;
+        } else if (m->config.l_threshold >= 0 && code < m->config.l_threshold && m->cbs.on_below_low_thresh) {
+            m->cbs.on_below_low_thresh(m, &event, m->user_data);
+            called = true;
+        }
+    }
+
+    adc_digi_output_data_t result = {};
+    result.type2.data = code;
+    result.type2.channel = slot.channel;
+    result.type2.unit = slot.unit;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&result.val);
+    a->frame.insert(a->frame.end(), bytes, bytes + SOC_ADC_DIGI_RESULT_BYTES);
+    if (a->frame.size() < a->frame_bytes) return called;
+
+    if (a->pool.size() == a->pool_frames) {
+        adc_continuous_evt_data_t event = { nullptr, 0 };
+        if (a->cbs.on_pool_ovf) a->cbs.on_pool_ovf(a, &event, a->user_data);
+    } else {
+        a->pool.push_back(a->frame);
+        adc_continuous_evt_data_t event = { a->pool.back().data(), (uint32_t)a->pool.back().size() };
+        if (a->cbs.on_conv_done) a->cbs.on_conv_done(a, &event, a->user_data);
+    }
+    a->frame.clear();
+    return true;
+}
+
+// ---- ADC calibration: a chip with eFuse coefficients whose curve is the ----
+// simulated ADC's own linear transfer, so adc_cal builds exact tables (its
+// no-eFuse fallback carries the hand-tuned factors of the real board)
+
+struct sim_adc_cali {
+    int unused;
+};
+
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t*, adc_cali_handle_t* out) {
+    static sim_adc_cali scheme;
+    *out = &scheme;
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_delete_scheme_curve_fitting(adc_cali_handle_t) {
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t, int raw, int* mv) {
+    *mv = (raw * 3300 + 4095 / 2) / 4095;
+    return ESP_OK;
+}
+
+// ---- Harness API ----
+
+// Earliest timer deadline or task timeout up to limit_us: the clock moves
+// there and the callback runs, or the task wakes; false - nothing due
+static bool step(int64_t limit_us) {
+    sim_timer* timer = nullptr;
+    for (sim_timer* t : timers) {
+        if (t->active && t->deadline <= limit_us && (!timer || t->deadline < timer->deadline)) timer = t;
+    }
+    idf_task* task = nullptr;
+    for (idf_task* t : tasks) {
+        if (!t->ready && !t->done && t->wake_us >= 0 && t->wake_us <= limit_us &&
+            (!task || t->wake_us < task->wake_us)) {
+            task = t;
+        }
+    }
+    if (task && (!timer || task->wake_us < timer->deadline)) {
+        if (task->wake_us > clock_us) clock_us = task->wake_us;
+        wake(task);
+        run_ready();
+        return true;
+    }
+    if (!timer) return false;
+    if (timer->deadline > clock_us) clock_us = timer->deadline;
+    if (timer->period) timer->deadline += timer->period;
+    else timer->active = false;
+    callbacks++;
+    timer->callback(timer->arg);
+    run_ready();
+    return true;
+}
+
+namespace sim {
+    int64_t now() {
+        return clock_us;
+    }
+
+    void advanceTo(int64_t t_us) {
+        while (step(t_us)) {
+        }
+        if (t_us > clock_us) clock_us = t_us;
+    }
+
+    uint64_t timerCallbacks() {
+        return callbacks;
+    }
+
+    int pinLevel(int gpio) {
+        if (!valid_pin(gpio)) return 0;
+        const Pin& pin = pins[gpio];
+        switch (pin.route) {
+            case Route::Ledc: return ledc_level(pin.source);
+            case Route::Mcpwm: return mcpwm_level(generators[pin.source]);
+            default: return pin.level;
+        }
+    }
+
+    void setAnalogSource(AnalogSource source, void* ctx) {
+        analog_source = source;
+        analog_ctx = ctx;
+    }
+
+    void setAdcNoise(double sigma_codes, uint32_t seed) {
+        noise_sigma = sigma_codes;
+        noise_rng.seed(seed);
+    }
+
+    // A task woken by a callback may stop or recreate the driver: the handle
+    // is looked up again after each callback
+    void pollAdc() {
+        while (adc && adc->started) {
+            sim_adc_continuous* a = adc;
+            uint64_t due = (uint64_t)(clock_us - a->started_us) * a->freq_hz / 1000000;
+            if (a->converted >= due) break;
+            int64_t t_us = a->started_us + (int64_t)(a->converted * 1000000 / a->freq_hz);
+            const adc_digi_pattern_config_t& slot = a->pattern[a->converted % a->pattern.size()];
+            a->converted++;
+            if (adc_conversion(a, slot, adc_convert((adc_channel_t)slot.channel, t_us))) run_ready();
+        }
+    }
+}
@@ -0,0 +1,40 @@
+// Harness side of the simulation backend (see tools/idf/idf.h and sim.cpp):
+// virtual clock, pin levels driven by the simulated LEDC / MCPWM / GPIO
+// peripherals and the ADC DMA driver behind adc_sampler. Log level:
+// idf::setLogLevel().
+#ifndef SIM_H
+#define SIM_H
+
+#include "idf.h"
+#include <cstdint>
+
+namespace sim {
+    // ---- Clock, timers and tasks ----
+    int64_t now();
+
+    // Runs every esp_timer callback and task timeout due up to t_us in time
+    // order (the clock reads the deadline meanwhile), and the tasks they make
+    // ready, then sets the clock to t_us
+    void advanceTo(int64_t t_us);
+    uint64_t timerCallbacks();          // Callbacks run since start
+
+    // ---- Pins ----
+    // Output level of a pin right now: plain GPIO level, or the LEDC channel /
+    // MCPWM generator routed to it (esp_rom_gpio_connect_out_signal with
+    // SIG_GPIO_OUT_IDX detaches the pin back to GPIO, as on the chip)
+    int pinLevel(int gpio);
+
+    // ---- ADC (adc_continuous driver) ----
+    // Pin voltage of a channel at time t_us; the ADC adds its own noise and
+    // quantizes with the linear 0..3300 mV -> 0..4095 transfer
+    typedef int32_t (*AnalogSource)(adc_channel_t channel, int64_t t_us, void* ctx);
+    void setAnalogSource(AnalogSource source, void* ctx);
+    void setAdcNoise(double sigma_codes, uint32_t seed);
+
+    // Takes every conversion due up to the current time: monitor callbacks fire
+    // per conversion, full frames wake the adc_sampler task, which runs its
+    // filter chains and listeners before pollAdc() returns
+    void pollAdc();
+}
+
+#endif
@@ -0,0 +1,151 @@
+// Run the firmware spectrum analysis (src/fft.cpp) over a recorded current trace on the host.
+//
+// Build:
+//     g++ -O2 -std=c++17 -Isrc tools/spectrum_trace.cpp src/fft.cpp -o spectrum_trace
+//
+// Record a trace of the ACS712 channel (one raw 12-bit code per line, '#' lines are ignored):
+//     curl -s 'http://192.168.6.1/api/adc/raw?channel=5' > current.txt
+//
+// Usage:
+//     spectrum_trace [--rate HZ] [--size N] [--check] [--bench] <trace|->
+//
+// Prints dominant frequency, AC RMS and band RMS for every full block of N samples
+// (amplitudes in ADC codes). --check compares the fixed-point spectrum of the first
+// block against a double-precision DFT. --bench reports the cost of one block.
+#include "fft.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Same bands as the device (src/spectrum.cpp)
+static const fft::Band BANDS[] = {
+    { "mechanical", 1, 100 },
+    { "pwm", 100, 500 },
+    { "harmonics", 500, 2000 },
+    { "high", 2000, 1000000 },
+};
+static const size_t BAND_COUNT = sizeof(BANDS) / sizeof(BANDS[0]);
+
+static bool load_trace(const char* path, std::vector<uint16_t>& trace) {
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char line[64];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        trace.push_back((uint16_t)strtol(line, nullptr, 10));
+    }
+    if (f != stdin) fclose(f);
+    return true;
+}
+
+static double codes(uint32_t value) {
+    return value / double(1 << fft::FRAC_BITS);
+}
+
+// Fixed-point bins vs a direct DFT of the same windowed block
+static void check(const fft::Plan& plan, const uint16_t* block, std::vector<int32_t>& work) {
+    const size_t n = plan.size;
+    double mean = 0;
+    for (size_t i = 0; i < n; i++) mean += block[i];
+    mean /= n;
+    std::vector<double> x(n);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = (block[i] - mean) * (1 << fft::FRAC_BITS) * (0.5 * (1 - cos(2 * M_PI * i / n)));
+    }
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += block[i];
+    int32_t dc = (int32_t)((sum << fft::FRAC_BITS) / (int64_t)n);
+    for (size_t i = 0; i < n; i++) {
+        work[i] = (int32_t)(((int64_t)(((int32_t)block[i] << fft::FRAC_BITS) - dc) * plan.window[i]) >> 15);
+    }
+    fft::realForward(plan, work.data());
+
+    double peak = 0, max_error = 0;
+    size_t worst = 0;
+    std::vector<double> re(n / 2), im(n / 2);
+    for (size_t k = 1; k < n / 2; k++) {
+        for (size_t i = 0; i < n; i++) {
+            re[k] += x[i] * cos(2 * M_PI * k * i / n);
+            im[k] -= x[i] * sin(2 * M_PI * k * i / n);
+        }
+        peak = std::max(peak, std::hypot(re[k], im[k]));
+    }
+    for (size_t k = 1; k < n / 2; k++) {
+        double error = std::hypot(work[2 * k] - re[k], work[2 * k + 1] - im[k]);
+        if (error > max_error) {
+            max_error = error;
+            worst = k;
+        }
+    }
+    fprintf(stderr, "check   max bin error %.1f at k=%zu, peak |X| %.0f, error/peak %.2e (%.1f dB)\n",
+            max_error, worst, peak, max_error / peak, 20 * log10(max_error / peak));
+}
+
+int main(int argc, char** argv) {
+    uint32_t rate = 10000;
+    size_t size = 1024;
+    bool bench = false;
+    bool verify = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) bench = true;
+        else if (strcmp(argv[i], "--check") == 0) verify = true;
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) rate = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) size = (size_t)atoi(argv[++i]);
+        else if (!path) path = argv[i];
+    }
+    if (!path || rate == 0) {
+        fprintf(stderr, "usage: %s [--rate HZ] [--size N] [--check] [--bench] <trace|->\n", argv[0]);
+        return 2;
+    }
+
+    static fft::Plan plan;
+    if (!fft::init(plan, size)) {
+        fprintf(stderr, "size must be a power of two in %zu..%zu\n", fft::MIN_SIZE, fft::MAX_SIZE);
+        return 2;
+    }
+    std::vector<uint16_t> trace;
+    if (!load_trace(path, trace)) return 1;
+    if (trace.size() < size) {
+        fprintf(stderr, "trace has %zu samples, need at least %zu\n", trace.size(), size);
+        return 1;
+    }
+
+    std::vector<int32_t> work(size);
+    fft::Result result;
+    printf("# block dominant_hz amplitude rms");
+    for (size_t b = 0; b < BAND_COUNT; b++) printf(" %s", BANDS[b].name);
+    printf("\n");
+    for (size_t offset = 0; offset + size <= trace.size(); offset += size) {
+        fft::analyze(plan, trace.data() + offset, rate, BANDS, BAND_COUNT, work.data(), &result);
+        printf("%zu %.2f %.2f %.2f", offset / size, result.dominant_hz_x100 / 100.0,
+               codes(result.dominant_amplitude), codes(result.rms));
+        for (size_t b = 0; b < BAND_COUNT; b++) printf(" %.2f", codes(result.band_rms[b]));
+        printf("\n");
+    }
+    fprintf(stderr, "blocks  %zu x %zu samples at %u Hz, %.2f Hz per bin\n",
+            trace.size() / size, size, rate, result.bin_hz_x100 / 100.0);
+
+    if (verify) check(plan, trace.data(), work);
+
+    if (bench) {
+        const size_t rounds = 20000000 / size + 1;
+        uint64_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; r++) {
+            fft::analyze(plan, trace.data(), rate, BANDS, BAND_COUNT, work.data(), &result);
+            sink += result.dominant_hz_x100;
+        }
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        fprintf(stderr, "bench   %zu blocks  %.2f us/block  (checksum %llu)\n",
+                rounds, elapsed / rounds, (unsigned long long)sink);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Time the firmware telemetry encoder (src/telemetry_codec.cpp, src/cbor.cpp) on the host:
+// one /api/telemetry batch encoded as JSON, CBOR and binary records through a
+// 512-byte chunked sink, as the HTTP handler does.
+//
+// Build:
+//     g++ -O2 -std=c++17 -Isrc tools/telemetry_bench.cpp src/telemetry_codec.cpp src/cbor.cpp -o telemetry_bench
+//
+// Usage:
+//     telemetry_bench [-n SAMPLES] [--rounds N] [--chunk BYTES] [--dump json|cbor|bin]
+//
+// -n defaults to the device history depth (256). --dump writes one encoded batch
+// to stdout instead of timing, e.g. to check it against the Python decoder:
+//     telemetry_bench --dump cbor | tools/telemetry_codec.py decode - --format cbor
+//
+// Times are host wall-clock; the ESP32-C6 runs the same code ~10-20x slower.
+// `telemetry_codec.py bench` times its Python codecs, not this encoder.
+#include "telemetry_codec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Options {
+    size_t samples;
+    int rounds;
+    size_t chunk;
+    const char* dump;
+};
+
+struct Counter {
+    size_t bytes;
+    size_t chunks;
+    FILE* out;
+};
+
+static const char* FORMAT_NAMES[] = { "json", "cbor", "bin" };
+static const telemetry_codec::Format FORMATS[] = {
+    telemetry_codec::Format::Json, telemetry_codec::Format::Cbor, telemetry_codec::Format::Binary,
+};
+
+static void usage() {
+    fprintf(stderr, "usage: telemetry_bench [-n SAMPLES] [--rounds N] [--chunk BYTES] [--dump json|cbor|bin]\n");
+    exit(2);
+}
+
+static Options parse_options(int argc, char** argv) {
+    Options opt = { 256, 2000, 512, NULL };
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strcmp(a, "-n") == 0 && i + 1 < argc) opt.samples = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(a, "--rounds") == 0 && i + 1 < argc) opt.rounds = atoi(argv[++i]);
+        else if (strcmp(a, "--chunk") == 0 && i + 1 < argc) opt.chunk = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(a, "--dump") == 0 && i + 1 < argc) opt.dump = argv[++i];
+        else usage();
+    }
+    if (opt.samples == 0 || opt.rounds <= 0 || opt.chunk < 16) usage();
+    return opt;
+}
+
+// Same shape as the device history: 100 ms period with jitter, divider mV and current mA
+static std::vector<telemetry_codec::Sample> synthetic_batch(size_t n) {
+    static const int32_t BASE[] = { 12800, 1500 };
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> jitter(-2, 2);
+    std::uniform_int_distribution<int> noise(-40, 40);
+    std::vector<telemetry_codec::Sample> samples(n);
+    uint32_t t = 123456;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0) t += 100 + jitter(rng);
+        samples[i].t_ms = t;
+        for (size_t c = 0; c < telemetry_codec::CHANNELS; c++) {
+            samples[i].values[c] = BASE[c % 2] + noise(rng);
+        }
+    }
+    return samples;
+}
+
+static bool count_chunk(void* ctx, const uint8_t* data, size_t len) {
+    Counter* counter = static_cast<Counter*>(ctx);
+    counter->bytes += len;
+    counter->chunks++;
+    if (counter->out) fwrite(data, 1, len, counter->out);
+    return true;
+}
+
+static bool encode(telemetry_codec::Format format, const std::vector<telemetry_codec::Sample>& samples,
+                   std::vector<uint8_t>& buf, Counter* counter) {
+    cbor::Sink sink;
+    cbor::sinkInit(sink, buf.data(), buf.size(), count_chunk, counter);
+    telemetry_codec::encodeBatch(format, samples.data(), samples.size(), sink);
+    return cbor::finish(sink);
+}
+
+int main(int argc, char** argv) {
+    Options opt = parse_options(argc, argv);
+    std::vector<telemetry_codec::Sample> samples = synthetic_batch(opt.samples);
+    std::vector<uint8_t> buf(opt.chunk);
+
+    if (opt.dump) {
+        telemetry_codec::Format format;
+        if (!telemetry_codec::fromName(opt.dump, &format)) usage();
+        Counter counter = { 0, 0, stdout };
+        return encode(format, samples, buf, &counter) ? 0 : 1;
+    }
+
+    printf("%zu samples x %zu channels, %d rounds, %zu-byte chunks\n",
+           opt.samples, telemetry_codec::CHANNELS, opt.rounds, opt.chunk);
+    printf("%-6s %7s %8s %7s %10s\n", "format", "bytes", "vs json", "chunks", "encode us");
+    size_t json_bytes = 0;
+    for (size_t f = 0; f < sizeof(FORMATS) / sizeof(FORMATS[0]); f++) {
+        Counter counter = { 0, 0, NULL };
+        if (!encode(FORMATS[f], samples, buf, &counter)) {
+            fprintf(stderr, "%s: encoding failed\n", FORMAT_NAMES[f]);
+            return 1;
+        }
+        if (json_bytes == 0) json_bytes = counter.bytes;
+
+        Counter scratch = { 0, 0, NULL };
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < opt.rounds; i++) encode(FORMATS[f], samples, buf, &scratch);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%-6s %7zu %8.2f %7zu %10.2f\n", FORMAT_NAMES[f], counter.bytes,
+               (double)counter.bytes / json_bytes, counter.chunks, us / opt.rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""Decode device telemetry batches and compare JSON, CBOR and binary encodings.
+
+The device serves /api/telemetry as JSON (default), CBOR (Accept:
+application/cbor or ?format=cbor) or a fixed little-endian record format
+(Accept: application/octet-stream or ?format=bin). All three carry the same
+batch: a start timestamp, channel names, per-sample time deltas and integer
+channel values (mV, mA).
+
+Binary layout (see src/telemetry_codec.h):
+    header: magic "ET", version u8, channels u8, count u16, reserved u16, t0_ms u32
+    record: dt_ms u16, value int16 x channels
+
+Examples:
+    telemetry_codec.py fetch 192.168.6.1 --format cbor -n 50
+    telemetry_codec.py fetch 192.168.6.1 --compare
+    telemetry_bench --dump bin | telemetry_codec.py decode - --format bin
+    telemetry_codec.py bench -n 256 --channels 2
+
+`bench` times the Python codecs in this file. Its sizes match the device, but
+its times are Python codec-only estimates, not the firmware encoder. For the
+C++ encoder (src/telemetry_codec.cpp) use tools/telemetry_bench.cpp.
+"""
+import argparse
+import json
+import random
+import struct
+import sys
+import time
+import urllib.request
+
+BINARY_MAGIC = b"ET"
+BINARY_HEADER = struct.Struct("<2sBBHHI")
+CONTENT_TYPES = {"json": "application/json", "cbor": "application/cbor",
+                 "bin": "application/octet-stream"}
+
+
+# ---- CBOR (the subset the device emits: ints, text, arrays, maps, bools) ----
+
+def _cbor_head(major, value):
+    if value < 24:
+        return bytes([major << 5 | value])
+    for info, fmt in ((24, ">B"), (25, ">H"), (26, ">I"), (27, ">Q")):
+        if value < 1 << (8 * struct.calcsize(fmt)):
+            return bytes([major << 5 | info]) + struct.pack(fmt, value)
+    raise ValueError("integer too large")
+
+
+def cbor_encode(obj):
+    if isinstance(obj, bool):
+        return b"\xf5" if obj else b"\xf4"
+    if isinstance(obj, int):
+        return _cbor_head(0, obj) if obj >= 0 else _cbor_head(1, -1 - obj)
+    if isinstance(obj, str):
+        data = obj.encode()
+        return _cbor_head(3, len(data)) + data
+    if isinstance(obj, (list, tuple)):
+        return _cbor_head(4, len(obj)) + b"".join(cbor_encode(x) for x in obj)
+    if isinstance(obj, dict):
+        return _cbor_head(5, len(obj)) + b"".join(
+            cbor_encode(k) + cbor_encode(v) for k, v in obj.items())
+    raise TypeError(f"cannot encode {type(obj).__name__}")
+
+
+def cbor_decode(data):
+    def item(pos):
+        initial = data[pos]
+        major, info = initial >> 5, initial & 0x1f
+        pos += 1
+        if major == 7:
+            if info in (20, 21):
+                return info == 21, pos
+            raise ValueError(f"unsupported simple value {info}")
+        if info < 24:
+            arg = info
+        elif info <= 27:
+            size = 1 << (info - 24)
+            arg = int.from_bytes(data[pos:pos + size], "big")
+            pos += size
+        else:
+            raise ValueError("indefinite lengths are not supported")
+        if major == 0:
+            return arg, pos
+        if major == 1:
+            return -1 - arg, pos
+        if major == 2:
+            return bytes(data[pos:pos + arg]), pos + arg
+        if major == 3:
+            return data[pos:pos + arg].decode(), pos + arg
+        if major == 4:
+            out = []
+            for _ in range(arg):
+                value, pos = item(pos)
+                out.append(value)
+            return out, pos
+        if major == 5:
+            out = {}
+            for _ in range(arg):
+                key, pos = item(pos)
+                out[key], pos = item(pos)
+            return out, pos
+        raise ValueError(f"unsupported major type {major}")
+
+    value, end = item(0)
+    if end != len(data):
+        raise ValueError(f"{len(data) - end} trailing bytes")
+    return value
+
+
+# ---- binary record format ----
+
+def binary_encode(batch):
+    channels, dts, values = batch["ch"], batch["dt"], batch["v"]
+    out = [BINARY_HEADER.pack(BINARY_MAGIC, 1, len(channels), len(dts), 0, batch["t0"])]
+    record = struct.Struct("<H" + "h" * len(channels))
+    for i, dt in enumerate(dts):
+        row = [max(-32768, min(32767, values[c][i])) for c in range(len(channels))]
+        out.append(record.pack(min(dt, 0xffff), *row))
+    return b"".join(out)
+
+
+def binary_decode(data, names=None):
+    magic, version, nch, count, _, t0 = BINARY_HEADER.unpack_from(data)
+    if magic != BINARY_MAGIC or version != 1:
+        raise ValueError("not a telemetry record stream")
+    record = struct.Struct("<H" + "h" * nch)
+    if len(data) != BINARY_HEADER.size + count * record.size:
+        raise ValueError("length does not match header")
+    dts, values = [], [[] for _ in range(nch)]
+    for fields in record.iter_unpack(data[BINARY_HEADER.size:]):
+        dts.append(fields[0])
+        for c in range(nch):
+            values[c].append(fields[1 + c])
+    # Channel names are not carried in the binary form
+    return {"t0": t0, "ch": names or [f"ch{c}" for c in range(nch)], "dt": dts, "v": values}
+
+
+def decode(fmt, data):
+    if fmt == "cbor":
+        return cbor_decode(data)
+    if fmt == "bin":
+        return binary_decode(data)
+    return json.loads(data)
+
+
+def to_rows(batch):
+    """Expand a batch into (t_ms, {channel: value}) rows with absolute time."""
+    t = batch["t0"]
+    for i, dt in enumerate(batch["dt"]):
+        t += dt
+        yield t, {name: batch["v"][c][i] for c, name in enumerate(batch["ch"])}
+
+
+# ---- commands ----
+
+def fetch(host, fmt, n):
+    url = f"http://{host}/api/telemetry" + (f"?n={n}" if n else "")
+    req = urllib.request.Request(url, headers={"Accept": CONTENT_TYPES[fmt]})
+    with urllib.request.urlopen(req, timeout=10) as resp:
+        return resp.read()
+
+
+def print_rows(batch):
+    for t, values in to_rows(batch):
+        print(t, " ".join(f"{k}={v}" for k, v in values.items()))
+
+
+def cmd_fetch(args):
+    formats = list(CONTENT_TYPES) if args.compare else [args.format]
+    for fmt in formats:
+        start = time.perf_counter()
+        data = fetch(args.host, fmt, args.n)
+        elapsed = (time.perf_counter() - start) * 1000
+        batch = decode(fmt, data)
+        print(f"{fmt:5} {len(data):6} bytes  {len(batch['dt']):4} samples  {elapsed:7.1f} ms")
+    if not args.compare:
+        print_rows(batch)
+
+
+def cmd_decode(args):
+    if args.file == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    batch = decode(args.format, data)
+    print(f"{args.format:5} {len(data):6} bytes  {len(batch['dt']):4} samples")
+    print_rows(batch)
+
+
+def synthetic_batch(n, channels, period_ms):
+    rng = random.Random(1)
+    base = [12800, 1500, 3300, 500]
+    dts = [0] + [period_ms + rng.randint(-2, 2) for _ in range(n - 1)]
+    values = [[base[c % 4] + rng.randint(-40, 40) for _ in range(n)] for c in range(channels)]
+    return {"t0": 123456, "ch": [f"ch{c}" for c in range(channels)], "dt": dts, "v": values}
+
+
+def bench(func, rounds):
+    start = time.perf_counter()
+    for _ in range(rounds):
+        func()
+    return (time.perf_counter() - start) / rounds * 1e6
+
+
+def cmd_bench(args):
+    batch = synthetic_batch(args.n, args.channels, args.period)
+    codecs = {
+        "json": (lambda b: json.dumps(b, separators=(",", ":")).encode(), json.loads),
+        "cbor": (cbor_encode, cbor_decode),
+        "bin": (binary_encode, lambda d: binary_decode(d, batch["ch"])),
+    }
+    json_size = None
+    print(f"{args.n} samples x {args.channels} channels, {args.rounds} rounds "
+          "(Python codecs; device encoder: tools/telemetry_bench.cpp)")
+    print(f"{'format':6} {'bytes':>7} {'vs json':>8} {'encode us':>10} {'decode us':>10}")
+    for name, (enc, dec) in codecs.items():
+        data = enc(batch)
+        assert dec(data) == batch, f"{name} round-trip mismatch"
+        json_size = json_size or len(data)
+        enc_us = bench(lambda: enc(batch), args.rounds)
+        dec_us = bench(lambda: dec(data), args.rounds)
+        print(f"{name:6} {len(data):7} {len(data) / json_size:8.2f} {enc_us:10.1f} {dec_us:10.1f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("fetch", help="fetch and decode /api/telemetry from the device")
+    p.add_argument("host")
+    p.add_argument("-f", "--format", choices=CONTENT_TYPES, default="cbor")
+    p.add_argument("-n", type=int, default=0, help="number of latest samples (default: all)")
+    p.add_argument("--compare", action="store_true", help="fetch every format and compare sizes")
+    p.set_defaults(func=cmd_fetch)
+
+    p = sub.add_parser("decode", help="decode a saved batch, e.g. from telemetry_bench --dump")
+    p.add_argument("file", help="batch file, - for stdin")
+    p.add_argument("-f", "--format", choices=CONTENT_TYPES, default="cbor")
+    p.set_defaults(func=cmd_decode)
+
+    p = sub.add_parser("bench", help="size of each encoding and Python codec speed on synthetic data")
+    p.add_argument("-n", type=int, default=256, help="samples per batch")
+    p.add_argument("--channels", type=int, default=1)
+    p.add_argument("--period", type=int, default=100, help="sample period, ms")
+    p.add_argument("--rounds", type=int, default=200)
+    p.set_defaults(func=cmd_bench)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,37 @@
+const POLL_MS = 2000;
+
+function set(id, text) {
+  document.getElementById(id).textContent = text;
+}
+
+function parseMetrics(text) {
+  const metrics = {};
+  for (const line of text.split("\n")) {
+    if (!line || line.startsWith("#")) continue;
+    const space = line.lastIndexOf(" ");
+    metrics[line.slice(0, space)] = parseFloat(line.slice(space + 1));
+  }
+  return metrics;
+}
+
+async function poll() {
+  try {
+    const [v3, vr, metrics] = await Promise.all([
+      fetch("/api/voltage_3v3").then((r) => r.text()),
+      fetch("/api/voltage_r1_r2").then((r) => r.text()),
+      fetch("/metrics").then((r) => r.text()).then(parseMetrics),
+    ]);
+    set("voltage_3v3", v3 + " V");
+    set("voltage_r1_r2", vr + " V");
+    set("heap", Math.round(metrics["esp_heap_free_bytes"] / 1024) + " KiB");
+    set("rssi", "wifi_sta_rssi_dbm" in metrics ? metrics["wifi_sta_rssi_dbm"] + " dBm" : "-");
+    set("stations", metrics["wifi_ap_stations"] ?? "-");
+    set("uptime", Math.round(metrics["esp_uptime_seconds"] / 60) + " min");
+    set("status", "Updated " + new Date().toLocaleTimeString());
+  } catch (e) {
+    set("status", "Update failed: " + e);
+  }
+  setTimeout(poll, POLL_MS);
+}
+
+poll();